@@ -25,12 +25,11 @@ size_t getsizeof(TestConfigStreamType);
 size_t getstreamelems(RuntimeStreamConfig *sdata);
 size_t getstreambytes(RuntimeStreamConfig *sdata);
 
-int init_function(void* ptr, int state, TestConfigStreamType type, int dims, size_t* dimsizes, void* init_val, ...);
-
 int allocate_arrays(RuntimeStreamConfig *sdata);
 void release_arrays(RuntimeStreamConfig *sdata);
 
 int initialize_arrays(RuntimeStreamConfig *sdata);
+int initialize_range(RuntimeStreamConfig *sdata, void* ptr, size_t first, size_t count);
 int allocate_streams(RuntimeConfig* runcfg);
 
 int print_arrays(RuntimeStreamConfig *sdata);
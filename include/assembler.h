@@ -0,0 +1,53 @@
+#ifndef ASSEMBLER_H
+#define ASSEMBLER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bstrlib.h"
+#include "bstrlib_helper.h"
+
+/*
+ * Minimal in-process assembler for the Intel syntax subset used by the x86-64 kernels.
+ * It supports general purpose integer instructions, SSE/MMX moves and arithmetic and the
+ * VEX encoded xmm/ymm instructions. Everything else (e.g. zmm registers which require EVEX)
+ * is reported as -ENOTSUP, so the caller can fall back to the external compiler.
+ */
+
+#define ASM_SECTION_TEXT 0
+#define ASM_SECTION_DATA 1
+
+#define ASM_DATA_ALIGNMENT 64
+
+typedef enum {
+    ASM_OPERAND_NONE = 0,
+    ASM_OPERAND_REG,
+    ASM_OPERAND_MEM,
+    ASM_OPERAND_IMM,
+    ASM_OPERAND_LABEL,
+} AsmOperandType;
+
+typedef enum {
+    ASM_REGCLASS_GPR64 = 0,
+    ASM_REGCLASS_XMM,
+    ASM_REGCLASS_YMM,
+    ASM_REGCLASS_MM,
+} AsmRegClass;
+
+typedef struct {
+    AsmOperandType type;
+    AsmRegClass regclass;
+    int reg;
+    int base;
+    int index;
+    int scale;
+    int64_t disp;
+    int riprel;
+    bstring label;
+    int64_t imm;
+} AsmOperand;
+
+int assemble_code(struct bstrList* code, bstring funcname, void** buffer, size_t* size, void** function);
+int release_code(void* buffer, size_t size);
+
+#endif /* ASSEMBLER_H */
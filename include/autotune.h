@@ -0,0 +1,47 @@
+// autotune.h
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include <stdint.h>
+
+#include "bstrlib.h"
+#include "test_types.h"
+
+/* Upper limit of variants of one kernel, the product of the option counts of its tunables */
+#define AUTOTUNE_MAX_VARIANTS 256
+/* Runtime of each variant in seconds if the iterations are not given on the command line */
+#define AUTOTUNE_RUNTIME 0.1
+/* File in the kernel object cache folder with the fastest variant per machine and kernel */
+#define AUTOTUNE_CACHE_FILE "autotune"
+
+/* Number of variants of the tunables of a kernel, -EINVAL if it has none */
+int autotune_num_variants(TestConfig_t cfg);
+
+/*
+ * Selects the options of variant (0 to autotune_num_variants-1). The first tunable changes
+ * fastest, variant 0 selects the first option of all tunables, which is the default.
+ */
+int autotune_select(TestConfig_t cfg, int variant);
+
+/* Selected options as <name>=<option>,... in the order of the tunables */
+bstring autotune_variant_name(TestConfig_t cfg);
+/* Selects the options of a name created by autotune_variant_name */
+int autotune_apply(TestConfig_t cfg, const_bstring name);
+
+/*
+ * Hash of the CPU model lines of the first processor in cpuinfo and the number of hwthreads.
+ * Frequencies and other lines that change between runs are not part of it.
+ */
+int autotune_fingerprint(const_bstring cpuinfo, int hwthreads, uint64_t* fp);
+/* Fingerprint of this machine from /proc/cpuinfo */
+int autotune_machine_fingerprint(uint64_t* fp);
+
+/*
+ * The cache file has one line '<fingerprint> <kernel> <variant> <ns per iteration>' per machine
+ * and kernel. Loading selects the stored variant, -ENOENT if there is none or it does not match
+ * the tunables of the kernel anymore. Storing replaces the line of the machine and kernel.
+ */
+int autotune_load(const char* file, uint64_t fp, TestConfig_t cfg);
+int autotune_store(const char* file, uint64_t fp, TestConfig_t cfg, double ns_per_iter);
+
+#endif /* AUTOTUNE_H */
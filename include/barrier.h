@@ -0,0 +1,61 @@
+// barrier.h
+#ifndef BARRIER_H
+#define BARRIER_H
+
+#include "test_types.h"
+
+#define BARRIER_ALIGN 64
+/* Polls of a barrier flag before a waiting thread starts to yield the CPU */
+#define BARRIER_SPIN 10000
+/* Dissemination rounds, enough for 2^BARRIER_MAX_ROUNDS threads */
+#define BARRIER_MAX_ROUNDS 16
+#define BARRIER_BENCH_WARMUP 1000
+#define BARRIER_BENCH_ROUNDS 100000
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_RELAX() __asm__ __volatile__("pause" ::: "memory")
+#elif defined(__aarch64__)
+#define CPU_RELAX() __asm__ __volatile__("yield" ::: "memory")
+#else
+#define CPU_RELAX() __asm__ __volatile__("" ::: "memory")
+#endif
+
+/*
+ * Node of the combining tree. The last thread arriving at a node continues to the parent
+ * and releases the node after the parent released it. count and sense are on separate
+ * cache lines, so the waiting threads do not disturb the arriving ones.
+ */
+struct barrier_node {
+    int count __attribute__((aligned(BARRIER_ALIGN)));
+    int expected;
+    int parent;
+    int level;
+    int sense __attribute__((aligned(BARRIER_ALIGN)));
+};
+
+struct barrier_thread {
+    int sense __attribute__((aligned(BARRIER_ALIGN)));
+    int parity;
+    int leaf;
+    int flags[2][BARRIER_MAX_ROUNDS];
+};
+
+/*
+ * Barrier implementations for the threads of a workgroup:
+ *   pthread        - pthread_barrier_wait (default)
+ *   central        - sense-reversing counter shared by all threads
+ *   tree           - combining tree following the SMT, core and socket hierarchy
+ *   dissemination  - log2(n) rounds of pairwise flags
+ */
+int barrier_parse_type(const char* str, BarrierType* type);
+const char* barrier_type_name(BarrierType type);
+
+/* hwthreads is used to build the tree, it may be NULL for the other types */
+int barrier_init(thread_barrier_t* barrier, BarrierType type, int num_threads, const int* hwthreads);
+void barrier_wait(thread_barrier_t* barrier, int id);
+void barrier_destroy(thread_barrier_t* barrier);
+
+/* Latency of all barrier types on the hwthreads of a core, a socket and the whole system */
+int barrier_benchmark();
+
+#endif /* BARRIER_H */
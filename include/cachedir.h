@@ -0,0 +1,30 @@
+// cachedir.h
+#ifndef CACHEDIR_H
+#define CACHEDIR_H
+
+#include <stddef.h>
+
+/* Folder below $XDG_CACHE_HOME or ~/.cache for the kernel objects, tuned variants and timer state */
+#define CACHEDIR_NAME "likwid-bench"
+
+/*
+ * Writes the cache folder of the calling user to buf: $XDG_CACHE_HOME/likwid-bench if the
+ * variable is an absolute path, otherwise ~/.cache/likwid-bench. Returns -ENOENT if the user
+ * has no home folder and -ENAMETOOLONG if buf is too small.
+ */
+int cachedir_user_folder(char* buf, size_t len);
+
+/*
+ * Creates folder and its missing parents with mode 0700 and checks the folder like
+ * cachedir_check. An existing folder is kept but rejected if it cannot be trusted.
+ */
+int cachedir_create(const char* folder);
+
+/*
+ * Files and folders of the cache are only trusted if they are no symlinks, belong to the
+ * calling user and are not writable by group or others. Returns 0 if path is trusted,
+ * -EPERM if it is not trusted and -ENOENT if it does not exist.
+ */
+int cachedir_check(const char* path);
+
+#endif /* CACHEDIR_H */
@@ -71,15 +71,33 @@ static ConstCliOption _basecliopts[] = {
     {"json", 'J', no_argument, "Output results in JSON format"},
     {"detailed", 'd', no_argument, "Output detailed results (cycles and frequency will be printed)"},
     {"printdomains", 'p', no_argument, "List available domains available on the architecture"},
+    {"cachefolder", 'c', required_argument, "Folder for the kernel object cache"},
+    {"nocache", 'n', no_argument, "Bypass the kernel object cache and compile all kernels"},
+    {"purgecache", 'P', no_argument, "Remove all objects from the kernel object cache"},
+    {"builtinasm", 'A', no_argument, "Assemble kernels in-process, falls back to the compiler for unsupported instructions"},
+    {"timer", 'T', required_argument, "Timer for measurements: rdtsc (default), perf (core cycles from perf_event), gettime"},
+    {"repetitions", 'R', required_argument, "Number of timed repetitions per thread, reported with statistics if larger than 1"},
+    {"relerror", 'E', required_argument, "Stop repeating once the relative error of the mean runtime is reached (e.g. 0.01 or 1%)"},
+    {"placement", 'M', required_argument, "NUMA placement for all streams or per stream (e.g. STR0=bind:1,STR1=interleave): local, interleave, bind:<node>, firsttouch"},
+    {"allocation", 'L', required_argument, "Memory for all streams or per stream (e.g. STR0=thp): heap, thp, nothp, hugetlb2m, hugetlb1g, hugetlbfs[:<dir>]"},
+    {"initialization", 'I', required_argument, "Initialization for all streams or per stream (e.g. STR0=chase:tlb): linear, random, pattern, chase[:random|page|tlb]"},
+    {"barrier", 'B', required_argument, "Barrier between the threads of a workgroup: pthread (default), central, tree, dissemination"},
+    {"barrierbench", 'b', no_argument, "Measure the latency of all barriers per topology level"},
+    {"scaling", 'S', required_argument, "Run with 1 to all hwthreads of the workgroup, added in compact or scatter order"},
+    {"saturation", 'F', required_argument, "Fraction of the peak rate that counts as saturated in scaling runs (default 0.9 or 90%)"},
+    {"autotune", 'U', no_argument, "Time all variants of the kernel's tunables and store the fastest one for this machine"},
+    {"batch", 'X', required_argument, "File with instruction forms, measures latency and throughput of each form with instrlt and instrtp"},
+    {"aggregate", 'G', required_argument, "Aggregations of the workgroup, global and domain results (default min,max,sum,median): min, max, sum, median, mean, stddev, hmean, p<N>"},
+    {"domains", 'g', required_argument, "Aggregate the thread results per topology domain in an extra table: socket, numa, core"},
 };
 
 static ConstCliOptions basecliopts = {
-    .num_options = 15,
+    .num_options = 33,
     .options = _basecliopts,
 };
 
 static ConstCliOption _wgroupopts[] = {
-    {"workgroup", 'w', multi_argument, "Workgroup definition"},
+    {"workgroup", 'w', multi_argument, "Workgroup definition, <group>@<kernel> runs another kernel in this workgroup"},
 };
 
 static ConstCliOptions wgroupopts = {
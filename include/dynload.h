@@ -4,6 +4,8 @@
 #include "bstrlib.h"
 #include "test_types.h"
 
+#include <stdint.h>
+
 #define NUM_COMPILER_CANDIDATES 4
 static struct tagbstring compiler_candidates[NUM_COMPILER_CANDIDATES] = {
     bsStatic("gcc"),
@@ -12,10 +14,18 @@ static struct tagbstring compiler_candidates[NUM_COMPILER_CANDIDATES] = {
     bsStatic("clang"),
 };
 
+/* FNV-1a parameters for hashing kernel code into cache object names */
+#define DYNLOAD_HASH_OFFSET 0xcbf29ce484222325ULL
+#define DYNLOAD_HASH_PRIME 0x100000001b3ULL
+
 bstring get_compiler(bstring candidates);
 int open_function(RuntimeThreadConfig* thread);
+int open_workgroup_functions(RuntimeWorkgroupConfig* wcfg);
 int close_function(RuntimeThreadConfig* thread);
 int dump_assembly(RuntimeThreadConfig* thread, bstring outfile);
+uint64_t dynload_hash_code(struct bstrList* code, bstring compiler, bstring flags);
+int dynload_purge_cache(bstring cachefolder);
 int dynload_create_runtime_test_config(RuntimeConfig* rcfg, RuntimeWorkgroupConfig* wcfg);
+int dynload_update_runtime_test_config(RuntimeConfig* rcfg, RuntimeWorkgroupConfig* wcfg);
 
 #endif /* DYNLOAD_H */
@@ -0,0 +1,55 @@
+// fill.h
+#ifndef FILL_H
+#define FILL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bstrlib.h"
+#include "test_types.h"
+
+/* Width of the vector stores used for filling */
+#define FILL_VECTOR_BYTES 64
+
+/* Nodes of a pointer-chase cycle are cache lines, the orders page and tlb group them in pages */
+#define CHASE_NODE_BYTES 64
+#define CHASE_PAGE_BYTES 4096
+/* Chains of a pointer-chase kernel start at the nodes 0 to CHASE_MAX_CHAINS-1 */
+#define CHASE_MAX_CHAINS 16
+
+/*
+ * Initialization modes of the stream arrays besides constant values:
+ *   linear[:<start>[:<step>]]   - element i is start + i * step (default 0 and 1)
+ *   random[:<seed>]             - uniform values in [0, 1) for floating-point types and
+ *                                 non-negative values for integers, reproducible for the seed
+ *   pattern:<v0>:<v1>:...       - element i is v(i mod number of values)
+ *   chase[:<order>[:<seed>]]    - one random cycle through the cache lines of the filled range
+ *                                 for pointer chasing (int64 streams only), see fill_chase
+ * Returns -ENOENT if the string is none of these (e.g. a constant, which is read with the
+ * stream type) and -EINVAL if the arguments of a mode are invalid.
+ */
+int parse_fill(bstring str, StreamFill* fill);
+const char* fill_name(StreamFillMode mode);
+
+/*
+ * Fills count elements at ptr. first is the index of ptr[0] in the whole stream, so the
+ * values do not depend on how the stream is split between threads.
+ */
+int fill_stream(void* ptr, TestConfigStreamType type, size_t first, size_t count, const StreamFill* fill);
+
+/*
+ * Links the CHASE_NODE_BYTES nodes in [ptr, ptr + count) to one cycle. The first element of
+ * each node holds the byte offset of the next node relative to ptr, the other elements are 0.
+ * The order of the cycle is
+ *   random  - all nodes in random order
+ *   page    - the nodes of a page in random order before the next page, pages in random order
+ *   tlb     - every access goes to another page: the same line slot of all pages in random
+ *             page order, then the next slot
+ * The nodes 0 to CHASE_MAX_CHAINS-1 are moved to the positions n*vdc(j) of the cycle (vdc is
+ * the van der Corput sequence), so K chains started at the nodes 0 to K-1 each walk n/K nodes
+ * before they reach the start of the next chain if K is a power of two.
+ */
+int fill_chase(int64_t* ptr, size_t count, StreamChaseOrder order, uint64_t seed);
+const char* chase_order_name(StreamChaseOrder order);
+
+#endif /* FILL_H */
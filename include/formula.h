@@ -0,0 +1,53 @@
+// formula.h
+#ifndef FORMULA_H
+#define FORMULA_H
+
+#include "bstrlib.h"
+#include "bstrlib_helper.h"
+
+/* Upper limit of the arguments of functions like median(a, b, ...) */
+#define FORMULA_MAX_ARGS 256
+
+/* Operations of a compiled formula, they work on a stack of doubles in postfix order */
+typedef enum {
+    FORMULA_OP_CONST = 0,
+    FORMULA_OP_SLOT,
+    FORMULA_OP_NEG,
+    FORMULA_OP_ADD,
+    FORMULA_OP_SUB,
+    FORMULA_OP_MUL,
+    FORMULA_OP_DIV,
+    FORMULA_OP_MOD,
+    FORMULA_OP_POW,
+    FORMULA_OP_FUNC,
+} FormulaOpcode;
+
+typedef struct {
+    FormulaOpcode op;
+    int arg;        // slot of FORMULA_OP_SLOT, function of FORMULA_OP_FUNC
+    int count;      // arguments of FORMULA_OP_FUNC
+    double value;   // constant of FORMULA_OP_CONST
+} FormulaOp;
+
+typedef struct {
+    int num_ops;
+    FormulaOp* ops;
+    int depth;      // stack entries needed by the evaluation
+} Formula;
+
+/*
+ * Parses expr once into a postfix program. Every occurrence of a name of names in expr,
+ * the longest one first and only if it is not part of a longer word, reads the slot with
+ * the index of the name at evaluation. Besides the names, expr consists of numbers, the
+ * operators + - * / % ^, parentheses, nan, inf and the functions of the calculator (abs,
+ * sqrt, log, min, max, sum, mean, median, ...). Other words are an error (-EINVAL).
+ */
+int formula_compile(const_bstring expr, struct bstrList* names, Formula* formula);
+/*
+ * Evaluates the program with the values of the names in slots. A division by zero returns
+ * -EFAULT with inf or nan in result like the calculator.
+ */
+int formula_eval(const Formula* formula, const double* slots, double* result);
+void formula_free(Formula* formula);
+
+#endif /* FORMULA_H */
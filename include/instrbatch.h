@@ -0,0 +1,48 @@
+// instrbatch.h
+#ifndef INSTRBATCH_H
+#define INSTRBATCH_H
+
+#include "bstrlib.h"
+#include "bstrlib_helper.h"
+
+/* Kernels with the dependent and the independent chain of an instruction form */
+#define INSTRBATCH_LATENCY_KERNEL "instrlt"
+#define INSTRBATCH_THROUGHPUT_KERNEL "instrtp"
+/* Operand parameters op1 to op5 of the kernels */
+#define INSTRBATCH_MAX_OPERANDS 5
+/* Runtime of each measurement in seconds if neither runtime nor iterations are given */
+#define INSTRBATCH_RUNTIME 0.1
+/* Flag of the forms that read their destination, it is no CPU flag */
+#define INSTRBATCH_RMW_FLAG "rmw"
+
+/* One instruction form: mnemonic, operand classes, the CPU flags it needs and whether it reads the destination */
+typedef struct {
+    bstring mnemonic;
+    struct bstrList* operands;
+    struct bstrList* flags;
+    int rmw;
+} InstrForm;
+
+/*
+ * Parses a spec with one form per line: '<mnemonic> <op1>, <op2>, ... [| <flag> ...]'. The flag
+ * 'rmw' marks forms that read their destination. Empty lines and lines starting with '#' are skipped. Returns the number of forms or -EINVAL with
+ * the line number of the first invalid line in *errline.
+ */
+int instrbatch_parse(const_bstring spec, InstrForm** forms, int* errline);
+void instrbatch_free(int num_forms, InstrForm* forms);
+
+/* Feature flags of the first processor in cpuinfo ('flags' on x86, 'Features' on ARM) */
+int instrbatch_cpu_flags(const_bstring cpuinfo, struct bstrList** flags);
+/* Returns NULL if the CPU has all flags of the form, otherwise the first missing flag */
+bstring instrbatch_missing_flag(InstrForm* form, struct bstrList* cpuflags);
+
+/*
+ * Operand of the latency chain that reads the destination of the previous instruction: the
+ * first source with the class of the destination, otherwise the destination itself for forms
+ * marked rmw. Returns 0 if no operand carries the dependency, the form has no latency.
+ */
+int instrbatch_dependency(InstrForm* form);
+/* Operand classes separated by spaces, so the table stays valid CSV */
+bstring instrbatch_operands(InstrForm* form);
+
+#endif /* INSTRBATCH_H */
@@ -138,6 +138,13 @@ int loopfooter(struct bstrList* code, char* loopname, int step)
 }
 
 
+int prefetch(struct bstrList* code, bstring hint, bstring stream, bstring loopreg, int elemsize, long offset)
+{
+    errno = ENOTSUP;
+    ERROR_PRINT("The PREFETCH keyword is not supported on %s", ARCHNAME);
+    return -ENOTSUP;
+}
+
 struct tagbstring  Registers[] = {
     bsStatic("r0"),
     bsStatic("r1"),
@@ -161,4 +168,32 @@ struct tagbstring  Registers[] = {
 struct tagbstring  RegisterSptr = bsStatic("sp");
 struct tagbstring  RegisterBptr = bsStatic("rbp");
 
+int operand_class(bstring cls, int* registers)
+{
+    errno = ENOTSUP;
+    ERROR_PRINT("The chain keywords are not supported on %s", ARCHNAME);
+    return -ENOTSUP;
+}
+
+bstring operand_name(bstring cls, int index, bstring stream)
+{
+    return NULL;
+}
+
+/* The chain keywords are not supported, no registers to initialize */
+int operand_init(struct bstrList* code, bstring inst, bstring cls, int index)
+{
+    return 0;
+}
+
+/* UNROLL does not rename registers yet */
+struct tagbstring VectorRegisters[] = {
+    bsStatic("")
+};
+
+int num_vector_registers(struct bstrList* code)
+{
+    return 0;
+}
+
 #endif /* LIKWID_BENCH_ISA_ARMV7_H */
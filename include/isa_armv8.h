@@ -223,6 +223,13 @@ int loopfooter(struct bstrList* code, bstring loopname, bstring loopreg, bstring
 }
 
 
+int prefetch(struct bstrList* code, bstring hint, bstring stream, bstring loopreg, int elemsize, long offset)
+{
+    errno = ENOTSUP;
+    ERROR_PRINT("The PREFETCH keyword is not supported on %s", ARCHNAME);
+    return -ENOTSUP;
+}
+
 struct tagbstring Registers[] = {
     bsStatic("x1"),
     bsStatic("x2"),
@@ -255,6 +262,39 @@ struct tagbstring Registers[] = {
     bsStatic("")
 };
 
+int operand_class(bstring cls, int* registers)
+{
+    errno = ENOTSUP;
+    ERROR_PRINT("The chain keywords are not supported on %s", ARCHNAME);
+    return -ENOTSUP;
+}
+
+bstring operand_name(bstring cls, int index, bstring stream)
+{
+    return NULL;
+}
+
+/* The chain keywords are not supported, no registers to initialize */
+int operand_init(struct bstrList* code, bstring inst, bstring cls, int index)
+{
+    return 0;
+}
+
+/* Vector registers <prefix><index> renamed by the UNROLL keyword, the prefixes share the index */
+struct tagbstring VectorRegisters[] = {
+    bsStatic("v"),
+    bsStatic("q"),
+    bsStatic("d"),
+    bsStatic("s"),
+    bsStatic("z"),
+    bsStatic("")
+};
+
+int num_vector_registers(struct bstrList* code)
+{
+    return 32;
+}
+
 struct tagbstring RegisterSptr = bsStatic("sp"); // x31, zero or streaming pointer
 struct tagbstring RegisterBptr = bsStatic("x29"); // frame pointer
 struct tagbstring RegisterLptr = bsStatic("x30"); // link register
@@ -165,6 +165,13 @@ int loopfooter(struct bstrList* code, bstring loopname, bstring loopreg, bstring
 }
 
 
+int prefetch(struct bstrList* code, bstring hint, bstring stream, bstring loopreg, int elemsize, long offset)
+{
+    errno = ENOTSUP;
+    ERROR_PRINT("The PREFETCH keyword is not supported on %s", ARCHNAME);
+    return -ENOTSUP;
+}
+
 struct tagbstring  Registers[] = {
     bsStatic("r3"),
     bsStatic("r4"),
@@ -201,4 +208,32 @@ struct tagbstring  Registers[] = {
 struct tagbstring  RegisterSptr = bsStatic("SP");
 struct tagbstring  RegisterBptr = bsStatic("rbp");
 
+int operand_class(bstring cls, int* registers)
+{
+    errno = ENOTSUP;
+    ERROR_PRINT("The chain keywords are not supported on %s", ARCHNAME);
+    return -ENOTSUP;
+}
+
+bstring operand_name(bstring cls, int index, bstring stream)
+{
+    return NULL;
+}
+
+/* The chain keywords are not supported, no registers to initialize */
+int operand_init(struct bstrList* code, bstring inst, bstring cls, int index)
+{
+    return 0;
+}
+
+/* UNROLL does not rename registers yet */
+struct tagbstring VectorRegisters[] = {
+    bsStatic("")
+};
+
+int num_vector_registers(struct bstrList* code)
+{
+    return 0;
+}
+
 #endif /* LIKWID_BENCH_ISA_PPC64_H */
@@ -29,12 +29,17 @@
 #ifndef LIKWID_BENCH_ISA_X8664_H
 #define LIKWID_BENCH_ISA_X8664_H
 
+#include <ctype.h>
+#include <string.h>
 #include "bstrlib.h"
 #include "bstrlib_helper.h"
 #include "test_strings.h"
 
 #define ARCHNAME "x86-64"
 
+/* First local stack slot below the five callee-saved registers pushed in header() */
+#define ARG_LOCALS_OFFSET 48
+
 
 int header(struct bstrList* code, bstring funcname)
 {
@@ -78,6 +83,10 @@ int header(struct bstrList* code, bstring funcname)
 int footer(struct bstrList* code, bstring funcname)
 {
     bstring line = bformat(".size %s, .-%s", bdata(funcname), bdata(funcname));
+    bstring stackline = bformat("lea rsp, [rbp-%d]", ARG_LOCALS_OFFSET - 8);
+    // Drop the local slots of the argument block before restoring the registers
+    bstrListAdd(code, stackline);
+    bdestroy(stackline);
     bstrListAddChar(code, "pop r15");
     bstrListAddChar(code, "pop r14");
     bstrListAddChar(code, "pop r13");
@@ -98,6 +107,12 @@ int footer(struct bstrList* code, bstring funcname)
     bdestroy(line);
 }
 
+/* Numbers are immediates, names are the placeholders of the stream dimensions */
+static char* _loop_immediate(bstring value)
+{
+    return (isdigit(bchar(value, 0)) ? "" : "#");
+}
+
 int loopheader(struct bstrList* code, bstring loopname, bstring loopreg, bstring start, bstring condreg, bstring cond, bstring step)
 {
     struct tagbstring bzero = bsStatic("0");
@@ -123,7 +138,7 @@ int loopheader(struct bstrList* code, bstring loopname, bstring loopreg, bstring
     {
         bstring base = bmidstr(cond, 0, pos);
         bstring offset = bmidstr(cond, pos + 1, blength(cond) - pos - 1);
-        condline = bformat("mov %s, #%s", bdata(condreg), bdata(base));
+        condline = bformat("mov %s, %s%s", bdata(condreg), _loop_immediate(base), bdata(base));
         bstrListAdd(code, condline);
         condline = bformat("add %s, %s", bdata(condreg), bdata(offset));
         bstrListAdd(code, condline);
@@ -134,7 +149,7 @@ int loopheader(struct bstrList* code, bstring loopname, bstring loopreg, bstring
     {
         bstring base = bmidstr(cond, 0, pos);
         bstring offset = bmidstr(cond, pos + 1, blength(cond) - pos - 1);
-        condline = bformat("mov %s, #%s", bdata(condreg), bdata(base));
+        condline = bformat("mov %s, %s%s", bdata(condreg), _loop_immediate(base), bdata(base));
         bstrListAdd(code, condline);
         condline = bformat("sub %s, %s", bdata(condreg), bdata(offset));
         bstrListAdd(code, condline);
@@ -143,7 +158,7 @@ int loopheader(struct bstrList* code, bstring loopname, bstring loopreg, bstring
     }
     else
     {
-        condline = bformat("mov %s, #%s", bdata(condreg), bdata(cond));
+        condline = bformat("mov %s, %s%s", bdata(condreg), _loop_immediate(cond), bdata(cond));
         bstrListAdd(code, condline);
     }
     bdestroy(condline);
@@ -217,6 +232,36 @@ int streamheader(struct bstrList* code, bstring reg, bstring ptr)
     return 0;
 }
 
+/* Instructions of the hints of the PREFETCH keyword */
+static struct {
+    char* hint;
+    char* inst;
+} PrefetchHints[] = {
+    {"t0", "prefetcht0"},
+    {"t1", "prefetcht1"},
+    {"t2", "prefetcht2"},
+    {"nta", "prefetchnta"},
+    {"w", "prefetchw"},
+    {NULL, NULL}
+};
+
+int prefetch(struct bstrList* code, bstring hint, bstring stream, bstring loopreg, int elemsize, long offset)
+{
+    for (int i = 0; PrefetchHints[i].hint != NULL; i++)
+    {
+        if (biseqcstr(hint, PrefetchHints[i].hint))
+        {
+            bstring line = bformat("%s [%s + %s * %d + %ld]", PrefetchHints[i].inst, bdata(stream), bdata(loopreg), elemsize, offset);
+            bstrListAdd(code, line);
+            bdestroy(line);
+            return 0;
+        }
+    }
+    errno = EINVAL;
+    ERROR_PRINT("Unknown prefetch hint '%s', use t0, t1, t2, nta or w", bdata(hint));
+    return -EINVAL;
+}
+
 struct tagbstring Registers[] = {
     bsStatic("rax"),
     bsStatic("rbx"),
@@ -235,7 +280,144 @@ struct tagbstring Registers[] = {
     bsStatic("")
 };
 
+/*
+ * General purpose registers for the operands of BUILD_DEP_CHAIN and BUILD_INDEP_CHAIN, rax and
+ * rdi are left for the loops
+ */
+static char* OperandGpr64[] = {"rbx", "rcx", "rdx", "rsi", "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15", NULL};
+static char* OperandGpr32[] = {"ebx", "ecx", "edx", "esi", "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d", NULL};
+
+/* Operand classes of the chain keywords, the prefix is the register name or the memory size */
+static struct {
+    char* cls;
+    PttOperandFamily family;
+    char* prefix;
+    int registers;
+} OperandClasses[] = {
+    {"r64", PTT_OPERAND_GPR, NULL, 12},
+    {"gpr", PTT_OPERAND_GPR, NULL, 12},
+    {"r32", PTT_OPERAND_GPR, NULL, 12},
+    {"xmm", PTT_OPERAND_VECTOR, "xmm", 16},
+    {"ymm", PTT_OPERAND_VECTOR, "ymm", 16},
+    {"zmm", PTT_OPERAND_VECTOR, "zmm", 32},
+    {"m8", PTT_OPERAND_MEMORY, "BYTE PTR ", 0},
+    {"m16", PTT_OPERAND_MEMORY, "WORD PTR ", 0},
+    {"m32", PTT_OPERAND_MEMORY, "DWORD PTR ", 0},
+    {"m64", PTT_OPERAND_MEMORY, "QWORD PTR ", 0},
+    {"m128", PTT_OPERAND_MEMORY, "XMMWORD PTR ", 0},
+    {"m256", PTT_OPERAND_MEMORY, "YMMWORD PTR ", 0},
+    {"m512", PTT_OPERAND_MEMORY, "ZMMWORD PTR ", 0},
+    {"mem", PTT_OPERAND_MEMORY, "", 0},
+    {"imm", PTT_OPERAND_IMMEDIATE, NULL, 0},
+    {NULL, 0, NULL, 0}
+};
+
+/* Family of an operand class and its number of registers, -EINVAL for unknown classes */
+int operand_class(bstring cls, int* registers)
+{
+    for (int i = 0; OperandClasses[i].cls != NULL; i++)
+    {
+        if (biseqcstr(cls, OperandClasses[i].cls))
+        {
+            *registers = OperandClasses[i].registers;
+            return OperandClasses[i].family;
+        }
+    }
+    errno = EINVAL;
+    ERROR_PRINT("Unknown operand class '%s', use r64, r32, xmm, ymm, zmm, m8 to m512, mem or imm", bdata(cls));
+    return -EINVAL;
+}
+
+/* Register index of an operand class, memory operands address the stream */
+bstring operand_name(bstring cls, int index, bstring stream)
+{
+    for (int i = 0; OperandClasses[i].cls != NULL; i++)
+    {
+        if (!biseqcstr(cls, OperandClasses[i].cls))
+        {
+            continue;
+        }
+        switch (OperandClasses[i].family)
+        {
+            case PTT_OPERAND_GPR:
+                return bfromcstr(biseqcstr(cls, "r32") ? OperandGpr32[index] : OperandGpr64[index]);
+            case PTT_OPERAND_VECTOR:
+                return bformat("%s%d", OperandClasses[i].prefix, index);
+            case PTT_OPERAND_MEMORY:
+                return bformat("%s[%s]", OperandClasses[i].prefix, bdata(stream));
+            case PTT_OPERAND_IMMEDIATE:
+                return bfromcstr("1");
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Initialization of a chain register before the loops, so the chain does not start from
+ * the stale contents of the register: denormal values slow down the floating-point units
+ * by orders of magnitude. Vector registers get 1.0 in all elements, in single precision
+ * for the ps/ss instructions, which neither collapses to 0 nor overflows in multiply
+ * chains. General purpose registers get 1, which is also a valid divisor.
+ */
+int operand_init(struct bstrList* code, bstring inst, bstring cls, int index)
+{
+    int regs = 0;
+    int family = operand_class(cls, &regs);
+    bstring reg = operand_name(cls, index, NULL);
+    bstring line = NULL;
+    if (family == PTT_OPERAND_GPR)
+    {
+        line = bformat("mov %s, 1", bdata(reg));
+    }
+    else if (family == PTT_OPERAND_VECTOR)
+    {
+        char* suffix = bdata(inst) + (blength(inst) > 2 ? blength(inst) - 2 : 0);
+        int single = (strcmp(suffix, "ps") == 0 || strcmp(suffix, "ss") == 0);
+        if (biseqcstr(cls, "xmm"))
+        {
+            // Legacy SSE load, the 16 byte constants are aligned
+            line = bformat("%s %s, [rip + %s]", (single ? "movaps" : "movapd"), bdata(reg), (single ? "SSCALAR" : "SCALAR"));
+        }
+        else
+        {
+            line = bformat("%s %s, %s [rip + %s]", (single ? "vbroadcastss" : "vbroadcastsd"), bdata(reg), (single ? "DWORD PTR" : "QWORD PTR"), (single ? "SSCALAR" : "SCALAR"));
+        }
+    }
+    if (line)
+    {
+        bstrListAdd(code, line);
+        bdestroy(line);
+    }
+    bdestroy(reg);
+    return 0;
+}
+
+/* Vector registers <prefix><index> renamed by the UNROLL keyword, the prefixes share the index */
+struct tagbstring VectorRegisters[] = {
+    bsStatic("xmm"),
+    bsStatic("ymm"),
+    bsStatic("zmm"),
+    bsStatic("")
+};
+
+/* 16 vector registers, code with zmm registers has the 32 of AVX-512 */
+int num_vector_registers(struct bstrList* code)
+{
+    struct tagbstring bzmm = bsStatic("zmm");
+    for (int i = 0; i < code->qty; i++)
+    {
+        if (binstr(code->entry[i], 0, &bzmm) != BSTR_ERR)
+        {
+            return 32;
+        }
+    }
+    return 16;
+}
+
 struct tagbstring RegisterSptr = bsStatic("rsp");
 struct tagbstring RegisterBptr = bsStatic("rbp");
+/* The kernel argument block is the first function argument */
+struct tagbstring RegisterArgs = bsStatic("rdi");
+struct tagbstring RegisterScratch = bsStatic("rax");
 
 #endif /* LIKWID_BENCH_ISA_X8664_H */
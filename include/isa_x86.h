@@ -30,6 +30,7 @@
 #define LIKWID_BENCH_ISA_X86_H
 
 
+#include <ctype.h>
 #include "bstrlib.h"
 #include "bstrlib_helper.h"
 #include "test_strings.h"
@@ -89,6 +90,12 @@ int footer(struct bstrList* code, bstring funcname)
     bstrListAddChar(code, "#endif");
 }
 
+/* Numbers are immediates, names are the placeholders of the stream dimensions */
+static char* _loop_immediate(bstring value)
+{
+    return (isdigit(bchar(value, 0)) ? "" : "#");
+}
+
 int loopheader(struct bstrList* code, bstring loopname, bstring loopreg, bstring start, bstring condreg, bstring cond, bstring step)
 //int loopheader(struct bstrList* code, char* loopname, int step)
 {
@@ -98,7 +105,7 @@ int loopheader(struct bstrList* code, bstring loopname, bstring loopreg, bstring
     if (bstrncmp(start, &bzero, blength(&bzero)) == BSTR_OK)
         initline = bformat("xor %s, %s", bdata(loopreg), bdata(loopreg));
     else
-        initline = bformat("mov %s, #%s", bdata(loopreg), bdata(start));
+        initline = bformat("mov %s, %s%s", bdata(loopreg), _loop_immediate(start), bdata(start));
     bstrListAdd(code, initline);
     bdestroy(initline);
 
@@ -106,7 +113,7 @@ int loopheader(struct bstrList* code, bstring loopname, bstring loopreg, bstring
     if (bstrncmp(cond, &bzero, blength(&bzero)) == BSTR_OK)
         condline = bformat("xor %s, %s", bdata(condreg), bdata(condreg));
     else
-        condline = bformat("mov %s, #%s", bdata(condreg), bdata(cond));
+        condline = bformat("mov %s, %s%s", bdata(condreg), _loop_immediate(cond), bdata(cond));
     bstrListAdd(code, condline);
     bdestroy(condline);
 
@@ -169,6 +176,36 @@ int loopfooter(struct bstrList* code, bstring loopname, bstring loopreg, bstring
 }
 
 
+/* Instructions of the hints of the PREFETCH keyword */
+static struct {
+    char* hint;
+    char* inst;
+} PrefetchHints[] = {
+    {"t0", "prefetcht0"},
+    {"t1", "prefetcht1"},
+    {"t2", "prefetcht2"},
+    {"nta", "prefetchnta"},
+    {"w", "prefetchw"},
+    {NULL, NULL}
+};
+
+int prefetch(struct bstrList* code, bstring hint, bstring stream, bstring loopreg, int elemsize, long offset)
+{
+    for (int i = 0; PrefetchHints[i].hint != NULL; i++)
+    {
+        if (biseqcstr(hint, PrefetchHints[i].hint))
+        {
+            bstring line = bformat("%s [%s + %s * %d + %ld]", PrefetchHints[i].inst, bdata(stream), bdata(loopreg), elemsize, offset);
+            bstrListAdd(code, line);
+            bdestroy(line);
+            return 0;
+        }
+    }
+    errno = EINVAL;
+    ERROR_PRINT("Unknown prefetch hint '%s', use t0, t1, t2, nta or w", bdata(hint));
+    return -EINVAL;
+}
+
 struct tagbstring Registers[] = {
     bsStatic("eax"),
     bsStatic("ebx"),
@@ -182,4 +219,34 @@ struct tagbstring Registers[] = {
 struct tagbstring RegisterSptr = bsStatic("esp");
 struct tagbstring RegisterBptr = bsStatic("ebp");
 
+int operand_class(bstring cls, int* registers)
+{
+    errno = ENOTSUP;
+    ERROR_PRINT("The chain keywords are not supported on %s", ARCHNAME);
+    return -ENOTSUP;
+}
+
+bstring operand_name(bstring cls, int index, bstring stream)
+{
+    return NULL;
+}
+
+/* The chain keywords are not supported, no registers to initialize */
+int operand_init(struct bstrList* code, bstring inst, bstring cls, int index)
+{
+    return 0;
+}
+
+/* Vector registers <prefix><index> renamed by the UNROLL keyword, the prefixes share the index */
+struct tagbstring VectorRegisters[] = {
+    bsStatic("xmm"),
+    bsStatic("ymm"),
+    bsStatic("")
+};
+
+int num_vector_registers(struct bstrList* code)
+{
+    return 8;
+}
+
 #endif /* LIKWID_BENCH_ISA_X86_H */
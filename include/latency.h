@@ -0,0 +1,39 @@
+// latency.h
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bstrlib.h"
+#include "table.h"
+#include "test_types.h"
+
+/* Accesses timed one by one per thread after the run of a pointer-chase kernel */
+#define LATENCY_HIST_SAMPLES 65536
+/* Empty timed regions to measure the overhead of the timestamps */
+#define LATENCY_OVERHEAD_ROUNDS 1000
+
+/*
+ * Bucket b > 0 counts the accesses taking 2^(b-1) to 2^b ns, bucket 0 the ones below 1ns and
+ * the last bucket all above 2^(LATENCY_HIST_BUCKETS-2) ns.
+ */
+int latency_bucket(double ns);
+bstring latency_bucket_name(int bucket);
+
+/*
+ * Follows the pointer-chase cycle at ptr (see fill_chase) from node 0 for samples accesses and
+ * adds each access to its bucket in hist. The overhead of the timestamps is subtracted.
+ */
+int latency_histogram(const int64_t* ptr, uint64_t samples, uint64_t* hist);
+
+/* Histogram of the first per-thread pointer-chase stream of the thread, a no-op without one */
+int latency_thread(RuntimeThreadConfig* thread);
+
+/*
+ * One row per thread with the share of its accesses per bucket in percent. The table is NULL
+ * if no thread walked a pointer-chase stream.
+ */
+int latency_table(RuntimeConfig* runcfg, Table** table);
+
+#endif /* LATENCY_H */
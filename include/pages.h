@@ -0,0 +1,35 @@
+// pages.h
+#ifndef PAGES_H
+#define PAGES_H
+
+#include <stddef.h>
+
+#include "bstrlib.h"
+#include "test_types.h"
+
+/*
+ * Allocation backends for the stream arrays:
+ *   heap       - posix_memalign with cache line alignment (default)
+ *   thp        - anonymous mmap, aligned to the huge page size and advised with MADV_HUGEPAGE
+ *   nothp      - anonymous mmap advised with MADV_NOHUGEPAGE
+ *   hugetlb2m  - anonymous mmap with MAP_HUGETLB and 2 MB pages
+ *   hugetlb1g  - anonymous mmap with MAP_HUGETLB and 1 GB pages
+ *   hugetlbfs  - file in a hugetlbfs mount, hugetlbfs:<dir> selects the mount point
+ */
+int parse_allocation(bstring str, StreamAllocation* allocation, bstring path);
+const char* allocation_name(StreamAllocation allocation);
+
+/*
+ * Maps at least size bytes with the given backend (except heap). alloc_size returns the
+ * size of the mapping, which is needed to unmap it again with free_pages.
+ */
+int alloc_pages(size_t size, StreamAllocation allocation, bstring path, void** ptr, size_t* alloc_size);
+void free_pages(void* ptr, size_t alloc_size);
+
+/*
+ * Page size backing [ptr, ptr + size) as reported by /proc/self/smaps. Transparent huge
+ * pages count if they back at least half of the resident memory of the range.
+ */
+int query_pagesize(void* ptr, size_t size, size_t* pagesize);
+
+#endif /* PAGES_H */
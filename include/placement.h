@@ -0,0 +1,39 @@
+// placement.h
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+#include <stddef.h>
+
+#include "bstrlib.h"
+#include "test_types.h"
+
+/* Upper limit for NUMA node IDs handled by the placement policies */
+#define PLACEMENT_MAX_NODES 1024
+
+/*
+ * NUMA placement of the stream arrays. The policies are applied with the mbind system call
+ * directly, so there is no dependency to libnuma:
+ *   local      - bind to the NUMA nodes of the hwthreads in the workgroup
+ *   interleave - interleave page-wise over the NUMA nodes of the hwthreads in the workgroup
+ *   bind:<n>   - bind to NUMA node n
+ *   firsttouch - no policy, but every thread initializes its own part of the array
+ */
+int parse_placement(bstring str, StreamPlacement* placement, int* node);
+const char* placement_name(StreamPlacement placement);
+
+/* Highest NUMA node ID of the system (from /sys/devices/system/node/possible) */
+int placement_max_node();
+
+/*
+ * Applies the placement to the pages of [ptr, ptr + size). nodes are the NUMA nodes used
+ * by the local and interleave policies, node is the target of the bind policy.
+ */
+int apply_placement(void* ptr, size_t size, StreamPlacement placement, int node, const int* nodes, int num_nodes);
+
+/*
+ * Counts the pages of [ptr, ptr + size) per NUMA node with move_pages(2). pages_per_node must
+ * hold max_node + 1 entries, pages that are not yet touched are counted in unmapped.
+ */
+int query_placement(void* ptr, size_t size, int max_node, size_t* pages_per_node, size_t* unmapped);
+
+#endif /* PLACEMENT_H */
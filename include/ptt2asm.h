@@ -83,6 +83,20 @@ static RegisterMap StreamPatterns[] = {
     {"", ""},
 };
 
+/* Operand families of the chain keywords, the register classes of a family share the index */
+typedef enum {
+    PTT_OPERAND_GPR = 0,
+    PTT_OPERAND_VECTOR,
+    PTT_OPERAND_MEMORY,
+    PTT_OPERAND_IMMEDIATE,
+} PttOperandFamily;
+
+/*
+ * Keywords nested in a loop prefix the lines that must run once before all loops, like the
+ * register initialization of the chains. prepare_ptt moves them in front of the kernel code.
+ */
+#define PTT_PROLOGUE_PREFIX "#prologue "
+
 typedef struct {
     char* begin;
     char* end;
@@ -96,6 +110,6 @@ typedef struct {
 } PttKeywordInternal;
 
 int prepare_ptt(TestConfig_t config, struct bstrList* out, struct bstrList* regs);
-int generate_code(RuntimeConfig* runcfg, RuntimeThreadConfig* thread, struct bstrList* out);
+int generate_code(TestConfig_t config, RuntimeThreadConfig* thread, struct bstrList* out);
 
 #endif /* PTT2ASM_H */
@@ -0,0 +1,335 @@
+/*
+ * =======================================================================================
+ *
+ *      Filename:  ptt_keyword_chain.h
+ *
+ *      Description:  Header file for the keywords BUILD_DEP_CHAIN & BUILD_DEP_CHAINEND and
+ *                    BUILD_INDEP_CHAIN & BUILD_INDEP_CHAINEND
+ *
+ *      Version:   <VERSION>
+ *      Released:  <DATE>
+ *
+ *      Author:   Thomas Gruber (tg), thomas.roehl@googlemail.com
+ *      Project:  likwid-bench
+ *
+ *      Copyright (C) 2019 RRZE, University Erlangen-Nuremberg
+ *
+ *      This program is free software: you can redistribute it and/or modify it under
+ *      the terms of the GNU General Public License as published by the Free Software
+ *      Foundation, either version 2 of the License, or (at your option) any later
+ *      version.
+ *
+ *      This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ *      WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ *      PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along with
+ *      this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * =======================================================================================
+ */
+
+#ifndef PTT_KEYWORD_CHAIN_H
+#define PTT_KEYWORD_CHAIN_H
+
+#include "test_types.h"
+#include "bstrlib.h"
+#include "bstrlib_helper.h"
+#include "error.h"
+
+#define CHAIN_MAX_LENGTH 1024
+#define CHAIN_MAX_OPERANDS 8
+#define CHAIN_REGISTER_FAMILIES 2
+
+/*
+ * Splits the template line '<instruction> <op1>, <op2>, ...' of a chain block. The instruction
+ * and the operand classes are resolved with get_string, operands with the class 'none' are
+ * dropped, so optional trailing operands can be parameters with the default none.
+ */
+static int _chain_template(TestConfig_t config, bstring line, bstring* inst, struct bstrList* ops)
+{
+    struct tagbstring bnone = bsStatic("none");
+    bstring t = bstrcpy(line);
+    btrimws(t);
+    int space = bstrchr(t, ' ');
+    if (space == BSTR_ERR)
+    {
+        space = blength(t);
+    }
+    bstring mnemonic = bmidstr(t, 0, space);
+    bstring operands = bmidstr(t, space, blength(t) - space);
+    *inst = bstrcpy(get_string(config, mnemonic));
+    struct bstrList* tmp = bsplittrim(operands, ',');
+    for (int i = 0; i < tmp->qty; i++)
+    {
+        bstring cls = get_string(config, tmp->entry[i]);
+        if (cls && blength(cls) > 0 && bstrcmp(cls, &bnone) != BSTR_OK)
+        {
+            bstrListAdd(ops, cls);
+        }
+    }
+    bstrListDestroy(tmp);
+    bdestroy(operands);
+    bdestroy(mnemonic);
+    bdestroy(t);
+    if (blength(*inst) == 0 || ops->qty == 0 || ops->qty > CHAIN_MAX_OPERANDS)
+    {
+        errno = EINVAL;
+        ERROR_PRINT("Invalid template line '%s', use <instruction> <op1>, ... with 1 to %d operands", bdata(line), CHAIN_MAX_OPERANDS);
+        return -EINVAL;
+    }
+    return 0;
+}
+
+/*
+ * Common parser of both chain keywords. A dependent chain writes the same destination register
+ * in all copies and reads it in the operand dep (1-based, 1 is a read-modify-write of the
+ * destination), so every instruction waits for the previous one. An independent chain rotates
+ * the destinations over all registers that are not used by the sources. All registers of the
+ * chain are initialized in the prologue, so the measurement does not depend on their contents.
+ */
+static int _parse_chain(TestConfig_t config, struct bstrList* code, struct bstrList* out, bstring bkeybegin, bstring bkeyend, int dependent)
+{
+    int err = 0;
+    int nargs = (dependent ? 3 : 2);
+    long dep = 0;
+    long count = 0;
+    int families[CHAIN_MAX_OPERANDS];
+    int indices[CHAIN_MAX_OPERANDS];
+    int pool[CHAIN_REGISTER_FAMILIES] = {0, 0};
+    int next[CHAIN_REGISTER_FAMILIES] = {0, 0};
+    struct tagbstring bgpr = bsStatic("r64");
+    for (int i = 0; i < code->qty; i++)
+    {
+        DEBUG_PRINT(DEBUGLEV_DEVELOP, "%s: %s", bdata(bkeybegin), bdata(code->entry[i]));
+    }
+    // First we do some basic checks
+    // Does the first line start with the keyword
+    if (!has_prefix(code->entry[0], bkeybegin))
+    {
+        errno = EINVAL;
+        ERROR_PRINT("First line does not start with %s", bdata(bkeybegin));
+        return -EINVAL;
+    }
+    // Does the last line start with the end keyword
+    if (!has_prefix(code->entry[code->qty-1], bkeyend))
+    {
+        errno = EINVAL;
+        ERROR_PRINT("Last line does not start with %s", bdata(bkeyend));
+        return -EINVAL;
+    }
+    // Now get a list of all arguments in the first line
+    struct bstrList* beginArgs = get_argList(code->entry[0]);
+    if (beginArgs->qty != nargs)
+    {
+        errno = EINVAL;
+        ERROR_PRINT("%s needs %d arguments: %s", bdata(bkeybegin), nargs, bdata(code->entry[0]));
+        bstrListDestroy(beginArgs);
+        return -EINVAL;
+    }
+    // Now get a list of all arguments in the last line
+    struct bstrList* endArgs = get_argList(code->entry[code->qty-1]);
+    if (endArgs->qty < 1 || bstrcmp(beginArgs->entry[0], endArgs->entry[0]) != BSTR_OK)
+    {
+        errno = EINVAL;
+        ERROR_PRINT("%s and %s for different blocks: %s <-> %s", bdata(bkeybegin), bdata(bkeyend), bdata(code->entry[0]), bdata(code->entry[code->qty-1]));
+        bstrListDestroy(beginArgs);
+        bstrListDestroy(endArgs);
+        return -EINVAL;
+    }
+    bstrListDestroy(endArgs);
+    // List of all arguments:
+    // 0: name
+    // 1: operand index of the dependency (BUILD_DEP_CHAIN only)
+    // last: number of instructions
+    if (dependent)
+    {
+        err = get_value(config, beginArgs->entry[1], &dep);
+    }
+    if (err == 0)
+    {
+        err = get_value(config, beginArgs->entry[nargs-1], &count);
+    }
+    if (err == 0 && (count <= 0 || count > CHAIN_MAX_LENGTH))
+    {
+        errno = EINVAL;
+        ERROR_PRINT("Invalid length %ld of %s block %s, use 1 to %d", count, bdata(bkeybegin), bdata(beginArgs->entry[0]), CHAIN_MAX_LENGTH);
+        err = -EINVAL;
+    }
+
+    // The block contains exactly one template line
+    int tline = -1;
+    for (int i = 1; i < code->qty-1 && err == 0; i++)
+    {
+        if (blength(code->entry[i]) == 0) continue;
+        if (tline >= 0)
+        {
+            errno = EINVAL;
+            ERROR_PRINT("%s block %s has more than one template line", bdata(bkeybegin), bdata(beginArgs->entry[0]));
+            err = -EINVAL;
+        }
+        tline = i;
+    }
+    if (err == 0 && tline < 0)
+    {
+        errno = EINVAL;
+        ERROR_PRINT("%s block %s has no template line", bdata(bkeybegin), bdata(beginArgs->entry[0]));
+        err = -EINVAL;
+    }
+    bstring inst = NULL;
+    struct bstrList* ops = bstrListCreate();
+    if (err == 0)
+    {
+        err = _chain_template(config, code->entry[tline], &inst, ops);
+    }
+
+    // Operand classes, registers of a family are shared by its classes (xmm0 and ymm0)
+    for (int i = 0; i < ops->qty && err == 0; i++)
+    {
+        int regs = 0;
+        families[i] = operand_class(ops->entry[i], &regs);
+        indices[i] = 0;
+        if (families[i] < 0)
+        {
+            err = families[i];
+            break;
+        }
+        if (families[i] == PTT_OPERAND_MEMORY && config->num_streams == 0)
+        {
+            errno = EINVAL;
+            ERROR_PRINT("Memory operand %s needs a stream in the kernel", bdata(ops->entry[i]));
+            err = -EINVAL;
+        }
+        if (families[i] < CHAIN_REGISTER_FAMILIES && (pool[families[i]] == 0 || regs < pool[families[i]]))
+        {
+            pool[families[i]] = regs;
+        }
+    }
+    // The stream pointers need general purpose registers as well
+    pool[PTT_OPERAND_GPR] -= config->num_streams;
+    if (err == 0 && families[0] == PTT_OPERAND_IMMEDIATE)
+    {
+        errno = EINVAL;
+        ERROR_PRINT("The destination of %s block %s cannot be an immediate", bdata(bkeybegin), bdata(beginArgs->entry[0]));
+        err = -EINVAL;
+    }
+    if (err == 0 && dependent && (dep < 1 || dep > ops->qty || families[dep-1] != families[0]))
+    {
+        errno = EINVAL;
+        ERROR_PRINT("Operand %ld of %s block %s does not exist or is not of the destination's family", dep, bdata(bkeybegin), bdata(beginArgs->entry[0]));
+        err = -EINVAL;
+    }
+
+    // Fixed registers: the sources of both chains and the destination of a dependent chain
+    for (int i = (dependent ? 0 : 1); i < ops->qty && err == 0; i++)
+    {
+        int f = families[i];
+        if (f >= CHAIN_REGISTER_FAMILIES) continue;
+        if (dependent && i == dep-1 && i > 0)
+        {
+            indices[i] = indices[0];
+            continue;
+        }
+        indices[i] = next[f]++;
+        if (next[f] > pool[f])
+        {
+            errno = EINVAL;
+            ERROR_PRINT("Not enough registers for the operands of %s block %s", bdata(bkeybegin), bdata(beginArgs->entry[0]));
+            err = -EINVAL;
+        }
+    }
+    int rotate = 1;
+    if (err == 0 && !dependent && families[0] < CHAIN_REGISTER_FAMILIES)
+    {
+        rotate = pool[families[0]] - next[families[0]];
+        if (rotate < 1)
+        {
+            errno = EINVAL;
+            ERROR_PRINT("No register left for the destinations of %s block %s", bdata(bkeybegin), bdata(beginArgs->entry[0]));
+            err = -EINVAL;
+        }
+        indices[0] = next[families[0]];
+        next[families[0]] += (rotate < count ? rotate : count);
+        DEBUG_PRINT(DEBUGLEV_DEVELOP, "%s block %s rotates %ld destinations over %d registers", bdata(bkeybegin), bdata(beginArgs->entry[0]), count, rotate);
+    }
+
+    if (err == 0)
+    {
+        toComment(out, code->entry[0]);
+        // The 64 bit names in a comment reserve the general purpose registers for the stream detection
+        if (next[PTT_OPERAND_GPR] > 0)
+        {
+            bstring line = bformat("# %s registers:", bdata(beginArgs->entry[0]));
+            for (int r = 0; r < next[PTT_OPERAND_GPR]; r++)
+            {
+                bstring reg = operand_name(&bgpr, r, NULL);
+                bconchar(line, ' ');
+                bconcat(line, reg);
+                bdestroy(reg);
+            }
+            bstrListAdd(out, line);
+            bdestroy(line);
+        }
+        struct bstrList* init = bstrListCreate();
+        for (int i = 0; i < ops->qty; i++)
+        {
+            if (families[i] >= CHAIN_REGISTER_FAMILIES || (dependent && i == dep-1 && i > 0))
+            {
+                continue;
+            }
+            int num = ((i == 0 && !dependent) ? (rotate < count ? rotate : (int)count) : 1);
+            for (int r = 0; r < num; r++)
+            {
+                operand_init(init, inst, ops->entry[i], indices[i] + r);
+            }
+        }
+        for (int i = 0; i < init->qty; i++)
+        {
+            bstring line = bformat("%s%s", PTT_PROLOGUE_PREFIX, bdata(init->entry[i]));
+            bstrListAdd(out, line);
+            bdestroy(line);
+        }
+        bstrListDestroy(init);
+        for (long c = 0; c < count; c++)
+        {
+            bstring line = bformat("%s ", bdata(inst));
+            for (int i = 0; i < ops->qty; i++)
+            {
+                int index = indices[i];
+                if (i == 0 && !dependent)
+                {
+                    index += (int)(c % rotate);
+                }
+                bstring op = operand_name(ops->entry[i], index, config->streams ? config->streams[0].name : NULL);
+                if (i > 0) bcatcstr(line, ", ");
+                bconcat(line, op);
+                bdestroy(op);
+            }
+            bstrListAdd(out, line);
+            bdestroy(line);
+        }
+        toComment(out, code->entry[code->qty-1]);
+    }
+
+    // Cleaup used data structures
+    bdestroy(inst);
+    bstrListDestroy(ops);
+    bstrListDestroy(beginArgs);
+    return err;
+}
+
+int parse_dep_chain(TestConfig_t config, struct bstrList* code, struct bstrList* out)
+{
+    struct tagbstring bkeybegin = bsStatic("BUILD_DEP_CHAIN");
+    struct tagbstring bkeyend = bsStatic("BUILD_DEP_CHAINEND");
+    return _parse_chain(config, code, out, &bkeybegin, &bkeyend, 1);
+}
+
+int parse_indep_chain(TestConfig_t config, struct bstrList* code, struct bstrList* out)
+{
+    struct tagbstring bkeybegin = bsStatic("BUILD_INDEP_CHAIN");
+    struct tagbstring bkeyend = bsStatic("BUILD_INDEP_CHAINEND");
+    return _parse_chain(config, code, out, &bkeybegin, &bkeyend, 0);
+}
+
+#endif /* PTT_KEYWORD_CHAIN_H */
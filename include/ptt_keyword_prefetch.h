@@ -0,0 +1,243 @@
+/*
+ * =======================================================================================
+ *
+ *      Filename:  ptt_keyword_prefetch.h
+ *
+ *      Description:  Header file for the keyword PREFETCH & PREFETCHEND
+ *
+ *      Version:   <VERSION>
+ *      Released:  <DATE>
+ *
+ *      Author:   Thomas Gruber (tg), thomas.roehl@googlemail.com
+ *      Project:  likwid-bench
+ *
+ *      Copyright (C) 2019 RRZE, University Erlangen-Nuremberg
+ *
+ *      This program is free software: you can redistribute it and/or modify it under
+ *      the terms of the GNU General Public License as published by the Free Software
+ *      Foundation, either version 2 of the License, or (at your option) any later
+ *      version.
+ *
+ *      This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ *      WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ *      PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along with
+ *      this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * =======================================================================================
+ */
+
+#ifndef PTT_KEYWORD_PREFETCH_H
+#define PTT_KEYWORD_PREFETCH_H
+
+#include "test_types.h"
+#include "bstrlib.h"
+#include "bstrlib_helper.h"
+#include "error.h"
+
+/* A prefetch instruction fetches one cache line */
+#define PREFETCH_LINE_BYTES 64
+
+int parse_prefetch(TestConfig_t config, struct bstrList* code, struct bstrList* out)
+{
+    int err = 0;
+    int loopline = -1;
+    long distance = 0;
+    long step = 0;
+    struct tagbstring bkeybegin = bsStatic("PREFETCH");
+    struct tagbstring bkeyend = bsStatic("PREFETCHEND");
+    struct tagbstring bkeyloop = bsStatic("LOOP");
+    struct tagbstring bunitlines = bsStatic("lines");
+    struct tagbstring bunititers = bsStatic("iters");
+    for (int i = 0; i < code->qty; i++)
+    {
+        DEBUG_PRINT(DEBUGLEV_DEVELOP, "PREFETCH: %s", bdata(code->entry[i]));
+    }
+    // First we do some basic checks
+    // Does the first line start with 'PREFETCH'
+    if (!has_prefix(code->entry[0], &bkeybegin))
+    {
+        errno = EINVAL;
+        ERROR_PRINT("First line does not start with %s", bdata(&bkeybegin));
+        return -EINVAL;
+    }
+    // Does the last line start with 'PREFETCHEND'
+    if (!has_prefix(code->entry[code->qty-1], &bkeyend))
+    {
+        errno = EINVAL;
+        ERROR_PRINT("Last line does not start with %s", bdata(&bkeyend));
+        return -EINVAL;
+    }
+    // Now get a list of all arguments in the first line -> PREFETCH(arg0, arg1, ...)
+    struct bstrList* beginArgs = get_argList(code->entry[0]);
+    if (!beginArgs)
+    {
+        errno = EINVAL;
+        ERROR_PRINT("Arguments missing in %s line: %s", bdata(&bkeybegin), bdata(code->entry[0]));
+        return -EINVAL;
+    }
+    // The PREFETCH line should have 4 arguments
+    if (beginArgs->qty != 4)
+    {
+        errno = EINVAL;
+        ERROR_PRINT("Arguments missing in %s line: %s", bdata(&bkeybegin), bdata(code->entry[0]));
+        bstrListDestroy(beginArgs);
+        return -EINVAL;
+    }
+    // Now get a list of all arguments in the last line -> PREFETCHEND(arg0)
+    struct bstrList* endArgs = get_argList(code->entry[code->qty-1]);
+    if (!endArgs)
+    {
+        errno = EINVAL;
+        ERROR_PRINT("Arguments missing in %s line: %s", bdata(&bkeyend), bdata(code->entry[code->qty-1]));
+        bstrListDestroy(beginArgs);
+        return -EINVAL;
+    }
+    // Do both lines have the same first argument aka the keyword label
+    if (bstrcmp(beginArgs->entry[0], endArgs->entry[0]) != BSTR_OK)
+    {
+        errno = EINVAL;
+        ERROR_PRINT("%s and %s for different blocks %s <-> %s", bdata(&bkeybegin), bdata(&bkeyend), bdata(beginArgs->entry[0]), bdata(endArgs->entry[0]));
+        bstrListDestroy(beginArgs);
+        bstrListDestroy(endArgs);
+        return -EINVAL;
+    }
+    bstrListDestroy(endArgs);
+    // List of all PREFETCH arguments:
+    // 0: name
+    // 1: streams separated by spaces
+    // 2: <distance> [lines|iters], iterations of the loop if no unit is given
+    // 3: hint
+
+    // The prefetches are added to the first loop in the block, which is parsed in the next round
+    for (int i = 1; i < code->qty-1; i++)
+    {
+        if (has_prefix(code->entry[i], &bkeyloop))
+        {
+            loopline = i;
+            break;
+        }
+    }
+    if (loopline < 0)
+    {
+        errno = EINVAL;
+        ERROR_PRINT("No %s in %s block %s", bdata(&bkeyloop), bdata(&bkeybegin), bdata(beginArgs->entry[0]));
+        bstrListDestroy(beginArgs);
+        return -EINVAL;
+    }
+    struct bstrList* loopArgs = get_argList(code->entry[loopline]);
+    struct bstrList* startloop = (loopArgs->qty == 5 ? bsplittrim(loopArgs->entry[1], '=') : bstrListCreate());
+    if (startloop->qty != 2)
+    {
+        errno = EINVAL;
+        ERROR_PRINT("Invalid %s line in %s block: %s", bdata(&bkeyloop), bdata(&bkeybegin), bdata(code->entry[loopline]));
+        err = -EINVAL;
+    }
+    if (err == 0)
+    {
+        err = get_value(config, loopArgs->entry[4], &step);
+    }
+
+    // Distance with an optional unit
+    struct bstrList* streams = bstrListCreate();
+    struct bstrList* tmp = bsplittrim(beginArgs->entry[2], ' ');
+    struct bstrList* dist = bstrListCreate();
+    for (int i = 0; i < tmp->qty; i++)
+    {
+        if (blength(tmp->entry[i]) > 0) bstrListAdd(dist, tmp->entry[i]);
+    }
+    bstrListDestroy(tmp);
+    if (err == 0 && (dist->qty < 1 || dist->qty > 2 || (dist->qty == 2 && bstrcmp(dist->entry[1], &bunitlines) != BSTR_OK && bstrcmp(dist->entry[1], &bunititers) != BSTR_OK)))
+    {
+        errno = EINVAL;
+        ERROR_PRINT("Invalid distance '%s' in %s line, use <distance> [lines|iters]", bdata(beginArgs->entry[2]), bdata(&bkeybegin));
+        err = -EINVAL;
+    }
+    if (err == 0)
+    {
+        err = get_value(config, dist->entry[0], &distance);
+    }
+    if (err == 0 && (distance < 0 || step <= 0))
+    {
+        errno = EINVAL;
+        ERROR_PRINT("Invalid distance %ld or loop step %ld in %s block %s", distance, step, bdata(&bkeybegin), bdata(beginArgs->entry[0]));
+        err = -EINVAL;
+    }
+
+    // The streams must be streams of the kernel, their element size scales the loop register
+    tmp = bsplittrim(beginArgs->entry[1], ' ');
+    for (int i = 0; i < tmp->qty && err == 0; i++)
+    {
+        if (blength(tmp->entry[i]) == 0) continue;
+        int found = 0;
+        for (int s = 0; s < config->num_streams; s++)
+        {
+            if (bstrcmp(config->streams[s].name, tmp->entry[i]) == BSTR_OK)
+            {
+                found = 1;
+                break;
+            }
+        }
+        if (!found)
+        {
+            errno = EINVAL;
+            ERROR_PRINT("Unknown stream %s in %s line", bdata(tmp->entry[i]), bdata(&bkeybegin));
+            err = -EINVAL;
+        }
+        bstrListAdd(streams, tmp->entry[i]);
+    }
+    bstrListDestroy(tmp);
+    if (err == 0 && streams->qty == 0)
+    {
+        errno = EINVAL;
+        ERROR_PRINT("No streams in %s line: %s", bdata(&bkeybegin), bdata(code->entry[0]));
+        err = -EINVAL;
+    }
+
+    if (err == 0)
+    {
+        toComment(out, code->entry[0]);
+        for (int i = 1; i <= loopline; i++)
+        {
+            bstrListAdd(out, code->entry[i]);
+        }
+        // A distance of 0 prefetches the lines of the current iteration, so the instruction count stays the same in a sweep
+        for (int s = 0; s < streams->qty && err == 0; s++)
+        {
+            TestConfigStream* str = NULL;
+            for (int j = 0; j < config->num_streams; j++)
+            {
+                if (bstrcmp(config->streams[j].name, streams->entry[s]) == BSTR_OK)
+                {
+                    str = &config->streams[j];
+                }
+            }
+            int elemsize = (int)getsizeof(str->type);
+            long iter_bytes = step * elemsize;
+            long offset = (dist->qty == 2 && bstrcmp(dist->entry[1], &bunitlines) == BSTR_OK ? distance * PREFETCH_LINE_BYTES : distance * iter_bytes);
+            // One prefetch per cache line that an iteration touches
+            for (long b = 0; b < iter_bytes; b += PREFETCH_LINE_BYTES)
+            {
+                err = prefetch(out, beginArgs->entry[3], streams->entry[s], startloop->entry[0], elemsize, offset + b);
+                if (err < 0) break;
+            }
+        }
+        for (int i = loopline+1; i < code->qty-1; i++)
+        {
+            bstrListAdd(out, code->entry[i]);
+        }
+        toComment(out, code->entry[code->qty-1]);
+    }
+
+    // Cleaup used data structures
+    bstrListDestroy(dist);
+    bstrListDestroy(streams);
+    bstrListDestroy(startloop);
+    bstrListDestroy(loopArgs);
+    bstrListDestroy(beginArgs);
+    return err;
+}
+
+
+#endif /* PTT_KEYWORD_PREFETCH_H */
@@ -0,0 +1,415 @@
+/*
+ * =======================================================================================
+ *
+ *      Filename:  ptt_keyword_unroll.h
+ *
+ *      Description:  Header file for the keyword UNROLL & UNROLLEND
+ *
+ *      Version:   <VERSION>
+ *      Released:  <DATE>
+ *
+ *      Author:   Thomas Gruber (tg), thomas.roehl@googlemail.com
+ *      Project:  likwid-bench
+ *
+ *      Copyright (C) 2019 RRZE, University Erlangen-Nuremberg
+ *
+ *      This program is free software: you can redistribute it and/or modify it under
+ *      the terms of the GNU General Public License as published by the Free Software
+ *      Foundation, either version 2 of the License, or (at your option) any later
+ *      version.
+ *
+ *      This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ *      WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ *      PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along with
+ *      this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * =======================================================================================
+ */
+
+#ifndef PTT_KEYWORD_UNROLL_H
+#define PTT_KEYWORD_UNROLL_H
+
+#include <ctype.h>
+
+#include "test_types.h"
+#include "bstrlib.h"
+#include "bstrlib_helper.h"
+#include "error.h"
+
+/* Upper limit of the vector register indices and of the unroll factor */
+#define UNROLL_MAX_REGISTERS 64
+#define UNROLL_MAX_FACTOR 64
+
+static int _unroll_is_word(bstring line, int pos)
+{
+    if (pos < 0 || pos >= blength(line)) return 0;
+    char c = bchar(line, pos);
+    return (isalnum(c) || c == '_');
+}
+
+/*
+ * Finds the next vector register <prefix><index> at or after pos. Returns its position or -1,
+ * len is the length of the whole register name
+ */
+static int _unroll_next_register(bstring line, int pos, int* len, int* index)
+{
+    for (int p = pos; p < blength(line); p++)
+    {
+        if (_unroll_is_word(line, p-1)) continue;
+        for (int k = 0; blength(&VectorRegisters[k]) > 0; k++)
+        {
+            int plen = blength(&VectorRegisters[k]);
+            if (p + plen >= blength(line) || memcmp(bdata(line) + p, bdata(&VectorRegisters[k]), plen) != 0)
+            {
+                continue;
+            }
+            int d = p + plen;
+            int idx = 0;
+            while (d < blength(line) && isdigit(bchar(line, d)) && d - (p + plen) < 2)
+            {
+                idx = idx * 10 + (bchar(line, d) - '0');
+                d++;
+            }
+            if (d == p + plen || _unroll_is_word(line, d) || idx >= UNROLL_MAX_REGISTERS) continue;
+            *len = d - p;
+            *index = idx;
+            return p;
+        }
+    }
+    return -1;
+}
+
+static void _unroll_mark_registers(bstring line, int* used)
+{
+    int pos = 0, len = 0, idx = 0;
+    while ((pos = _unroll_next_register(line, pos, &len, &idx)) >= 0)
+    {
+        used[idx] = 1;
+        pos += len;
+    }
+}
+
+/* Copy of the line with the vector register indices replaced by map[index] */
+static bstring _unroll_rename(bstring line, int* map)
+{
+    bstring out = bfromcstr("");
+    int last = 0, pos = 0, len = 0, idx = 0;
+    while ((pos = _unroll_next_register(line, pos, &len, &idx)) >= 0)
+    {
+        int digits = (idx >= 10 ? 2 : 1);
+        bstring pre = bmidstr(line, last, pos + len - digits - last);
+        bconcat(out, pre);
+        bdestroy(pre);
+        bstring reg = bformat("%d", map[idx]);
+        bconcat(out, reg);
+        bdestroy(reg);
+        pos += len;
+        last = pos;
+    }
+    bstring post = bmidstr(line, last, blength(line) - last);
+    bconcat(out, post);
+    bdestroy(post);
+    return out;
+}
+
+/* Element size of the first stream named in the memory operand, 0 if there is none */
+static int _unroll_stream_elemsize(TestConfig_t config, bstring operand)
+{
+    for (int s = 0; s < config->num_streams; s++)
+    {
+        bstring name = config->streams[s].name;
+        int pos = 0;
+        while ((pos = binstr(operand, pos, name)) != BSTR_ERR)
+        {
+            if (!_unroll_is_word(operand, pos-1) && !_unroll_is_word(operand, pos + blength(name)))
+            {
+                return (int)getsizeof(config->streams[s].type);
+            }
+            pos += blength(name);
+        }
+    }
+    return 0;
+}
+
+/* Adds bytes to the displacement of every memory operand [...] of a stream in the line */
+static void _unroll_displace(TestConfig_t config, bstring line, long elems)
+{
+    int open = 0;
+    while ((open = bstrchrp(line, '[', open)) != BSTR_ERR)
+    {
+        int close = bstrchrp(line, ']', open);
+        if (close == BSTR_ERR) break;
+        bstring inner = bmidstr(line, open + 1, close - open - 1);
+        int elemsize = _unroll_stream_elemsize(config, inner);
+        if (elemsize > 0 && elems > 0)
+        {
+            long delta = elems * elemsize;
+            int op = -1;
+            for (int i = blength(inner) - 1; i > 0 && op < 0; i--)
+            {
+                if (bchar(inner, i) == '+' || bchar(inner, i) == '-') op = i;
+            }
+            bstring head = NULL;
+            long disp = 0;
+            if (op > 0)
+            {
+                bstring tail = bmidstr(inner, op + 1, blength(inner) - op - 1);
+                btrimws(tail);
+                char* end = NULL;
+                long x = strtol(bdata(tail), &end, 0);
+                if (blength(tail) > 0 && *end == '\0')
+                {
+                    // The last term is a number, it is replaced by the new displacement
+                    disp = (bchar(inner, op) == '-' ? -x : x);
+                    head = bmidstr(inner, 0, op);
+                    brtrimws(head);
+                }
+                bdestroy(tail);
+            }
+            if (!head)
+            {
+                head = bstrcpy(inner);
+                brtrimws(head);
+            }
+            disp += delta;
+            bstring newinner = bformat("%s %c %ld", bdata(head), (disp < 0 ? '-' : '+'), (disp < 0 ? -disp : disp));
+            breplace(line, open + 1, close - open - 1, newinner, ' ');
+            close = open + 1 + blength(newinner);
+            bdestroy(newinner);
+            bdestroy(head);
+        }
+        bdestroy(inner);
+        open = close + 1;
+    }
+}
+
+int parse_unroll(TestConfig_t config, struct bstrList* code, struct bstrList* out)
+{
+    int err = 0;
+    int loopline = -1;
+    int loopendline = -1;
+    long factor = 0;
+    long step = 0;
+    struct tagbstring bkeybegin = bsStatic("UNROLL");
+    struct tagbstring bkeyend = bsStatic("UNROLLEND");
+    struct tagbstring bkeyloop = bsStatic("LOOP");
+    struct tagbstring bkeyloopend = bsStatic("LOOPEND");
+    for (int i = 0; i < code->qty; i++)
+    {
+        DEBUG_PRINT(DEBUGLEV_DEVELOP, "UNROLL: %s", bdata(code->entry[i]));
+    }
+    // First we do some basic checks
+    // Does the first line start with 'UNROLL'
+    if (!has_prefix(code->entry[0], &bkeybegin))
+    {
+        errno = EINVAL;
+        ERROR_PRINT("First line does not start with %s", bdata(&bkeybegin));
+        return -EINVAL;
+    }
+    // Does the last line start with 'UNROLLEND'
+    if (!has_prefix(code->entry[code->qty-1], &bkeyend))
+    {
+        errno = EINVAL;
+        ERROR_PRINT("Last line does not start with %s", bdata(&bkeyend));
+        return -EINVAL;
+    }
+    // Now get a list of all arguments in the first line -> UNROLL(arg0, arg1)
+    struct bstrList* beginArgs = get_argList(code->entry[0]);
+    if (!beginArgs)
+    {
+        errno = EINVAL;
+        ERROR_PRINT("Arguments missing in %s line: %s", bdata(&bkeybegin), bdata(code->entry[0]));
+        return -EINVAL;
+    }
+    // The UNROLL line should have 2 arguments
+    if (beginArgs->qty != 2)
+    {
+        errno = EINVAL;
+        ERROR_PRINT("Arguments missing in %s line: %s", bdata(&bkeybegin), bdata(code->entry[0]));
+        bstrListDestroy(beginArgs);
+        return -EINVAL;
+    }
+    // Now get a list of all arguments in the last line -> UNROLLEND(arg0)
+    struct bstrList* endArgs = get_argList(code->entry[code->qty-1]);
+    if (!endArgs)
+    {
+        errno = EINVAL;
+        ERROR_PRINT("Arguments missing in %s line: %s", bdata(&bkeyend), bdata(code->entry[code->qty-1]));
+        bstrListDestroy(beginArgs);
+        return -EINVAL;
+    }
+    // Do both lines have the same first argument aka the keyword label
+    if (bstrcmp(beginArgs->entry[0], endArgs->entry[0]) != BSTR_OK)
+    {
+        errno = EINVAL;
+        ERROR_PRINT("%s and %s for different blocks %s <-> %s", bdata(&bkeybegin), bdata(&bkeyend), bdata(beginArgs->entry[0]), bdata(endArgs->entry[0]));
+        bstrListDestroy(beginArgs);
+        bstrListDestroy(endArgs);
+        return -EINVAL;
+    }
+    bstrListDestroy(endArgs);
+    // List of all UNROLL arguments:
+    // 0: name
+    // 1: factor
+
+    err = get_value(config, beginArgs->entry[1], &factor);
+    if (err == 0 && (factor < 1 || factor > UNROLL_MAX_FACTOR))
+    {
+        errno = EINVAL;
+        ERROR_PRINT("Invalid unroll factor %ld in %s line, allowed 1 to %d", factor, bdata(&bkeybegin), UNROLL_MAX_FACTOR);
+        err = -EINVAL;
+    }
+    if (err < 0)
+    {
+        bstrListDestroy(beginArgs);
+        return err;
+    }
+
+    // The body of the first loop in the block is unrolled, the loop itself is parsed in the next round
+    bstring loopname = NULL;
+    for (int i = 1; i < code->qty-1; i++)
+    {
+        if (loopline < 0 && has_prefix(code->entry[i], &bkeyloop))
+        {
+            loopline = i;
+            loopname = get_name(code->entry[i]);
+        }
+        else if (loopline >= 0 && has_prefix(code->entry[i], &bkeyloopend))
+        {
+            bstring n = get_name(code->entry[i]);
+            int match = (bstrcmp(n, loopname) == BSTR_OK);
+            bdestroy(n);
+            if (match)
+            {
+                loopendline = i;
+                break;
+            }
+        }
+    }
+    if (loopname) bdestroy(loopname);
+    if (loopline < 0 || loopendline < 0)
+    {
+        errno = EINVAL;
+        ERROR_PRINT("No %s ... %s in %s block %s", bdata(&bkeyloop), bdata(&bkeyloopend), bdata(&bkeybegin), bdata(beginArgs->entry[0]));
+        bstrListDestroy(beginArgs);
+        return -EINVAL;
+    }
+    struct bstrList* loopArgs = get_argList(code->entry[loopline]);
+    if (loopArgs->qty != 5)
+    {
+        errno = EINVAL;
+        ERROR_PRINT("Invalid %s line in %s block: %s", bdata(&bkeyloop), bdata(&bkeybegin), bdata(code->entry[loopline]));
+        err = -EINVAL;
+    }
+    if (err == 0)
+    {
+        err = get_value(config, loopArgs->entry[4], &step);
+    }
+    if (err == 0 && step <= 0)
+    {
+        errno = EINVAL;
+        ERROR_PRINT("Invalid loop step %ld in %s block %s", step, bdata(&bkeybegin), bdata(beginArgs->entry[0]));
+        err = -EINVAL;
+    }
+    if (err < 0)
+    {
+        bstrListDestroy(loopArgs);
+        bstrListDestroy(beginArgs);
+        return err;
+    }
+
+    /*
+     * Vector registers used outside of the block (like a scalar broadcast before the loop) keep
+     * their names in all copies. The registers of the body are renamed from a pool that starts
+     * with the registers of the body and continues with the free ones.
+     */
+    int fixed[UNROLL_MAX_REGISTERS] = {0};
+    int used[UNROLL_MAX_REGISTERS] = {0};
+    int block[UNROLL_MAX_REGISTERS];
+    int pool[UNROLL_MAX_REGISTERS];
+    int num_block = 0;
+    int num_pool = 0;
+    struct bstrList* all = bsplittrim(config->code, '\n');
+    int inblock = 0;
+    for (int i = 0; i < all->qty; i++)
+    {
+        if (has_prefix(all->entry[i], &bkeybegin) || has_prefix(all->entry[i], &bkeyend))
+        {
+            bstring n = get_name(all->entry[i]);
+            if (bstrcmp(n, beginArgs->entry[0]) == BSTR_OK)
+            {
+                inblock = has_prefix(all->entry[i], &bkeybegin);
+            }
+            bdestroy(n);
+            continue;
+        }
+        if (!inblock) _unroll_mark_registers(all->entry[i], fixed);
+    }
+    bstrListDestroy(all);
+    for (int i = loopline+1; i < loopendline; i++)
+    {
+        int pos = 0, len = 0, idx = 0;
+        while ((pos = _unroll_next_register(code->entry[i], pos, &len, &idx)) >= 0)
+        {
+            if (!fixed[idx] && !used[idx])
+            {
+                used[idx] = 1;
+                block[num_block++] = idx;
+                pool[num_pool++] = idx;
+            }
+            pos += len;
+        }
+    }
+    for (int r = 0; r < num_vector_registers(code) && r < UNROLL_MAX_REGISTERS; r++)
+    {
+        if (!fixed[r] && !used[r]) pool[num_pool++] = r;
+    }
+    if (num_block * factor > num_pool && num_block > 0)
+    {
+        WARN_PRINT("The %ld copies of block %s need %ld vector registers, %d are free. Registers are reused", factor, bdata(beginArgs->entry[0]), num_block * factor, num_pool);
+    }
+
+    toComment(out, code->entry[0]);
+    for (int i = 1; i < loopline; i++)
+    {
+        bstrListAdd(out, code->entry[i]);
+    }
+    bstring newloop = bformat("%s(%s, %s, %s, %s, %ld)", bdata(&bkeyloop), bdata(loopArgs->entry[0]), bdata(loopArgs->entry[1]), bdata(loopArgs->entry[2]), bdata(loopArgs->entry[3]), step * factor);
+    bstrListAdd(out, newloop);
+    bdestroy(newloop);
+    for (int c = 0; c < factor; c++)
+    {
+        int map[UNROLL_MAX_REGISTERS];
+        for (int r = 0; r < UNROLL_MAX_REGISTERS; r++)
+        {
+            map[r] = r;
+        }
+        for (int j = 0; j < num_block; j++)
+        {
+            map[block[j]] = pool[(c * num_block + j) % num_pool];
+        }
+        // Each copy works on the elements of the next loop step
+        for (int i = loopline+1; i < loopendline; i++)
+        {
+            bstring line = _unroll_rename(code->entry[i], map);
+            _unroll_displace(config, line, c * step);
+            bstrListAdd(out, line);
+            bdestroy(line);
+        }
+    }
+    for (int i = loopendline; i < code->qty-1; i++)
+    {
+        bstrListAdd(out, code->entry[i]);
+    }
+    toComment(out, code->entry[code->qty-1]);
+
+    // Cleaup used data structures
+    bstrListDestroy(loopArgs);
+    bstrListDestroy(beginArgs);
+    return 0;
+}
+
+
+#endif /* PTT_KEYWORD_UNROLL_H */
@@ -33,6 +33,8 @@
 #ifndef WITH_BSTRING
 #define WITH_BSTRING
 #endif
+#include <stdint.h>
+
 #include "map.h"
 #include "test_types.h"
 #include "bstrlib.h"
@@ -71,5 +73,22 @@ int replace_all(RuntimeWorkgroupResult* result, bstring formula, struct bstrList
 void destroy_result(RuntimeWorkgroupResult* result);
 void print_result(RuntimeWorkgroupResult* result);
 
+/*
+ * Access by symbol ID (see symbols.h). Values are doubles, variables set by ID are integers.
+ * The getters return -ENOENT if the result has no slot for the ID.
+ */
+int set_value_by_id(RuntimeWorkgroupResult* result, int id, double value);
+int get_value_by_id(RuntimeWorkgroupResult* result, int id, double* value);
+int set_variable_by_id(RuntimeWorkgroupResult* result, int id, int64_t value);
+int get_variable_by_id(RuntimeWorkgroupResult* result, int id, double* value);
+/* Text of a slot as it is substituted into formulas, NULL if missing. The caller destroys it */
+bstring get_value_text(RuntimeWorkgroupResult* result, int id);
+bstring get_variable_text(RuntimeWorkgroupResult* result, int id);
+
+/* Calls func for each set value or variable in the order of the symbol IDs */
+typedef void (*result_foreach_func)(int id, bstring name, mpointer user_data);
+void foreach_value(RuntimeWorkgroupResult* result, result_foreach_func func, mpointer user_data);
+void foreach_variable(RuntimeWorkgroupResult* result, result_foreach_func func, mpointer user_data);
+
 int fill_results(RuntimeConfig* runcfg);
 #endif /* RESULTS_H */
@@ -0,0 +1,35 @@
+// scaling.h
+#ifndef SCALING_H
+#define SCALING_H
+
+#include "bstrlib.h"
+#include "table.h"
+#include "test_types.h"
+
+/* Fraction of the peak rate from which a thread count counts as saturating */
+#define SCALING_DEFAULT_SATURATION 0.9
+
+/*
+ * Thread scaling runs the kernel with 1 to n hwthreads of a workgroup:
+ *   compact  - in the order of the workgroup definition
+ *   scatter  - round-robin over the NUMA domains, one hwthread per core before the SMT siblings
+ */
+int scaling_parse_order(const char* str, ScalingOrder* order);
+const char* scaling_order_name(ScalingOrder order);
+
+/* Scatter order of list, domains and cores hold the NUMA domain and the core of each entry */
+int scaling_scatter(int* list, const int* domains, const int* cores, int count);
+/* Reorders the hwthreads of a workgroup with the topology of the system */
+int scaling_order_hwthreads(int* list, int count, ScalingOrder order);
+
+/* Index of the first point whose rate reaches fraction of the peak of all points */
+int scaling_saturation(const double* rates, int count, double fraction);
+
+/*
+ * Table with one row per thread count. rates[p * metrics->qty + m] is the aggregate of metric m
+ * with p + 1 threads, hwthreads[p] the hwthread added at that point. Every metric gets the
+ * aggregate, the rate per thread and the parallel efficiency against a single thread.
+ */
+int scaling_table(struct bstrList* metrics, int num_points, const int* hwthreads, const double* rates, Table** table);
+
+#endif /* SCALING_H */
@@ -0,0 +1,101 @@
+// stats.h
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+
+/* Confidence level used for the interval of the mean and the relative error stopping rule */
+#define STATS_CONFIDENCE 0.95
+/* Number of samples needed before the relative error is considered meaningful */
+#define STATS_MIN_SAMPLES 3
+
+/*
+ * Aggregation of a set of values (e.g. a metric of all threads of a workgroup):
+ *   min, max, sum, mean
+ *   median  - the lower one of the two middle values for an even count like the calculator
+ *   stddev  - sample standard deviation, 0 for a single value
+ *   hmean   - harmonic mean, the mean of rates that ran for the same amount of work
+ *   p<N>    - percentile N between 0 and 100 (e.g. p95), interpolated like in sample_stats
+ */
+typedef enum {
+    AGGREGATION_MIN = 0,
+    AGGREGATION_MAX,
+    AGGREGATION_SUM,
+    AGGREGATION_MEDIAN,
+    AGGREGATION_MEAN,
+    AGGREGATION_STDDEV,
+    AGGREGATION_HMEAN,
+    AGGREGATION_PERCENTILE,
+    MAX_AGGREGATION
+} AggregationType;
+
+typedef struct {
+    AggregationType type;
+    double percentile;  // fraction between 0 and 1 of AGGREGATION_PERCENTILE
+} SampleAggregation;
+
+/* Aggregations of the workgroup and global results if no others are selected */
+#define STATS_DEFAULT_AGGREGATIONS "min,max,sum,median"
+
+typedef struct {
+    int count;
+    double min;
+    double max;
+    double median;
+    double mean;
+    double stddev;
+    double p5;
+    double p95;
+    double ci;
+} SampleStats;
+
+/*
+ * Timing of a group of threads from their start and stop timestamps in nanoseconds:
+ *   start_skew - time between the first and the last thread starting
+ *   stop_skew  - time between the first and the last thread stopping
+ *   overlap    - window in which all threads were running, 0 if there is none
+ *   span       - window from the first start to the last stop
+ */
+typedef struct {
+    double start_skew;
+    double stop_skew;
+    double overlap;
+    double span;
+} OverlapStats;
+
+/*
+ * Summary of a set of samples (e.g. the runtime of each repetition in nanoseconds).
+ * The samples are not modified, percentiles are interpolated linearly between the
+ * closest ranks and ci is the half-width of the confidence interval of the mean.
+ */
+int sample_stats(const uint64_t* samples, int count, SampleStats* stats);
+
+int sample_overlap(const uint64_t* starts, const uint64_t* stops, int count, OverlapStats* stats);
+
+/*
+ * Relative error (half-width of the confidence interval divided by the mean) from
+ * running sums as provided by the Welford algorithm: count samples with mean and
+ * m2 as the sum of squared differences from the mean. Returns a negative value if
+ * the relative error cannot be determined yet.
+ */
+double sample_relerror(int count, double mean, double m2);
+
+/* Two-sided Student's t quantile for the confidence level with count - 1 degrees of freedom */
+double sample_tquantile(int count);
+
+int sample_parse_aggregation(const char* name, SampleAggregation* agg);
+
+/*
+ * Value of rank k (starting at 0) of count values in O(count) on average. The values are
+ * reordered, all before k are smaller or equal and all after k larger or equal.
+ */
+double sample_select(double* values, int count, int k);
+
+/*
+ * Aggregates count values without sorting them. The values are reordered and nan values,
+ * e.g. of metrics that could not be evaluated for a thread, are skipped. Returns -EINVAL
+ * if no value is left.
+ */
+int sample_aggregate(const SampleAggregation* agg, double* values, int count, double* result);
+
+#endif /* STATS_H */
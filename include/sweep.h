@@ -0,0 +1,30 @@
+// sweep.h
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "bstrlib.h"
+
+/* Upper limit of points in one sweep */
+#define SWEEP_MAX_POINTS 4096
+/* Factor of a geometric range without a step */
+#define SWEEP_DEFAULT_FACTOR 2.0
+
+/*
+ * Expands the value of a kernel parameter into the points of a sweep:
+ *   <value>                    - a single point, returned as given
+ *   <v0>,<v1>,...              - a list of points, returned as given
+ *   <start>:<end>[:<step>]     - all points from start up to end. The step is x<factor> for a
+ *                                geometric range (default x2) or [+]<increment> for a linear one
+ * The bounds and the increment are plain numbers or sizes with a unit (B, KB, MiB, ...). If one
+ * of them has a unit, the points of a range are returned in bytes (e.g. '4096B').
+ * Returns the number of points or a negative error code.
+ */
+int sweep_parse(const_bstring str, struct bstrList** points);
+
+/* Value of a plain number or a size with unit in bytes, has_unit tells which one it was */
+int sweep_value(const_bstring str, size_t* value, int* has_unit);
+
+/* Index of the largest point. The streams are allocated for it, smaller points reuse them */
+int sweep_largest(struct bstrList* points);
+
+#endif /* SWEEP_H */
@@ -0,0 +1,29 @@
+// symbols.h
+#ifndef SYMBOLS_H
+#define SYMBOLS_H
+
+#include <stdint.h>
+
+#include "bstrlib.h"
+
+/*
+ * Names of values and variables are interned once per run. Each name gets a symbol ID,
+ * the IDs count up from 0 in the order the names are added, so they can index flat
+ * arrays. The lookups take the hash of the name, which callers compute once with
+ * symbol_hash() for names they use repeatedly.
+ */
+uint32_t symbol_hash(const_bstring name);
+
+/* Symbol ID of name, the name is added if it is new */
+int symbol_intern(const_bstring name, uint32_t hash);
+/* Symbol ID of name or -ENOENT if it was never added */
+int symbol_find(const_bstring name, uint32_t hash);
+
+/* Name of a symbol, owned by the symbol table */
+bstring symbol_name(int id);
+int symbol_count();
+
+/* Removes all symbols, the IDs of earlier names are invalid afterwards */
+void symbol_reset();
+
+#endif /* SYMBOLS_H */
@@ -12,6 +12,7 @@ typedef struct {
     struct bstrList* headers;
     struct bstrList* rows;
     int* col_widths;
+    int* keep_format;
     int num_cols;
 } Table;
 
@@ -28,6 +29,7 @@ static void write_indent(FILE* file, int level)
 int table_destroy(Table* table);
 int table_create(struct bstrList* headers, Table** table);
 int table_addrow(Table* table, struct bstrList* row);
+int table_keep_format(Table* table, int col);
 int table_print(FILE* output, Table* table, int transpose);
 int table_to_csv(FILE* output, Table* table, const char* fname, int max_cols, int transpose);
 int table_to_json(FILE* output, Table* table, const char* fname, const char* tname);
@@ -19,6 +19,7 @@ static struct tagbstring bthreadid = bsStatic("THREAD_ID");
 static struct tagbstring bthreadcpu = bsStatic("THREAD_CPU"); 
 static struct tagbstring bglobalid = bsStatic("GLOBAL_ID");
 static struct tagbstring bbytesperiter = bsStatic("BYTES_PER_ITER");
+static struct tagbstring bcycles = bsStatic("CYCLES");
 
 static struct tagbstring btrue = bsStatic("true");
 static struct tagbstring bfalse = bsStatic("false");
@@ -49,6 +50,25 @@ static struct tagbstring bstats2[] =
 
 static int stats2_count = 1;
 
+/*
+ * bstats3 are the statistics of the repetitions, which are reported in addition to bstats1
+ * or bstats2 if more than one repetition is requested. They sort after "time", so the
+ * values in `update_results` are appended to the ones of bstats1 or bstats2
+ */
+static struct tagbstring bstats3[] =
+{
+    bsStatic("time_ci"),
+    bsStatic("time_mean"),
+    bsStatic("time_median"),
+    bsStatic("time_min"),
+    bsStatic("time_p5"),
+    bsStatic("time_p95"),
+    bsStatic("time_samples"),
+    bsStatic("time_stddev"),
+};
+
+static int stats3_count = 8;
+
 static struct tagbstring bvc_switch = bsStatic("voluntary_ctxt_switches");
 static struct tagbstring bnvc_switch = bsStatic("nonvoluntary_ctxt_switches");
 
@@ -43,6 +43,7 @@ typedef struct {
     bstring                 description;
     struct bstrList*        options;
     bstring                 defvalue;
+    bstring                 value;  // current value, kernel keywords like PREFETCH can use it
 } TestConfigParameter;
 
 typedef enum {
@@ -62,6 +63,25 @@ typedef enum {
 } TestConfigStreamFlag;
 #define MIN_STREAM_TYPE 0
 
+typedef enum {
+    STREAM_PLACEMENT_DEFAULT = 0,
+    STREAM_PLACEMENT_LOCAL,
+    STREAM_PLACEMENT_INTERLEAVE,
+    STREAM_PLACEMENT_BIND,
+    STREAM_PLACEMENT_FIRSTTOUCH,
+    MAX_STREAM_PLACEMENT
+} StreamPlacement;
+
+typedef enum {
+    STREAM_ALLOCATION_HEAP = 0,
+    STREAM_ALLOCATION_THP,
+    STREAM_ALLOCATION_NOTHP,
+    STREAM_ALLOCATION_HUGETLB_2M,
+    STREAM_ALLOCATION_HUGETLB_1G,
+    STREAM_ALLOCATION_HUGETLBFS,
+    MAX_STREAM_ALLOCATION
+} StreamAllocation;
+
 typedef union {
     float       fval;
     double      dval;
@@ -72,6 +92,36 @@ typedef union {
     int64_t     i64val;
 } TestConfigStreamData;
 
+typedef enum {
+    STREAM_FILL_CONSTANT = 0,
+    STREAM_FILL_LINEAR,
+    STREAM_FILL_RANDOM,
+    STREAM_FILL_PATTERN,
+    STREAM_FILL_CHASE,
+    MAX_STREAM_FILL
+} StreamFillMode;
+
+/* Order of the cache-line nodes in the cycle of a pointer-chase stream */
+typedef enum {
+    CHASE_ORDER_RANDOM = 0,
+    CHASE_ORDER_PAGE,
+    CHASE_ORDER_TLB,
+    MAX_CHASE_ORDER
+} StreamChaseOrder;
+
+#define STREAM_FILL_MAX_PATTERN 16
+
+typedef struct {
+    StreamFillMode mode;
+    TestConfigStreamData value;
+    double start;
+    double step;
+    uint64_t seed;
+    int num_pattern;
+    double pattern[STREAM_FILL_MAX_PATTERN];
+    StreamChaseOrder order;
+} StreamFill;
+
 typedef struct {
     bstring                 name;
     int                     num_dims;
@@ -82,6 +132,9 @@ typedef struct {
     struct bstrList*        sizes;
     struct bstrList*        offsets;
     bool                    initialization;
+    bstring                 placement;
+    bstring                 allocation;
+    bstring                 binit;
 } TestConfigStream;
 
 typedef struct {
@@ -89,6 +142,17 @@ typedef struct {
     bstring                 value;
 } TestConfigVariable;
 
+/*
+ * A knob of the kernel code like the store instruction or the prefetch distance. Its name is
+ * replaced in the code by the selected option, the first option is the default.
+ */
+typedef struct {
+    bstring                 name;
+    bstring                 description;
+    struct bstrList*        options;
+    int                     selected;
+} TestConfigTunable;
+
 typedef struct {
     bstring                 name;
     bstring                 description;
@@ -104,6 +168,8 @@ typedef struct {
     TestConfigVariable *    vars;
     int                     num_metrics;
     TestConfigVariable *    metrics;
+    int                     num_tunables;
+    TestConfigTunable *     tunables;
     struct bstrList*        flags;
     bool                    requirewg;
 } TestConfig;
@@ -124,37 +190,49 @@ typedef struct {
     int dims;
     Bitmap flags;
     int id;
-    int (*init)(void* ptr, int state, TestConfigStreamType type, int dims, size_t* dimsizes, void* init_val, ...);
     TestConfigStreamType type;
     TestConfigStreamData data;
     void* init_val;
+    StreamFill fill;
     bool initialization;
+    StreamPlacement placement;
+    int placement_node;
+    StreamAllocation allocation;
+    bstring allocation_path;
+    size_t alloc_size;
+    size_t capacity;    // bytes of the array memory, smaller arrays of a sweep are carved out of it
 } RuntimeStreamConfig;
 
+/* Type of the slot of a name in a result, see symbols.h for the IDs that index the slots */
+typedef enum {
+    RESULT_SLOT_EMPTY = 0,
+    RESULT_SLOT_DOUBLE,
+    RESULT_SLOT_INT,
+    RESULT_SLOT_TEXT,   // variables that are no integer, e.g. '1.5' or a formula
+} ResultSlotType;
+
+typedef union {
+    int64_t i;
+    double d;       // also the number in a RESULT_SLOT_TEXT, nan if the text is no number
+} ResultSlot;
+
 typedef struct {
-    int num_aggregations;
-    struct tagbstring baggregations[4];
-} Aggregations;
-
-static const Aggregations aggregations = {
-    .num_aggregations = 4,
-    .baggregations = {
-        bsStatic("min"),
-        bsStatic("max"),
-        bsStatic("sum"),
-        bsStatic("median"),
-    }
-};
+    int num_slots;
+    uint8_t* types;
+    ResultSlot* slots;
+    bstring* texts;
+} ResultSlots;
 
 typedef struct {
-    Map_t values;
-    Map_t variables;
+    ResultSlots values;
+    ResultSlots variables;
 } RuntimeWorkgroupResult;
 
 typedef struct {
     bstring name;
     bstring value;
     struct bstrList* values;
+    struct bstrList* sweep;  // points of a sweep, value holds the current one
 } RuntimeParameterConfig;
 
 typedef struct {
@@ -164,6 +242,9 @@ typedef struct {
     bstring compiler;
     void* dlhandle;
     void* function;
+    void* codebuf;
+    size_t codesize;
+    uint64_t hash;
 } RuntimeTestConfig;
 
 typedef enum {
@@ -172,35 +253,91 @@ typedef enum {
     LIKWID_THREAD_COMMAND_INITIALIZE,
     LIKWID_THREAD_COMMAND_RUN,
     LIKWID_THREAD_COMMAND_VERIFY,
+    MAX_LIKWID_THREAD_COMMAND,
 } LikwidThreadCommand;
 
-typedef struct Queue {
+/* Commands in flight per workgroup before the main thread waits for the slowest thread */
+#define THREAD_DISPATCH_SLOTS 16
+#define THREAD_DISPATCH_ALIGN 64
+
+typedef struct {
     LikwidThreadCommand cmd;
-    struct Queue* next;
-} Queue;
+    uint64_t issued;
+    int num_threads;  // threads taking part, the others of the pool only acknowledge the command
+} thread_dispatch_slot_t;
+
+/*
+ * Command broadcast of a workgroup. The main thread writes the command into the slot of the
+ * next generation and increments the generation, which is also the futex word the threads
+ * wait on. Each thread keeps its own count of consumed generations.
+ */
+typedef struct {
+    uint32_t generation __attribute__((aligned(THREAD_DISPATCH_ALIGN)));
+    uint32_t sleepers;
+    thread_dispatch_slot_t slots[THREAD_DISPATCH_SLOTS] __attribute__((aligned(THREAD_DISPATCH_ALIGN)));
+} thread_dispatch_t;
 
 typedef struct {
     LikwidThreadCommand cmd;
-    Queue* head;
-    Queue* tail;
     union {
         int (*exit)();
         void (*run)();
     } cmdfunc;
-    int done;
+    uint32_t started;       // generations picked up, a command is running while it is ahead of completed
+    uint32_t completed;     // generations completed, the futex word the main thread waits on
+    uint32_t waiters;
+    uint64_t latency[MAX_LIKWID_THREAD_COMMAND];
     pthread_attr_t attr;
-    pthread_mutex_t mutex;
-    pthread_mutexattr_t m_attr;
-    pthread_cond_t cond;
-    pthread_condattr_t c_attr;
-    void* init_val;
 } RuntimeThreadCommand;
 
+typedef enum {
+    BARRIER_PTHREAD = 0,
+    BARRIER_CENTRAL,
+    BARRIER_TREE,
+    BARRIER_DISSEMINATION,
+    MAX_BARRIER
+} BarrierType;
+
+typedef enum {
+    SCALING_NONE = 0,
+    SCALING_COMPACT,
+    SCALING_SCATTER,
+    MAX_SCALING
+} ScalingOrder;
+
+typedef enum {
+    DOMAIN_NONE = 0,
+    DOMAIN_SOCKET,
+    DOMAIN_NUMA,
+    DOMAIN_CORE,
+    MAX_DOMAIN
+} DomainLevel;
+
+struct barrier_node;
+struct barrier_thread;
+
 typedef struct {
     pthread_barrier_t barrier;
     pthread_barrierattr_t b_attr;
+    uint64_t reduce[3];
+    BarrierType type;
+    int num_threads;
+    int num_nodes;
+    int rounds;
+    struct barrier_node* nodes;
+    struct barrier_thread* threads;
 } thread_barrier_t;
 
+/*
+ * Start barrier over the threads of all workgroups, so the timed regions of workgroups running
+ * different kernels begin together. running counts the threads still in their timed repetitions,
+ * the threads that are done keep their kernel running until it drops to zero.
+ */
+typedef struct {
+    thread_barrier_t barrier;
+    int running;
+} thread_sync_t;
+
 typedef enum {
     THREAD_DATA_THREADINIT = 0,
     THREAD_DATA_MAX,
@@ -209,11 +346,25 @@ typedef enum {
 
 #define THREAD_DATA_THREADINIT_FLAG (1<<THREAD_DATA_THREADINIT)
 
+/* Power-of-two buckets of the latency histogram: <1ns, 1-2ns, ..., 512-1024ns, >1024ns */
+#define LATENCY_HIST_BUCKETS 12
+
 typedef struct {
     uint64_t iters;
     uint64_t cycles;
     uint64_t freq;
     uint64_t min_runtime;
+    uint64_t start;     // timestamps in ns of the repetition used for the skew analysis, the same
+    uint64_t stop;      // repetition for all threads, taken before the timer starts and the closing barrier
+    uint64_t* samples;
+    uint64_t* starts;   // timestamps of each repetition
+    uint64_t* stops;
+    int num_samples;
+    int max_samples;
+    double relerror;
+    uint64_t reductions;
+    uint64_t latency[LATENCY_HIST_BUCKETS];    // accesses per bucket of the pointer-chase walk
+    uint64_t latency_samples;
     //const TestConfig_t test;
     int hwthread;
     int flags;
@@ -233,6 +384,8 @@ typedef struct {
     double runtime;
     uint64_t cycles;
     thread_barrier_t* barrier;
+    thread_sync_t* sync;
+    thread_dispatch_t* dispatch;
     thread_data_t data;
     RuntimeThreadCommand* command;
     int num_threads;
@@ -241,14 +394,21 @@ typedef struct {
     int num_streams;
     RuntimeStreamConfig* sdata;
     RuntimeThreadStreamConfig* tstreams;
+    int num_args;
+    uint64_t* args;
+    int timer;
 } RuntimeThreadConfig;
 
 typedef struct {
     bstring str;
     int num_threads;
     int* hwthreads;
+    int max_threads;  // threads in the pool, the first num_threads of them take part in the commands
+    bstring testname;
+    TestConfig_t tcfg;  // kernel of the workgroup, the one of RuntimeConfig unless given with -w <group>@<kernel>
     RuntimeThreadConfig* threads;
     thread_barrier_t barrier;
+    thread_dispatch_t* dispatch;
     RuntimeWorkgroupResult* results;
     RuntimeWorkgroupResult* group_results;
     int num_streams;
@@ -275,8 +435,27 @@ typedef struct {
     bstring compiler;
     bstring kernelfolder;
     bstring tmpfolder;
+    bstring cachefolder;
+    int nocache;
+    int purgecache;
+    int builtinasm;
+    int timer;
+    BarrierType barrier;
+    int barrierbench;
+    ScalingOrder scaling;
+    double saturation;
+    int autotune;
+    bstring batchfile;
+    struct bstrList* aggregations;  // aggregations of the workgroup, global and domain results
+    DomainLevel domains;
+    int repetitions;
+    double relerror;
+    bstring placement;
+    bstring allocation;
+    bstring initialization;
     bstring arraysize;
     TestConfig_t tcfg;
+    thread_sync_t* sync;
     RuntimeWorkgroupResult* global_results;
     struct bstrList* mkstempfiles;
     struct bstrList* benchfiles;
@@ -41,13 +41,27 @@
 
 #include "test_types.h"
 
-#define MIN_ITERATIONS ((size_t)10)
 #define MIN_RUNTIME ((double)1.0)
+#define MAX_REPETITIONS 100
+/* The iteration count is extrapolated from a probe that takes this fraction of the runtime */
+#define CALIBRATION_FRACTION ((double)0.1)
+#define CALIBRATION_PROBES 8
+#define CALIBRATION_MAX_GROWTH ((double)1000.0)
+#define WARMUP_RUNTIME ((double)0.1)
 #define TIMEOUT_SECONDS 60
+/* Polls of the dispatch generation before a waiting thread sleeps on the futex */
+#define DISPATCH_SPIN 20000
 
-int send_cmd(LikwidThreadCommand cmd, RuntimeThreadConfig* thread);
+int broadcast_cmd(LikwidThreadCommand cmd, RuntimeWorkgroupConfig* wg);
+int wait_cmds(RuntimeWorkgroupConfig* wg);
+void report_dispatch(RuntimeWorkgroupConfig* wg);
 int destroy_threads(int num_wgroups, RuntimeWorkgroupConfig* wgroups);
 int update_threads(RuntimeConfig* runcfg);
+int refresh_threads(RuntimeConfig* runcfg);
+int scale_threads(RuntimeConfig* runcfg, RuntimeWorkgroupConfig* wg, int num_threads);
+/* Start barrier of all workgroups, only set up if there is more than one workgroup */
+void start_sync(RuntimeConfig* runcfg);
+void destroy_sync(RuntimeConfig* runcfg);
 int create_threads(int num_wgroups, RuntimeWorkgroupConfig* wgroups);
 int join_threads(int num_wgroups, RuntimeWorkgroupConfig* wgroups);
 
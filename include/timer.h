@@ -46,11 +46,54 @@ typedef enum {
     TIMER_PERF_EVENT
 } TimerEvents;
 
+/* Sources for the frequency of the TIMER_RDTSC counter, in the order they are tried */
+typedef enum {
+    TIMER_FREQ_SOURCE_NONE = 0,
+    TIMER_FREQ_SOURCE_CACHE,
+    TIMER_FREQ_SOURCE_CPUID,
+    TIMER_FREQ_SOURCE_SYSFS,
+    TIMER_FREQ_SOURCE_PERF,
+    TIMER_FREQ_SOURCE_ARCH,
+    TIMER_FREQ_SOURCE_REGRESSION,
+    MAX_TIMER_FREQ_SOURCE
+} TimerFreqSource;
+
+typedef struct {
+    uint64_t        freq;
+    uint64_t        ci;     // half width of the 95% confidence interval in Hz, 0 for nominal values
+    TimerFreqSource source;
+} TimerFreqInfo;
+
+/* Per-boot state file for the calibrated frequency in the user's cache folder, keyed by the kernel's boot_id */
+#define TIMER_FREQ_CACHE_NAME "timer-freq"
+#define TIMER_BOOT_ID_FILE "/proc/sys/kernel/random/boot_id"
+#define TIMER_SYSFS_TSC_KHZ_FILE "/sys/devices/system/cpu/cpu0/tsc_freq_khz"
+
+/* Regression calibration: samples per round, spacing of the first round and target precision */
+#define TIMER_CALIB_SAMPLES 32
+#define TIMER_CALIB_BRACKET_TRIES 5
+#define TIMER_CALIB_SPACING_NS (2 * 1000 * 1000ULL)
+#define TIMER_CALIB_MAX_ROUNDS 4
+#define TIMER_CALIB_TARGET_PPM 10
+
+/* Counters opened for TIMER_PERF_EVENT, the reference cycles are optional */
+#define TIMER_PERF_CYCLES       0
+#define TIMER_PERF_REF_CYCLES   1
+#define TIMER_PERF_NUM_COUNTERS 2
+
+typedef struct {
+    int         fd;
+    void*       page;   // perf_event_mmap_page for reads with rdpmc
+    uint64_t    start;
+    uint64_t    stop;
+} TimerPerfCounter;
+
 typedef struct {
     TimerEvents type;
     Timer       start;
     Timer       stop;
     ClockInfo   ci;
+    TimerPerfCounter perf[TIMER_PERF_NUM_COUNTERS];
 } TimerDataLB;
 
 int lb_timer_init(TimerEvents type, TimerDataLB* tdata);
@@ -61,10 +104,18 @@ void lb_timer_close(TimerDataLB* tdata);
 int lb_timer_as_ns(TimerDataLB* tdata, uint64_t* ns);
 int lb_timer_as_cycles(TimerDataLB* tdata, uint64_t* cycles);
 int lb_timer_as_resolution(TimerDataLB* tdata, uint64_t* resolution);
+int lb_timer_as_freq(TimerDataLB* tdata, uint64_t* freq);
 
 int lb_timer_supports_cycles(TimerEvents type);
 int lb_timer_has_type(TimerEvents type);
+int lb_timer_parse_type(const char* name, TimerEvents* type);
+const char* lb_timer_type_name(TimerEvents type);
 
 int lb_timer_sleep(uint64_t ns);
+uint64_t lb_timer_timestamp(void);
+
+int lb_timer_calibrate(TimerFreqInfo* info);
+int lb_timer_freq_from_source(TimerFreqSource source, TimerFreqInfo* info);
+const char* lb_timer_freq_source_name(TimerFreqSource source);
 
 #endif /* TIMER_H */
@@ -42,6 +42,14 @@ int check_hwthreads();
 int print_hwthreads();
 int get_num_hw_threads();
 int lb_cpustr_to_cpulist(bstring cpustr, int* list, int length);
+int get_hwthread_numa_id(int os_id);
+int get_hwthread_location(int os_id, int* core_id, int* socket_id);
+int get_usable_hwthreads(int* list, int length);
+/* Topology levels whose domains get their own aggregation of the thread results */
+int parse_domain_level(const char* str, DomainLevel* level);
+const char* domain_level_name(DomainLevel level);
+/* ID of the domain of the hwthread at the level, the IDs of cores are unique across sockets */
+int get_hwthread_domain(int os_id, DomainLevel level);
 void destroy_hwthreads();
 
 #ifdef __cplusplus
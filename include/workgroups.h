@@ -38,10 +38,18 @@ void delete_workgroup(RuntimeConfig* runcfg, RuntimeWorkgroupConfig* wg);
 void release_streams(int num_wgroups, RuntimeWorkgroupConfig* wgroups);
 int resolve_workgroup(RuntimeWorkgroupConfig* wg, int maxThreads);
 int resolve_workgroups(RuntimeConfig* runcfg, int detailed, int num_wgroups, RuntimeWorkgroupConfig* wgroups);
+int resolve_workgroup_kernels(RuntimeConfig* runcfg);
+void release_workgroup_kernel(RuntimeConfig* runcfg, RuntimeWorkgroupConfig* wg);
 int manage_streams(RuntimeWorkgroupConfig* wg, RuntimeConfig* runcfg);
+int resize_streams(RuntimeWorkgroupConfig* wg, RuntimeConfig* runcfg);
+int report_placement(RuntimeWorkgroupConfig* wg);
 void print_workgroup(RuntimeWorkgroupConfig* wgroup);
 int update_results(RuntimeConfig* runcfg, int num_wgroups, RuntimeWorkgroupConfig* wgroups);
+void release_results(RuntimeConfig* runcfg);
+int reset_results(RuntimeConfig* runcfg);
 
 int update_table(RuntimeConfig* runcfg, Table** thread, Table** wgroup, Table** global, int* max_cols, int transpose);
+int domain_table(RuntimeConfig* runcfg, Table** table);
+int add_sweep_row(RuntimeConfig* runcfg, bstring param, size_t value, Table** table);
 
 #endif /* WORKGROUP_H */
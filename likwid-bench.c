@@ -1,4 +1,7 @@
 #include <dirent.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -20,12 +23,22 @@
 #include "ptt2asm.h"
 #include "allocator.h"
 #include "results.h"
+#include "cachedir.h"
+#include "symbols.h"
 #include "topology.h"
 #include "thread_group.h"
 #include "dynload.h"
 #include "table.h"
 #include "test_strings.h"
 #include "path.h"
+#include "timer.h"
+#include "barrier.h"
+#include "sweep.h"
+#include "scaling.h"
+#include "stats.h"
+#include "latency.h"
+#include "autotune.h"
+#include "instrbatch.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -133,6 +146,7 @@ int _rsrc_usg()
 
 int allocate_runtime_config(RuntimeConfig** config)
 {
+    struct tagbstring baggregations = bsStatic(STATS_DEFAULT_AGGREGATIONS);
     RuntimeConfig* runcfg = malloc(sizeof(RuntimeConfig));
     if (!runcfg)
     {
@@ -142,11 +156,30 @@ int allocate_runtime_config(RuntimeConfig** config)
     memset(runcfg, 0, sizeof(RuntimeConfig));
     runcfg->wgroups = NULL;
     runcfg->tcfg = NULL;
+    runcfg->sync = NULL;
     runcfg->params = NULL;
     runcfg->global_results = NULL;
     runcfg->testname = bfromcstr("");
     runcfg->pttfile = bfromcstr("");
     runcfg->tmpfolder = bfromcstr("");
+    runcfg->cachefolder = bfromcstr("");
+    runcfg->nocache = 0;
+    runcfg->purgecache = 0;
+    runcfg->builtinasm = 0;
+    runcfg->timer = TIMER_RDTSC;
+    runcfg->barrier = BARRIER_PTHREAD;
+    runcfg->barrierbench = 0;
+    runcfg->scaling = SCALING_NONE;
+    runcfg->saturation = SCALING_DEFAULT_SATURATION;
+    runcfg->autotune = 0;
+    runcfg->batchfile = bfromcstr("");
+    runcfg->aggregations = bsplit(&baggregations, ',');
+    runcfg->domains = DOMAIN_NONE;
+    runcfg->repetitions = 0;
+    runcfg->relerror = 0.0;
+    runcfg->placement = bfromcstr("");
+    runcfg->allocation = bfromcstr("");
+    runcfg->initialization = bfromcstr("");
     runcfg->kernelfolder = bfromcstr("");
     runcfg->arraysize = bfromcstr("");
     runcfg->compiler = bfromcstr("");
@@ -190,12 +223,24 @@ void free_runtime_config(RuntimeConfig* runcfg)
         bdestroy(runcfg->testname);
         DEBUG_PRINT(DEBUGLEV_DEVELOP, "Destroy tmpfolder in RuntimeConfig");
         bdestroy(runcfg->tmpfolder);
+        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Destroy cachefolder in RuntimeConfig");
+        bdestroy(runcfg->cachefolder);
+        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Destroy placement in RuntimeConfig");
+        bdestroy(runcfg->placement);
+        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Destroy allocation in RuntimeConfig");
+        bdestroy(runcfg->allocation);
+        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Destroy initialization in RuntimeConfig");
+        bdestroy(runcfg->initialization);
         DEBUG_PRINT(DEBUGLEV_DEVELOP, "Destroy compiler in RuntimeConfig");
         bdestroy(runcfg->compiler);
         DEBUG_PRINT(DEBUGLEV_DEVELOP, "Destroy kernelfolder in RuntimeConfig");
         bdestroy(runcfg->kernelfolder);
         DEBUG_PRINT(DEBUGLEV_DEVELOP, "Destroy arraysize in RuntimeConfig");
         bdestroy(runcfg->arraysize);
+        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Destroy batchfile in RuntimeConfig");
+        bdestroy(runcfg->batchfile);
+        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Destroy aggregations in RuntimeConfig");
+        bstrListDestroy(runcfg->aggregations);
         DEBUG_PRINT(DEBUGLEV_DEVELOP, "Destroy mkstemp files in RuntimeConfig");
         DEBUG_PRINT(DEBUGLEV_DEVELOP, "Remove /tmp files");
         _rm_tmpfiles(runcfg);
@@ -208,12 +253,14 @@ void free_runtime_config(RuntimeConfig* runcfg)
         {
             bstrListDestroy(runcfg->benchfiles);
         }
+        destroy_sync(runcfg);
         if (runcfg->wgroups)
         {
             DEBUG_PRINT(DEBUGLEV_DEVELOP, "Destroy workgroups in RuntimeConfig");
             for (int i = 0; i < runcfg->num_wgroups; i++)
             {
                 bdestroy(runcfg->wgroups[i].str);
+                release_workgroup_kernel(runcfg, &runcfg->wgroups[i]);
                 if (runcfg->wgroups[i].results)
                 {
                     for (int j = 0; j < runcfg->wgroups[i].num_threads; j++)
@@ -232,11 +279,6 @@ void free_runtime_config(RuntimeConfig* runcfg)
                             }
                             if (runcfg->wgroups[i].threads[j].command)
                             {
-                                if (runcfg->wgroups[i].threads[j].command->init_val)
-                                {
-                                    free(runcfg->wgroups[i].threads[j].command->init_val);
-                                    runcfg->wgroups[i].threads[j].command->init_val = NULL;
-                                }
                                 free(runcfg->wgroups[i].threads[j].command);
                                 runcfg->wgroups[i].threads[j].command = NULL;
                             }
@@ -245,6 +287,11 @@ void free_runtime_config(RuntimeConfig* runcfg)
                                 bstrListDestroy(runcfg->wgroups[i].threads[j].codelines);
                                 runcfg->wgroups[i].threads[j].codelines = NULL;
                             }
+                            if (runcfg->wgroups[i].threads[j].args != NULL)
+                            {
+                                free(runcfg->wgroups[i].threads[j].args);
+                                runcfg->wgroups[i].threads[j].args = NULL;
+                            }
                         }
                     }
                     free(runcfg->wgroups[i].threads);
@@ -285,6 +332,7 @@ void free_runtime_config(RuntimeConfig* runcfg)
                 bdestroy(runcfg->params[i].name);
                 if (runcfg->params[i].value) bdestroy(runcfg->params[i].value);
                 else if (runcfg->params[i].values) bstrListDestroy(runcfg->params[i].values);
+                if (runcfg->params[i].sweep) bstrListDestroy(runcfg->params[i].sweep);
             }
             free(runcfg->params);
             runcfg->params = NULL;
@@ -299,12 +347,9 @@ void free_runtime_config(RuntimeConfig* runcfg)
 
         if (runcfg->global_results)
         {
-            if (runcfg->global_results->variables)
-            {
-                destroy_result(runcfg->global_results);
-                free(runcfg->global_results);
-                runcfg->global_results = NULL;
-            }
+            destroy_result(runcfg->global_results);
+            free(runcfg->global_results);
+            runcfg->global_results = NULL;
         }
 
         bdestroy(runcfg->output);
@@ -400,6 +445,523 @@ static void _print_benchinfo(struct bstrList* blist)
     }
 }
 
+/* Current values of the parameters for the kernel code, they change with the points of a sweep */
+static void _update_parameters(RuntimeConfig* runcfg, TestConfig_t tcfg)
+{
+    for (int i = 0; i < tcfg->num_params; i++)
+    {
+        TestConfigParameter* p = &tcfg->params[i];
+        for (int j = 0; j < runcfg->num_params; j++)
+        {
+            if (bstrcmp(p->name, runcfg->params[j].name) == BSTR_OK && runcfg->params[j].value)
+            {
+                if (p->value) bdestroy(p->value);
+                p->value = bstrcpy(runcfg->params[j].value);
+            }
+        }
+    }
+}
+
+static int _generate_code(RuntimeConfig* runcfg)
+{
+    for (int w = 0; w < runcfg->num_wgroups; w++)
+    {
+        RuntimeWorkgroupConfig* wg = &runcfg->wgroups[w];
+        _update_parameters(runcfg, wg->tcfg);
+        for (int t = 0; t < wg->num_threads; t++)
+        {
+            RuntimeThreadConfig* thread =  &wg->threads[t];
+            if (thread->codelines)
+            {
+                bstrListDestroy(thread->codelines);
+            }
+            thread->codelines = bstrListCreate();
+            int err = generate_code(wg->tcfg, thread, thread->codelines);
+            if (err < 0)
+            {
+                return err;
+            }
+            for (int i = 0; i < thread->codelines->qty; i++)
+            {
+                DEBUG_PRINT(DEBUGLEV_DETAIL, "HWTHREAD %d CODE: %s", thread->data->hwthread, bdata(thread->codelines->entry[i]));
+            }
+        }
+    }
+    return 0;
+}
+
+/*
+ * Evaluates everything that depends on the parameters and the number of threads again before
+ * the next point of a sweep or a scaling run. The streams are carved out of the memory of the
+ * largest point and the kernels are only rebuilt if their code changed.
+ */
+static int _prepare_point(RuntimeConfig* runcfg)
+{
+    int err = reset_results(runcfg);
+    if (err < 0)
+    {
+        ERROR_PRINT("Error resetting result storages");
+        return err;
+    }
+    err = fill_results(runcfg);
+    if (err < 0)
+    {
+        ERROR_PRINT("Error filling result storages");
+        return err;
+    }
+    for (int w = 0; w < runcfg->num_wgroups; w++)
+    {
+        err = resize_streams(&runcfg->wgroups[w], runcfg);
+        if (err < 0)
+        {
+            ERROR_PRINT("Error resizing streams");
+            return err;
+        }
+    }
+    err = refresh_threads(runcfg);
+    if (err < 0)
+    {
+        ERROR_PRINT("Error updating thread groups");
+        return err;
+    }
+    err = _generate_code(runcfg);
+    if (err < 0)
+    {
+        ERROR_PRINT("Error generating code");
+        return err;
+    }
+    for (int w = 0; w < runcfg->num_wgroups; w++)
+    {
+        err = dynload_update_runtime_test_config(runcfg, &runcfg->wgroups[w]);
+        if (err < 0)
+        {
+            ERROR_PRINT("Error generating function object");
+            return err;
+        }
+    }
+    return 0;
+}
+
+/* The stored variants live next to the kernel objects, -n neither reads nor updates them */
+static bstring _autotune_file(RuntimeConfig* runcfg, uint64_t* fingerprint)
+{
+    if (runcfg->nocache || blength(runcfg->cachefolder) == 0)
+    {
+        return NULL;
+    }
+    int err = autotune_machine_fingerprint(fingerprint);
+    if (err < 0)
+    {
+        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Cannot determine machine fingerprint: %s", strerror(-err));
+        return NULL;
+    }
+    if (cachedir_create(bdata(runcfg->cachefolder)) != 0)
+    {
+        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Kernel object cache %s cannot be used for the tuned variants", bdata(runcfg->cachefolder));
+        return NULL;
+    }
+    int slash = (bchar(runcfg->cachefolder, blength(runcfg->cachefolder) - 1) == '/');
+    return bformat("%s%s%s", bdata(runcfg->cachefolder), (slash ? "" : "/"), AUTOTUNE_CACHE_FILE);
+}
+
+/* Selects the variant of the tunables stored by an earlier autotuning run on this machine */
+static void _load_tuned_variant(RuntimeConfig* runcfg)
+{
+    uint64_t fingerprint = 0;
+    bstring bfile = _autotune_file(runcfg, &fingerprint);
+    int stored = (bfile && autotune_load(bdata(bfile), fingerprint, runcfg->tcfg) == 0);
+    bstring variant = autotune_variant_name(runcfg->tcfg);
+    if (variant)
+    {
+        printf("Tunables: %s (%s)\n", bdata(variant), (stored ? "tuned for this machine" : "default"));
+    }
+    bdestroy(variant);
+    bdestroy(bfile);
+}
+
+/* Time per iteration of the slowest thread running the kernel of the runtime configuration */
+static double _variant_time(RuntimeConfig* runcfg)
+{
+    double ns = 0.0;
+    for (int w = 0; w < runcfg->num_wgroups; w++)
+    {
+        RuntimeWorkgroupConfig* wg = &runcfg->wgroups[w];
+        if (wg->tcfg != runcfg->tcfg)
+        {
+            continue;
+        }
+        for (int t = 0; t < wg->num_threads; t++)
+        {
+            thread_data_t data = wg->threads[t].data;
+            if (data->iters > 0 && (double)data->min_runtime / (double)data->iters > ns)
+            {
+                ns = (double)data->min_runtime / (double)data->iters;
+            }
+        }
+    }
+    return ns;
+}
+
+/*
+ * Runs every variant of the tunables briefly under the workgroups, reports the fastest one and
+ * its margin over the default and stores it for this machine. The fastest variant stays
+ * selected for the following measurement.
+ */
+static int _autotune(RuntimeConfig* runcfg)
+{
+    TestConfig_t cfg = runcfg->tcfg;
+    int num_variants = autotune_num_variants(cfg);
+    if (num_variants < 0)
+    {
+        errno = EINVAL;
+        ERROR_PRINT("Kernel %s has no tunables", bdata(runcfg->testname));
+        return num_variants;
+    }
+    double runtime = runcfg->runtime;
+    if (runcfg->iterations == 0)
+    {
+        runcfg->runtime = AUTOTUNE_RUNTIME;
+    }
+    printf("Autotuning %s over %d variants\n", bdata(runcfg->testname), num_variants);
+    int err = 0;
+    int best = -1;
+    double best_ns = 0.0;
+    double default_ns = 0.0;
+    for (int v = 0; v < num_variants && err == 0; v++)
+    {
+        err = autotune_select(cfg, v);
+        if (err == 0)
+        {
+            err = _prepare_point(runcfg);
+        }
+        /* The kernels do not change their input streams, so they are initialized once */
+        for (int w = 0; w < runcfg->num_wgroups && err == 0 && v == 0; w++)
+        {
+            err = broadcast_cmd(LIKWID_THREAD_COMMAND_INITIALIZE, &runcfg->wgroups[w]);
+        }
+        if (err == 0)
+        {
+            start_sync(runcfg);
+        }
+        for (int w = 0; w < runcfg->num_wgroups && err == 0; w++)
+        {
+            RuntimeWorkgroupConfig* wg = &runcfg->wgroups[w];
+            for (int i = 0; i < wg->num_threads; i++)
+            {
+                wg->threads[i].command->cmdfunc.run = wg->threads[i].testconfig->function;
+            }
+            err = broadcast_cmd(LIKWID_THREAD_COMMAND_RUN, wg);
+        }
+        for (int w = 0; w < runcfg->num_wgroups && err == 0; w++)
+        {
+            err = wait_cmds(&runcfg->wgroups[w]);
+        }
+        if (err != 0)
+        {
+            break;
+        }
+        double ns = _variant_time(runcfg);
+        bstring variant = autotune_variant_name(cfg);
+        printf("\t%s: %.3f us per iteration%s\n", bdata(variant), ns * 1E-3, (v == 0 ? " (default)" : ""));
+        bdestroy(variant);
+        if (v == 0)
+        {
+            default_ns = ns;
+        }
+        if (ns > 0.0 && (best < 0 || ns < best_ns))
+        {
+            best = v;
+            best_ns = ns;
+        }
+    }
+    runcfg->runtime = runtime;
+    if (err != 0)
+    {
+        ERROR_PRINT("Error timing the variants of %s", bdata(runcfg->testname));
+        return err;
+    }
+    if (best < 0)
+    {
+        errno = EINVAL;
+        ERROR_PRINT("No variant of %s was timed", bdata(runcfg->testname));
+        return -EINVAL;
+    }
+
+    autotune_select(cfg, best);
+    bstring variant = autotune_variant_name(cfg);
+    printf("Fastest variant: %s, %.3f us per iteration, %.1f%% faster than the default\n", bdata(variant), best_ns * 1E-3,
+           (default_ns > 0.0 ? (default_ns / best_ns - 1.0) * 100.0 : 0.0));
+    bdestroy(variant);
+    uint64_t fingerprint = 0;
+    bstring bfile = _autotune_file(runcfg, &fingerprint);
+    if (bfile)
+    {
+        err = autotune_store(bdata(bfile), fingerprint, cfg, best_ns);
+        if (err == 0)
+        {
+            printf("Stored for machine %016" PRIx64 " in %s\n", fingerprint, bdata(bfile));
+        }
+        else
+        {
+            WARN_PRINT("Cannot store the tuned variant in %s: %s", bdata(bfile), strerror(-err));
+        }
+        bdestroy(bfile);
+    }
+    /* The measurement runs the fastest variant with the runtime from the command line */
+    return _prepare_point(runcfg);
+}
+
+/* Sets a kernel parameter that does not come from the command line */
+static int _set_parameter(RuntimeConfig* runcfg, const char* name, const_bstring value)
+{
+    for (int i = 0; i < runcfg->num_params; i++)
+    {
+        if (biseqcstr(runcfg->params[i].name, name))
+        {
+            bdestroy(runcfg->params[i].value);
+            runcfg->params[i].value = bstrcpy(value);
+            return 0;
+        }
+    }
+    RuntimeParameterConfig* tmp = realloc(runcfg->params, (runcfg->num_params + 1) * sizeof(RuntimeParameterConfig));
+    if (!tmp)
+    {
+        return -ENOMEM;
+    }
+    runcfg->params = tmp;
+    RuntimeParameterConfig* p = &runcfg->params[runcfg->num_params];
+    p->name = bfromcstr(name);
+    p->value = bstrcpy(value);
+    p->values = NULL;
+    p->sweep = NULL;
+    runcfg->num_params++;
+    return 0;
+}
+
+/* The parameters of the instruction kernels for one instruction form, unused operands are 'none' */
+static int _batch_set_form(RuntimeConfig* runcfg, InstrForm* form)
+{
+    struct tagbstring bnone = bsStatic("none");
+    int err = _set_parameter(runcfg, "instruction", form->mnemonic);
+    for (int i = 0; i < INSTRBATCH_MAX_OPERANDS && err == 0; i++)
+    {
+        char name[8];
+        snprintf(name, sizeof(name), "op%d", i + 1);
+        err = _set_parameter(runcfg, name, (i < form->operands->qty ? form->operands->entry[i] : &bnone));
+    }
+    if (err == 0)
+    {
+        /* The latency kernel of a form without dependency is still built, but not measured */
+        int operand = instrbatch_dependency(form);
+        bstring dep = bformat("%d", (operand > 0 ? operand : 1));
+        err = _set_parameter(runcfg, "dependency_reg", dep);
+        bdestroy(dep);
+    }
+    return err;
+}
+
+/* Cycles per instruction of the slowest thread, the kernels execute INST_PER_ITER instructions per iteration */
+static double _cycles_per_instruction(RuntimeConfig* runcfg)
+{
+    TestConfig_t cfg = runcfg->tcfg;
+    double inst = 0.0;
+    for (int i = 0; i < cfg->num_vars; i++)
+    {
+        if (biseqcstr(cfg->vars[i].name, "INST_PER_ITER"))
+        {
+            inst = strtod(bdata(cfg->vars[i].value), NULL);
+        }
+    }
+    double cycles = 0.0;
+    for (int w = 0; w < runcfg->num_wgroups; w++)
+    {
+        RuntimeWorkgroupConfig* wg = &runcfg->wgroups[w];
+        for (int t = 0; t < wg->num_threads; t++)
+        {
+            thread_data_t data = wg->threads[t].data;
+            if (data->iters > 0 && (double)data->cycles / (double)data->iters > cycles)
+            {
+                cycles = (double)data->cycles / (double)data->iters;
+            }
+        }
+    }
+    return (inst > 0.0 ? cycles / inst : 0.0);
+}
+
+/*
+ * Runs the kernel cfg in all workgroups. Returns 1 if the current instruction form cannot be
+ * built with it, the threads stay usable for the next form then.
+ */
+static int _batch_run(RuntimeConfig* runcfg, TestConfig_t cfg, const char* name, int initialize, double* cpi)
+{
+    runcfg->tcfg = cfg;
+    for (int w = 0; w < runcfg->num_wgroups; w++)
+    {
+        /* The function in the kernel object is named after the kernel */
+        runcfg->wgroups[w].tcfg = cfg;
+        btrunc(runcfg->wgroups[w].testname, 0);
+        bcatcstr(runcfg->wgroups[w].testname, name);
+    }
+    int err = _prepare_point(runcfg);
+    if (err < 0)
+    {
+        return 1;
+    }
+    for (int w = 0; w < runcfg->num_wgroups && err == 0 && initialize; w++)
+    {
+        err = broadcast_cmd(LIKWID_THREAD_COMMAND_INITIALIZE, &runcfg->wgroups[w]);
+    }
+    if (err == 0)
+    {
+        start_sync(runcfg);
+    }
+    for (int w = 0; w < runcfg->num_wgroups && err == 0; w++)
+    {
+        RuntimeWorkgroupConfig* wg = &runcfg->wgroups[w];
+        for (int i = 0; i < wg->num_threads; i++)
+        {
+            wg->threads[i].command->cmdfunc.run = wg->threads[i].testconfig->function;
+        }
+        err = broadcast_cmd(LIKWID_THREAD_COMMAND_RUN, wg);
+    }
+    for (int w = 0; w < runcfg->num_wgroups && err == 0; w++)
+    {
+        err = wait_cmds(&runcfg->wgroups[w]);
+    }
+    if (err == 0)
+    {
+        *cpi = _cycles_per_instruction(runcfg);
+    }
+    return err;
+}
+
+/*
+ * Measures every instruction form of the batch with the dependent chain of the latency kernel
+ * and the independent chains of the throughput kernel and collects one row per form. Forms the
+ * CPU lacks a flag for or that do not assemble are skipped with a note.
+ */
+static int _instr_batch(RuntimeConfig* runcfg, int num_forms, InstrForm* forms, struct bstrList* cpuflags, Table** table)
+{
+    TestConfig_t lt = runcfg->tcfg;
+    TestConfig_t tp = NULL;
+    for (int w = 0; w < runcfg->num_wgroups; w++)
+    {
+        if (runcfg->wgroups[w].tcfg != lt)
+        {
+            errno = EINVAL;
+            ERROR_PRINT("The batch mode runs the instruction kernels in all work groups, work group %d selects %s", w + 1, bdata(runcfg->wgroups[w].testname));
+            return -EINVAL;
+        }
+    }
+    bstring path = bformat("%s/%s.yaml", bdata(runcfg->kernelfolder), INSTRBATCH_THROUGHPUT_KERNEL);
+    int err = read_yaml_ptt(bdata(path), &tp);
+    if (err < 0)
+    {
+        ERROR_PRINT("Error reading %s", bdata(path));
+        bdestroy(path);
+        return err;
+    }
+    bdestroy(path);
+    struct bstrList* headers = bstrListCreate();
+    bstrListAddChar(headers, "mnemonic");
+    bstrListAddChar(headers, "operands");
+    // The perf timer counts core cycles, the other timers the cycles of the TSC frequency
+    if (runcfg->timer == TIMER_PERF_EVENT)
+    {
+        bstrListAddChar(headers, "latency [cy]");
+        bstrListAddChar(headers, "rthroughput [cy]");
+    }
+    else
+    {
+        bstrListAddChar(headers, "latency [ref cy]");
+        bstrListAddChar(headers, "rthroughput [ref cy]");
+    }
+    bstrListAddChar(headers, "uops");
+    err = table_create(headers, table);
+    bstrListDestroy(headers);
+    if (err == 0)
+    {
+        // Both columns use the same precision
+        err = table_keep_format(*table, 2);
+        err = (err == 0 ? table_keep_format(*table, 3) : err);
+    }
+    if (err < 0)
+    {
+        close_yaml_ptt(tp);
+        return err;
+    }
+    double runtime = runcfg->runtime;
+    if (runcfg->iterations == 0 && runtime < 0)
+    {
+        runcfg->runtime = INSTRBATCH_RUNTIME;
+    }
+    printf("Measuring %d instruction forms\n", num_forms);
+    int initialized = 0;
+    for (int f = 0; f < num_forms && err == 0; f++)
+    {
+        InstrForm* form = &forms[f];
+        bstring operands = instrbatch_operands(form);
+        bstring missing = instrbatch_missing_flag(form, cpuflags);
+        double latency = NAN;
+        double rthroughput = 0.0;
+        if (missing)
+        {
+            printf("\t%s %s: skipped, the CPU has no flag %s\n", bdata(form->mnemonic), bdata(operands), bdata(missing));
+            bdestroy(operands);
+            continue;
+        }
+        err = _batch_set_form(runcfg, form);
+        // Forms that write their destination without reading it have no dependency chain
+        if (err == 0 && instrbatch_dependency(form) > 0)
+        {
+            err = _batch_run(runcfg, lt, INSTRBATCH_LATENCY_KERNEL, !initialized, &latency);
+            initialized |= (err == 0);
+        }
+        if (err == 0)
+        {
+            err = _batch_run(runcfg, tp, INSTRBATCH_THROUGHPUT_KERNEL, !initialized, &rthroughput);
+            initialized |= (err == 0);
+        }
+        if (err > 0)
+        {
+            WARN_PRINT("Cannot build the kernels for %s %s, skipping it", bdata(form->mnemonic), bdata(operands));
+            err = 0;
+        }
+        else if (err == 0)
+        {
+            bstring blat = (isnan(latency) ? bfromcstr("-") : bformat("%.2f", latency));
+            printf("\t%s %s: latency %s, reciprocal throughput %.2f %s\n", bdata(form->mnemonic), bdata(operands), bdata(blat), rthroughput, (runcfg->timer == TIMER_PERF_EVENT ? "cycles" : "reference cycles"));
+            struct bstrList* row = bstrListCreate();
+            bstrListAdd(row, form->mnemonic);
+            bstrListAdd(row, operands);
+            bstring btp = bformat("%.2f", rthroughput);
+            bstrListAdd(row, blat);
+            bstrListAdd(row, btp);
+            /* Generic perf events have no micro-op counter */
+            bstrListAddChar(row, "-");
+            err = table_addrow(*table, row);
+            bdestroy(blat);
+            bdestroy(btp);
+            bstrListDestroy(row);
+        }
+        bdestroy(operands);
+    }
+    runcfg->runtime = runtime;
+    runcfg->tcfg = lt;
+    for (int w = 0; w < runcfg->num_wgroups; w++)
+    {
+        runcfg->wgroups[w].tcfg = lt;
+        btrunc(runcfg->wgroups[w].testname, 0);
+        bcatcstr(runcfg->wgroups[w].testname, INSTRBATCH_LATENCY_KERNEL);
+    }
+    close_yaml_ptt(tp);
+    if (err < 0)
+    {
+        ERROR_PRINT("Error measuring the instruction forms");
+    }
+    return err;
+}
+
 int main(int argc, char** argv)
 {
 #ifdef LIKWID_PERFMON
@@ -417,6 +979,9 @@ int main(int argc, char** argv)
     Map_t useropts = NULL;
     struct bstrList* args = NULL;
     int got_testcase = 0;
+    InstrForm* forms = NULL;
+    int num_forms = 0;
+    struct bstrList* cpuflags = NULL;
     CliOptions baseopts = {
         .num_options = 0,
         .options = NULL,
@@ -450,6 +1015,17 @@ int main(int argc, char** argv)
     bstring kernelfolder = bformat("./");
 #endif
     bstring tmpfolder = bformat("/tmp/likwid-bench-%d/%s/", getpid(), bdata(arch));
+    /* The cache is per user, objects in a shared folder could be planted by other users */
+    char usercache[PATH_MAX];
+    bstring cachefolder = NULL;
+    if (cachedir_user_folder(usercache, sizeof(usercache)) == 0)
+    {
+        cachefolder = bformat("%s/%s/", usercache, bdata(arch));
+    }
+    else
+    {
+        cachefolder = bfromcstr("");
+    }
     bstring compiler = bfromcstr("gcc");
     bdestroy(arch);
     int (*ownaccess)(const char*, int) = access;
@@ -470,6 +1046,7 @@ int main(int argc, char** argv)
     }
     bconcat(runcfg->kernelfolder, kernelfolder);
     bconcat(runcfg->tmpfolder, tmpfolder);
+    bconcat(runcfg->cachefolder, cachefolder);
     bconcat(runcfg->compiler, compiler);
     _get_benchmarks(bdata(kernelfolder), &runcfg->benchfiles);
 
@@ -503,6 +1080,19 @@ int main(int argc, char** argv)
         _print_benchinfo(runcfg->benchfiles);
         goto main_out;
     }
+    if (runcfg->purgecache)
+    {
+        err = dynload_purge_cache(runcfg->cachefolder);
+        if (err < 0)
+        {
+            ERROR_PRINT("Error purging kernel object cache %s", bdata(runcfg->cachefolder));
+            goto main_out;
+        }
+        if ((blength(runcfg->testname) + blength(runcfg->pttfile)) == 0)
+        {
+            goto main_out;
+        }
+    }
     if (runcfg->help && (blength(runcfg->testname) + blength(runcfg->pttfile)) == 0)
     {
         printCliOptions(&baseopts);
@@ -513,6 +1103,54 @@ int main(int argc, char** argv)
         DEBUG_PRINT(DEBUGLEV_DEVELOP, "Setting verbosity to %d", runcfg->verbosity);
         global_verbosity = runcfg->verbosity;
     }
+    if (runcfg->barrierbench)
+    {
+        err = barrier_benchmark();
+        goto main_out;
+    }
+    /*
+     * The batch mode measures each instruction form of the file with the instruction kernels
+     */
+    if (blength(runcfg->batchfile) > 0)
+    {
+        int errline = 0;
+        if (access(bdata(runcfg->batchfile), R_OK))
+        {
+            err = -errno;
+            ERROR_PRINT("Cannot read instruction forms from %s", bdata(runcfg->batchfile));
+            goto main_out;
+        }
+        bstring spec = read_file(bdata(runcfg->batchfile));
+        num_forms = instrbatch_parse(spec, &forms, &errline);
+        bdestroy(spec);
+        if (num_forms < 0)
+        {
+            err = num_forms;
+            errno = -err;
+            ERROR_PRINT("Invalid instruction form in %s line %d", bdata(runcfg->batchfile), errline);
+            num_forms = 0;
+            goto main_out;
+        }
+        else if (num_forms == 0)
+        {
+            err = -EINVAL;
+            errno = EINVAL;
+            ERROR_PRINT("No instruction forms in %s", bdata(runcfg->batchfile));
+            goto main_out;
+        }
+        bstring cpuinfo = read_file("/proc/cpuinfo");
+        if (!cpuinfo || instrbatch_cpu_flags(cpuinfo, &cpuflags) < 0)
+        {
+            WARN_PRINT("Cannot read the CPU flags, forms that need flags are skipped");
+        }
+        bdestroy(cpuinfo);
+        bstring path = bformat("%s/%s.yaml", bdata(runcfg->kernelfolder), INSTRBATCH_LATENCY_KERNEL);
+        btrunc(runcfg->testname, 0);
+        bcatcstr(runcfg->testname, INSTRBATCH_LATENCY_KERNEL);
+        btrunc(runcfg->pttfile, 0);
+        bconcat(runcfg->pttfile, path);
+        bdestroy(path);
+    }
 
     if (blength(runcfg->testname) > 0)
     {
@@ -541,6 +1179,15 @@ int main(int argc, char** argv)
     {
         printCliOptions(&baseopts);
         printCliOptions(&testopts);
+        struct tagbstring bcomma = bsStatic(", ");
+        for (int i = 0; i < runcfg->tcfg->num_tunables; i++)
+        {
+            TestConfigTunable* t = &runcfg->tcfg->tunables[i];
+            bstring options = bjoin(t->options, &bcomma);
+            if (i == 0) printf("Tunables (first option is the default, see -U):\n");
+            printf("\t%s: %s (%s)\n", bdata(t->name), (t->description ? bdata(t->description) : ""), bdata(options));
+            bdestroy(options);
+        }
         goto main_out;
     }
     
@@ -554,11 +1201,40 @@ int main(int argc, char** argv)
         ERROR_PRINT("Error assigning runtime CLI test options");
         goto main_out;
     }
-    else if (err > 0)
+    else if (err > 0 && num_forms == 0)
     {
         ERROR_PRINT("Error not all required test parameters set");
         goto main_out;
     }
+    if (num_forms > 0)
+    {
+        /* The first form the CPU supports builds the kernels, the batch sets all others */
+        int f = 0;
+        while (f < num_forms && instrbatch_missing_flag(&forms[f], cpuflags))
+        {
+            f++;
+        }
+        if (f == num_forms)
+        {
+            err = -ENOTSUP;
+            errno = ENOTSUP;
+            ERROR_PRINT("No instruction form in %s runs on this CPU", bdata(runcfg->batchfile));
+            goto main_out;
+        }
+        if (runcfg->autotune || runcfg->scaling != SCALING_NONE)
+        {
+            err = -EINVAL;
+            errno = EINVAL;
+            ERROR_PRINT("The batch mode cannot be combined with autotuning or thread scaling");
+            goto main_out;
+        }
+        err = _batch_set_form(runcfg, &forms[f]);
+        if (err < 0)
+        {
+            ERROR_PRINT("Error setting the parameters of the instruction forms");
+            goto main_out;
+        }
+    }
 
     if (runcfg->tcfg->requirewg)
     {
@@ -575,6 +1251,33 @@ int main(int argc, char** argv)
             ERROR_PRINT("No workgroups on the command line");
             goto main_out;
         }
+        err = resolve_workgroup_kernels(runcfg);
+        if (err < 0)
+        {
+            ERROR_PRINT("Error loading the kernels of the workgroups");
+            goto main_out;
+        }
+    }
+
+    if (runcfg->scaling != SCALING_NONE && runcfg->num_wgroups != 1)
+    {
+        errno = EINVAL;
+        ERROR_PRINT("Thread scaling needs exactly one workgroup");
+        goto main_out;
+    }
+    if (runcfg->scaling != SCALING_NONE)
+    {
+        /* The rate of each thread count is the sum over the threads */
+        struct tagbstring bsum = bsStatic("sum");
+        int found = 0;
+        for (int a = 0; a < runcfg->aggregations->qty && !found; a++)
+        {
+            found = biseqcaseless(runcfg->aggregations->entry[a], &bsum);
+        }
+        if (!found)
+        {
+            bstrListAdd(runcfg->aggregations, &bsum);
+        }
     }
 
     err = parse_cpu_folders();
@@ -584,6 +1287,13 @@ int main(int argc, char** argv)
         goto main_out;
     }
 
+    if (!lb_timer_has_type(runcfg->timer))
+    {
+        err = -ENOTSUP;
+        ERROR_PRINT("Timer %s not available (perf_event needs hardware counters and a suitable perf_event_paranoid setting)", lb_timer_type_name(runcfg->timer));
+        goto main_out;
+    }
+
     bstring hline = bhline();
     printf("%s", bdata(hline));
     printf("Application: LIKWID-BENCH\n");
@@ -609,11 +1319,47 @@ int main(int argc, char** argv)
         goto main_out;
     }
 
+    if (runcfg->autotune && runcfg->tcfg->num_tunables == 0)
+    {
+        err = -EINVAL;
+        errno = EINVAL;
+        ERROR_PRINT("Kernel %s has no tunables", bdata(runcfg->testname));
+        goto main_out;
+    }
+    if (runcfg->tcfg->num_tunables > 0 && !runcfg->autotune)
+    {
+        _load_tuned_variant(runcfg);
+    }
+
+    /*
+     * A scaling run adds the hwthreads of the workgroup one by one in the selected order
+     */
+    if (runcfg->scaling != SCALING_NONE)
+    {
+        RuntimeWorkgroupConfig* wg = &runcfg->wgroups[0];
+        err = scaling_order_hwthreads(wg->hwthreads, wg->num_threads, runcfg->scaling);
+        if (err < 0)
+        {
+            ERROR_PRINT("Error ordering hwthreads for thread scaling");
+            goto main_out;
+        }
+        printf("Scaling from 1 to %d threads in %s order: [%d", wg->num_threads, scaling_order_name(runcfg->scaling), wg->hwthreads[0]);
+        for (int t = 1; t < wg->num_threads; t++)
+        {
+            printf(",%d", wg->hwthreads[t]);
+        }
+        printf("]\n");
+    }
+
     printf("Using %d work groups\n", runcfg->num_wgroups);
     for (int w = 0; w < runcfg->num_wgroups; w++)
     {
         RuntimeWorkgroupConfig* wg = &runcfg->wgroups[w];
-        if (runcfg->num_wgroups != 1)
+        if (runcfg->num_wgroups != 1 && wg->tcfg != runcfg->tcfg)
+        {
+            printf("\twork group %d - %d threads - kernel %s\n", w + 1, wg->num_threads, bdata(wg->testname));
+        }
+        else if (runcfg->num_wgroups != 1)
         {
             printf("\twork group %d - %d threads\n", w + 1, wg->num_threads);
         }
@@ -622,8 +1368,50 @@ int main(int argc, char** argv)
             printf("\tUsing %d threads\n", wg->num_threads);
         }
     }
+    /*
+     * Determine the timer frequency before the threads start measuring
+     */
+    TimerFreqInfo freqinfo;
+    if (lb_timer_calibrate(&freqinfo) == 0)
+    {
+        if (runcfg->detailed)
+        {
+            printf("Timer frequency: %.6f MHz +- %.3f kHz (%s)\n", (double)freqinfo.freq * 1E-6, (double)freqinfo.ci * 1E-3, lb_timer_freq_source_name(freqinfo.source));
+        }
+    }
+    else
+    {
+        WARN_PRINT("Cannot determine timer frequency");
+    }
     printf("%s", bdata(hline));
 
+    /*
+     * A swept parameter starts at its largest point, so the streams are allocated only once
+     */
+    RuntimeParameterConfig* sweep = NULL;
+    for (int i = 0; i < runcfg->num_params; i++)
+    {
+        if (runcfg->params[i].sweep)
+        {
+            sweep = &runcfg->params[i];
+            bdestroy(sweep->value);
+            sweep->value = bstrcpy(sweep->sweep->entry[sweep_largest(sweep->sweep)]);
+            printf("Sweeping %s over %d points\n", bdata(sweep->name), sweep->sweep->qty);
+        }
+    }
+    if (sweep && runcfg->scaling != SCALING_NONE)
+    {
+        errno = EINVAL;
+        ERROR_PRINT("A parameter sweep cannot be combined with thread scaling");
+        goto main_out;
+    }
+    if (sweep && num_forms > 0)
+    {
+        errno = EINVAL;
+        ERROR_PRINT("A parameter sweep cannot be combined with the batch mode");
+        goto main_out;
+    }
+
     /*
      * Evaluate variables, constants, ... for remaining operations
      * There should be now all values available
@@ -674,24 +1462,11 @@ int main(int argc, char** argv)
     /*
      * Generate assembly
      */
-    for (int w = 0; w < runcfg->num_wgroups; w++)
+    err = _generate_code(runcfg);
+    if (err < 0)
     {
-        RuntimeWorkgroupConfig* wg = &runcfg->wgroups[w];
-        for (int t = 0; t < wg->num_threads; t++)
-        {
-            RuntimeThreadConfig* thread =  &wg->threads[t];
-            thread->codelines = bstrListCreate();
-            err = generate_code(runcfg, thread, thread->codelines);
-            if (err < 0)
-            {
-                ERROR_PRINT("Error generating code");
-                goto main_out;
-            }
-            for (int i = 0; i < thread->codelines->qty; i++)
-            {
-                DEBUG_PRINT(DEBUGLEV_DETAIL, "HWTHREAD %d CODE: %s", thread->data->hwthread, bdata(thread->codelines->entry[i]));
-            }
-        }
+        ERROR_PRINT("Error generating code");
+        goto main_out;
     }
 
     /*
@@ -708,16 +1483,11 @@ int main(int argc, char** argv)
     }
     for (int w = 0; w < runcfg->num_wgroups; w++)
     {
-        RuntimeWorkgroupConfig* wg = &runcfg->wgroups[w];
-        for (int i = 0; i < wg->num_threads; i++)
+        err = open_workgroup_functions(&runcfg->wgroups[w]);
+        if (err < 0)
         {
-            RuntimeThreadConfig* thread =  &wg->threads[i];
-            err = open_function(thread);
-            if (err < 0)
-            {
-                ERROR_PRINT("Error opening function objects");
-                goto main_out;
-            }
+            ERROR_PRINT("Error opening function objects");
+            goto main_out;
         }
     }
 
@@ -732,13 +1502,97 @@ int main(int argc, char** argv)
         goto main_out;
     }
 
-    /* Send LIKWID CMD's */
-    for (int w = 0; w < runcfg->num_wgroups; w++)
+    /*
+     * The autotuner selects the fastest variant of the tunables before the measurement
+     */
+    if (runcfg->autotune)
     {
-        RuntimeWorkgroupConfig* wg = &runcfg->wgroups[w];
-        for (int i = 0; i < wg->num_threads; i++)
+        err = _autotune(runcfg);
+        if (err < 0)
+        {
+            destroy_threads(runcfg->num_wgroups, runcfg->wgroups);
+            goto main_out;
+        }
+        printf("%s", bdata(hline));
+    }
+
+    /*
+     * Without a sweep or a scaling run there is a single point with the setup from above
+     */
+    Table* pointtable = NULL;
+    int num_points = 1;
+    struct bstrList* rate_metrics = bstrListCreate();
+    double* rates = NULL;
+    if (sweep)
+    {
+        num_points = sweep->sweep->qty;
+    }
+    else if (runcfg->scaling != SCALING_NONE)
+    {
+        num_points = runcfg->wgroups[0].max_threads;
+        TestConfig_t cfg = runcfg->wgroups[0].tcfg;
+        for (int m = 0; m < cfg->num_metrics; m++)
+        {
+            struct tagbstring brate = bsStatic("/s]");
+            if (binstr(cfg->metrics[m].name, 0, &brate) != BSTR_ERR)
+            {
+                bstrListAdd(rate_metrics, cfg->metrics[m].name);
+            }
+        }
+        rates = malloc(num_points * (rate_metrics->qty + 1) * sizeof(double));
+        if (!rates)
+        {
+            err = -ENOMEM;
+            ERROR_PRINT("Error allocating scaling results");
+            bstrListDestroy(rate_metrics);
+            destroy_threads(runcfg->num_wgroups, runcfg->wgroups);
+            goto main_out;
+        }
+    }
+    if (num_forms > 0)
+    {
+        err = _instr_batch(runcfg, num_forms, forms, cpuflags, &pointtable);
+        if (err < 0)
+        {
+            bstrListDestroy(rate_metrics);
+            destroy_threads(runcfg->num_wgroups, runcfg->wgroups);
+            goto main_out;
+        }
+        num_points = 0;
+    }
+    for (int p = 0; p < num_points; p++)
+    {
+        if (sweep || runcfg->scaling != SCALING_NONE)
+        {
+            if (sweep)
+            {
+                bdestroy(sweep->value);
+                sweep->value = bstrcpy(sweep->sweep->entry[p]);
+            }
+            else
+            {
+                /* The results are sized for the threads, so they go before the thread count changes */
+                release_results(runcfg);
+                err = scale_threads(runcfg, &runcfg->wgroups[0], p + 1);
+            }
+            if (err == 0)
+            {
+                err = _prepare_point(runcfg);
+            }
+            if (err < 0)
+            {
+                ERROR_PRINT("Error preparing the next point");
+                bstrListDestroy(rate_metrics);
+                free(rates);
+                destroy_threads(runcfg->num_wgroups, runcfg->wgroups);
+                goto main_out;
+            }
+        }
+
+        /* Send LIKWID CMD's */
+        for (int w = 0; w < runcfg->num_wgroups; w++)
         {
-            err = send_cmd(LIKWID_THREAD_COMMAND_INITIALIZE, &wg->threads[i]);
+            err = broadcast_cmd(LIKWID_THREAD_COMMAND_INITIALIZE, &runcfg->wgroups[w]);
             if (err < 0)
             {
                 ERROR_PRINT("Error communicating with threads");
@@ -746,20 +1600,21 @@ int main(int argc, char** argv)
                 goto main_out;
             }
         }
-    }
 
-    /*
-     * Run benchmark
-     */
-    for (int w = 0; w < runcfg->num_wgroups; w++)
-    {
-        RuntimeWorkgroupConfig* wg = &runcfg->wgroups[w];
-        for (int i = 0; i < wg->num_threads; i++)
+        /*
+         * Run benchmark
+         */
+        start_sync(runcfg);
+        for (int w = 0; w < runcfg->num_wgroups; w++)
         {
-            RuntimeThreadConfig* thread =  &wg->threads[i];
-            DEBUG_PRINT(DEBUGLEV_DEVELOP, "Setting thread %d run command function to %p", thread->local_id, thread->testconfig->function);
-            thread->command->cmdfunc.run = thread->testconfig->function;
-            err = send_cmd(LIKWID_THREAD_COMMAND_RUN, thread);
+            RuntimeWorkgroupConfig* wg = &runcfg->wgroups[w];
+            for (int i = 0; i < wg->num_threads; i++)
+            {
+                RuntimeThreadConfig* thread =  &wg->threads[i];
+                DEBUG_PRINT(DEBUGLEV_DEVELOP, "Setting thread %d run command function to %p", thread->local_id, thread->testconfig->function);
+                thread->command->cmdfunc.run = thread->testconfig->function;
+            }
+            err = broadcast_cmd(LIKWID_THREAD_COMMAND_RUN, wg);
             if (err < 0)
             {
                 ERROR_PRINT("Error communicating with threads");
@@ -767,25 +1622,103 @@ int main(int argc, char** argv)
                 goto main_out;
             }
         }
+
+        if (sweep || runcfg->scaling != SCALING_NONE)
+        {
+            /* The results of the point are collected before the next one changes the streams */
+            for (int w = 0; w < runcfg->num_wgroups; w++)
+            {
+                err = wait_cmds(&runcfg->wgroups[w]);
+                if (err < 0)
+                {
+                    ERROR_PRINT("Error communicating with threads");
+                    bstrListDestroy(rate_metrics);
+                    free(rates);
+                    destroy_threads(runcfg->num_wgroups, runcfg->wgroups);
+                    goto main_out;
+                }
+            }
+            err = update_results(runcfg, runcfg->num_wgroups, runcfg->wgroups);
+            if (err != 0)
+            {
+                ERROR_PRINT("Error updating results");
+            }
+        }
+        if (runcfg->scaling != SCALING_NONE)
+        {
+            for (int m = 0; m < rate_metrics->qty; m++)
+            {
+                bstring bkey = bformat("%s[sum]", bdata(rate_metrics->entry[m]));
+                rates[p * rate_metrics->qty + m] = 0.0;
+                get_value(runcfg->global_results, bkey, &rates[p * rate_metrics->qty + m]);
+                bdestroy(bkey);
+            }
+        }
+        else if (sweep)
+        {
+            size_t value = 0;
+            int unit = 0;
+            sweep_value(sweep->value, &value, &unit);
+            bstring bheader = (unit ? bformat("%s [B]", bdata(sweep->name)) : bstrcpy(sweep->name));
+            err = add_sweep_row(runcfg, bheader, value, &pointtable);
+            bdestroy(bheader);
+            if (err != 0)
+            {
+                ERROR_PRINT("Error adding results of %s=%s", bdata(sweep->name), bdata(sweep->value));
+            }
+        }
     }
 
     /*
-     * Exit threads
+     * All threads of the pool take part in the exit, the results are not needed anymore
      */
-    for (int w = 0; w < runcfg->num_wgroups; w++)
+    if (runcfg->scaling != SCALING_NONE)
     {
-        RuntimeWorkgroupConfig* wg = &runcfg->wgroups[w];
-        for (int i = 0; i < wg->num_threads; i++)
+        RuntimeWorkgroupConfig* wg = &runcfg->wgroups[0];
+        release_results(runcfg);
+        err = scale_threads(runcfg, wg, wg->max_threads);
+        if (err == 0)
         {
-            err = send_cmd(LIKWID_THREAD_COMMAND_EXIT, &wg->threads[i]);
-            if (err < 0)
+            err = reset_results(runcfg);
+        }
+        if (err == 0)
+        {
+            err = scaling_table(rate_metrics, num_points, wg->hwthreads, rates, &pointtable);
+        }
+        if (err != 0)
+        {
+            ERROR_PRINT("Error evaluating thread scaling");
+        }
+        for (int m = 0; m < rate_metrics->qty; m++)
+        {
+            double series[num_points];
+            for (int p = 0; p < num_points; p++)
             {
-                ERROR_PRINT("Error communicating with threads");
-                destroy_threads(runcfg->num_wgroups, runcfg->wgroups);
-                goto main_out;
+                series[p] = rates[p * rate_metrics->qty + m];
+            }
+            int sat = scaling_saturation(series, num_points, runcfg->saturation);
+            if (sat >= 0)
+            {
+                printf("%s: %d threads reach %.0f%% of the peak (%.3f)\n", bdata(rate_metrics->entry[m]), sat + 1, runcfg->saturation * 100.0, series[sat]);
             }
         }
     }
+    bstrListDestroy(rate_metrics);
+    free(rates);
+
+    /*
+     * Exit threads
+     */
+    for (int w = 0; w < runcfg->num_wgroups; w++)
+    {
+        err = broadcast_cmd(LIKWID_THREAD_COMMAND_EXIT, &runcfg->wgroups[w]);
+        if (err < 0)
+        {
+            ERROR_PRINT("Error communicating with threads");
+            destroy_threads(runcfg->num_wgroups, runcfg->wgroups);
+            goto main_out;
+        }
+    }
 
     // _sig_handlers(runcfg);
 
@@ -796,10 +1729,46 @@ int main(int argc, char** argv)
         goto main_out;
     }
 
-    err = update_results(runcfg, runcfg->num_wgroups, runcfg->wgroups);
-    if (err != 0)
+    /*
+     * Report how long the threads took to pick up the commands
+     */
+    for (int w = 0; w < runcfg->num_wgroups; w++)
+    {
+        report_dispatch(&runcfg->wgroups[w]);
+    }
+
+    /*
+     * Verify the NUMA placement of the streams
+     */
+    for (int w = 0; w < runcfg->num_wgroups; w++)
+    {
+        err = report_placement(&runcfg->wgroups[w]);
+        if (err != 0)
+        {
+            ERROR_PRINT("Error verifying NUMA placement");
+        }
+    }
+
+    Table* latency = NULL;
+    Table* domains = NULL;
+    if (num_points == 1 && !sweep && runcfg->scaling == SCALING_NONE)
     {
-        ERROR_PRINT("Error updating results");
+        err = update_results(runcfg, runcfg->num_wgroups, runcfg->wgroups);
+        if (err != 0)
+        {
+            ERROR_PRINT("Error updating results");
+        }
+        /* The threads hold the histograms, collect them before they are destroyed */
+        err = latency_table(runcfg, &latency);
+        if (err != 0)
+        {
+            ERROR_PRINT("Error collecting latency histograms");
+        }
+        err = domain_table(runcfg, &domains);
+        if (err != 0)
+        {
+            ERROR_PRINT("Error aggregating the results per %s", domain_level_name(runcfg->domains));
+        }
     }
 
     /*
@@ -824,7 +1793,7 @@ int main(int argc, char** argv)
     /*
      * * Print everything
      */
-    if (DEBUGLEV_DEVELOP == global_verbosity)
+    if (DEBUGLEV_DEVELOP == global_verbosity && !pointtable)
     {
         printf("Workgroup Results\n");
         for (int i = 0; i < runcfg->num_wgroups; i++)
@@ -840,7 +1809,10 @@ int main(int argc, char** argv)
     Table* wgroup = NULL;
     Table* global = NULL;
     int max_cols = 0;
-    update_table(runcfg, &thread, &wgroup, &global, &max_cols, 1);
+    if (!pointtable)
+    {
+        update_table(runcfg, &thread, &wgroup, &global, &max_cols, 1);
+    }
     FILE* output = NULL;
     int fileout = 0;
     if (blength(runcfg->output) > 0)
@@ -870,7 +1842,24 @@ int main(int argc, char** argv)
         }
     }
 
-    if (runcfg->csv == 0 && runcfg->json == 0)
+    if (pointtable)
+    {
+        /* One row per point, the per-thread results of the last point are not printed */
+        if (runcfg->csv == 0 && runcfg->json == 0)
+        {
+            fprintf(output, (num_forms > 0 ? "\nInstruction Results\n" : (sweep ? "\nSweep Results\n" : "\nScaling Results\n")));
+            table_print(output, pointtable, 0);
+        }
+        else if (runcfg->csv > 0)
+        {
+            table_to_csv(output, pointtable, bdata(runcfg->output), pointtable->headers->qty, 0);
+        }
+        else if (runcfg->json > 0)
+        {
+            table_to_json(output, pointtable, bdata(runcfg->output), (num_forms > 0 ? "instruction_results" : (sweep ? "sweep_results" : "scaling_results")));
+        }
+    }
+    else if (runcfg->csv == 0 && runcfg->json == 0)
     {
         fprintf(output, "\nThread Results\n");
         table_print(output, thread, 1);
@@ -878,22 +1867,64 @@ int main(int argc, char** argv)
         table_print(output, wgroup, 1);
         fprintf(output, "\nGlobal Results\n");
         table_print(output, global, 1);
+        if (domains)
+        {
+            fprintf(output, "\nDomain Results\n");
+            table_print(output, domains, 1);
+        }
+        if (latency)
+        {
+            fprintf(output, "\nLatency Histogram\n");
+            table_print(output, latency, 1);
+        }
     }
     else if (runcfg->csv > 0)
     {
         table_to_csv(output, thread, bdata(runcfg->output), max_cols, 1);
         table_to_csv(output, wgroup, bdata(runcfg->output), max_cols, 1);
         table_to_csv(output, global, bdata(runcfg->output), max_cols, 1);
+        if (domains)
+        {
+            table_to_csv(output, domains, bdata(runcfg->output), max_cols, 1);
+        }
+        if (latency)
+        {
+            table_to_csv(output, latency, bdata(runcfg->output), max_cols, 1);
+        }
     }
     else if (runcfg->json > 0)
     {
         table_to_json(output, thread, bdata(runcfg->output), "thread_results");
         table_to_json(output, wgroup, bdata(runcfg->output), "workgroup_results");
+        /* The global results close the JSON object */
+        if (domains)
+        {
+            table_to_json(output, domains, bdata(runcfg->output), "domain_results");
+        }
         table_to_json(output, global, bdata(runcfg->output), "global_results");
+        if (latency)
+        {
+            table_to_json(output, latency, bdata(runcfg->output), "latency_histogram");
+        }
+    }
+    if (latency)
+    {
+        table_destroy(latency);
+    }
+    if (domains)
+    {
+        table_destroy(domains);
+    }
+    if (pointtable)
+    {
+        table_destroy(pointtable);
+    }
+    else
+    {
+        table_destroy(thread);
+        table_destroy(wgroup);
+        table_destroy(global);
     }
-    table_destroy(thread);
-    table_destroy(wgroup);
-    table_destroy(global);
 
     if (fileout && output)
     {
@@ -923,6 +1954,7 @@ int main(int argc, char** argv)
 main_out:
     DEBUG_PRINT(DEBUGLEV_DEVELOP, "MAIN_OUT");
     free_runtime_config(runcfg);
+    symbol_reset();
     destroyCliOptions(&baseopts);
     destroyCliOptions(&testopts);
     if (kernelfolder)
@@ -933,6 +1965,10 @@ main_out:
     {
         bdestroy(tmpfolder);
     }
+    if (cachefolder)
+    {
+        bdestroy(cachefolder);
+    }
     if (compiler)
     {
         bdestroy(compiler);
@@ -941,6 +1977,11 @@ main_out:
     {
         bstrListDestroy(args);
     }
+    instrbatch_free(num_forms, forms);
+    if (cpuflags)
+    {
+        bstrListDestroy(cpuflags);
+    }
     /*
     if (hline)
     {
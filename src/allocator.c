@@ -9,6 +9,8 @@
 
 #include "allocator.h"
 #include "bitmap.h"
+#include "pages.h"
+#include "fill.h"
 
 size_t getsizeof(TestConfigStreamType type)
 {
@@ -97,13 +99,46 @@ size_t getstreamdimbytes(RuntimeStreamConfig *sdata, int dim)
     return total;
 }
 
+/*
+ * Stream memory comes from the heap with cache line alignment or, for the other
+ * allocation backends, from a separate mapping that is released with munmap
+ */
+static int _allocate_memory(RuntimeStreamConfig *sdata, void** ptr, size_t size)
+{
+    sdata->alloc_size = 0;
+    if (sdata->allocation == STREAM_ALLOCATION_HEAP)
+    {
+        return posix_memalign(ptr, CL_SIZE, size);
+    }
+    int err = alloc_pages(size, sdata->allocation, sdata->allocation_path, ptr, &sdata->alloc_size);
+    if (err != 0)
+    {
+        errno = -err;
+        ERROR_PRINT("Cannot allocate %zu Bytes with %s pages for stream %s", size, allocation_name(sdata->allocation), bdata(sdata->name));
+    }
+    return err;
+}
+
+static void _release_memory(RuntimeStreamConfig *sdata)
+{
+    if (sdata->alloc_size > 0)
+    {
+        free_pages(sdata->base_ptr, sdata->alloc_size);
+        sdata->alloc_size = 0;
+    }
+    else
+    {
+        free(sdata->base_ptr);
+    }
+}
+
 #define DEFINE_1DIM_TYPE_CASE_ALLOC(streamtype, datatype, offset) \
     case streamtype: \
         if (offset < 0 || (size_t)offset >= sdata->dimsizes[0]) return -EINVAL; \
         size_t msize_##datatype = (size + offset) * sizeof(datatype); \
         if (msize_##datatype <= 0) return -EINVAL; \
         datatype * p_##datatype = NULL; \
-        if (posix_memalign((void**)&p_##datatype, CL_SIZE, msize_##datatype) != 0) return -ENOMEM; \
+        if (_allocate_memory(sdata, (void**)&p_##datatype, msize_##datatype) != 0) return -ENOMEM; \
         sdata->base_ptr = p_##datatype; \
         sdata->ptr = (char*)(p_##datatype + offset); \
         DEBUG_PRINT(DEBUGLEV_DEVELOP, "1dim: base - %p, ptr - %p", sdata->base_ptr, sdata->ptr); \
@@ -140,7 +175,7 @@ int _allocate_arrays_1dim(RuntimeStreamConfig *sdata)
         msize2_##datatype = (offset2 + size2) * msize1_##datatype * sizeof(datatype); \
         if (msize1_##datatype <= 0 || msize2_##datatype <= 0) return -EINVAL; \
         datatype * p_##datatype = NULL; \
-        if (posix_memalign((void**)&p_##datatype, CL_SIZE, msize2_##datatype) != 0) return -ENOMEM; \
+        if (_allocate_memory(sdata, (void**)&p_##datatype, msize2_##datatype) != 0) return -ENOMEM; \
         sdata->base_ptr = p_##datatype; \
         sdata->ptr = (char*)(p_##datatype + (offset1 * (size2 + offset2) + offset2)); \
         DEBUG_PRINT(DEBUGLEV_DEVELOP, "2dim: base - %p, ptr - %p", sdata->base_ptr, sdata->ptr); \
@@ -183,7 +218,7 @@ static int _allocate_arrays_2dim(RuntimeStreamConfig *sdata)
         msize3_##datatype = (msize2_##datatype) * (size3 + offset3) * sizeof(datatype); \
         if (msize1_##datatype <= 0 || msize2_##datatype <= 0 || msize3_##datatype <= 0) return -EINVAL; \
         datatype * p_##datatype = NULL; \
-        if (posix_memalign((void**)&p_##datatype, CL_SIZE, msize3_##datatype) != 0) return -ENOMEM; \
+        if (_allocate_memory(sdata, (void**)&p_##datatype, msize3_##datatype) != 0) return -ENOMEM; \
         sdata->base_ptr = p_##datatype; \
         sdata->ptr = (char*)(p_##datatype + (offset1 * (size2 + offset2) * (size3 + offset3) + offset2 * (size3 + offset3) + offset3)); \
         DEBUG_PRINT(DEBUGLEV_DEVELOP, "3dim: base - %p, ptr - %p", sdata->base_ptr, sdata->ptr); \
@@ -241,23 +276,27 @@ int allocate_arrays(RuntimeStreamConfig *sdata)
 
 int allocate_streams(RuntimeConfig* runcfg)
 {
-    if (runcfg->tcfg->num_streams == 0 || runcfg->num_wgroups == 0)
+    if (runcfg->num_wgroups == 0)
     {
         return 0;
     }
     for (int w = 0; w < runcfg->num_wgroups; w++)
     {
         RuntimeWorkgroupConfig* wg = &runcfg->wgroups[w];
-        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Allocating %d streams", runcfg->tcfg->num_streams);
-        wg->streams = malloc(runcfg->tcfg->num_streams * sizeof(RuntimeStreamConfig));
+        if (wg->tcfg->num_streams == 0)
+        {
+            continue;
+        }
+        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Allocating %d streams", wg->tcfg->num_streams);
+        wg->streams = malloc(wg->tcfg->num_streams * sizeof(RuntimeStreamConfig));
         if (!wg->streams)
         {
             return -ENOMEM;
         }
-        memset(wg->streams, 0, runcfg->tcfg->num_streams * sizeof(RuntimeStreamConfig));
-        for (int i = 0; i < runcfg->tcfg->num_streams; i++)
+        memset(wg->streams, 0, wg->tcfg->num_streams * sizeof(RuntimeStreamConfig));
+        for (int i = 0; i < wg->tcfg->num_streams; i++)
         {
-            TestConfigStream *istream = &runcfg->tcfg->streams[i];
+            TestConfigStream *istream = &wg->tcfg->streams[i];
             RuntimeStreamConfig* ostream = &wg->streams[i];
             if (istream && ostream)
             {
@@ -273,7 +312,7 @@ int allocate_streams(RuntimeConfig* runcfg)
                 }
             }
         }
-        wg->num_streams = runcfg->tcfg->num_streams;
+        wg->num_streams = wg->tcfg->num_streams;
         for (int i = 0; i < wg->num_streams; i++)
         {
             allocate_arrays(&wg->streams[i]);
@@ -288,7 +327,7 @@ void _release_arrays_1dim(RuntimeStreamConfig *sdata)
     if (sdata && sdata->base_ptr != NULL)
     {
         DEBUG_PRINT(DEBUGLEV_DEVELOP, "release str %s, base ptr: %p", bdata(sdata->name), sdata->base_ptr);
-        free(sdata->base_ptr);
+        _release_memory(sdata);
         sdata->base_ptr = NULL;
         sdata->ptr = NULL;
     }
@@ -297,7 +336,7 @@ void _release_arrays_1dim(RuntimeStreamConfig *sdata)
 #define DEFINE_2DIM_TYPE_CASE_RELEASE(streamtype, datatype) \
     case streamtype: \
         if (sdata && sdata->base_ptr != NULL) {\
-            free(sdata->base_ptr);\
+            _release_memory(sdata);\
             sdata->base_ptr = NULL;\
             sdata->ptr = NULL; }\
         break;
@@ -330,7 +369,7 @@ void _release_arrays_2dim(RuntimeStreamConfig *sdata)
 #define DEFINE_3DIM_TYPE_CASE_RELEASE(streamtype, datatype) \
     case streamtype: \
         if (sdata && sdata->base_ptr != NULL) {\
-            free(sdata->base_ptr); \
+            _release_memory(sdata); \
             sdata->ptr = NULL; \
             sdata->base_ptr = NULL; }\
         break;
@@ -377,198 +416,32 @@ void release_arrays(RuntimeStreamConfig *sdata)
 }
 
 
-#define INIT_ARRAY(datatype) \
-    do { \
-        datatype * base = (datatype*) ptr; \
-        if (dims == 1) base[indices[0]] = *(datatype*)init_val; \
-        else if (dims == 2) \
-        { \
-            size_t stride1_##datatype = (dimsizes[1] / sizeof(datatype)); \
-            base[indices[0] * stride1_##datatype + indices[1]] = *(datatype*)init_val; \
-        } \
-        else if (dims == 3) \
-        { \
-            size_t stride2_##datatype = (dimsizes[2] / sizeof(datatype)); \
-            size_t stride1_##datatype = (dimsizes[1] / sizeof(datatype)) * stride2_##datatype; \
-            base[indices[0] * stride1_##datatype + indices[1] * stride2_##datatype + indices[2]] = *(datatype*)init_val; \
-        } \
-    } while (0)
-
-
-int init_function(void* ptr, int state, TestConfigStreamType type, int dims, size_t* dimsizes, void* init_val, ...)
-{
-    va_list args;
-    va_start(args, init_val);
-    int indices[3] = {0, 0, 0};
-    for (int i = 0; i < dims; i++)
-    {
-        indices[i] = va_arg(args, int);
-    }
-    va_end(args);
-
-    if (ptr != NULL)
-    {
-        switch (type)
-        {
-            case TEST_STREAM_TYPE_SINGLE:
-                INIT_ARRAY(float);
-                break;
-            case TEST_STREAM_TYPE_DOUBLE:
-                INIT_ARRAY(double);
-                break;
-            case TEST_STREAM_TYPE_INT:
-                INIT_ARRAY(int);
-                break;
-            case TEST_STREAM_TYPE_INT64:
-                INIT_ARRAY(int64_t);
-                break;
-#ifdef WITH_HALF_PRECISION
-            case TEST_STREAM_TYPE_HALF:
-                INIT_ARRAY(_Float16);
-                break;
-#endif
-            default:
-                ERROR_PRINT("Invalid datatype");
-                return state;
-        }
-    }
-    return state + 1;
-}
-
-#define DEFINE_1D_TYPE_CASE_INIT(streamtype, datatype) \
-    case streamtype: \
-        tmp = sdata->ptr; \
-        datatype* datatype##_ptr = (datatype *)tmp; \
-        for (size_t i = 0; i < elems; i++) \
-        { \
-            state = sdata->init((void*)datatype##_ptr, state, sdata->type, sdata->dims, sdata->dimsizes, sdata->init_val, i); \
-        } \
-        break;
-
-int _initialize_arrays_1dim(RuntimeStreamConfig *sdata)
-{
-    if (sdata && sdata->ptr)
-    {
-        void* tmp = NULL;
-        int state = 0;
-        size_t elems = getstreamelems(sdata);
-        // printf("initialize str %d with %d dimensions and total %lu elements\n", sdata->id, sdata->dims, elems);
-        switch(sdata->type)
-        {
-            DEFINE_1D_TYPE_CASE_INIT(TEST_STREAM_TYPE_DOUBLE, double)
-            DEFINE_1D_TYPE_CASE_INIT(TEST_STREAM_TYPE_INT, int)
-            DEFINE_1D_TYPE_CASE_INIT(TEST_STREAM_TYPE_SINGLE, float)
-            DEFINE_1D_TYPE_CASE_INIT(TEST_STREAM_TYPE_INT64, int64_t)
-#ifdef WITH_HALF_PRECISION
-            DEFINE_1D_TYPE_CASE_INIT(TEST_STREAM_TYPE_HALF, _Float16)
-#endif
-            default:
-                fprintf(stderr, "Unknown stream type\n");
-                break;
-        }
-    }
-    return 0;
-}
-
-#define DEFINE_2D_TYPE_CASE_INIT(streamtype, datatype) \
-    case streamtype: \
-        tmp = sdata->ptr; \
-        datatype * datatype##_ptr = (datatype *)tmp; \
-        for (size_t i = 0; i < size1; i++) \
-        { \
-            for (size_t j = 0; j < size2; j++) \
-            { \
-                state = sdata->init((void*)datatype##_ptr, state, sdata->type, sdata->dims, sdata->dimsizes, sdata->init_val, i, j);  \
-            } \
-        } \
-        break;
-
-int _initialize_arrays_2dim(RuntimeStreamConfig *sdata)
-{
-    if (sdata && sdata->ptr)
-    {
-        void* tmp = NULL;
-        int state = 0;
-        size_t elems = getstreamelems(sdata);
-        size_t size1 = sdata->dimsizes[0] / getsizeof(sdata->type);
-        size_t size2 = sdata->dimsizes[1] / getsizeof(sdata->type);
-        // printf("initialize str %d with %d dimensions and total %lu elements\n", sdata->id, sdata->dims, elems);
-        switch(sdata->type)
-        {
-            DEFINE_2D_TYPE_CASE_INIT(TEST_STREAM_TYPE_DOUBLE, double)
-            DEFINE_2D_TYPE_CASE_INIT(TEST_STREAM_TYPE_INT, int)
-            DEFINE_2D_TYPE_CASE_INIT(TEST_STREAM_TYPE_SINGLE, float)
-            DEFINE_2D_TYPE_CASE_INIT(TEST_STREAM_TYPE_INT64, int64_t)
-#ifdef WITH_HALF_PRECISION
-            DEFINE_2D_TYPE_CASE_INIT(TEST_STREAM_TYPE_HALF, _Float16)
-#endif
-            default:
-                fprintf(stderr, "Unknown stream type\n");
-                break;
-        }
-    }
-    return 0;
-}
-
-#define DEFINE_3D_TYPE_CASE_INIT(streamtype, datatype) \
-    case streamtype: \
-        tmp = sdata->ptr; \
-        datatype* datatype##_ptr = (datatype *)tmp; \
-        for (size_t i = 0; i < size1; i++) \
-        { \
-            for (size_t j = 0; j < size2; j++) \
-            { \
-                for (size_t k = 0; k < size3; k++) \
-                { \
-                    state = sdata->init((void*)datatype##_ptr, state, sdata->type, sdata->dims, sdata->dimsizes, sdata->init_val, i, j, k); \
-                } \
-            } \
-        } \
-        break;
-
-int _initialize_arrays_3dim(RuntimeStreamConfig *sdata)
+/*
+ * Fills count elements at ptr with the initialization of the stream, first is the index
+ * of ptr[0] in the whole stream. Constant values come from init_val if it is set.
+ */
+int initialize_range(RuntimeStreamConfig *sdata, void* ptr, size_t first, size_t count)
 {
-    if (sdata && sdata->ptr)
+    StreamFill fill = sdata->fill;
+    if (fill.mode == STREAM_FILL_CONSTANT && sdata->init_val)
     {
-        void* tmp = NULL;
-        int state = 0;
-        size_t elems = getstreamelems(sdata);
-        size_t size1 = sdata->dimsizes[0] / getsizeof(sdata->type);
-        size_t size2 = sdata->dimsizes[1] / getsizeof(sdata->type);
-        size_t size3 = sdata->dimsizes[2] / getsizeof(sdata->type);
-        // printf("initialize str %d with %d dimensions and total %lu elements\n", sdata->id, sdata->dims, elems);
-        switch(sdata->type)
-        {
-            DEFINE_3D_TYPE_CASE_INIT(TEST_STREAM_TYPE_DOUBLE, double)
-            DEFINE_3D_TYPE_CASE_INIT(TEST_STREAM_TYPE_INT, int)
-            DEFINE_3D_TYPE_CASE_INIT(TEST_STREAM_TYPE_SINGLE, float)
-            DEFINE_3D_TYPE_CASE_INIT(TEST_STREAM_TYPE_INT64, int64_t)
-#ifdef WITH_HALF_PRECISION
-            DEFINE_3D_TYPE_CASE_INIT(TEST_STREAM_TYPE_HALF, _Float16)
-#endif
-            default:
-                fprintf(stderr, "Unknown stream type\n");
-                break;
-        }
+        memcpy(&fill.value, sdata->init_val, getsizeof(sdata->type));
     }
-    return 0;
+    return fill_stream(ptr, sdata->type, first, count, &fill);
 }
 
 int initialize_arrays(RuntimeStreamConfig *sdata)
 {
-    if (sdata->dims == 1)
-    {
-        return _initialize_arrays_1dim(sdata);
-    }
-    else if (sdata->dims == 2)
+    if (sdata->dims < 1 || sdata->dims > 3)
     {
-        return _initialize_arrays_2dim(sdata);
+        return -EINVAL;
     }
-    else if (sdata->dims == 3)
+    if (sdata->ptr)
     {
-        return _initialize_arrays_3dim(sdata);
+        // The dimensions are stored contiguously, so all elements are filled at once
+        return initialize_range(sdata, sdata->ptr, 0, getstreamelems(sdata));
     }
-    return -EINVAL;
+    return 0;
 }
 
 
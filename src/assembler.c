@@ -0,0 +1,1195 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "error.h"
+#include "bstrlib.h"
+#include "bstrlib_helper.h"
+#include "assembler.h"
+
+#if defined(__x86_64) || defined(__x86_64__)
+
+typedef struct {
+    unsigned char* data;
+    size_t len;
+    size_t size;
+} AsmBuffer;
+
+typedef struct {
+    bstring label;
+    size_t pos;
+    size_t next;
+} AsmFixup;
+
+typedef struct {
+    AsmBuffer text;
+    AsmBuffer data;
+    int section;
+    int num_labels;
+    bstring* label_names;
+    int* label_sections;
+    size_t* label_offsets;
+    int num_fixups;
+    AsmFixup* fixups;
+} AsmContext;
+
+/* Encoding order of the registers: the index is the register number in ModRM/SIB/REX */
+static char* _gpr64_names[16] = {
+    "rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+    "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15",
+};
+
+#define ASM_GPR_RSP 4
+#define ASM_GPR_RBP 5
+#define ASM_GPR_R12 12
+#define ASM_GPR_R13 13
+
+typedef struct {
+    char* name;
+    unsigned char jcc;
+} AsmJumpDefinition;
+
+static AsmJumpDefinition _jumps[] = {
+    {"jmp", 0x00},
+    {"je", 0x84},
+    {"jz", 0x84},
+    {"jne", 0x85},
+    {"jnz", 0x85},
+    {"jb", 0x82},
+    {"jae", 0x83},
+    {"jbe", 0x86},
+    {"ja", 0x87},
+    {"jl", 0x8C},
+    {"jge", 0x8D},
+    {"jle", 0x8E},
+    {"jg", 0x8F},
+    {NULL, 0x00},
+};
+
+typedef struct {
+    char* name;
+    unsigned char rm_reg;
+    unsigned char digit;
+} AsmArithDefinition;
+
+/* rm_reg is the 'r/m <- r/m op reg' opcode, 'reg <- reg op r/m' is rm_reg + 2 */
+static AsmArithDefinition _ariths[] = {
+    {"add", 0x01, 0},
+    {"or", 0x09, 1},
+    {"and", 0x21, 4},
+    {"sub", 0x29, 5},
+    {"xor", 0x31, 6},
+    {"cmp", 0x39, 7},
+    {NULL, 0x00, 0},
+};
+
+typedef enum {
+    ASM_ENC_SSE = 0,
+    ASM_ENC_VEX,
+} AsmVectorEncoding;
+
+#define ASM_VEC_MOVE   (1<<0)
+#define ASM_VEC_ARITH  (1<<1)
+#define ASM_VEC_MMX    (1<<2)
+#define ASM_VEC_SCALAR (1<<3)
+
+#define ASM_OPCODE_NONE -1
+
+typedef struct {
+    char* name;
+    AsmVectorEncoding enc;
+    unsigned char prefix;
+    int map;
+    int load_op;
+    int store_op;
+    int w;
+    int flags;
+} AsmVectorDefinition;
+
+/* map: 0 = one-byte, 1 = 0F, 2 = 0F38, 3 = 0F3A */
+static AsmVectorDefinition _vectors[] = {
+    {"movapd", ASM_ENC_SSE, 0x66, 1, 0x28, 0x29, 0, ASM_VEC_MOVE},
+    {"movaps", ASM_ENC_SSE, 0x00, 1, 0x28, 0x29, 0, ASM_VEC_MOVE},
+    {"movupd", ASM_ENC_SSE, 0x66, 1, 0x10, 0x11, 0, ASM_VEC_MOVE},
+    {"movups", ASM_ENC_SSE, 0x00, 1, 0x10, 0x11, 0, ASM_VEC_MOVE},
+    {"movsd", ASM_ENC_SSE, 0xF2, 1, 0x10, 0x11, 0, ASM_VEC_MOVE|ASM_VEC_SCALAR},
+    {"movss", ASM_ENC_SSE, 0xF3, 1, 0x10, 0x11, 0, ASM_VEC_MOVE|ASM_VEC_SCALAR},
+    {"movntpd", ASM_ENC_SSE, 0x66, 1, ASM_OPCODE_NONE, 0x2B, 0, ASM_VEC_MOVE},
+    {"movntps", ASM_ENC_SSE, 0x00, 1, ASM_OPCODE_NONE, 0x2B, 0, ASM_VEC_MOVE},
+    {"movntdq", ASM_ENC_SSE, 0x66, 1, ASM_OPCODE_NONE, 0xE7, 0, ASM_VEC_MOVE},
+    {"movntdqa", ASM_ENC_SSE, 0x66, 2, 0x2A, ASM_OPCODE_NONE, 0, ASM_VEC_MOVE},
+    {"movq", ASM_ENC_SSE, 0x00, 1, 0x6F, 0x7F, 0, ASM_VEC_MOVE|ASM_VEC_MMX},
+    {"movntq", ASM_ENC_SSE, 0x00, 1, ASM_OPCODE_NONE, 0xE7, 0, ASM_VEC_MOVE|ASM_VEC_MMX},
+    {"addpd", ASM_ENC_SSE, 0x66, 1, 0x58, ASM_OPCODE_NONE, 0, ASM_VEC_MOVE},
+    {"addps", ASM_ENC_SSE, 0x00, 1, 0x58, ASM_OPCODE_NONE, 0, ASM_VEC_MOVE},
+    {"addsd", ASM_ENC_SSE, 0xF2, 1, 0x58, ASM_OPCODE_NONE, 0, ASM_VEC_MOVE|ASM_VEC_SCALAR},
+    {"addss", ASM_ENC_SSE, 0xF3, 1, 0x58, ASM_OPCODE_NONE, 0, ASM_VEC_MOVE|ASM_VEC_SCALAR},
+    {"mulpd", ASM_ENC_SSE, 0x66, 1, 0x59, ASM_OPCODE_NONE, 0, ASM_VEC_MOVE},
+    {"mulps", ASM_ENC_SSE, 0x00, 1, 0x59, ASM_OPCODE_NONE, 0, ASM_VEC_MOVE},
+    {"mulsd", ASM_ENC_SSE, 0xF2, 1, 0x59, ASM_OPCODE_NONE, 0, ASM_VEC_MOVE|ASM_VEC_SCALAR},
+    {"mulss", ASM_ENC_SSE, 0xF3, 1, 0x59, ASM_OPCODE_NONE, 0, ASM_VEC_MOVE|ASM_VEC_SCALAR},
+    {"subpd", ASM_ENC_SSE, 0x66, 1, 0x5C, ASM_OPCODE_NONE, 0, ASM_VEC_MOVE},
+    {"subps", ASM_ENC_SSE, 0x00, 1, 0x5C, ASM_OPCODE_NONE, 0, ASM_VEC_MOVE},
+    {"subsd", ASM_ENC_SSE, 0xF2, 1, 0x5C, ASM_OPCODE_NONE, 0, ASM_VEC_MOVE|ASM_VEC_SCALAR},
+    {"divpd", ASM_ENC_SSE, 0x66, 1, 0x5E, ASM_OPCODE_NONE, 0, ASM_VEC_MOVE},
+    {"divps", ASM_ENC_SSE, 0x00, 1, 0x5E, ASM_OPCODE_NONE, 0, ASM_VEC_MOVE},
+    {"divsd", ASM_ENC_SSE, 0xF2, 1, 0x5E, ASM_OPCODE_NONE, 0, ASM_VEC_MOVE|ASM_VEC_SCALAR},
+    {"xorpd", ASM_ENC_SSE, 0x66, 1, 0x57, ASM_OPCODE_NONE, 0, ASM_VEC_MOVE},
+    {"xorps", ASM_ENC_SSE, 0x00, 1, 0x57, ASM_OPCODE_NONE, 0, ASM_VEC_MOVE},
+    {"pxor", ASM_ENC_SSE, 0x66, 1, 0xEF, ASM_OPCODE_NONE, 0, ASM_VEC_MOVE},
+    {"vmovapd", ASM_ENC_VEX, 0x66, 1, 0x28, 0x29, 0, ASM_VEC_MOVE},
+    {"vmovaps", ASM_ENC_VEX, 0x00, 1, 0x28, 0x29, 0, ASM_VEC_MOVE},
+    {"vmovupd", ASM_ENC_VEX, 0x66, 1, 0x10, 0x11, 0, ASM_VEC_MOVE},
+    {"vmovups", ASM_ENC_VEX, 0x00, 1, 0x10, 0x11, 0, ASM_VEC_MOVE},
+    {"vmovsd", ASM_ENC_VEX, 0xF2, 1, 0x10, 0x11, 0, ASM_VEC_MOVE|ASM_VEC_SCALAR},
+    {"vmovss", ASM_ENC_VEX, 0xF3, 1, 0x10, 0x11, 0, ASM_VEC_MOVE|ASM_VEC_SCALAR},
+    {"vmovntpd", ASM_ENC_VEX, 0x66, 1, ASM_OPCODE_NONE, 0x2B, 0, ASM_VEC_MOVE},
+    {"vmovntps", ASM_ENC_VEX, 0x00, 1, ASM_OPCODE_NONE, 0x2B, 0, ASM_VEC_MOVE},
+    {"vmovntdq", ASM_ENC_VEX, 0x66, 1, ASM_OPCODE_NONE, 0xE7, 0, ASM_VEC_MOVE},
+    {"vmovntdqa", ASM_ENC_VEX, 0x66, 2, 0x2A, ASM_OPCODE_NONE, 0, ASM_VEC_MOVE},
+    {"vbroadcastsd", ASM_ENC_VEX, 0x66, 2, 0x19, ASM_OPCODE_NONE, 0, ASM_VEC_MOVE},
+    {"vbroadcastss", ASM_ENC_VEX, 0x66, 2, 0x18, ASM_OPCODE_NONE, 0, ASM_VEC_MOVE},
+    {"vaddpd", ASM_ENC_VEX, 0x66, 1, 0x58, ASM_OPCODE_NONE, 0, ASM_VEC_ARITH},
+    {"vaddps", ASM_ENC_VEX, 0x00, 1, 0x58, ASM_OPCODE_NONE, 0, ASM_VEC_ARITH},
+    {"vaddsd", ASM_ENC_VEX, 0xF2, 1, 0x58, ASM_OPCODE_NONE, 0, ASM_VEC_ARITH|ASM_VEC_SCALAR},
+    {"vaddss", ASM_ENC_VEX, 0xF3, 1, 0x58, ASM_OPCODE_NONE, 0, ASM_VEC_ARITH|ASM_VEC_SCALAR},
+    {"vmulpd", ASM_ENC_VEX, 0x66, 1, 0x59, ASM_OPCODE_NONE, 0, ASM_VEC_ARITH},
+    {"vmulps", ASM_ENC_VEX, 0x00, 1, 0x59, ASM_OPCODE_NONE, 0, ASM_VEC_ARITH},
+    {"vmulsd", ASM_ENC_VEX, 0xF2, 1, 0x59, ASM_OPCODE_NONE, 0, ASM_VEC_ARITH|ASM_VEC_SCALAR},
+    {"vmulss", ASM_ENC_VEX, 0xF3, 1, 0x59, ASM_OPCODE_NONE, 0, ASM_VEC_ARITH|ASM_VEC_SCALAR},
+    {"vsubpd", ASM_ENC_VEX, 0x66, 1, 0x5C, ASM_OPCODE_NONE, 0, ASM_VEC_ARITH},
+    {"vsubps", ASM_ENC_VEX, 0x00, 1, 0x5C, ASM_OPCODE_NONE, 0, ASM_VEC_ARITH},
+    {"vdivpd", ASM_ENC_VEX, 0x66, 1, 0x5E, ASM_OPCODE_NONE, 0, ASM_VEC_ARITH},
+    {"vdivps", ASM_ENC_VEX, 0x00, 1, 0x5E, ASM_OPCODE_NONE, 0, ASM_VEC_ARITH},
+    {"vxorpd", ASM_ENC_VEX, 0x66, 1, 0x57, ASM_OPCODE_NONE, 0, ASM_VEC_ARITH},
+    {"vxorps", ASM_ENC_VEX, 0x00, 1, 0x57, ASM_OPCODE_NONE, 0, ASM_VEC_ARITH},
+    {"vpxor", ASM_ENC_VEX, 0x66, 1, 0xEF, ASM_OPCODE_NONE, 0, ASM_VEC_ARITH},
+    {"vfmadd132pd", ASM_ENC_VEX, 0x66, 2, 0x98, ASM_OPCODE_NONE, 1, ASM_VEC_ARITH},
+    {"vfmadd213pd", ASM_ENC_VEX, 0x66, 2, 0xA8, ASM_OPCODE_NONE, 1, ASM_VEC_ARITH},
+    {"vfmadd231pd", ASM_ENC_VEX, 0x66, 2, 0xB8, ASM_OPCODE_NONE, 1, ASM_VEC_ARITH},
+    {"vfmadd132ps", ASM_ENC_VEX, 0x66, 2, 0x98, ASM_OPCODE_NONE, 0, ASM_VEC_ARITH},
+    {"vfmadd213ps", ASM_ENC_VEX, 0x66, 2, 0xA8, ASM_OPCODE_NONE, 0, ASM_VEC_ARITH},
+    {"vfmadd231ps", ASM_ENC_VEX, 0x66, 2, 0xB8, ASM_OPCODE_NONE, 0, ASM_VEC_ARITH},
+    {"vfmadd132sd", ASM_ENC_VEX, 0x66, 2, 0x99, ASM_OPCODE_NONE, 1, ASM_VEC_ARITH|ASM_VEC_SCALAR},
+    {"vfmadd213sd", ASM_ENC_VEX, 0x66, 2, 0xA9, ASM_OPCODE_NONE, 1, ASM_VEC_ARITH|ASM_VEC_SCALAR},
+    {"vfmadd231sd", ASM_ENC_VEX, 0x66, 2, 0xB9, ASM_OPCODE_NONE, 1, ASM_VEC_ARITH|ASM_VEC_SCALAR},
+    {"vfmadd132ss", ASM_ENC_VEX, 0x66, 2, 0x99, ASM_OPCODE_NONE, 0, ASM_VEC_ARITH|ASM_VEC_SCALAR},
+    {"vfmadd213ss", ASM_ENC_VEX, 0x66, 2, 0xA9, ASM_OPCODE_NONE, 0, ASM_VEC_ARITH|ASM_VEC_SCALAR},
+    {"vfmadd231ss", ASM_ENC_VEX, 0x66, 2, 0xB9, ASM_OPCODE_NONE, 0, ASM_VEC_ARITH|ASM_VEC_SCALAR},
+    {NULL, ASM_ENC_SSE, 0x00, 0, ASM_OPCODE_NONE, ASM_OPCODE_NONE, 0, 0},
+};
+
+static int _buffer_add(AsmBuffer* buf, const void* bytes, size_t len)
+{
+    if (buf->len + len > buf->size)
+    {
+        size_t newsize = (buf->size > 0 ? buf->size : 256);
+        while (buf->len + len > newsize)
+        {
+            newsize *= 2;
+        }
+        unsigned char* tmp = realloc(buf->data, newsize);
+        if (!tmp)
+        {
+            return -ENOMEM;
+        }
+        buf->data = tmp;
+        buf->size = newsize;
+    }
+    memcpy(buf->data + buf->len, bytes, len);
+    buf->len += len;
+    return 0;
+}
+
+static int _emit_byte(AsmContext* ctx, unsigned char b)
+{
+    return _buffer_add(&ctx->text, &b, 1);
+}
+
+static int _emit_int32(AsmContext* ctx, int32_t v)
+{
+    unsigned char b[4];
+    for (int i = 0; i < 4; i++)
+    {
+        b[i] = (unsigned char)((uint32_t)v >> (8*i));
+    }
+    return _buffer_add(&ctx->text, b, 4);
+}
+
+static int _emit_int64(AsmContext* ctx, int64_t v)
+{
+    unsigned char b[8];
+    for (int i = 0; i < 8; i++)
+    {
+        b[i] = (unsigned char)((uint64_t)v >> (8*i));
+    }
+    return _buffer_add(&ctx->text, b, 8);
+}
+
+static int _add_label(AsmContext* ctx, bstring name)
+{
+    for (int i = 0; i < ctx->num_labels; i++)
+    {
+        if (bstrcmp(ctx->label_names[i], name) == BSTR_OK)
+        {
+            ERROR_PRINT("Label %s defined multiple times", bdata(name));
+            return -EINVAL;
+        }
+    }
+    bstring* names = realloc(ctx->label_names, (ctx->num_labels+1) * sizeof(bstring));
+    if (!names)
+    {
+        return -ENOMEM;
+    }
+    ctx->label_names = names;
+    int* sections = realloc(ctx->label_sections, (ctx->num_labels+1) * sizeof(int));
+    if (!sections)
+    {
+        return -ENOMEM;
+    }
+    ctx->label_sections = sections;
+    size_t* offsets = realloc(ctx->label_offsets, (ctx->num_labels+1) * sizeof(size_t));
+    if (!offsets)
+    {
+        return -ENOMEM;
+    }
+    ctx->label_offsets = offsets;
+    ctx->label_names[ctx->num_labels] = bstrcpy(name);
+    ctx->label_sections[ctx->num_labels] = ctx->section;
+    ctx->label_offsets[ctx->num_labels] = (ctx->section == ASM_SECTION_TEXT ? ctx->text.len : ctx->data.len);
+    ctx->num_labels++;
+    return 0;
+}
+
+static int _find_label(AsmContext* ctx, bstring name)
+{
+    for (int i = 0; i < ctx->num_labels; i++)
+    {
+        if (bstrcmp(ctx->label_names[i], name) == BSTR_OK)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int _add_fixup(AsmContext* ctx, bstring label)
+{
+    AsmFixup* tmp = realloc(ctx->fixups, (ctx->num_fixups+1) * sizeof(AsmFixup));
+    if (!tmp)
+    {
+        return -ENOMEM;
+    }
+    ctx->fixups = tmp;
+    ctx->fixups[ctx->num_fixups].label = bstrcpy(label);
+    ctx->fixups[ctx->num_fixups].pos = ctx->text.len;
+    ctx->fixups[ctx->num_fixups].next = 0;
+    ctx->num_fixups++;
+    return 0;
+}
+
+static void _destroy_context(AsmContext* ctx)
+{
+    for (int i = 0; i < ctx->num_labels; i++)
+    {
+        bdestroy(ctx->label_names[i]);
+    }
+    for (int i = 0; i < ctx->num_fixups; i++)
+    {
+        bdestroy(ctx->fixups[i].label);
+    }
+    free(ctx->label_names);
+    free(ctx->label_sections);
+    free(ctx->label_offsets);
+    free(ctx->fixups);
+    free(ctx->text.data);
+    free(ctx->data.data);
+    memset(ctx, 0, sizeof(AsmContext));
+}
+
+static int _parse_number(const char* str, int64_t* value)
+{
+    char* end = NULL;
+    if (!str || *str == '\0')
+    {
+        return -EINVAL;
+    }
+    errno = 0;
+    long long v = strtoll(str, &end, 0);
+    if (errno != 0 || *end != '\0')
+    {
+        return -EINVAL;
+    }
+    *value = (int64_t)v;
+    return 0;
+}
+
+static int _parse_register(const char* str, AsmRegClass* regclass, int* reg)
+{
+    for (int i = 0; i < 16; i++)
+    {
+        if (strcasecmp(str, _gpr64_names[i]) == 0)
+        {
+            *regclass = ASM_REGCLASS_GPR64;
+            *reg = i;
+            return 0;
+        }
+    }
+    if ((strncasecmp(str, "xmm", 3) == 0) || (strncasecmp(str, "ymm", 3) == 0))
+    {
+        int64_t num = 0;
+        if (_parse_number(str + 3, &num) == 0 && num >= 0 && num < 16)
+        {
+            *regclass = (tolower(str[0]) == 'x' ? ASM_REGCLASS_XMM : ASM_REGCLASS_YMM);
+            *reg = (int)num;
+            return 0;
+        }
+        return -ENOTSUP;
+    }
+    if (strncasecmp(str, "zmm", 3) == 0)
+    {
+        // AVX-512 requires EVEX encoding
+        return -ENOTSUP;
+    }
+    if (strncasecmp(str, "mm", 2) == 0 && str[2] >= '0' && str[2] <= '7' && str[3] == '\0')
+    {
+        *regclass = ASM_REGCLASS_MM;
+        *reg = str[2] - '0';
+        return 0;
+    }
+    return -EINVAL;
+}
+
+static int _parse_memory(bstring str, AsmOperand* op)
+{
+    int obracket = bstrchrp(str, '[', 0);
+    int ebracket = bstrchrp(str, ']', 0);
+    int err = 0;
+    if (obracket == BSTR_ERR || ebracket == BSTR_ERR || ebracket < obracket)
+    {
+        return -EINVAL;
+    }
+    bstring inner = bmidstr(str, obracket + 1, ebracket - obracket - 1);
+    // Remove all whitespace to simplify the term splitting
+    struct tagbstring bws = bsStatic(" ");
+    struct tagbstring btab = bsStatic("\t");
+    struct tagbstring bnone = bsStatic("");
+    bfindreplace(inner, &bws, &bnone, 0);
+    bfindreplace(inner, &btab, &bnone, 0);
+
+    op->type = ASM_OPERAND_MEM;
+    op->base = -1;
+    op->index = -1;
+    op->scale = 1;
+    op->disp = 0;
+    op->riprel = 0;
+    op->label = NULL;
+
+    int pos = 0;
+    while (pos < blength(inner) && err == 0)
+    {
+        int sign = 1;
+        if (bchar(inner, pos) == '+' || bchar(inner, pos) == '-')
+        {
+            sign = (bchar(inner, pos) == '-' ? -1 : 1);
+            pos++;
+        }
+        int end = pos;
+        while (end < blength(inner) && bchar(inner, end) != '+' && bchar(inner, end) != '-')
+        {
+            end++;
+        }
+        bstring term = bmidstr(inner, pos, end - pos);
+        pos = end;
+        int star = bstrchrp(term, '*', 0);
+        AsmRegClass rc;
+        int reg = -1;
+        int64_t num = 0;
+        if (star != BSTR_ERR)
+        {
+            bstring left = bmidstr(term, 0, star);
+            bstring right = bmidstr(term, star + 1, blength(term) - star - 1);
+            if (_parse_register(bdata(left), &rc, &reg) == 0 && _parse_number(bdata(right), &num) == 0)
+            {
+            }
+            else if (_parse_register(bdata(right), &rc, &reg) == 0 && _parse_number(bdata(left), &num) == 0)
+            {
+            }
+            else
+            {
+                err = -EINVAL;
+            }
+            if (err == 0 && (rc != ASM_REGCLASS_GPR64 || sign < 0 || op->index >= 0 || reg == ASM_GPR_RSP || (num != 1 && num != 2 && num != 4 && num != 8)))
+            {
+                err = -EINVAL;
+            }
+            if (err == 0)
+            {
+                op->index = reg;
+                op->scale = (int)num;
+            }
+            bdestroy(left);
+            bdestroy(right);
+        }
+        else if (strcasecmp(bdata(term), "rip") == 0)
+        {
+            op->riprel = 1;
+        }
+        else if (_parse_register(bdata(term), &rc, &reg) == 0)
+        {
+            if (rc != ASM_REGCLASS_GPR64 || sign < 0)
+            {
+                err = -EINVAL;
+            }
+            else if (op->base < 0)
+            {
+                op->base = reg;
+            }
+            else if (op->index < 0 && reg != ASM_GPR_RSP)
+            {
+                op->index = reg;
+                op->scale = 1;
+            }
+            else
+            {
+                err = -EINVAL;
+            }
+        }
+        else if (_parse_number(bdata(term), &num) == 0)
+        {
+            op->disp += sign * num;
+        }
+        else if (blength(term) > 0 && sign > 0 && !op->label)
+        {
+            op->label = bstrcpy(term);
+        }
+        else
+        {
+            err = -EINVAL;
+        }
+        bdestroy(term);
+    }
+    bdestroy(inner);
+    if (err == 0 && op->label && !op->riprel)
+    {
+        // Absolute addresses of labels are not position independent
+        err = -ENOTSUP;
+    }
+    if (err == 0 && op->riprel && (op->base >= 0 || op->index >= 0))
+    {
+        err = -EINVAL;
+    }
+    if (err == 0 && !op->riprel && op->base < 0 && op->index < 0)
+    {
+        err = -ENOTSUP;
+    }
+    if (err == 0 && (op->disp > INT32_MAX || op->disp < INT32_MIN))
+    {
+        err = -EINVAL;
+    }
+    return err;
+}
+
+static int _parse_operand(bstring str, AsmOperand* op)
+{
+    memset(op, 0, sizeof(AsmOperand));
+    if (bstrchrp(str, '[', 0) != BSTR_ERR)
+    {
+        return _parse_memory(str, op);
+    }
+    AsmRegClass rc;
+    int reg = -1;
+    int err = _parse_register(bdata(str), &rc, &reg);
+    if (err == 0)
+    {
+        op->type = ASM_OPERAND_REG;
+        op->regclass = rc;
+        op->reg = reg;
+        return 0;
+    }
+    else if (err == -ENOTSUP)
+    {
+        return err;
+    }
+    int64_t num = 0;
+    if (_parse_number(bdata(str), &num) == 0)
+    {
+        op->type = ASM_OPERAND_IMM;
+        op->imm = num;
+        return 0;
+    }
+    op->type = ASM_OPERAND_LABEL;
+    op->label = bstrcpy(str);
+    return 0;
+}
+
+static void _free_operand(AsmOperand* op)
+{
+    if (op->label)
+    {
+        bdestroy(op->label);
+        op->label = NULL;
+    }
+}
+
+/* REX.R/X/B bits for the given reg field and r/m operand */
+static int _rex_bits(int regfield, AsmOperand* rm)
+{
+    int rex = 0;
+    if (regfield & 0x8) rex |= 0x4;
+    if (rm->type == ASM_OPERAND_REG)
+    {
+        if (rm->reg & 0x8) rex |= 0x1;
+    }
+    else if (rm->type == ASM_OPERAND_MEM)
+    {
+        if (rm->index >= 0 && (rm->index & 0x8)) rex |= 0x2;
+        if (rm->base >= 0 && (rm->base & 0x8)) rex |= 0x1;
+    }
+    return rex;
+}
+
+static int _emit_modrm(AsmContext* ctx, int regfield, AsmOperand* rm)
+{
+    int err = 0;
+    int reg = regfield & 0x7;
+    if (rm->type == ASM_OPERAND_REG)
+    {
+        return _emit_byte(ctx, (unsigned char)(0xC0 | (reg << 3) | (rm->reg & 0x7)));
+    }
+    if (rm->riprel)
+    {
+        err = _emit_byte(ctx, (unsigned char)(0x00 | (reg << 3) | 0x5));
+        if (err == 0 && rm->label)
+        {
+            err = _add_fixup(ctx, rm->label);
+        }
+        if (err == 0)
+        {
+            err = _emit_int32(ctx, (int32_t)rm->disp);
+        }
+        return err;
+    }
+    int mod = 0;
+    int need_sib = (rm->index >= 0 || rm->base < 0 || (rm->base & 0x7) == ASM_GPR_RSP);
+    if (rm->base < 0)
+    {
+        // [index*scale + disp32] requires mod 00 with base 101 in the SIB byte
+        mod = 0;
+    }
+    else if (rm->disp == 0 && (rm->base & 0x7) != ASM_GPR_RBP)
+    {
+        mod = 0;
+    }
+    else if (rm->disp >= INT8_MIN && rm->disp <= INT8_MAX)
+    {
+        mod = 1;
+    }
+    else
+    {
+        mod = 2;
+    }
+    if (need_sib)
+    {
+        int ss = 0;
+        switch (rm->scale)
+        {
+            case 1: ss = 0; break;
+            case 2: ss = 1; break;
+            case 4: ss = 2; break;
+            case 8: ss = 3; break;
+        }
+        int index = (rm->index >= 0 ? (rm->index & 0x7) : ASM_GPR_RSP);
+        int base = (rm->base >= 0 ? (rm->base & 0x7) : ASM_GPR_RBP);
+        err = _emit_byte(ctx, (unsigned char)((mod << 6) | (reg << 3) | 0x4));
+        if (err == 0) err = _emit_byte(ctx, (unsigned char)((ss << 6) | (index << 3) | base));
+    }
+    else
+    {
+        err = _emit_byte(ctx, (unsigned char)((mod << 6) | (reg << 3) | (rm->base & 0x7)));
+    }
+    if (err == 0)
+    {
+        if (rm->base < 0 || mod == 2)
+        {
+            err = _emit_int32(ctx, (int32_t)rm->disp);
+        }
+        else if (mod == 1)
+        {
+            err = _emit_byte(ctx, (unsigned char)(int8_t)rm->disp);
+        }
+    }
+    return err;
+}
+
+static int _emit_opcode_map(AsmContext* ctx, int map)
+{
+    int err = 0;
+    if (map >= 1) err = _emit_byte(ctx, 0x0F);
+    if (err == 0 && map == 2) err = _emit_byte(ctx, 0x38);
+    if (err == 0 && map == 3) err = _emit_byte(ctx, 0x3A);
+    return err;
+}
+
+static int _emit_legacy(AsmContext* ctx, unsigned char prefix, int rexw, int map, unsigned char opcode, int regfield, AsmOperand* rm)
+{
+    int err = 0;
+    int rex = _rex_bits(regfield, rm) | (rexw ? 0x8 : 0x0);
+    if (prefix) err = _emit_byte(ctx, prefix);
+    if (err == 0 && rex) err = _emit_byte(ctx, (unsigned char)(0x40 | rex));
+    if (err == 0) err = _emit_opcode_map(ctx, map);
+    if (err == 0) err = _emit_byte(ctx, opcode);
+    if (err == 0) err = _emit_modrm(ctx, regfield, rm);
+    return err;
+}
+
+static int _emit_vex(AsmContext* ctx, unsigned char prefix, int map, int w, int l, int vvvv, unsigned char opcode, int regfield, AsmOperand* rm)
+{
+    int err = 0;
+    int rex = _rex_bits(regfield, rm);
+    int pp = 0;
+    switch (prefix)
+    {
+        case 0x66: pp = 1; break;
+        case 0xF3: pp = 2; break;
+        case 0xF2: pp = 3; break;
+        default: pp = 0; break;
+    }
+    unsigned char last = (unsigned char)(((w & 0x1) << 7) | ((~vvvv & 0xF) << 3) | ((l & 0x1) << 2) | pp);
+    if (map == 1 && !(rex & 0x3) && !w)
+    {
+        err = _emit_byte(ctx, 0xC5);
+        if (err == 0) err = _emit_byte(ctx, (unsigned char)((((rex & 0x4) ? 0 : 1) << 7) | (last & 0x7F)));
+    }
+    else
+    {
+        err = _emit_byte(ctx, 0xC4);
+        if (err == 0) err = _emit_byte(ctx, (unsigned char)((((rex & 0x4) ? 0 : 1) << 7) | (((rex & 0x2) ? 0 : 1) << 6) | (((rex & 0x1) ? 0 : 1) << 5) | (map & 0x1F)));
+        if (err == 0) err = _emit_byte(ctx, last);
+    }
+    if (err == 0) err = _emit_byte(ctx, opcode);
+    if (err == 0) err = _emit_modrm(ctx, regfield, rm);
+    return err;
+}
+
+static int _is_gpr(AsmOperand* op)
+{
+    return (op->type == ASM_OPERAND_REG && op->regclass == ASM_REGCLASS_GPR64);
+}
+
+static int _is_vreg(AsmOperand* op, int mmx)
+{
+    if (op->type != ASM_OPERAND_REG) return 0;
+    if (mmx) return (op->regclass == ASM_REGCLASS_MM);
+    return (op->regclass == ASM_REGCLASS_XMM || op->regclass == ASM_REGCLASS_YMM);
+}
+
+static int _encode_vector(AsmContext* ctx, AsmVectorDefinition* def, int nops, AsmOperand* ops)
+{
+    int mmx = (def->flags & ASM_VEC_MMX) ? 1 : 0;
+    if (def->enc == ASM_ENC_SSE)
+    {
+        if (nops != 2) return -EINVAL;
+        // MMX registers need to be matched exactly, movq with xmm registers is a different instruction
+        if (mmx && !(_is_vreg(&ops[0], 1) || _is_vreg(&ops[1], 1))) return -ENOTSUP;
+        if (_is_vreg(&ops[0], mmx) && ops[0].regclass != ASM_REGCLASS_YMM && (ops[1].type == ASM_OPERAND_MEM || _is_vreg(&ops[1], mmx)) && def->load_op != ASM_OPCODE_NONE)
+        {
+            if (ops[1].type == ASM_OPERAND_REG && ops[1].regclass == ASM_REGCLASS_YMM) return -EINVAL;
+            return _emit_legacy(ctx, def->prefix, 0, def->map, (unsigned char)def->load_op, ops[0].reg, &ops[1]);
+        }
+        if (ops[0].type == ASM_OPERAND_MEM && _is_vreg(&ops[1], mmx) && ops[1].regclass != ASM_REGCLASS_YMM && def->store_op != ASM_OPCODE_NONE)
+        {
+            return _emit_legacy(ctx, def->prefix, 0, def->map, (unsigned char)def->store_op, ops[1].reg, &ops[0]);
+        }
+        return -ENOTSUP;
+    }
+    if (def->flags & ASM_VEC_MOVE)
+    {
+        if (nops != 2) return -ENOTSUP;
+        if (_is_vreg(&ops[0], 0) && (ops[1].type == ASM_OPERAND_MEM || (_is_vreg(&ops[1], 0) && !(def->flags & ASM_VEC_SCALAR))) && def->load_op != ASM_OPCODE_NONE)
+        {
+            int l = (ops[0].regclass == ASM_REGCLASS_YMM ? 1 : 0);
+            return _emit_vex(ctx, def->prefix, def->map, def->w, l, 0, (unsigned char)def->load_op, ops[0].reg, &ops[1]);
+        }
+        if (ops[0].type == ASM_OPERAND_MEM && _is_vreg(&ops[1], 0) && def->store_op != ASM_OPCODE_NONE)
+        {
+            int l = (ops[1].regclass == ASM_REGCLASS_YMM ? 1 : 0);
+            return _emit_vex(ctx, def->prefix, def->map, def->w, l, 0, (unsigned char)def->store_op, ops[1].reg, &ops[0]);
+        }
+        return -ENOTSUP;
+    }
+    if (nops != 3 || !_is_vreg(&ops[0], 0) || !_is_vreg(&ops[1], 0) || !(ops[2].type == ASM_OPERAND_MEM || _is_vreg(&ops[2], 0)))
+    {
+        return -ENOTSUP;
+    }
+    if (ops[0].regclass != ops[1].regclass || (ops[2].type == ASM_OPERAND_REG && ops[2].regclass != ops[0].regclass))
+    {
+        return -EINVAL;
+    }
+    int l = (ops[0].regclass == ASM_REGCLASS_YMM ? 1 : 0);
+    return _emit_vex(ctx, def->prefix, def->map, def->w, l, ops[1].reg, (unsigned char)def->load_op, ops[0].reg, &ops[2]);
+}
+
+static int _encode_instruction(AsmContext* ctx, bstring mnemonic, int nops, AsmOperand* ops)
+{
+    const char* m = bdata(mnemonic);
+    if (ctx->section != ASM_SECTION_TEXT)
+    {
+        ERROR_PRINT("Instruction %s outside of text section", m);
+        return -EINVAL;
+    }
+    if (strcasecmp(m, "ret") == 0 && nops == 0)
+    {
+        return _emit_byte(ctx, 0xC3);
+    }
+    if (strcasecmp(m, "nop") == 0 && nops == 0)
+    {
+        return _emit_byte(ctx, 0x90);
+    }
+    if ((strcasecmp(m, "push") == 0 || strcasecmp(m, "pop") == 0) && nops == 1 && _is_gpr(&ops[0]))
+    {
+        int err = 0;
+        if (ops[0].reg & 0x8) err = _emit_byte(ctx, 0x41);
+        if (err == 0) err = _emit_byte(ctx, (unsigned char)((tolower(m[1]) == 'u' ? 0x50 : 0x58) + (ops[0].reg & 0x7)));
+        return err;
+    }
+    for (int i = 0; _jumps[i].name != NULL; i++)
+    {
+        if (strcasecmp(m, _jumps[i].name) == 0)
+        {
+            int err = 0;
+            if (nops != 1 || ops[0].type != ASM_OPERAND_LABEL) return -ENOTSUP;
+            // Backward jumps (the loops) use rel8 if possible, forward jumps always rel32
+            int l = _find_label(ctx, ops[0].label);
+            if (l >= 0 && ctx->label_sections[l] == ASM_SECTION_TEXT)
+            {
+                int64_t rel = (int64_t)ctx->label_offsets[l] - (int64_t)(ctx->text.len + 2);
+                if (rel >= INT8_MIN && rel <= INT8_MAX)
+                {
+                    err = _emit_byte(ctx, (_jumps[i].jcc == 0x00 ? 0xEB : (unsigned char)(0x70 | (_jumps[i].jcc & 0xF))));
+                    if (err == 0) err = _emit_byte(ctx, (unsigned char)(int8_t)rel);
+                    return err;
+                }
+            }
+            if (_jumps[i].jcc == 0x00)
+            {
+                err = _emit_byte(ctx, 0xE9);
+            }
+            else
+            {
+                err = _emit_byte(ctx, 0x0F);
+                if (err == 0) err = _emit_byte(ctx, _jumps[i].jcc);
+            }
+            if (err == 0) err = _add_fixup(ctx, ops[0].label);
+            if (err == 0) err = _emit_int32(ctx, 0);
+            return err;
+        }
+    }
+    if ((strcasecmp(m, "inc") == 0 || strcasecmp(m, "dec") == 0) && nops == 1 && _is_gpr(&ops[0]))
+    {
+        return _emit_legacy(ctx, 0x00, 1, 0, 0xFF, (tolower(m[0]) == 'i' ? 0 : 1), &ops[0]);
+    }
+    if (strcasecmp(m, "lea") == 0 && nops == 2 && _is_gpr(&ops[0]) && ops[1].type == ASM_OPERAND_MEM)
+    {
+        return _emit_legacy(ctx, 0x00, 1, 0, 0x8D, ops[0].reg, &ops[1]);
+    }
+    if (strcasecmp(m, "mov") == 0 && nops == 2)
+    {
+        if (_is_gpr(&ops[0]) && (_is_gpr(&ops[1]) || ops[1].type == ASM_OPERAND_MEM))
+        {
+            if (_is_gpr(&ops[1]))
+            {
+                return _emit_legacy(ctx, 0x00, 1, 0, 0x89, ops[1].reg, &ops[0]);
+            }
+            return _emit_legacy(ctx, 0x00, 1, 0, 0x8B, ops[0].reg, &ops[1]);
+        }
+        if (ops[0].type == ASM_OPERAND_MEM && _is_gpr(&ops[1]))
+        {
+            return _emit_legacy(ctx, 0x00, 1, 0, 0x89, ops[1].reg, &ops[0]);
+        }
+        if (_is_gpr(&ops[0]) && ops[1].type == ASM_OPERAND_IMM)
+        {
+            int err = 0;
+            if (ops[1].imm >= INT32_MIN && ops[1].imm <= INT32_MAX)
+            {
+                err = _emit_legacy(ctx, 0x00, 1, 0, 0xC7, 0, &ops[0]);
+                if (err == 0) err = _emit_int32(ctx, (int32_t)ops[1].imm);
+                return err;
+            }
+            err = _emit_byte(ctx, (unsigned char)(0x48 | ((ops[0].reg & 0x8) ? 0x1 : 0x0)));
+            if (err == 0) err = _emit_byte(ctx, (unsigned char)(0xB8 + (ops[0].reg & 0x7)));
+            if (err == 0) err = _emit_int64(ctx, ops[1].imm);
+            return err;
+        }
+        return -ENOTSUP;
+    }
+    for (int i = 0; _ariths[i].name != NULL; i++)
+    {
+        if (strcasecmp(m, _ariths[i].name) == 0)
+        {
+            if (nops != 2) return -ENOTSUP;
+            if (_is_gpr(&ops[0]) && _is_gpr(&ops[1]))
+            {
+                return _emit_legacy(ctx, 0x00, 1, 0, _ariths[i].rm_reg, ops[1].reg, &ops[0]);
+            }
+            if (_is_gpr(&ops[0]) && ops[1].type == ASM_OPERAND_MEM)
+            {
+                return _emit_legacy(ctx, 0x00, 1, 0, (unsigned char)(_ariths[i].rm_reg + 2), ops[0].reg, &ops[1]);
+            }
+            if (ops[0].type == ASM_OPERAND_MEM && _is_gpr(&ops[1]))
+            {
+                return _emit_legacy(ctx, 0x00, 1, 0, _ariths[i].rm_reg, ops[1].reg, &ops[0]);
+            }
+            if (_is_gpr(&ops[0]) && ops[1].type == ASM_OPERAND_IMM)
+            {
+                int err = 0;
+                if (ops[1].imm >= INT8_MIN && ops[1].imm <= INT8_MAX)
+                {
+                    err = _emit_legacy(ctx, 0x00, 1, 0, 0x83, _ariths[i].digit, &ops[0]);
+                    if (err == 0) err = _emit_byte(ctx, (unsigned char)(int8_t)ops[1].imm);
+                }
+                else if (ops[1].imm >= INT32_MIN && ops[1].imm <= INT32_MAX)
+                {
+                    err = _emit_legacy(ctx, 0x00, 1, 0, 0x81, _ariths[i].digit, &ops[0]);
+                    if (err == 0) err = _emit_int32(ctx, (int32_t)ops[1].imm);
+                }
+                else
+                {
+                    err = -EINVAL;
+                }
+                return err;
+            }
+            return -ENOTSUP;
+        }
+    }
+    for (int i = 0; _vectors[i].name != NULL; i++)
+    {
+        if (strcasecmp(m, _vectors[i].name) == 0)
+        {
+            return _encode_vector(ctx, &_vectors[i], nops, ops);
+        }
+    }
+    return -ENOTSUP;
+}
+
+/* Recommended multi-byte NOP sequences (Intel SDM Vol. 2B, NOP) */
+#define ASM_MAX_NOP_LENGTH 9
+static unsigned char _nops[ASM_MAX_NOP_LENGTH][ASM_MAX_NOP_LENGTH] = {
+    {0x90},
+    {0x66, 0x90},
+    {0x0F, 0x1F, 0x00},
+    {0x0F, 0x1F, 0x40, 0x00},
+    {0x0F, 0x1F, 0x44, 0x00, 0x00},
+    {0x66, 0x0F, 0x1F, 0x44, 0x00, 0x00},
+    {0x0F, 0x1F, 0x80, 0x00, 0x00, 0x00, 0x00},
+    {0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00},
+    {0x66, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00},
+};
+
+static int _align_section(AsmContext* ctx, int64_t alignment)
+{
+    int err = 0;
+    unsigned char zero = 0x00;
+    if (alignment <= 0 || (alignment & (alignment - 1)) != 0 || alignment > ASM_DATA_ALIGNMENT)
+    {
+        return -EINVAL;
+    }
+    if (ctx->section == ASM_SECTION_DATA)
+    {
+        while (err == 0 && (ctx->data.len % alignment) != 0)
+        {
+            err = _buffer_add(&ctx->data, &zero, 1);
+        }
+        return err;
+    }
+    // Padding in front of loops is executed, so use few long NOPs instead of many short ones
+    while (err == 0 && (ctx->text.len % alignment) != 0)
+    {
+        size_t pad = alignment - (ctx->text.len % alignment);
+        if (pad > ASM_MAX_NOP_LENGTH)
+        {
+            pad = ASM_MAX_NOP_LENGTH;
+        }
+        err = _buffer_add(&ctx->text, _nops[pad-1], pad);
+    }
+    return err;
+}
+
+static int _data_directive(AsmContext* ctx, bstring directive, bstring args)
+{
+    int err = 0;
+    AsmBuffer* buf = (ctx->section == ASM_SECTION_TEXT ? &ctx->text : &ctx->data);
+    struct bstrList* vals = bsplit(args, ',');
+    for (int i = 0; i < vals->qty && err == 0; i++)
+    {
+        btrimws(vals->entry[i]);
+        const char* v = bdata(vals->entry[i]);
+        char* end = NULL;
+        if (biseqcstrcaseless(directive, ".double"))
+        {
+            double d = strtod(v, &end);
+            err = (*end == '\0' ? _buffer_add(buf, &d, sizeof(double)) : -EINVAL);
+        }
+        else if (biseqcstrcaseless(directive, ".single") || biseqcstrcaseless(directive, ".float"))
+        {
+            float f = strtof(v, &end);
+            err = (*end == '\0' ? _buffer_add(buf, &f, sizeof(float)) : -EINVAL);
+        }
+        else if (biseqcstrcaseless(directive, ".int") || biseqcstrcaseless(directive, ".long"))
+        {
+            int64_t n = 0;
+            err = _parse_number(v, &n);
+            int32_t i32 = (int32_t)n;
+            if (err == 0) err = _buffer_add(buf, &i32, sizeof(int32_t));
+        }
+        else if (biseqcstrcaseless(directive, ".quad"))
+        {
+            int64_t n = 0;
+            err = _parse_number(v, &n);
+            if (err == 0) err = _buffer_add(buf, &n, sizeof(int64_t));
+        }
+        else
+        {
+            err = -ENOTSUP;
+        }
+    }
+    bstrListDestroy(vals);
+    return err;
+}
+
+static int _assemble_line(AsmContext* ctx, bstring line)
+{
+    int err = 0;
+    int comment = bstrchrp(line, '#', 0);
+    if (comment != BSTR_ERR)
+    {
+        btrunc(line, comment);
+    }
+    btrimws(line);
+    if (blength(line) == 0)
+    {
+        return 0;
+    }
+    // Label definition like 'loop:' or 'name :'
+    if (bchar(line, blength(line) - 1) == ':')
+    {
+        bstring name = bmidstr(line, 0, blength(line) - 1);
+        btrimws(name);
+        if (blength(name) > 0 && bstrchrp(name, ' ', 0) == BSTR_ERR)
+        {
+            err = _add_label(ctx, name);
+            bdestroy(name);
+            return err;
+        }
+        bdestroy(name);
+        return -EINVAL;
+    }
+    int split = 0;
+    while (split < blength(line) && !isspace(bchar(line, split)))
+    {
+        split++;
+    }
+    bstring mnemonic = bmidstr(line, 0, split);
+    bstring args = bmidstr(line, split, blength(line) - split);
+    btrimws(args);
+
+    if (bchar(mnemonic, 0) == '.')
+    {
+        if (biseqcstrcaseless(mnemonic, ".text"))
+        {
+            ctx->section = ASM_SECTION_TEXT;
+        }
+        else if (biseqcstrcaseless(mnemonic, ".data"))
+        {
+            ctx->section = ASM_SECTION_DATA;
+        }
+        else if (biseqcstrcaseless(mnemonic, ".align") || biseqcstrcaseless(mnemonic, ".balign"))
+        {
+            int64_t alignment = 0;
+            err = _parse_number(bdata(args), &alignment);
+            if (err == 0) err = _align_section(ctx, alignment);
+        }
+        else if (biseqcstrcaseless(mnemonic, ".double") || biseqcstrcaseless(mnemonic, ".single") ||
+                 biseqcstrcaseless(mnemonic, ".float") || biseqcstrcaseless(mnemonic, ".int") ||
+                 biseqcstrcaseless(mnemonic, ".long") || biseqcstrcaseless(mnemonic, ".quad"))
+        {
+            err = _data_directive(ctx, mnemonic, args);
+        }
+        else if (biseqcstrcaseless(mnemonic, ".intel_syntax") || biseqcstrcaseless(mnemonic, ".global") ||
+                 biseqcstrcaseless(mnemonic, ".globl") || biseqcstrcaseless(mnemonic, ".type") ||
+                 biseqcstrcaseless(mnemonic, ".size") || biseqcstrcaseless(mnemonic, ".section"))
+        {
+            // Only relevant for object files
+        }
+        else
+        {
+            err = -ENOTSUP;
+        }
+        if (err != 0)
+        {
+            DEBUG_PRINT(DEBUGLEV_DEVELOP, "Cannot handle directive '%s'", bdata(line));
+        }
+        bdestroy(mnemonic);
+        bdestroy(args);
+        return err;
+    }
+
+    AsmOperand ops[4];
+    int nops = 0;
+    memset(ops, 0, sizeof(ops));
+    if (blength(args) > 0)
+    {
+        struct bstrList* oplist = bsplit(args, ',');
+        if (oplist->qty > 4)
+        {
+            err = -ENOTSUP;
+        }
+        for (int i = 0; i < oplist->qty && err == 0; i++)
+        {
+            btrimws(oplist->entry[i]);
+            err = _parse_operand(oplist->entry[i], &ops[i]);
+            nops++;
+        }
+        bstrListDestroy(oplist);
+    }
+    if (err == 0)
+    {
+        int first_fixup = ctx->num_fixups;
+        err = _encode_instruction(ctx, mnemonic, nops, ops);
+        for (int i = first_fixup; i < ctx->num_fixups && err == 0; i++)
+        {
+            ctx->fixups[i].next = ctx->text.len;
+        }
+    }
+    if (err != 0)
+    {
+        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Cannot assemble '%s'", bdata(line));
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        _free_operand(&ops[i]);
+    }
+    bdestroy(mnemonic);
+    bdestroy(args);
+    return err;
+}
+
+int assemble_code(struct bstrList* code, bstring funcname, void** buffer, size_t* size, void** function)
+{
+    int err = 0;
+    AsmContext ctx;
+    size_t data_offset = 0;
+    size_t total = 0;
+    long pagesize = sysconf(_SC_PAGESIZE);
+    unsigned char* mem = NULL;
+    if (!code || !funcname || !buffer || !size || !function)
+    {
+        return -EINVAL;
+    }
+    memset(&ctx, 0, sizeof(AsmContext));
+    ctx.section = ASM_SECTION_TEXT;
+
+    for (int i = 0; i < code->qty && err == 0; i++)
+    {
+        // Some entries contain multiple lines (e.g. the data definitions in the header)
+        struct bstrList* lines = bsplit(code->entry[i], '\n');
+        for (int j = 0; j < lines->qty && err == 0; j++)
+        {
+            err = _assemble_line(&ctx, lines->entry[j]);
+        }
+        bstrListDestroy(lines);
+    }
+    if (err != 0)
+    {
+        _destroy_context(&ctx);
+        return err;
+    }
+
+    int func = _find_label(&ctx, funcname);
+    if (func < 0 || ctx.label_sections[func] != ASM_SECTION_TEXT)
+    {
+        ERROR_PRINT("Function label %s not found", bdata(funcname));
+        _destroy_context(&ctx);
+        return -EINVAL;
+    }
+
+    data_offset = ((ctx.text.len + ASM_DATA_ALIGNMENT - 1) / ASM_DATA_ALIGNMENT) * ASM_DATA_ALIGNMENT;
+    total = data_offset + ctx.data.len;
+    total = ((total + pagesize - 1) / pagesize) * pagesize;
+    mem = mmap(NULL, total, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+    {
+        ERROR_PRINT("Failed to map memory for kernel code");
+        _destroy_context(&ctx);
+        return -ENOMEM;
+    }
+    memset(mem, 0x90, data_offset);
+    memcpy(mem, ctx.text.data, ctx.text.len);
+    if (ctx.data.len > 0)
+    {
+        memcpy(mem + data_offset, ctx.data.data, ctx.data.len);
+    }
+
+    for (int i = 0; i < ctx.num_fixups && err == 0; i++)
+    {
+        AsmFixup* f = &ctx.fixups[i];
+        int l = _find_label(&ctx, f->label);
+        if (l < 0)
+        {
+            ERROR_PRINT("Undefined label %s", bdata(f->label));
+            err = -EINVAL;
+            break;
+        }
+        int64_t target = (int64_t)ctx.label_offsets[l] + (ctx.label_sections[l] == ASM_SECTION_DATA ? (int64_t)data_offset : 0);
+        int32_t addend = 0;
+        memcpy(&addend, mem + f->pos, sizeof(int32_t));
+        int32_t rel = (int32_t)(target - (int64_t)f->next) + addend;
+        memcpy(mem + f->pos, &rel, sizeof(int32_t));
+    }
+    if (err == 0 && mprotect(mem, total, PROT_READ|PROT_EXEC) != 0)
+    {
+        ERROR_PRINT("Failed to make kernel code executable");
+        err = -errno;
+    }
+    if (err != 0)
+    {
+        munmap(mem, total);
+        _destroy_context(&ctx);
+        return err;
+    }
+    DEBUG_PRINT(DEBUGLEV_DEVELOP, "Assembled %zu bytes code and %zu bytes data at %p", ctx.text.len, ctx.data.len, mem);
+    *buffer = mem;
+    *size = total;
+    *function = mem + ctx.label_offsets[func];
+    _destroy_context(&ctx);
+    return 0;
+}
+
+int release_code(void* buffer, size_t size)
+{
+    if (buffer && size > 0)
+    {
+        return munmap(buffer, size);
+    }
+    return 0;
+}
+
+#else
+
+int assemble_code(struct bstrList* code, bstring funcname, void** buffer, size_t* size, void** function)
+{
+    return -ENOTSUP;
+}
+
+int release_code(void* buffer, size_t size)
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,334 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "autotune.h"
+#include "cachedir.h"
+#include "bstrlib.h"
+#include "bstrlib_helper.h"
+#include "error.h"
+
+/* Lines of /proc/cpuinfo that identify the CPU model on x86, ARM and POWER */
+static struct tagbstring _autotune_model_keys[] = {
+    bsStatic("vendor_id"),
+    bsStatic("cpu family"),
+    bsStatic("model"),
+    bsStatic("model name"),
+    bsStatic("stepping"),
+    bsStatic("CPU implementer"),
+    bsStatic("CPU architecture"),
+    bsStatic("CPU variant"),
+    bsStatic("CPU part"),
+    bsStatic("CPU revision"),
+    bsStatic("cpu"),
+    bsStatic("machine"),
+    bsStatic("revision"),
+};
+
+int autotune_num_variants(TestConfig_t cfg)
+{
+    if ((!cfg) || cfg->num_tunables <= 0 || (!cfg->tunables))
+    {
+        return -EINVAL;
+    }
+    int variants = 1;
+    for (int i = 0; i < cfg->num_tunables; i++)
+    {
+        TestConfigTunable* t = &cfg->tunables[i];
+        if ((!t->options) || t->options->qty == 0)
+        {
+            errno = EINVAL;
+            ERROR_PRINT("Tunable %s has no options", bdata(t->name));
+            return -EINVAL;
+        }
+        variants *= t->options->qty;
+        if (variants > AUTOTUNE_MAX_VARIANTS)
+        {
+            errno = E2BIG;
+            ERROR_PRINT("Kernel %s has more than %d variants", bdata(cfg->name), AUTOTUNE_MAX_VARIANTS);
+            return -E2BIG;
+        }
+    }
+    return variants;
+}
+
+int autotune_select(TestConfig_t cfg, int variant)
+{
+    int variants = autotune_num_variants(cfg);
+    if (variants < 0)
+    {
+        return variants;
+    }
+    if (variant < 0 || variant >= variants)
+    {
+        return -EINVAL;
+    }
+    for (int i = 0; i < cfg->num_tunables; i++)
+    {
+        TestConfigTunable* t = &cfg->tunables[i];
+        t->selected = variant % t->options->qty;
+        variant /= t->options->qty;
+    }
+    return 0;
+}
+
+bstring autotune_variant_name(TestConfig_t cfg)
+{
+    if ((!cfg) || cfg->num_tunables <= 0 || (!cfg->tunables))
+    {
+        return NULL;
+    }
+    bstring name = bfromcstr("");
+    for (int i = 0; i < cfg->num_tunables; i++)
+    {
+        TestConfigTunable* t = &cfg->tunables[i];
+        if (t->selected < 0 || t->selected >= t->options->qty)
+        {
+            bdestroy(name);
+            return NULL;
+        }
+        if (i > 0) bconchar(name, ',');
+        bconcat(name, t->name);
+        bconchar(name, '=');
+        bconcat(name, t->options->entry[t->selected]);
+    }
+    return name;
+}
+
+int autotune_apply(TestConfig_t cfg, const_bstring name)
+{
+    if ((!cfg) || (!name) || cfg->num_tunables <= 0 || (!cfg->tunables))
+    {
+        return -EINVAL;
+    }
+    int err = 0;
+    int selected[cfg->num_tunables];
+    for (int i = 0; i < cfg->num_tunables; i++)
+    {
+        selected[i] = -1;
+    }
+    struct bstrList* items = bsplit(name, ',');
+    for (int j = 0; j < items->qty && err == 0; j++)
+    {
+        struct bstrList* kv = bsplit(items->entry[j], '=');
+        for (int i = 0; i < kv->qty; i++)
+        {
+            btrimws(kv->entry[i]);
+        }
+        err = -EINVAL;
+        for (int i = 0; kv->qty == 2 && i < cfg->num_tunables; i++)
+        {
+            TestConfigTunable* t = &cfg->tunables[i];
+            if (bstrcmp(t->name, kv->entry[0]) != BSTR_OK)
+            {
+                continue;
+            }
+            for (int o = 0; o < t->options->qty; o++)
+            {
+                if (bstrcmp(t->options->entry[o], kv->entry[1]) == BSTR_OK)
+                {
+                    selected[i] = o;
+                    err = 0;
+                    break;
+                }
+            }
+        }
+        bstrListDestroy(kv);
+    }
+    bstrListDestroy(items);
+    for (int i = 0; i < cfg->num_tunables && err == 0; i++)
+    {
+        if (selected[i] < 0)
+        {
+            err = -EINVAL;
+        }
+    }
+    // Only a complete variant changes the selection
+    for (int i = 0; i < cfg->num_tunables && err == 0; i++)
+    {
+        cfg->tunables[i].selected = selected[i];
+    }
+    return err;
+}
+
+static uint64_t _fnv1a(uint64_t hash, const unsigned char* data, int len)
+{
+    for (int i = 0; i < len; i++)
+    {
+        hash ^= (uint64_t)data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+int autotune_fingerprint(const_bstring cpuinfo, int hwthreads, uint64_t* fp)
+{
+    if ((!cpuinfo) || (!fp) || hwthreads <= 0)
+    {
+        return -EINVAL;
+    }
+    int found = 0;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    struct bstrList* lines = bsplit(cpuinfo, '\n');
+    for (int l = 0; l < lines->qty; l++)
+    {
+        // The first processor ends at the first empty line
+        btrimws(lines->entry[l]);
+        if (blength(lines->entry[l]) == 0)
+        {
+            if (found > 0) break;
+            continue;
+        }
+        int colon = bstrchr(lines->entry[l], ':');
+        if (colon == BSTR_ERR)
+        {
+            continue;
+        }
+        bstring key = bmidstr(lines->entry[l], 0, colon);
+        btrimws(key);
+        for (int k = 0; k < (int)(sizeof(_autotune_model_keys)/sizeof(_autotune_model_keys[0])); k++)
+        {
+            if (bstrcmp(key, &_autotune_model_keys[k]) == BSTR_OK)
+            {
+                hash = _fnv1a(hash, (const unsigned char*)bdata(lines->entry[l]), blength(lines->entry[l]));
+                hash = _fnv1a(hash, (const unsigned char*)"\n", 1);
+                found++;
+                break;
+            }
+        }
+        bdestroy(key);
+    }
+    bstrListDestroy(lines);
+    if (found == 0)
+    {
+        return -ENOENT;
+    }
+    hash = _fnv1a(hash, (const unsigned char*)&hwthreads, sizeof(hwthreads));
+    *fp = hash;
+    return 0;
+}
+
+int autotune_machine_fingerprint(uint64_t* fp)
+{
+    struct tagbstring bcpuinfo = bsStatic("/proc/cpuinfo");
+    bstring cpuinfo = read_file(bdata(&bcpuinfo));
+    if ((!cpuinfo) || blength(cpuinfo) == 0)
+    {
+        bdestroy(cpuinfo);
+        return -EIO;
+    }
+    int err = autotune_fingerprint(cpuinfo, (int)sysconf(_SC_NPROCESSORS_CONF), fp);
+    bdestroy(cpuinfo);
+    return err;
+}
+
+/* Line prefix '<fingerprint> <kernel> ' of the machine and kernel */
+static bstring _autotune_prefix(uint64_t fp, TestConfig_t cfg)
+{
+    return bformat("%016" PRIx64 " %s ", fp, bdata(cfg->name));
+}
+
+int autotune_load(const char* file, uint64_t fp, TestConfig_t cfg)
+{
+    if ((!file) || (!cfg) || (!cfg->name))
+    {
+        return -EINVAL;
+    }
+    if (access(file, R_OK) != 0)
+    {
+        return -ENOENT;
+    }
+    /* The stored variant selects the code that runs, another user must not be able to plant it */
+    int err = cachedir_check(file);
+    if (err != 0)
+    {
+        WARN_PRINT("Ignoring tuned variants in %s, it is not owned by the user or writable by others", file);
+        return err;
+    }
+    err = -ENOENT;
+    bstring content = read_file((char*)file);
+    bstring prefix = _autotune_prefix(fp, cfg);
+    struct bstrList* lines = bsplit(content, '\n');
+    for (int l = 0; l < lines->qty; l++)
+    {
+        if (bstrncmp(lines->entry[l], prefix, blength(prefix)) != BSTR_OK)
+        {
+            continue;
+        }
+        bstring rest = bmidstr(lines->entry[l], blength(prefix), blength(lines->entry[l]));
+        struct bstrList* fields = bsplit(rest, ' ');
+        if (fields->qty >= 1 && autotune_apply(cfg, fields->entry[0]) == 0)
+        {
+            err = 0;
+        }
+        else
+        {
+            DEBUG_PRINT(DEBUGLEV_DEVELOP, "Stored variant '%s' does not match the tunables of %s", bdata(rest), bdata(cfg->name));
+        }
+        bstrListDestroy(fields);
+        bdestroy(rest);
+    }
+    bstrListDestroy(lines);
+    bdestroy(prefix);
+    bdestroy(content);
+    return err;
+}
+
+int autotune_store(const char* file, uint64_t fp, TestConfig_t cfg, double ns_per_iter)
+{
+    if ((!file) || (!cfg) || (!cfg->name))
+    {
+        return -EINVAL;
+    }
+    bstring variant = autotune_variant_name(cfg);
+    if (!variant)
+    {
+        return -EINVAL;
+    }
+    char tmpfile[1024];
+    snprintf(tmpfile, sizeof(tmpfile), "%s.XXXXXX", file);
+    int fd = mkstemp(tmpfile);
+    FILE* out = (fd >= 0 ? fdopen(fd, "w") : NULL);
+    if (!out)
+    {
+        int err = -errno;
+        if (fd >= 0)
+        {
+            close(fd);
+            unlink(tmpfile);
+        }
+        bdestroy(variant);
+        return err;
+    }
+    // Keep the lines of other machines and kernels
+    bstring prefix = _autotune_prefix(fp, cfg);
+    if (access(file, R_OK) == 0 && cachedir_check(file) == 0)
+    {
+        bstring content = read_file((char*)file);
+        struct bstrList* lines = bsplit(content, '\n');
+        for (int l = 0; l < lines->qty; l++)
+        {
+            if (blength(lines->entry[l]) > 0 && bstrncmp(lines->entry[l], prefix, blength(prefix)) != BSTR_OK)
+            {
+                fprintf(out, "%s\n", bdata(lines->entry[l]));
+            }
+        }
+        bstrListDestroy(lines);
+        bdestroy(content);
+    }
+    fprintf(out, "%s%s %.3f\n", bdata(prefix), bdata(variant), ns_per_iter);
+    fclose(out);
+    bdestroy(prefix);
+    bdestroy(variant);
+    // Write and rename, concurrent runs never read a partial file
+    if (rename(tmpfile, file) != 0)
+    {
+        int err = -errno;
+        unlink(tmpfile);
+        return err;
+    }
+    return 0;
+}
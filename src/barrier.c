@@ -0,0 +1,485 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#include "error.h"
+#include "barrier.h"
+#include "topology.h"
+
+static const char* _barrier_names[MAX_BARRIER] = {
+    [BARRIER_PTHREAD] = "pthread",
+    [BARRIER_CENTRAL] = "central",
+    [BARRIER_TREE] = "tree",
+    [BARRIER_DISSEMINATION] = "dissemination",
+};
+
+static const char* _barrier_level_names[] = {"core", "socket", "system"};
+
+const char* barrier_type_name(BarrierType type)
+{
+    if (type < BARRIER_PTHREAD || type >= MAX_BARRIER)
+    {
+        return "unknown";
+    }
+    return _barrier_names[type];
+}
+
+int barrier_parse_type(const char* str, BarrierType* type)
+{
+    if ((!str) || (!type))
+    {
+        return -EINVAL;
+    }
+    for (int t = BARRIER_PTHREAD; t < MAX_BARRIER; t++)
+    {
+        if (strcasecmp(str, _barrier_names[t]) == 0)
+        {
+            *type = (BarrierType)t;
+            return 0;
+        }
+    }
+    return -EINVAL;
+}
+
+/*
+ * Waits until *flag equals value. Polling keeps the wake-up latency low while the threads
+ * arrive close together, yielding afterwards keeps oversubscribed hwthreads going.
+ */
+static inline void _barrier_spin(int* flag, int value)
+{
+    for (int i = 0; i < BARRIER_SPIN; i++)
+    {
+        if (__atomic_load_n(flag, __ATOMIC_ACQUIRE) == value)
+        {
+            return;
+        }
+        CPU_RELAX();
+    }
+    while (__atomic_load_n(flag, __ATOMIC_ACQUIRE) != value)
+    {
+        sched_yield();
+    }
+}
+
+static int _barrier_add_node(thread_barrier_t* barrier, int parent, int level)
+{
+    struct barrier_node* node = &barrier->nodes[barrier->num_nodes];
+    node->count = 0;
+    node->sense = 0;
+    node->expected = 0;
+    node->parent = parent;
+    node->level = level;
+    if (parent >= 0)
+    {
+        barrier->nodes[parent].expected++;
+    }
+    return barrier->num_nodes++;
+}
+
+/*
+ * Builds the combining tree: the hwthreads of a core meet at a core node, the core nodes of
+ * a socket at a socket node and the sockets at the root. A thread alone on its core arrives
+ * directly at the socket node, a single socket is the root itself. Without topology
+ * information all threads are treated as separate cores of one socket.
+ */
+static int _barrier_build_tree(thread_barrier_t* barrier, const int* hwthreads)
+{
+    int n = barrier->num_threads;
+    int* cores = malloc(n * sizeof(int));
+    int* sockets = malloc(n * sizeof(int));
+    int* socket_nodes = malloc(n * sizeof(int));
+    if ((!cores) || (!sockets) || (!socket_nodes))
+    {
+        free(cores);
+        free(sockets);
+        free(socket_nodes);
+        return -ENOMEM;
+    }
+    int num_sockets = 0;
+    for (int t = 0; t < n; t++)
+    {
+        if ((!hwthreads) || get_hwthread_location(hwthreads[t], &cores[t], &sockets[t]) != 0)
+        {
+            cores[t] = t;
+            sockets[t] = 0;
+        }
+        int known = 0;
+        for (int u = 0; u < t && !known; u++)
+        {
+            known = (sockets[u] == sockets[t]);
+        }
+        num_sockets += !known;
+    }
+    int root = _barrier_add_node(barrier, -1, 2);
+    for (int t = 0; t < n; t++)
+    {
+        int first_in_socket = -1;
+        int first_on_core = -1;
+        int on_core = 0;
+        for (int u = 0; u < n; u++)
+        {
+            if (sockets[u] == sockets[t])
+            {
+                if (first_in_socket < 0)
+                {
+                    first_in_socket = u;
+                }
+                if (cores[u] == cores[t])
+                {
+                    if (first_on_core < 0)
+                    {
+                        first_on_core = u;
+                    }
+                    on_core++;
+                }
+            }
+        }
+        if (first_in_socket == t)
+        {
+            socket_nodes[t] = (num_sockets > 1 ? _barrier_add_node(barrier, root, 1) : root);
+        }
+        else
+        {
+            socket_nodes[t] = socket_nodes[first_in_socket];
+        }
+        if (on_core == 1)
+        {
+            barrier->threads[t].leaf = socket_nodes[t];
+            barrier->nodes[socket_nodes[t]].expected++;
+        }
+        else if (first_on_core == t)
+        {
+            barrier->threads[t].leaf = _barrier_add_node(barrier, socket_nodes[t], 0);
+            barrier->nodes[barrier->threads[t].leaf].expected = on_core;
+        }
+        else
+        {
+            barrier->threads[t].leaf = barrier->threads[first_on_core].leaf;
+        }
+    }
+    for (int i = 0; i < barrier->num_nodes; i++)
+    {
+        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Barrier node %d: level %s parent %d members %d", i, _barrier_level_names[barrier->nodes[i].level], barrier->nodes[i].parent, barrier->nodes[i].expected);
+    }
+    free(cores);
+    free(sockets);
+    free(socket_nodes);
+    return 0;
+}
+
+int barrier_init(thread_barrier_t* barrier, BarrierType type, int num_threads, const int* hwthreads)
+{
+    int err = 0;
+    if ((!barrier) || num_threads <= 0 || type < BARRIER_PTHREAD || type >= MAX_BARRIER)
+    {
+        return -EINVAL;
+    }
+    memset(barrier, 0, sizeof(thread_barrier_t));
+    barrier->type = type;
+    barrier->num_threads = num_threads;
+    err = pthread_barrierattr_init(&barrier->b_attr);
+    if (err != 0)
+    {
+        ERROR_PRINT("Failed to initialize barrier attribute %s", strerror(err));
+        return -err;
+    }
+    err = pthread_barrierattr_setpshared(&barrier->b_attr, PTHREAD_PROCESS_PRIVATE);
+    if (err == 0)
+    {
+        err = pthread_barrier_init(&barrier->barrier, &barrier->b_attr, num_threads);
+    }
+    if (err != 0)
+    {
+        ERROR_PRINT("Failed to initialize barrier %s", strerror(err));
+        pthread_barrierattr_destroy(&barrier->b_attr);
+        return -err;
+    }
+    if (type == BARRIER_PTHREAD)
+    {
+        return 0;
+    }
+
+    /* A tree has at most a core node per thread, a node per socket and the root */
+    if (posix_memalign((void**)&barrier->nodes, BARRIER_ALIGN, (2 * num_threads + 1) * sizeof(struct barrier_node)) != 0 ||
+        posix_memalign((void**)&barrier->threads, BARRIER_ALIGN, num_threads * sizeof(struct barrier_thread)) != 0)
+    {
+        ERROR_PRINT("Failed to allocate memory for %s barrier", barrier_type_name(type));
+        barrier_destroy(barrier);
+        return -ENOMEM;
+    }
+    memset(barrier->nodes, 0, (2 * num_threads + 1) * sizeof(struct barrier_node));
+    memset(barrier->threads, 0, num_threads * sizeof(struct barrier_thread));
+    switch (type)
+    {
+        case BARRIER_CENTRAL:
+            _barrier_add_node(barrier, -1, 2);
+            barrier->nodes[0].expected = num_threads;
+            break;
+        case BARRIER_TREE:
+            err = _barrier_build_tree(barrier, hwthreads);
+            break;
+        case BARRIER_DISSEMINATION:
+            while ((1 << barrier->rounds) < num_threads)
+            {
+                barrier->rounds++;
+            }
+            if (barrier->rounds > BARRIER_MAX_ROUNDS)
+            {
+                err = -EINVAL;
+            }
+            /* The flags start at 0, so the first episode signals with 1 */
+            for (int t = 0; t < num_threads; t++)
+            {
+                barrier->threads[t].sense = 1;
+            }
+            break;
+        default:
+            break;
+    }
+    if (err != 0)
+    {
+        ERROR_PRINT("Failed to set up %s barrier for %d threads", barrier_type_name(type), num_threads);
+        barrier_destroy(barrier);
+    }
+    return err;
+}
+
+static void _barrier_arrive(thread_barrier_t* barrier, int n, int sense)
+{
+    struct barrier_node* node = &barrier->nodes[n];
+    if (__atomic_add_fetch(&node->count, 1, __ATOMIC_ACQ_REL) == node->expected)
+    {
+        /* Reset before the release, no thread can arrive for the next episode earlier */
+        __atomic_store_n(&node->count, 0, __ATOMIC_RELAXED);
+        if (node->parent >= 0)
+        {
+            _barrier_arrive(barrier, node->parent, sense);
+        }
+        __atomic_store_n(&node->sense, sense, __ATOMIC_RELEASE);
+    }
+    else
+    {
+        _barrier_spin(&node->sense, sense);
+    }
+}
+
+void barrier_wait(thread_barrier_t* barrier, int id)
+{
+    struct barrier_thread* self = NULL;
+    switch (barrier->type)
+    {
+        case BARRIER_CENTRAL:
+        case BARRIER_TREE:
+            self = &barrier->threads[id];
+            self->sense = !self->sense;
+            _barrier_arrive(barrier, self->leaf, self->sense);
+            break;
+        case BARRIER_DISSEMINATION:
+            self = &barrier->threads[id];
+            for (int r = 0; r < barrier->rounds; r++)
+            {
+                struct barrier_thread* partner = &barrier->threads[(id + (1 << r)) % barrier->num_threads];
+                __atomic_store_n(&partner->flags[self->parity][r], self->sense, __ATOMIC_RELEASE);
+                _barrier_spin(&self->flags[self->parity][r], self->sense);
+            }
+            if (self->parity == 1)
+            {
+                self->sense = !self->sense;
+            }
+            self->parity = 1 - self->parity;
+            break;
+        default:
+            pthread_barrier_wait(&barrier->barrier);
+            break;
+    }
+}
+
+void barrier_destroy(thread_barrier_t* barrier)
+{
+    if ((!barrier) || barrier->num_threads == 0)
+    {
+        return;
+    }
+    pthread_barrier_destroy(&barrier->barrier);
+    pthread_barrierattr_destroy(&barrier->b_attr);
+    free(barrier->nodes);
+    barrier->nodes = NULL;
+    free(barrier->threads);
+    barrier->threads = NULL;
+    barrier->num_nodes = 0;
+    barrier->num_threads = 0;
+}
+
+typedef struct {
+    pthread_t thread;
+    thread_barrier_t* barrier;
+    int* start;
+    int id;
+    double latency;
+} BarrierBenchThread;
+
+static double _barrier_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void* _barrier_bench_thread(void* arg)
+{
+    BarrierBenchThread* bt = (BarrierBenchThread*)arg;
+    /* All threads are started before the first barrier, a negative start value cancels */
+    while (__atomic_load_n(bt->start, __ATOMIC_ACQUIRE) == 0)
+    {
+        sched_yield();
+    }
+    if (__atomic_load_n(bt->start, __ATOMIC_ACQUIRE) < 0)
+    {
+        return NULL;
+    }
+    for (int i = 0; i < BARRIER_BENCH_WARMUP; i++)
+    {
+        barrier_wait(bt->barrier, bt->id);
+    }
+    double start = _barrier_now();
+    for (int i = 0; i < BARRIER_BENCH_ROUNDS; i++)
+    {
+        barrier_wait(bt->barrier, bt->id);
+    }
+    bt->latency = (_barrier_now() - start) / BARRIER_BENCH_ROUNDS;
+    return NULL;
+}
+
+/* Mean time per barrier episode with one pinned thread per hwthread, maximum over the threads */
+static int _barrier_bench_level(BarrierType type, int num_threads, const int* hwthreads, double* latency)
+{
+    int err = 0;
+    int started = 0;
+    int start = 0;
+    thread_barrier_t barrier;
+    BarrierBenchThread* threads = malloc(num_threads * sizeof(BarrierBenchThread));
+    if (!threads)
+    {
+        return -ENOMEM;
+    }
+    err = barrier_init(&barrier, type, num_threads, hwthreads);
+    if (err != 0)
+    {
+        free(threads);
+        return err;
+    }
+    for (int t = 0; t < num_threads && err == 0; t++)
+    {
+        pthread_attr_t attr;
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(hwthreads[t], &cpuset);
+        pthread_attr_init(&attr);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpuset);
+        threads[t].barrier = &barrier;
+        threads[t].start = &start;
+        threads[t].id = t;
+        threads[t].latency = 0.0;
+        err = -pthread_create(&threads[t].thread, &attr, _barrier_bench_thread, &threads[t]);
+        pthread_attr_destroy(&attr);
+        started += (err == 0);
+    }
+    if (err != 0)
+    {
+        ERROR_PRINT("Failed to start barrier benchmark thread on hwthread %d", hwthreads[started]);
+    }
+    __atomic_store_n(&start, (err == 0 ? 1 : -1), __ATOMIC_RELEASE);
+    *latency = 0.0;
+    for (int t = 0; t < started; t++)
+    {
+        pthread_join(threads[t].thread, NULL);
+        if (threads[t].latency > *latency)
+        {
+            *latency = threads[t].latency;
+        }
+    }
+    barrier_destroy(&barrier);
+    free(threads);
+    return err;
+}
+
+int barrier_benchmark()
+{
+    int err = 0;
+    int num_levels = 0;
+    int max_threads = get_num_hw_threads();
+    if (max_threads <= 0)
+    {
+        ERROR_PRINT("Cannot read the hwthread topology");
+        return (max_threads < 0 ? max_threads : -ENODEV);
+    }
+    int* usable = malloc(max_threads * sizeof(int));
+    int* level = malloc(max_threads * sizeof(int));
+    if ((!usable) || (!level))
+    {
+        free(usable);
+        free(level);
+        return -ENOMEM;
+    }
+    int num_usable = get_usable_hwthreads(usable, max_threads);
+    int core = 0, socket = 0;
+    if (num_usable > 0)
+    {
+        get_hwthread_location(usable[0], &core, &socket);
+    }
+    printf("Barrier latency [ns] with %d episodes per measurement\n", BARRIER_BENCH_ROUNDS);
+    printf(HLINE);
+    printf("%-8s %9s", "Level", "hwthreads");
+    for (int t = BARRIER_PTHREAD; t < MAX_BARRIER; t++)
+    {
+        printf(" %14s", _barrier_names[t]);
+    }
+    printf("\n");
+    printf(HLINE);
+    int last_count = 0;
+    for (int l = 0; l < 3 && err == 0; l++)
+    {
+        /* The hwthreads sharing the core, then the socket of the first usable hwthread, then all */
+        int count = 0;
+        for (int i = 0; i < num_usable; i++)
+        {
+            int c = 0, s = 0;
+            get_hwthread_location(usable[i], &c, &s);
+            if (l == 2 || (s == socket && (l == 1 || c == core)))
+            {
+                level[count++] = usable[i];
+            }
+        }
+        if (count < 2 || count == last_count)
+        {
+            continue;
+        }
+        last_count = count;
+        num_levels++;
+        printf("%-8s %9d", _barrier_level_names[l], count);
+        for (int t = BARRIER_PTHREAD; t < MAX_BARRIER && err == 0; t++)
+        {
+            double latency = 0.0;
+            err = _barrier_bench_level((BarrierType)t, count, level, &latency);
+            printf(" %14.1f", latency);
+            fflush(stdout);
+        }
+        printf("\n");
+    }
+    if (num_levels == 0)
+    {
+        printf("No topology level with at least two usable hwthreads\n");
+    }
+    printf(HLINE);
+    free(usable);
+    free(level);
+    return err;
+}
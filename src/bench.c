@@ -9,8 +9,10 @@
 #include <time.h>
 #include <unistd.h>
 
+#include "barrier.h"
 #include "bench.h"
 #include "error.h"
+#include "stats.h"
 #include "timer.h"
 #include "test_types.h"
 #include "thread_group.h"
@@ -29,97 +31,233 @@ extern "C" }
 
 #define DECLARE_TIMER TimerDataLB timedata
 
+/*
+ * Runs iter calls in a timed block. The runtime is reduced to the maximum of the workgroup,
+ * so all threads take the same decisions based on it and stay in step at the barriers.
+ */
+#define PROBE(func, iter, runtime) \
+    do { \
+        if (lb_timer_init(data->timer, &timedata) != 0) fprintf(stderr, "Timer initialization failed!\n"); \
+        if (data->barrier) barrier_wait(data->barrier, data->local_id); \
+        lb_timer_start(&timedata); \
+        for (size_t i = 0; i < (iter); i++) \
+        {   \
+            func; \
+        } \
+        if (data->barrier) barrier_wait(data->barrier, data->local_id); \
+        lb_timer_stop(&timedata); \
+        lb_timer_as_ns(&timedata, &(runtime)); \
+        lb_timer_close(&timedata); \
+        (runtime) = _reduce_max(data, (runtime)); \
+    } while (0)
+
 #define MEASURE(func) \
     do { \
-        if (data->barrier) pthread_barrier_wait(&data->barrier->barrier); \
-        size_t iter = MIN_ITERATIONS; \
+        if (data->barrier) barrier_wait(data->barrier, data->local_id); \
         double min_runtime = ((data->runtime == -1.0) ? MIN_RUNTIME: data->runtime); \
+        uint64_t target = (uint64_t)(min_runtime * NANOS_PER_SEC); \
+        size_t iter = 1; \
         uint64_t runtime = 0; \
-        int doubled = 0; \
-        do { \
-            if (lb_timer_init(TIMER_RDTSC, &timedata) != 0) fprintf(stderr, "Timer initialization failed!\n"); \
-            if (data->barrier) pthread_barrier_wait(&data->barrier->barrier); \
-            lb_timer_start(&timedata); \
-            for (size_t i = 0; i < iter; i++) \
-            {   \
-                func; \
-            } \
-            if (data->barrier) pthread_barrier_wait(&data->barrier->barrier); \
-            lb_timer_stop(&timedata); \
-            lb_timer_as_ns(&timedata, &runtime); \
-            lb_timer_close(&timedata); \
-            if (((double)runtime / NANOS_PER_SEC ) < min_runtime) { iter <<= 1; doubled = 1; }\
-            else { doubled = 0; } \
-        } while (((double)runtime / NANOS_PER_SEC ) < min_runtime); \
-        if (doubled) iter >>= 1; \
+        for (int probe = 0; probe < CALIBRATION_PROBES; probe++) \
+        { \
+            PROBE(func, iter, runtime); \
+            if (_calibrate_step(probe, target, runtime, &iter)) break; \
+        } \
         myData->iters = iter; \
-        if (data->barrier) pthread_barrier_wait(&data->barrier->barrier); \
+        if (data->barrier) barrier_wait(data->barrier, data->local_id); \
     } while (0)
 
 #define WARMUP(func) \
     do { \
-        if (data->barrier) pthread_barrier_wait(&data->barrier->barrier); \
-        size_t iter = MIN_ITERATIONS; \
+        if (data->barrier) barrier_wait(data->barrier, data->local_id); \
+        uint64_t target = (uint64_t)(WARMUP_RUNTIME * NANOS_PER_SEC); \
+        size_t iter = 1; \
         uint64_t runtime = 0; \
-        int doubled = 0; \
-        do { \
-            if (lb_timer_init(TIMER_RDTSC, &timedata) != 0) fprintf(stderr, "Timer initialization failed!\n"); \
-            if (data->barrier) pthread_barrier_wait(&data->barrier->barrier); \
+        PROBE(func, iter, runtime); \
+        if (runtime < target && myData->iters > 1) \
+        { \
+            iter = _extrapolate(1, runtime, target); \
+            if (iter > myData->iters) iter = myData->iters; \
+            PROBE(func, iter, runtime); \
+        } \
+        if (data->barrier) barrier_wait(data->barrier, data->local_id); \
+    } while (0)
+
+/*
+ * Runs up to max_samples timed repetitions of myData->iters calls and stores the runtime of
+ * each repetition in the preallocated sample buffer. The cycles and frequency are taken from
+ * the fastest repetition, which is also reported as min_runtime. The start and stop timestamps
+ * of each repetition are kept for the skew analysis, which compares the same repetition of all
+ * threads; the stop is taken before the closing barrier, which would otherwise hide the
+ * threads finishing early.
+ */
+#define REPETITIONS(func) \
+    do { \
+        int max_samples = (myData->samples && myData->max_samples > 0) ? myData->max_samples : 1; \
+        double mean = 0.0; \
+        double m2 = 0.0; \
+        myData->num_samples = 0; \
+        for (int rep = 0; rep < max_samples; rep++) \
+        { \
+            uint64_t sample = 0; \
+            uint64_t start = 0; \
+            uint64_t stop = 0; \
+            if (data->barrier) barrier_wait(data->barrier, data->local_id); \
+            if (lb_timer_init(data->timer, &timedata) != 0) fprintf(stderr, "Timer initialization failed!\n"); \
+            start = lb_timer_timestamp(); \
             lb_timer_start(&timedata); \
-            for (size_t i = 0; i < iter; i++) \
+            for (size_t i = 0; i < myData->iters; i++) \
             {   \
                 func; \
             } \
-            if (data->barrier) pthread_barrier_wait(&data->barrier->barrier); \
+            stop = lb_timer_timestamp(); \
+            if (data->barrier) barrier_wait(data->barrier, data->local_id); \
             lb_timer_stop(&timedata); \
-            lb_timer_as_ns(&timedata, &runtime); \
+            lb_timer_as_ns(&timedata, &sample); \
+            myData->start = start; \
+            myData->stop = stop; \
+            if (myData->starts) myData->starts[rep] = start; \
+            if (myData->stops) myData->stops[rep] = stop; \
+            if (rep == 0 || sample < myData->min_runtime) \
+            { \
+                myData->min_runtime = sample; \
+                lb_timer_as_cycles(&timedata, &myData->cycles); \
+                lb_timer_as_freq(&timedata, &myData->freq); \
+            } \
             lb_timer_close(&timedata); \
-            if (((double)runtime / NANOS_PER_SEC ) < MIN_RUNTIME) { iter <<= 1; doubled = 1; }\
-            else { doubled = 0; } \
-        } while (((double)runtime / NANOS_PER_SEC ) < MIN_RUNTIME); \
-        if (doubled) iter >>= 1; \
-        if (data->barrier) pthread_barrier_wait(&data->barrier->barrier); \
+            if (myData->samples) myData->samples[rep] = sample; \
+            myData->num_samples++; \
+            if (_repetitions_done(data, rep, max_samples, sample, &mean, &m2)) break; \
+        } \
     } while (0)
 
+/*
+ * With several workgroups, the timed repetitions of all workgroups start together. A thread that
+ * is done with its repetitions keeps running the kernel until the threads of all workgroups are
+ * done, so each workgroup is measured while the others are active.
+ */
+#define SYNC_START() \
+    if (data->sync) barrier_wait(&data->sync->barrier, data->global_id);
+
+#define SYNC_STOP(func) \
+    if (data->sync) \
+    { \
+        __atomic_sub_fetch(&data->sync->running, 1, __ATOMIC_ACQ_REL); \
+        while (__atomic_load_n(&data->sync->running, __ATOMIC_ACQUIRE) > 0) \
+        { \
+            func; \
+        } \
+    }
+
 // todo markers
-// todo timer library with rdtsc? or perf?
 #ifdef LIKWID_PERFMON
 #define EXECUTE(func) \
     LIKWID_MARKER_REGISTER("LIKWID-BENCH"); \
-    if (data->barrier) pthread_barrier_wait(&data->barrier->barrier); \
-    if (lb_timer_init(TIMER_RDTSC, &timedata) != 0) fprintf(stderr, "Timer initialization failed!\n"); \
+    if (data->barrier) barrier_wait(data->barrier, data->local_id); \
+    SYNC_START(); \
     LIKWID_MARKER_START("LIKWID-BENCH"); \
-    lb_timer_start(&timedata); \
-    for (size_t i = 0; i < myData->iters; i++) \
-    {   \
-        func; \
-    } \
-    if (data->barrier) pthread_barrier_wait(&data->barrier->barrier); \
-    lb_timer_stop(&timedata); \
+    REPETITIONS(func); \
     LIKWID_MARKER_STOP("LIKWID-BENCH"); \
-    lb_timer_as_ns(&timedata, &myData->min_runtime); \
-    lb_timer_as_cycles(&timedata, &myData->cycles); \
-    myData->freq = timedata.ci.freq; \
-    lb_timer_close(&timedata); \
-    if (data->barrier) pthread_barrier_wait(&data->barrier->barrier);
+    SYNC_STOP(func); \
+    if (data->barrier) barrier_wait(data->barrier, data->local_id);
 #else
 #define EXECUTE(func) \
-    if (data->barrier) pthread_barrier_wait(&data->barrier->barrier); \
-    if (lb_timer_init(TIMER_RDTSC, &timedata) != 0) fprintf(stderr, "Timer initialization failed!\n"); \
-    lb_timer_start(&timedata); \
-    for (size_t i = 0; i < myData->iters; i++) \
-    {   \
-        func; \
-    } \
-    if (data->barrier) pthread_barrier_wait(&data->barrier->barrier); \
-    lb_timer_stop(&timedata); \
-    lb_timer_as_ns(&timedata, &myData->min_runtime); \
-    lb_timer_as_cycles(&timedata, &myData->cycles); \
-    myData->freq = timedata.ci.freq; \
-    lb_timer_close(&timedata); \
-    if (data->barrier) pthread_barrier_wait(&data->barrier->barrier);
+    if (data->barrier) barrier_wait(data->barrier, data->local_id); \
+    SYNC_START(); \
+    REPETITIONS(func); \
+    SYNC_STOP(func); \
+    if (data->barrier) barrier_wait(data->barrier, data->local_id);
 #endif
 
+/*
+ * Returns the maximum of value over all threads of the workgroup. The reductions rotate through
+ * three slots: the slot of the next reduction is reset before the barrier, which is safe because
+ * every thread has passed the barrier of the previous reduction and is done reading it.
+ */
+static uint64_t _reduce_max(RuntimeThreadConfig* data, uint64_t value)
+{
+    if (!data->barrier)
+    {
+        return value;
+    }
+    thread_data_t myData = data->data;
+    uint64_t* slot = &data->barrier->reduce[myData->reductions % 3];
+    if (data->local_id == 0)
+    {
+        data->barrier->reduce[(myData->reductions + 1) % 3] = 0;
+    }
+    uint64_t current = __atomic_load_n(slot, __ATOMIC_RELAXED);
+    while (current < value && !__atomic_compare_exchange_n(slot, &current, value, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    barrier_wait(data->barrier, data->local_id);
+    myData->reductions++;
+    return __atomic_load_n(slot, __ATOMIC_RELAXED);
+}
+
+/* Number of iterations that run for target nanoseconds if iter iterations took runtime nanoseconds */
+static size_t _extrapolate(size_t iter, uint64_t runtime, uint64_t target)
+{
+    double iters = (double)iter * (double)target / (double)(runtime > 0 ? runtime : 1);
+    return (iters < 1.0 ? 1 : (size_t)(iters + 0.5));
+}
+
+/*
+ * Decides the iteration count of the next probe or the final one. The first probe runs a single
+ * iteration to warm up and to get a rough cost per iteration. The following probes aim at
+ * CALIBRATION_FRACTION of the target runtime, which is long enough to amortize the timer and
+ * barrier overhead. Once a probe gets there, the final count is extrapolated from it, so the
+ * calibration takes about 10% of the target runtime and usually two or three kernel launches.
+ */
+static int _calibrate_step(int probe, uint64_t target, uint64_t runtime, size_t* iter)
+{
+    double goal = (double)target * CALIBRATION_FRACTION;
+    if (runtime >= target || (probe > 0 && (double)runtime >= goal / 2) || probe + 1 >= CALIBRATION_PROBES)
+    {
+        *iter = _extrapolate(*iter, runtime, target);
+        return 1;
+    }
+    double growth = goal / (double)(runtime > 0 ? runtime : 1);
+    if (growth > CALIBRATION_MAX_GROWTH)
+    {
+        growth = CALIBRATION_MAX_GROWTH;
+    }
+    else if (growth < 1.0)
+    {
+        growth = 1.0;
+    }
+    *iter = (size_t)((double)(*iter) * growth + 0.5);
+    return 0;
+}
+
+/*
+ * Decides after each repetition whether another one is required. All threads of a workgroup
+ * must run the same number of repetitions because of the barriers, so each thread votes with
+ * the relative error of its own samples and the workgroup stops once no thread votes for more.
+ */
+static int _repetitions_done(RuntimeThreadConfig* data, int rep, int max_samples, uint64_t sample, double* mean, double* m2)
+{
+    thread_data_t myData = data->data;
+    int count = rep + 1;
+    double delta = (double)sample - *mean;
+    *mean += delta / (double)count;
+    *m2 += delta * ((double)sample - *mean);
+    if (count >= max_samples)
+    {
+        return 1;
+    }
+    if (myData->relerror <= 0.0)
+    {
+        return 0;
+    }
+    double relerror = sample_relerror(count, *mean, *m2);
+    int converged = (relerror >= 0.0 && relerror <= myData->relerror);
+    converged = (_reduce_max(data, !converged) == 0);
+    if (converged)
+    {
+        DEBUG_PRINT(DEBUGLEV_DEVELOP, "hwthread %3d stops after %d repetitions with relative error %f", myData->hwthread, count, relerror);
+    }
+    return converged;
+}
+
 int run_benchmark(RuntimeThreadConfig* data)
 {
     cpu_set_t cpuset;
@@ -141,14 +279,11 @@ int run_benchmark(RuntimeThreadConfig* data)
     }
 
     if (!data->barrier) DEBUG_PRINT(DEBUGLEV_DEVELOP, "Run in serial mode");
-    if (data->barrier) pthread_barrier_wait(&data->barrier->barrier);
+    if (data->barrier) barrier_wait(data->barrier, data->local_id);
 
-    /* Up to 10 streams the following registers are used for Array ptr:
-     * Size rdi
-     * in Registers: rsi  rdx  rcx  r8  r9
-     * passed on stack, then: r10  r11  r12  r13  r14  r15
-     * If more than 10 streams are used first 5 streams are in register, above 5 a macro must be used to
-     * load them from stack
+    /* The kernel gets a single argument: the per-thread argument block created by generate_code.
+     * It holds the stream pointers followed by the per-thread dimension sizes, so one compiled
+     * kernel serves all threads of a workgroup.
      * */
 
     struct timespec ts;
@@ -157,15 +292,15 @@ int run_benchmark(RuntimeThreadConfig* data)
 
     if (myData->iters == 0)
     {
-        MEASURE(func());
+        MEASURE(func(data->args));
     }
     else
     {
-        WARMUP(func());
+        WARMUP(func(data->args));
     }
 
     // printf("Iters: %" PRIu64 "\n", myData->iters);
-    EXECUTE(func());
+    EXECUTE(func(data->args));
     // not sure whether we need to give the sizes here. Since we compile the code, we could add the sizes there directly
     // as constants
     /*
@@ -457,7 +592,7 @@ int run_benchmark(RuntimeThreadConfig* data)
     data->runtime = (double)myData->min_runtime / NANOS_PER_SEC;
     data->cycles = myData->cycles;
     DEBUG_PRINT(DEBUGLEV_DEVELOP, "hwthread %3d execution took %.15f seconds", myData->hwthread, data->runtime);
-    if (data->barrier) pthread_barrier_wait(&data->barrier->barrier);
+    if (data->barrier) barrier_wait(data->barrier, data->local_id);
 
     if (CPU_COUNT(&runset) > 0)
     {
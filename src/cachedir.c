@@ -0,0 +1,115 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pwd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "cachedir.h"
+
+int cachedir_user_folder(char* buf, size_t len)
+{
+    int ret = 0;
+    const char* xdg = getenv("XDG_CACHE_HOME");
+    const char* home = getenv("HOME");
+    if ((!buf) || len == 0)
+    {
+        return -EINVAL;
+    }
+    if (xdg && xdg[0] == '/')
+    {
+        ret = snprintf(buf, len, "%s/%s", xdg, CACHEDIR_NAME);
+    }
+    else
+    {
+        if ((!home) || home[0] != '/')
+        {
+            struct passwd* pw = getpwuid(getuid());
+            home = (pw ? pw->pw_dir : NULL);
+        }
+        if ((!home) || home[0] != '/')
+        {
+            return -ENOENT;
+        }
+        ret = snprintf(buf, len, "%s/.cache/%s", home, CACHEDIR_NAME);
+    }
+    if (ret < 0 || (size_t)ret >= len)
+    {
+        return -ENAMETOOLONG;
+    }
+    return 0;
+}
+
+int cachedir_check(const char* path)
+{
+    int err = 0;
+    struct stat st;
+    if ((!path) || strlen(path) == 0)
+    {
+        return -EINVAL;
+    }
+    /* lstat follows a symlink if the path ends with a slash */
+    char* p = strdup(path);
+    if (!p)
+    {
+        return -ENOMEM;
+    }
+    for (size_t len = strlen(p); len > 1 && p[len - 1] == '/'; len--)
+    {
+        p[len - 1] = '\0';
+    }
+    if (lstat(p, &st) != 0)
+    {
+        err = -errno;
+    }
+    else if (S_ISLNK(st.st_mode) || st.st_uid != getuid() || (st.st_mode & (S_IWGRP | S_IWOTH)))
+    {
+        err = -EPERM;
+    }
+    free(p);
+    return err;
+}
+
+int cachedir_create(const char* folder)
+{
+    int err = 0;
+    if ((!folder) || strlen(folder) == 0)
+    {
+        return -EINVAL;
+    }
+    char* path = strdup(folder);
+    if (!path)
+    {
+        return -ENOMEM;
+    }
+    size_t len = strlen(path);
+    for (size_t i = 1; i <= len && err == 0; i++)
+    {
+        if (i == len || path[i] == '/')
+        {
+            char c = path[i];
+            path[i] = '\0';
+            if (mkdir(path, 0700) != 0 && errno != EEXIST)
+            {
+                err = -errno;
+            }
+            path[i] = c;
+        }
+    }
+    free(path);
+    if (err == 0)
+    {
+        err = cachedir_check(folder);
+        if (err == 0)
+        {
+            struct stat st;
+            if (stat(folder, &st) != 0 || !S_ISDIR(st.st_mode))
+            {
+                err = -ENOTDIR;
+            }
+        }
+    }
+    return err;
+}
@@ -1,5 +1,6 @@
 #include <inttypes.h>
 #include <stdlib.h>
+#include <ctype.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
@@ -13,6 +14,13 @@
 #include "test_types.h"
 #include "error.h"
 #include "helper.h"
+#include "timer.h"
+#include "barrier.h"
+#include "thread_group.h"
+#include "sweep.h"
+#include "scaling.h"
+#include "stats.h"
+#include "topology.h"
 
 static size_t _strtosizet(const char *nptr)
 {
@@ -86,7 +94,8 @@ int addCliOption(CliOptions* options, CliOption* new)
         {
             name_free = 0;
         }
-        if (bstrcmp(x->symbol, new->symbol) == BSTR_OK)
+        // Options without a short symbol share the placeholder
+        if (bstrcmp(x->symbol, new->symbol) == BSTR_OK && !biseqcstr(new->symbol, "****"))
         {
             symbol_free = 0;
         }
@@ -278,6 +287,24 @@ static void add_multi_argument(bstring combine, bstring arg)
     bconcat(combine, arg);
 }
 
+/*
+ * The base options are parsed before the kernel options. A base option ends the arguments
+ * of a multi_argument option like -w, returns its argument type or -ENOENT for other arguments.
+ */
+static int _base_option(bstring arg)
+{
+    for (int i = 0; i < basecliopts.num_options; i++)
+    {
+        ConstCliOption* o = &basecliopts.options[i];
+        if ((blength(arg) == 2 && bchar(arg, 0) == '-' && bchar(arg, 1) == o->symbol) ||
+            (blength(arg) > 2 && bchar(arg, 0) == '-' && bchar(arg, 1) == '-' && strcmp(bdata(arg) + 2, o->name) == 0))
+        {
+            return o->has_arg;
+        }
+    }
+    return -ENOENT;
+}
+
 int parseCliOptions(struct bstrList* argv, CliOptions* options)
 {
     struct tagbstring btrue = bsStatic("1");
@@ -345,7 +372,24 @@ int parseCliOptions(struct bstrList* argv, CliOptions* options)
         }
         if (!processed && combine_opt)
         {
-            add_multi_argument(combine, argv->entry[i]);
+            int has_arg = _base_option(argv->entry[i]);
+            if (has_arg >= 0)
+            {
+                if (blength(combine) > 0)
+                {
+                    bstrListAdd(combine_opt->values, combine);
+                    btrunc(combine, 0);
+                }
+                combine_opt = NULL;
+                if (has_arg == required_argument)
+                {
+                    i++;
+                }
+            }
+            else
+            {
+                add_multi_argument(combine, argv->entry[i]);
+            }
         }
     }
     if (blength(combine) > 0 && combine_opt)
@@ -427,6 +471,24 @@ int assignBaseCliOptions(CliOptions* options, RuntimeConfig* runcfg)
     struct tagbstring btrue = bsStatic("1");
     struct tagbstring bcompiler = bsStatic("--compiler");
     struct tagbstring bprintdomains = bsStatic("--printdomains");
+    struct tagbstring bcachefolder = bsStatic("--cachefolder");
+    struct tagbstring bnocache = bsStatic("--nocache");
+    struct tagbstring bpurgecache = bsStatic("--purgecache");
+    struct tagbstring bbuiltinasm = bsStatic("--builtinasm");
+    struct tagbstring btimer = bsStatic("--timer");
+    struct tagbstring brepetitions = bsStatic("--repetitions");
+    struct tagbstring brelerror = bsStatic("--relerror");
+    struct tagbstring bplacement = bsStatic("--placement");
+    struct tagbstring ballocation = bsStatic("--allocation");
+    struct tagbstring binitialization = bsStatic("--initialization");
+    struct tagbstring bbarrier = bsStatic("--barrier");
+    struct tagbstring bbarrierbench = bsStatic("--barrierbench");
+    struct tagbstring bscaling = bsStatic("--scaling");
+    struct tagbstring bsaturation = bsStatic("--saturation");
+    struct tagbstring bautotune = bsStatic("--autotune");
+    struct tagbstring bbatch = bsStatic("--batch");
+    struct tagbstring baggregate = bsStatic("--aggregate");
+    struct tagbstring bdomains = bsStatic("--domains");
     for (int i = 0; i < options->num_options; i++)
     {
         CliOption* opt = &options->options[i];
@@ -493,6 +555,147 @@ int assignBaseCliOptions(CliOptions* options, RuntimeConfig* runcfg)
                 bconcat(runcfg->tmpfolder, opt->value);
             }
         }
+        else if (bstrcmp(opt->name, &bcachefolder) == BSTR_OK && blength(opt->value) > 0)
+        {
+            btrunc(runcfg->cachefolder, 0);
+            bconcat(runcfg->cachefolder, opt->value);
+        }
+        else if (bstrcmp(opt->name, &bnocache) == BSTR_OK && bstrcmp(opt->value, &btrue) == BSTR_OK)
+        {
+            runcfg->nocache = 1;
+        }
+        else if (bstrcmp(opt->name, &bpurgecache) == BSTR_OK && bstrcmp(opt->value, &btrue) == BSTR_OK)
+        {
+            runcfg->purgecache = 1;
+        }
+        else if (bstrcmp(opt->name, &bbuiltinasm) == BSTR_OK && bstrcmp(opt->value, &btrue) == BSTR_OK)
+        {
+            runcfg->builtinasm = 1;
+        }
+        else if (bstrcmp(opt->name, &btimer) == BSTR_OK && blength(opt->value) > 0)
+        {
+            TimerEvents timer = TIMER_RDTSC;
+            if (lb_timer_parse_type(bdata(opt->value), &timer) != 0)
+            {
+                ERROR_PRINT("Unknown timer '%s', available: rdtsc, perf, gettime", bdata(opt->value));
+                return -EINVAL;
+            }
+            runcfg->timer = timer;
+        }
+        else if (bstrcmp(opt->name, &brepetitions) == BSTR_OK && blength(opt->value) > 0)
+        {
+            runcfg->repetitions = atoi(bdata(opt->value));
+            if (runcfg->repetitions <= 0)
+            {
+                ERROR_PRINT("Number of repetitions must be positive");
+                return -EINVAL;
+            }
+        }
+        else if (bstrcmp(opt->name, &brelerror) == BSTR_OK && blength(opt->value) > 0)
+        {
+            char* end = NULL;
+            runcfg->relerror = strtod(bdata(opt->value), &end);
+            if (end && *end == '%')
+            {
+                runcfg->relerror /= 100.0;
+                end++;
+            }
+            if (end == bdata(opt->value) || (end && *end != '\0') || runcfg->relerror <= 0.0 || runcfg->relerror >= 1.0)
+            {
+                ERROR_PRINT("Invalid relative error '%s', expected a value between 0 and 1 or a percentage", bdata(opt->value));
+                return -EINVAL;
+            }
+        }
+        else if (bstrcmp(opt->name, &bplacement) == BSTR_OK && blength(opt->value) > 0)
+        {
+            btrunc(runcfg->placement, 0);
+            bconcat(runcfg->placement, opt->value);
+        }
+        else if (bstrcmp(opt->name, &ballocation) == BSTR_OK && blength(opt->value) > 0)
+        {
+            btrunc(runcfg->allocation, 0);
+            bconcat(runcfg->allocation, opt->value);
+        }
+        else if (bstrcmp(opt->name, &binitialization) == BSTR_OK && blength(opt->value) > 0)
+        {
+            btrunc(runcfg->initialization, 0);
+            bconcat(runcfg->initialization, opt->value);
+        }
+        else if (bstrcmp(opt->name, &bbarrier) == BSTR_OK && blength(opt->value) > 0)
+        {
+            BarrierType barrier = BARRIER_PTHREAD;
+            if (barrier_parse_type(bdata(opt->value), &barrier) != 0)
+            {
+                ERROR_PRINT("Unknown barrier '%s', available: pthread, central, tree, dissemination", bdata(opt->value));
+                return -EINVAL;
+            }
+            runcfg->barrier = barrier;
+        }
+        else if (bstrcmp(opt->name, &bbarrierbench) == BSTR_OK && bstrcmp(opt->value, &btrue) == BSTR_OK)
+        {
+            runcfg->barrierbench = 1;
+        }
+        else if (bstrcmp(opt->name, &bscaling) == BSTR_OK && blength(opt->value) > 0)
+        {
+            ScalingOrder order = SCALING_NONE;
+            if (scaling_parse_order(bdata(opt->value), &order) != 0)
+            {
+                ERROR_PRINT("Unknown scaling order '%s', available: compact, scatter", bdata(opt->value));
+                return -EINVAL;
+            }
+            runcfg->scaling = order;
+        }
+        else if (bstrcmp(opt->name, &bsaturation) == BSTR_OK && blength(opt->value) > 0)
+        {
+            char* end = NULL;
+            runcfg->saturation = strtod(bdata(opt->value), &end);
+            if (end && *end == '%')
+            {
+                runcfg->saturation /= 100.0;
+                end++;
+            }
+            if (end == bdata(opt->value) || (end && *end != '\0') || runcfg->saturation <= 0.0 || runcfg->saturation > 1.0)
+            {
+                ERROR_PRINT("Invalid saturation '%s', expected a value between 0 and 1 or a percentage", bdata(opt->value));
+                return -EINVAL;
+            }
+        }
+        else if (bstrcmp(opt->name, &bautotune) == BSTR_OK && bstrcmp(opt->value, &btrue) == BSTR_OK)
+        {
+            runcfg->autotune = 1;
+        }
+        else if (bstrcmp(opt->name, &bbatch) == BSTR_OK && blength(opt->value) > 0)
+        {
+            btrunc(runcfg->batchfile, 0);
+            bconcat(runcfg->batchfile, opt->value);
+        }
+        else if (bstrcmp(opt->name, &baggregate) == BSTR_OK && blength(opt->value) > 0)
+        {
+            struct bstrList* names = bsplit(opt->value, ',');
+            for (int a = 0; a < names->qty; a++)
+            {
+                SampleAggregation agg;
+                btrimws(names->entry[a]);
+                if (sample_parse_aggregation(bdata(names->entry[a]), &agg) != 0)
+                {
+                    ERROR_PRINT("Unknown aggregation '%s', available: min, max, sum, median, mean, stddev, hmean, p<N>", bdata(names->entry[a]));
+                    bstrListDestroy(names);
+                    return -EINVAL;
+                }
+            }
+            bstrListDestroy(runcfg->aggregations);
+            runcfg->aggregations = names;
+        }
+        else if (bstrcmp(opt->name, &bdomains) == BSTR_OK && blength(opt->value) > 0)
+        {
+            DomainLevel level = DOMAIN_NONE;
+            if (parse_domain_level(bdata(opt->value), &level) != 0)
+            {
+                ERROR_PRINT("Unknown domain '%s', available: socket, numa, core", bdata(opt->value));
+                return -EINVAL;
+            }
+            runcfg->domains = level;
+        }
         else if (bstrcmp(opt->name, &barraysize) == BSTR_OK && blength(opt->value) > 0)
         {
             btrunc(runcfg->arraysize, 0);
@@ -537,10 +740,47 @@ int assignBaseCliOptions(CliOptions* options, RuntimeConfig* runcfg)
         ERROR_PRINT("Runtime and Iterations cannot be set at a time");
         return -EINVAL;
     }
+    if (runcfg->repetitions == 0)
+    {
+        runcfg->repetitions = (runcfg->relerror > 0.0 ? MAX_REPETITIONS : 1);
+    }
 
     return 0;
 }
 
+/*
+ * Short symbol of a kernel parameter: its first letter in lower or upper case, if neither
+ * is taken by the base options or an earlier parameter, the parameter has only the long form
+ */
+static bstring _test_symbol(CliOptions* options, bstring name)
+{
+    char candidates[2] = {tolower(bchar(name, 0)), toupper(bchar(name, 0))};
+    if (bchar(name, 0) != candidates[0])
+    {
+        candidates[0] = candidates[1];
+        candidates[1] = tolower(bchar(name, 0));
+    }
+    for (int c = 0; c < 2; c++)
+    {
+        int taken = 0;
+        bstring symbol = bformat("-%c", candidates[c]);
+        for (int i = 0; i < basecliopts.num_options && !taken; i++)
+        {
+            taken = (basecliopts.options[i].symbol == candidates[c]);
+        }
+        for (int i = 0; i < options->num_options && !taken; i++)
+        {
+            taken = (bstrcmp(options->options[i].symbol, symbol) == BSTR_OK);
+        }
+        if (!taken)
+        {
+            return symbol;
+        }
+        bdestroy(symbol);
+    }
+    return bfromcstr("****");
+}
+
 int generateTestCliOptions(CliOptions* options, RuntimeConfig* runcfg)
 {
     int err = 0;
@@ -567,7 +807,7 @@ int generateTestCliOptions(CliOptions* options, RuntimeConfig* runcfg)
         TestConfigParameter* p = &runcfg->tcfg->params[i];
         CliOption opt = {
             .name = bformat("--%s", bdata(p->name)),
-            .symbol = bformat("-%c", bchar(p->name, 0)),
+            .symbol = _test_symbol(options, p->name),
             .has_arg = required_argument,
             .description = bstrcpy(p->description),
             .value = NULL,
@@ -602,9 +842,36 @@ static int add_runtime_parameter(RuntimeConfig* runcfg, TestConfigParameter* par
     runcfg->params[runcfg->num_params].name = bstrcpy(param->name);
     runcfg->params[runcfg->num_params].value = NULL;
     runcfg->params[runcfg->num_params].values= NULL;
+    runcfg->params[runcfg->num_params].sweep = NULL;
     if (opt->has_arg != multi_argument)
     {
-        runcfg->params[runcfg->num_params].value = bstrcpy(opt->value);
+        struct bstrList* points = NULL;
+        int num_points = sweep_parse(opt->value, &points);
+        if (num_points < 0)
+        {
+            bdestroy(runcfg->params[runcfg->num_params].name);
+            return num_points;
+        }
+        if (num_points > 1)
+        {
+            for (int i = 0; i < runcfg->num_params; i++)
+            {
+                if (runcfg->params[i].sweep)
+                {
+                    ERROR_PRINT("Only one parameter can be swept, %s is already swept", bdata(runcfg->params[i].name));
+                    bdestroy(runcfg->params[runcfg->num_params].name);
+                    bstrListDestroy(points);
+                    return -EINVAL;
+                }
+            }
+            runcfg->params[runcfg->num_params].sweep = points;
+            runcfg->params[runcfg->num_params].value = bstrcpy(points->entry[0]);
+        }
+        else
+        {
+            runcfg->params[runcfg->num_params].value = bstrcpy(opt->value);
+            bstrListDestroy(points);
+        }
     }
     else
     {
@@ -688,11 +955,36 @@ int assignWorkgroupCliOptions(CliOptions* options, RuntimeConfig* runcfg)
         bdestroy(woptstr);
         return -ENOMEM;
     }
+    memset(wgroups, 0, wopt->values->qty * sizeof(RuntimeWorkgroupConfig));
 
     for (int i = 0; i < wopt->values->qty; i++)
     {
         RuntimeWorkgroupConfig* wg = &wgroups[i];
-        wg->str = bstrcpy(wopt->values->entry[i]);
+        /* A kernel after '@' replaces the one of -t for this workgroup */
+        int at = bstrchr(wopt->values->entry[i], '@');
+        if (at != BSTR_ERR)
+        {
+            wg->str = bmidstr(wopt->values->entry[i], 0, at);
+            wg->testname = bmidstr(wopt->values->entry[i], at + 1, blength(wopt->values->entry[i]));
+            btrimws(wg->testname);
+            if (blength(wg->str) == 0 || blength(wg->testname) == 0)
+            {
+                errno = EINVAL;
+                ERROR_PRINT("Invalid workgroup '%s', expected <group>@<kernel>", bdata(wopt->values->entry[i]));
+                for (int j = 0; j <= i; j++)
+                {
+                    bdestroy(wgroups[j].str);
+                    bdestroy(wgroups[j].testname);
+                }
+                free(wgroups);
+                bdestroy(woptstr);
+                return -EINVAL;
+            }
+        }
+        else
+        {
+            wg->str = bstrcpy(wopt->values->entry[i]);
+        }
     }
 
     runcfg->wgroups = wgroups;
@@ -1,15 +1,24 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
+#include <dirent.h>
 #include <dlfcn.h>
+#include <sys/stat.h>
+#include <sys/types.h>
 
 #include "error.h"
 #include "bstrlib.h"
 #include "bstrlib_helper.h"
 #include "dynload.h"
+#include "assembler.h"
 #include "test_types.h"
+#include "cachedir.h"
+#include "results.h"
+#include "symbols.h"
 
 
 bstring get_compiler(bstring candidates)
@@ -92,6 +101,44 @@ int open_function(RuntimeThreadConfig* thread)
     return 0;
 }
 
+int open_workgroup_functions(RuntimeWorkgroupConfig* wcfg)
+{
+    int err = 0;
+    for (int t = 0; t < wcfg->num_threads; t++)
+    {
+        RuntimeThreadConfig* thread = &wcfg->threads[t];
+        RuntimeThreadConfig* owner = NULL;
+        if (thread->testconfig->function)
+        {
+            // Assembled in-process, nothing to load
+            continue;
+        }
+        for (int u = 0; u < t; u++)
+        {
+            RuntimeTestConfig* other = wcfg->threads[u].testconfig;
+            if (other->dlhandle && bstrcmp(other->objfile, thread->testconfig->objfile) == BSTR_OK)
+            {
+                owner = &wcfg->threads[u];
+                break;
+            }
+        }
+        if (owner)
+        {
+            // Only the owner keeps the handle, so the object is closed once
+            DEBUG_PRINT(DEBUGLEV_DEVELOP, "hwthread %d uses function of hwthread %d", thread->data->hwthread, owner->data->hwthread);
+            thread->testconfig->dlhandle = NULL;
+            thread->testconfig->function = owner->testconfig->function;
+            continue;
+        }
+        err = open_function(thread);
+        if (err < 0)
+        {
+            return err;
+        }
+    }
+    return 0;
+}
+
 int close_function(RuntimeThreadConfig* thread)
 {
     if (thread->testconfig->dlhandle)
@@ -100,6 +147,12 @@ int close_function(RuntimeThreadConfig* thread)
         thread->testconfig->dlhandle = NULL;
         thread->testconfig->function = NULL;
     }
+    if (thread->testconfig->codebuf)
+    {
+        release_code(thread->testconfig->codebuf, thread->testconfig->codesize);
+        thread->testconfig->codebuf = NULL;
+        thread->testconfig->function = NULL;
+    }
     if (thread->testconfig->objfile) bdestroy(thread->testconfig->objfile);
     if (thread->testconfig->functionname) bdestroy(thread->testconfig->functionname);
     if (thread->testconfig->flags) bdestroy(thread->testconfig->flags);
@@ -114,11 +167,10 @@ int dump_assembly(RuntimeThreadConfig* thread, bstring outfile)
     return write_bstrList_to_file(thread->codelines, bdata(outfile));
 }
 
-void fill_keylist(mpointer key, mpointer value, mpointer user_data)
+void fill_keylist(int id, bstring name, mpointer user_data)
 {
-    bstring bkey = (bstring)key;
     struct bstrList* list = (struct bstrList*)user_data;
-    bstrListAdd(list, bkey);
+    bstrListAdd(list, name);
 }
 
 int sortfunc(const struct tagbstring * left, const struct tagbstring * right)
@@ -152,143 +204,402 @@ int bunlink(bstring filename)
     return -1;
 }
 
-int dynload_create_runtime_test_config(RuntimeConfig* rcfg, RuntimeWorkgroupConfig* wcfg)
+static uint64_t _hash_bytes(uint64_t hash, const unsigned char* data, int len)
 {
-    int ret = 0;
-    bstring flags = bfromcstr("-fPIC -shared");
-    bstring compiler = get_compiler(rcfg->compiler);
-    for (int t = 0; t < wcfg->num_threads; t++)
+    for (int i = 0; i < len; i++)
     {
-        RuntimeThreadConfig* thread = &wcfg->threads[t];
-        int fd = 0;
-        bstring filetemplate = NULL;
-        bstring asmfile = NULL;
-        bstring objfile = NULL;
-        struct bstrList* wcodelines = NULL;
-        if (!compiler)
+        hash ^= (uint64_t)data[i];
+        hash *= DYNLOAD_HASH_PRIME;
+    }
+    return hash;
+}
+
+uint64_t dynload_hash_code(struct bstrList* code, bstring compiler, bstring flags)
+{
+    uint64_t hash = DYNLOAD_HASH_OFFSET;
+    unsigned char sep = '\n';
+    if (compiler)
+    {
+        hash = _hash_bytes(hash, (unsigned char*)bdata(compiler), blength(compiler));
+    }
+    hash = _hash_bytes(hash, &sep, 1);
+    if (flags)
+    {
+        hash = _hash_bytes(hash, (unsigned char*)bdata(flags), blength(flags));
+    }
+    hash = _hash_bytes(hash, &sep, 1);
+    if (code)
+    {
+        for (int i = 0; i < code->qty; i++)
         {
-            return -ENOENT;
+            hash = _hash_bytes(hash, (unsigned char*)bdata(code->entry[i]), blength(code->entry[i]));
+            hash = _hash_bytes(hash, &sep, 1);
         }
+    }
+    return hash;
+}
 
-        filetemplate = bformat("/tmp/likwid-bench-hwtid%d-XXXXXX", thread->data->hwthread);
-        fd = bmkstemp(filetemplate);
-        if (fd == -1)
+int dynload_purge_cache(bstring cachefolder)
+{
+    int removed = 0;
+    DIR* dp = NULL;
+    struct dirent* ep = NULL;
+    if (!cachefolder || blength(cachefolder) == 0)
+    {
+        return -EINVAL;
+    }
+    dp = opendir(bdata(cachefolder));
+    if (!dp)
+    {
+        if (errno == ENOENT)
         {
-            ERROR_PRINT("Failed to get temporary file name for assembly");
-            bdestroy(compiler);
-            bdestroy(filetemplate);
-            return -1;
+            return 0;
         }
-        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Generated file name is '%s'", bdata(filetemplate));
+        ERROR_PRINT("Cannot open kernel object cache %s", bdata(cachefolder));
+        return -errno;
+    }
+    while ((ep = readdir(dp)))
+    {
+        size_t len = strlen(ep->d_name);
+        if (len > 2 && strcmp(ep->d_name + len - 2, ".o") == 0)
+        {
+            bstring path = bformat("%s/%s", bdata(cachefolder), ep->d_name);
+            if (bunlink(path) == 0)
+            {
+                removed++;
+            }
+            else
+            {
+                WARN_PRINT("Failed to remove cached object %s", bdata(path));
+            }
+            bdestroy(path);
+        }
+    }
+    closedir(dp);
+    printf("Removed %d objects from kernel object cache %s\n", removed, bdata(cachefolder));
+    return removed;
+}
 
-        asmfile = bstrcpy(filetemplate);
-        close(fd);
-        if (bunlink(filetemplate) == -1)
+static int _compile_object(bstring compiler, bstring flags, bstring asmfile, bstring objfile)
+{
+    int ret = 0;
+    bstring cmd = bformat("%s %s %s -o %s 2>&1", bdata(compiler), bdata(flags), bdata(asmfile), bdata(objfile));
+    DEBUG_PRINT(DEBUGLEV_DEVELOP, "CMD %s", bdata(cmd));
+    FILE * fp = popen(bdata(cmd), "r");
+    if (fp)
+    {
+        bstring bstdout = bread ((bNread) fread, fp);
+        if (blength(bstdout) > 0)
         {
-            ERROR_PRINT("Failed to unlink '%s'", bdata(filetemplate));
-            bdestroy(asmfile);
-            bdestroy(compiler);
-            bdestroy(filetemplate);
-            return -1;
+            btrimws(bstdout);
+            struct bstrList* errlist = bsplit(bstdout, '\n');
+            for (int i = 0; i < errlist->qty; i++)
+            {
+                ERROR_PRINT("%s", bdata(errlist->entry[i]));
+            }
+            bstrListDestroy(errlist);
         }
-        bdestroy(filetemplate);
-        bconchar(asmfile, '.');
-        objfile = bstrcpy(asmfile);
-        bconchar(asmfile, 's');
-        bconchar(objfile, 'o');
-        bstrListAdd(rcfg->mkstempfiles, asmfile);
-        bstrListAdd(rcfg->mkstempfiles, objfile);
-
-        wcodelines = bstrListCopy(thread->codelines);
-        struct bstrList *valkeys = bstrListCreate();
-        struct bstrList *varkeys = bstrListCreate();
-        struct bstrList *sorted_valkeys = NULL;
-        struct bstrList *sorted_varkeys = NULL;
-        foreach_in_bmap(wcfg->results[t].values, fill_keylist, valkeys);
-        foreach_in_bmap(wcfg->results[t].variables, fill_keylist, varkeys);
-
-        bstrListSortFunc(valkeys, sortfunc, &sorted_valkeys);
-        bstrListSortFunc(varkeys, sortfunc, &sorted_varkeys);
-        bstrListDestroy(valkeys);
-        bstrListDestroy(varkeys);
-
-        for (int i = 0; i < wcodelines->qty; i++)
+        bdestroy(bstdout);
+        ret = pclose(fp);
+    }
+    else
+    {
+        ret = errno;
+        ERROR_PRINT("Failed to execute: %s", bdata(cmd))
+    }
+    bdestroy(cmd);
+    return ret;
+}
+
+/*
+ * Assemble the code of thread t into executable memory. Threads with identical code share
+ * the buffer of the first one, only that thread releases it in close_function.
+ */
+static int _assemble_thread_code(RuntimeWorkgroupConfig* wcfg, int t, uint64_t* hashes, struct bstrList* code, bstring funcname)
+{
+    int err = 0;
+    RuntimeThreadConfig* thread = &wcfg->threads[t];
+    for (int u = 0; u < t; u++)
+    {
+        RuntimeTestConfig* other = wcfg->threads[u].testconfig;
+        if (hashes[u] == hashes[t] && other->codebuf)
+        {
+            DEBUG_PRINT(DEBUGLEV_DETAIL, "hwthread %d shares assembled code of hwthread %d", thread->data->hwthread, wcfg->threads[u].data->hwthread);
+            thread->testconfig->function = other->function;
+            thread->testconfig->codebuf = NULL;
+            thread->testconfig->codesize = 0;
+            thread->testconfig->functionname = bstrcpy(funcname);
+            return 0;
+        }
+    }
+    err = assemble_code(code, funcname, &thread->testconfig->codebuf, &thread->testconfig->codesize, &thread->testconfig->function);
+    if (err == 0)
+    {
+        DEBUG_PRINT(DEBUGLEV_DETAIL, "Assembled kernel %s in-process for hwthread %d", bdata(funcname), thread->data->hwthread);
+        thread->testconfig->functionname = bstrcpy(funcname);
+        thread->testconfig->dlhandle = NULL;
+    }
+    return err;
+}
+
+/*
+ * Copy of the code of thread t with the values and variables of its results filled in.
+ */
+static struct bstrList* _substitute_code(RuntimeWorkgroupConfig* wcfg, int t)
+{
+    struct bstrList* wcodelines = bstrListCopy(wcfg->threads[t].codelines);
+    if (!wcodelines)
+    {
+        return NULL;
+    }
+    struct bstrList *valkeys = bstrListCreate();
+    struct bstrList *varkeys = bstrListCreate();
+    struct bstrList *sorted_valkeys = NULL;
+    struct bstrList *sorted_varkeys = NULL;
+    foreach_value(&wcfg->results[t], fill_keylist, valkeys);
+    foreach_variable(&wcfg->results[t], fill_keylist, varkeys);
+
+    bstrListSortFunc(valkeys, sortfunc, &sorted_valkeys);
+    bstrListSortFunc(varkeys, sortfunc, &sorted_varkeys);
+    bstrListDestroy(valkeys);
+    bstrListDestroy(varkeys);
+
+    for (int i = 0; i < wcodelines->qty; i++)
+    {
+        if (bchar(wcodelines->entry[i], 0) == '#') continue;
+        if (bchar(wcodelines->entry[i], 0) == '.') continue;
+        struct bstrList* blist = bstrListCreate();
+        bstrtok_delimters(wcodelines->entry[i], blist);
+        for (int k = 0; k < blist->qty; k++)
         {
-            if (bchar(wcodelines->entry[i], 0) == '#') continue;
-            if (bchar(wcodelines->entry[i], 0) == '.') continue;
-            struct bstrList* blist = bstrListCreate();
-            bstrtok_delimters(wcodelines->entry[i], blist);
-            for (int k = 0; k < blist->qty; k++)
+            for (int j = sorted_valkeys->qty - 1; j >= 0; j--)
             {
-                for (int j = sorted_valkeys->qty - 1; j >= 0; j--)
+                if (binstr(blist->entry[k], 0, sorted_valkeys->entry[j]) != BSTR_ERR)
                 {
-                    if (binstr(blist->entry[k], 0, sorted_valkeys->entry[j]) != BSTR_ERR)
+                    bstring key = sorted_valkeys->entry[j];
+                    bstring val = get_value_text(&wcfg->results[t], symbol_find(key, symbol_hash(key)));
+                    if (val)
                     {
-                        bstring val = NULL;
-                        ret = get_bmap_by_key(wcfg->results[t].values, sorted_valkeys->entry[j], (void**)&val);
-                        if (ret == 0)
-                        {
-                            DEBUG_PRINT(DEBUGLEV_DEVELOP, "Replacing '%s' with '%s' in '%s'", bdata(sorted_valkeys->entry[j]), bdata(val), bdata(wcodelines->entry[i]));
-                            bfindreplace(blist->entry[k], sorted_valkeys->entry[j], val, 0);
-                        }
+                        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Replacing '%s' with '%s' in '%s'", bdata(key), bdata(val), bdata(wcodelines->entry[i]));
+                        bfindreplace(blist->entry[k], key, val, 0);
+                        bdestroy(val);
                     }
                 }
-                for (int j = sorted_varkeys->qty - 1; j >= 0; j--)
+            }
+            for (int j = sorted_varkeys->qty - 1; j >= 0; j--)
+            {
+                if (binstr(blist->entry[k], 0, sorted_varkeys->entry[j]) != BSTR_ERR)
                 {
-                    if (binstr(blist->entry[k], 0, sorted_varkeys->entry[j]) != BSTR_ERR)
+                    bstring key = sorted_varkeys->entry[j];
+                    bstring val = get_variable_text(&wcfg->results[t], symbol_find(key, symbol_hash(key)));
+                    if (val)
                     {
-                        bstring val = NULL;
-                        ret = get_bmap_by_key(wcfg->results[t].variables, sorted_varkeys->entry[j], (void**)&val);
-                        if (ret == 0)
-                        {
-                            DEBUG_PRINT(DEBUGLEV_DEVELOP, "Replacing '%s' with '%s' in '%s'", bdata(sorted_varkeys->entry[j]), bdata(val), bdata(wcodelines->entry[i]));
-                            bfindreplace(blist->entry[k], sorted_varkeys->entry[j], val, 0);
-                        }
+                        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Replacing '%s' with '%s' in '%s'", bdata(key), bdata(val), bdata(wcodelines->entry[i]));
+                        bfindreplace(blist->entry[k], key, val, 0);
+                        bdestroy(val);
                     }
                 }
             }
-            bstrListDestroy(blist);
         }
+        bstrListDestroy(blist);
+    }
 
-        bstrListDestroy(sorted_valkeys);
-        bstrListDestroy(sorted_varkeys);
+    bstrListDestroy(sorted_valkeys);
+    bstrListDestroy(sorted_varkeys);
+    return wcodelines;
+}
 
-        ret = write_bstrList_to_file(wcodelines, bdata(asmfile));
-        if (ret < 0)
+int dynload_create_runtime_test_config(RuntimeConfig* rcfg, RuntimeWorkgroupConfig* wcfg)
+{
+    int ret = 0;
+    int use_cache = 0;
+    uint64_t* hashes = NULL;
+    bstring flags = bfromcstr("-fPIC -shared");
+    bstring compiler = get_compiler(rcfg->compiler);
+    if (!compiler && !rcfg->builtinasm)
+    {
+        bdestroy(flags);
+        return -ENOENT;
+    }
+    hashes = malloc(wcfg->num_threads * sizeof(uint64_t));
+    if (!hashes)
+    {
+        bdestroy(flags);
+        bdestroy(compiler);
+        return -ENOMEM;
+    }
+    if (!rcfg->nocache && rcfg->cachefolder && blength(rcfg->cachefolder) > 0)
+    {
+        /* The objects are loaded into this process, so the folder must be private to the user */
+        ret = cachedir_create(bdata(rcfg->cachefolder));
+        if (ret == 0)
         {
-            ERROR_PRINT("Failed to write assembly to file %s", bdata(asmfile));
-            bdestroy(asmfile);
-            bdestroy(objfile);
-            bstrListDestroy(wcodelines);
-            return -1;
+            use_cache = 1;
         }
+        else if (ret == -EPERM)
+        {
+            WARN_PRINT("Kernel object cache %s is not owned by the user or writable by others, compiling without cache", bdata(rcfg->cachefolder));
+            ret = 0;
+        }
+        else
+        {
+            errno = -ret;
+            WARN_PRINT("Cannot create kernel object cache %s, compiling without cache", bdata(rcfg->cachefolder));
+            ret = 0;
+        }
+    }
+    for (int t = 0; t < wcfg->num_threads; t++)
+    {
+        RuntimeThreadConfig* thread = &wcfg->threads[t];
+        int fd = 0;
+        int cached = 0;
+        bstring filetemplate = NULL;
+        bstring asmfile = NULL;
+        bstring objfile = NULL;
+        bstring buildfile = NULL;
+        struct bstrList* wcodelines = NULL;
+
+        wcodelines = _substitute_code(wcfg, t);
+        if (!wcodelines)
+        {
+            bdestroy(flags);
+            bdestroy(compiler);
+            free(hashes);
+            return -ENOMEM;
+        }
+
+        /*
+         * The object is named after the hash of the final assembly, the compiler and its flags.
+         * Threads with identical code and later runs with the same kernel pick up the existing object.
+         */
+        hashes[t] = dynload_hash_code(wcodelines, compiler, flags);
+        thread->testconfig->hash = hashes[t];
 
-        bstring cmd = bformat("%s %s %s -o %s 2>&1", bdata(compiler), bdata(flags), bdata(asmfile), bdata(objfile));
-        DEBUG_PRINT(DEBUGLEV_DEVELOP, "CMD %s", bdata(cmd));
-        FILE * fp = popen(bdata(cmd), "r");
-        if (fp)
+        if (rcfg->builtinasm)
         {
-            bstring bstdout = bread ((bNread) fread, fp);
-            if (blength(bstdout) > 0)
+            ret = _assemble_thread_code(wcfg, t, hashes, wcodelines, wcfg->testname);
+            if (ret == 0)
             {
-                btrimws(bstdout);
-                struct bstrList* errlist = bsplit(bstdout, '\n');
-                for (int i = 0; i < errlist->qty; i++)
-                {
-                    ERROR_PRINT("%s", bdata(errlist->entry[i]));
-                }
-                bstrListDestroy(errlist);
+                bstrListDestroy(wcodelines);
+                continue;
+            }
+            DEBUG_PRINT(DEBUGLEV_DETAIL, "Cannot assemble kernel in-process for hwthread %d, using %s", thread->data->hwthread, (compiler ? bdata(compiler) : "no compiler"));
+            ret = 0;
+            if (!compiler)
+            {
+                errno = ENOENT;
+                ERROR_PRINT("Kernel %s cannot be assembled in-process and no compiler found", bdata(wcfg->testname));
+                bstrListDestroy(wcodelines);
+                bdestroy(flags);
+                free(hashes);
+                return -ENOENT;
             }
-            bdestroy(bstdout);
-            ret = pclose(fp);
         }
-        else
+        for (int u = 0; u < t; u++)
+        {
+            if (hashes[u] == hashes[t])
+            {
+                DEBUG_PRINT(DEBUGLEV_DETAIL, "hwthread %d shares object %s", thread->data->hwthread, bdata(wcfg->threads[u].testconfig->objfile));
+                objfile = bstrcpy(wcfg->threads[u].testconfig->objfile);
+                cached = 1;
+                break;
+            }
+        }
+        if (use_cache && !cached)
+        {
+            objfile = bformat("%s/%s-%016" PRIx64 ".o", bdata(rcfg->cachefolder), bdata(wcfg->testname), hashes[t]);
+            int trusted = cachedir_check(bdata(objfile));
+            if (trusted == 0 && !access(bdata(objfile), R_OK))
+            {
+                DEBUG_PRINT(DEBUGLEV_DETAIL, "Using cached object %s for hwthread %d", bdata(objfile), thread->data->hwthread);
+                cached = 1;
+            }
+            else if (trusted == -EPERM)
+            {
+                /* The rename after compiling replaces it */
+                WARN_PRINT("Ignoring cached object %s, it is not owned by the user or writable by others", bdata(objfile));
+            }
+        }
+
+        if (!cached)
         {
-            ret = errno;
-            ERROR_PRINT("Failed to execute: %s", bdata(cmd))
+            filetemplate = bformat("/tmp/likwid-bench-hwtid%d-XXXXXX", thread->data->hwthread);
+            fd = bmkstemp(filetemplate);
+            if (fd == -1)
+            {
+                ERROR_PRINT("Failed to get temporary file name for assembly");
+                bdestroy(compiler);
+                bdestroy(flags);
+                bdestroy(filetemplate);
+                if (objfile) bdestroy(objfile);
+                bstrListDestroy(wcodelines);
+                free(hashes);
+                return -1;
+            }
+            DEBUG_PRINT(DEBUGLEV_DEVELOP, "Generated file name is '%s'", bdata(filetemplate));
+
+            asmfile = bstrcpy(filetemplate);
+            close(fd);
+            if (bunlink(filetemplate) == -1)
+            {
+                ERROR_PRINT("Failed to unlink '%s'", bdata(filetemplate));
+                bdestroy(asmfile);
+                bdestroy(compiler);
+                bdestroy(flags);
+                bdestroy(filetemplate);
+                if (objfile) bdestroy(objfile);
+                bstrListDestroy(wcodelines);
+                free(hashes);
+                return -1;
+            }
+            bdestroy(filetemplate);
+            bconchar(asmfile, '.');
+            if (use_cache)
+            {
+                /* compile next to the final name and rename, so no other run sees a partial object */
+                buildfile = bformat("%s.%d", bdata(objfile), getpid());
+            }
+            else
+            {
+                objfile = bstrcpy(asmfile);
+                bconchar(objfile, 'o');
+                bstrListAdd(rcfg->mkstempfiles, objfile);
+                buildfile = bstrcpy(objfile);
+            }
+            bconchar(asmfile, 's');
+            bstrListAdd(rcfg->mkstempfiles, asmfile);
+
+            ret = write_bstrList_to_file(wcodelines, bdata(asmfile));
+            if (ret < 0)
+            {
+                ERROR_PRINT("Failed to write assembly to file %s", bdata(asmfile));
+                bdestroy(asmfile);
+                bdestroy(objfile);
+                bdestroy(buildfile);
+                bdestroy(compiler);
+                bdestroy(flags);
+                bstrListDestroy(wcodelines);
+                free(hashes);
+                return -1;
+            }
+
+            ret = _compile_object(compiler, flags, asmfile, buildfile);
+            if (use_cache)
+            {
+                if (ret == 0 && rename(bdata(buildfile), bdata(objfile)) != 0)
+                {
+                    ERROR_PRINT("Failed to move %s to %s", bdata(buildfile), bdata(objfile));
+                    ret = -errno;
+                }
+                if (ret != 0)
+                {
+                    bunlink(buildfile);
+                }
+            }
+            bdestroy(buildfile);
+            bdestroy(asmfile);
         }
-        bdestroy(cmd);
-        bdestroy(asmfile);
+
         if (global_verbosity == DEBUGLEV_DEVELOP)
         {
             for (int i = 0; i < wcodelines->qty; i++)
@@ -305,12 +616,72 @@ int dynload_create_runtime_test_config(RuntimeConfig* rcfg, RuntimeWorkgroupConf
         thread->testconfig->objfile = bstrcpy(objfile);
         thread->testconfig->compiler = bstrcpy(compiler);
         thread->testconfig->flags = bstrcpy(flags);
-        thread->testconfig->functionname = bstrcpy(rcfg->testname);
+        thread->testconfig->functionname = bstrcpy(wcfg->testname);
         thread->testconfig->dlhandle = NULL;
         thread->testconfig->function = NULL;
         bdestroy(objfile);
     }
+    free(hashes);
     bdestroy(flags);
     bdestroy(compiler);
     return ret;
 }
+
+/*
+ * Rebuilds the functions of a workgroup after its results changed, e.g. between the points
+ * of a sweep. Stream pointers and sizes are mostly passed in the argument block, so the
+ * substituted code often stays the same and the loaded functions are kept.
+ * Returns 1 if the functions were rebuilt, 0 if they are unchanged, or a negative error.
+ */
+int dynload_update_runtime_test_config(RuntimeConfig* rcfg, RuntimeWorkgroupConfig* wcfg)
+{
+    int err = 0;
+    int changed = 0;
+    bstring flags = bfromcstr("-fPIC -shared");
+    bstring compiler = get_compiler(rcfg->compiler);
+    for (int t = 0; t < wcfg->num_threads && !changed; t++)
+    {
+        RuntimeThreadConfig* thread = &wcfg->threads[t];
+        struct bstrList* wcodelines = _substitute_code(wcfg, t);
+        if (!wcodelines)
+        {
+            bdestroy(flags);
+            bdestroy(compiler);
+            return -ENOMEM;
+        }
+        changed = (!thread->testconfig || thread->testconfig->hash != dynload_hash_code(wcodelines, compiler, flags));
+        bstrListDestroy(wcodelines);
+    }
+    bdestroy(flags);
+    bdestroy(compiler);
+    if (!changed)
+    {
+        return 0;
+    }
+    DEBUG_PRINT(DEBUGLEV_DETAIL, "Code of workgroup %s changed, rebuilding functions", bdata(wcfg->str));
+    for (int t = 0; t < wcfg->num_threads; t++)
+    {
+        RuntimeThreadConfig* thread = &wcfg->threads[t];
+        if (thread->testconfig)
+        {
+            close_function(thread);
+        }
+        thread->testconfig = malloc(sizeof(RuntimeTestConfig));
+        if (!thread->testconfig)
+        {
+            return -ENOMEM;
+        }
+        memset(thread->testconfig, 0, sizeof(RuntimeTestConfig));
+    }
+    err = dynload_create_runtime_test_config(rcfg, wcfg);
+    if (err < 0)
+    {
+        return err;
+    }
+    err = open_workgroup_functions(wcfg);
+    if (err < 0)
+    {
+        return err;
+    }
+    return 1;
+}
@@ -0,0 +1,426 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "error.h"
+#include "bstrlib.h"
+#include "bstrlib_helper.h"
+#include "fill.h"
+
+/* Increment of the splitmix64 generator, element i uses the state seed + (i + 1) * increment */
+#define FILL_GAMMA 0x9E3779B97F4A7C15ULL
+
+static const char* _fill_names[MAX_STREAM_FILL] = {
+    [STREAM_FILL_CONSTANT] = "constant",
+    [STREAM_FILL_LINEAR] = "linear",
+    [STREAM_FILL_RANDOM] = "random",
+    [STREAM_FILL_PATTERN] = "pattern",
+    [STREAM_FILL_CHASE] = "chase",
+};
+
+static const char* _chase_order_names[MAX_CHASE_ORDER] = {
+    [CHASE_ORDER_RANDOM] = "random",
+    [CHASE_ORDER_PAGE] = "page",
+    [CHASE_ORDER_TLB] = "tlb",
+};
+
+const char* fill_name(StreamFillMode mode)
+{
+    if (mode < STREAM_FILL_CONSTANT || mode >= MAX_STREAM_FILL)
+    {
+        return "unknown";
+    }
+    return _fill_names[mode];
+}
+
+const char* chase_order_name(StreamChaseOrder order)
+{
+    if (order < CHASE_ORDER_RANDOM || order >= MAX_CHASE_ORDER)
+    {
+        return "unknown";
+    }
+    return _chase_order_names[order];
+}
+
+int parse_fill(bstring str, StreamFill* fill)
+{
+    struct tagbstring blinear = bsStatic("linear");
+    struct tagbstring brandom = bsStatic("random");
+    struct tagbstring bpattern = bsStatic("pattern");
+    struct tagbstring bchase = bsStatic("chase");
+    int err = 0;
+    if ((!str) || (!fill))
+    {
+        return -EINVAL;
+    }
+    StreamFill f;
+    bstring bstr = bstrcpy(str);
+    btrimws(bstr);
+    struct bstrList* parts = bsplit(bstr, ':');
+    bdestroy(bstr);
+    memset(&f, 0, sizeof(StreamFill));
+    if (biseqcaseless(parts->entry[0], &blinear) == 1 && parts->qty <= 3)
+    {
+        f.mode = STREAM_FILL_LINEAR;
+        f.step = 1.0;
+        if (parts->qty > 1 && batod(parts->entry[1], &f.start) != BSTR_OK)
+        {
+            err = -EINVAL;
+        }
+        if (parts->qty > 2 && batod(parts->entry[2], &f.step) != BSTR_OK)
+        {
+            err = -EINVAL;
+        }
+    }
+    else if (biseqcaseless(parts->entry[0], &brandom) == 1 && parts->qty <= 2)
+    {
+        int64_t seed = 0;
+        f.mode = STREAM_FILL_RANDOM;
+        if (parts->qty > 1)
+        {
+            err = (batoi64(parts->entry[1], &seed) == BSTR_OK ? 0 : -EINVAL);
+        }
+        f.seed = (uint64_t)seed;
+    }
+    else if (biseqcaseless(parts->entry[0], &bpattern) == 1 && parts->qty > 1 && parts->qty <= STREAM_FILL_MAX_PATTERN + 1)
+    {
+        f.mode = STREAM_FILL_PATTERN;
+        for (int i = 1; i < parts->qty && err == 0; i++)
+        {
+            if (batod(parts->entry[i], &f.pattern[f.num_pattern++]) != BSTR_OK)
+            {
+                err = -EINVAL;
+            }
+        }
+    }
+    else if (biseqcaseless(parts->entry[0], &bchase) == 1 && parts->qty <= 3)
+    {
+        int64_t seed = 0;
+        f.mode = STREAM_FILL_CHASE;
+        f.order = CHASE_ORDER_RANDOM;
+        if (parts->qty > 1)
+        {
+            err = -EINVAL;
+            for (int o = CHASE_ORDER_RANDOM; o < MAX_CHASE_ORDER; o++)
+            {
+                if (biseqcstrcaseless(parts->entry[1], _chase_order_names[o]) == 1)
+                {
+                    f.order = (StreamChaseOrder)o;
+                    err = 0;
+                }
+            }
+        }
+        if (parts->qty > 2 && err == 0)
+        {
+            err = (batoi64(parts->entry[2], &seed) == BSTR_OK ? 0 : -EINVAL);
+        }
+        f.seed = (uint64_t)seed;
+    }
+    else
+    {
+        err = -ENOENT;
+    }
+    if (err == 0)
+    {
+        *fill = f;
+    }
+    bstrListDestroy(parts);
+    return err;
+}
+
+static inline uint64_t _fill_mix(uint64_t z)
+{
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/*
+ * Value of element idx for a type. Random numbers take the upper bits of the generator:
+ * 53 (double) or 24 (single) bits for [0, 1), 31 or 63 bits for non-negative integers.
+ */
+#define DEFINE_FILL_VALUE(name, datatype, member, RANDOM) \
+    static inline datatype _fill_value_##name(size_t idx, const StreamFill* fill) \
+    { \
+        uint64_t z = 0; \
+        switch (fill->mode) \
+        { \
+            case STREAM_FILL_LINEAR: \
+                return (datatype)fill->start + (datatype)idx * (datatype)fill->step; \
+            case STREAM_FILL_RANDOM: \
+                z = _fill_mix(fill->seed + (idx + 1) * FILL_GAMMA); \
+                return (datatype)RANDOM(z); \
+            case STREAM_FILL_PATTERN: \
+                return (datatype)fill->pattern[idx % fill->num_pattern]; \
+            default: \
+                return fill->value.member; \
+        } \
+    }
+
+/*
+ * Filling with vector stores of FILL_VECTOR_BYTES. The compiler maps the generic vectors to
+ * the available SIMD registers. The head up to the vector alignment and the tail are scalar,
+ * the vector part computes the same values for all lanes at once.
+ */
+#define DEFINE_FILL_VECTOR(name, datatype, member, RANDOM) \
+    typedef datatype name##_vec __attribute__((vector_size(FILL_VECTOR_BYTES))); \
+    typedef uint64_t name##_ivec __attribute__((vector_size(FILL_VECTOR_BYTES / sizeof(datatype) * sizeof(uint64_t)))); \
+    static void _fill_##name(datatype* ptr, size_t first, size_t count, const StreamFill* fill) \
+    { \
+        const size_t lanes = FILL_VECTOR_BYTES / sizeof(datatype); \
+        name##_ivec lane; \
+        name##_vec v; \
+        size_t i = 0; \
+        for (size_t l = 0; l < lanes; l++) \
+        { \
+            lane[l] = l; \
+        } \
+        for (; i < count && ((uintptr_t)(ptr + i) % FILL_VECTOR_BYTES) != 0; i++) \
+        { \
+            ptr[i] = _fill_value_##name(first + i, fill); \
+        } \
+        switch (fill->mode) \
+        { \
+            case STREAM_FILL_CONSTANT: \
+                v = (name##_vec){} + fill->value.member; \
+                for (; i + lanes <= count; i += lanes) \
+                { \
+                    *(name##_vec*)(ptr + i) = v; \
+                } \
+                break; \
+            case STREAM_FILL_LINEAR: \
+                for (; i + lanes <= count; i += lanes) \
+                { \
+                    name##_ivec idx = lane + (uint64_t)(first + i); \
+                    *(name##_vec*)(ptr + i) = (datatype)fill->start + __builtin_convertvector(idx, name##_vec) * (datatype)fill->step; \
+                } \
+                break; \
+            case STREAM_FILL_RANDOM: \
+                for (; i + lanes <= count; i += lanes) \
+                { \
+                    name##_ivec z = fill->seed + (lane + (uint64_t)(first + i + 1)) * FILL_GAMMA; \
+                    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL; \
+                    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL; \
+                    z = z ^ (z >> 31); \
+                    *(name##_vec*)(ptr + i) = RANDOM(z, name##_vec); \
+                } \
+                break; \
+            case STREAM_FILL_PATTERN: \
+                /* If the pattern repeats within a vector, all vectors are the same */ \
+                if (lanes % fill->num_pattern == 0) \
+                { \
+                    for (size_t l = 0; l < lanes; l++) \
+                    { \
+                        v[l] = _fill_value_##name(first + i + l, fill); \
+                    } \
+                    for (; i + lanes <= count; i += lanes) \
+                    { \
+                        *(name##_vec*)(ptr + i) = v; \
+                    } \
+                } \
+                break; \
+            default: \
+                break; \
+        } \
+        for (; i < count; i++) \
+        { \
+            ptr[i] = _fill_value_##name(first + i, fill); \
+        } \
+    }
+
+#define RANDOM_DOUBLE(z) ((double)((z) >> 11) * 0x1.0p-53)
+#define RANDOM_SINGLE(z) ((float)((z) >> 40) * 0x1.0p-24f)
+#define RANDOM_INT(z) ((int)((z) >> 33))
+#define RANDOM_INT64(z) ((int64_t)((z) >> 1))
+
+DEFINE_FILL_VALUE(double, double, dval, RANDOM_DOUBLE)
+DEFINE_FILL_VALUE(float, float, fval, RANDOM_SINGLE)
+DEFINE_FILL_VALUE(int, int, ival, RANDOM_INT)
+DEFINE_FILL_VALUE(int64, int64_t, i64val, RANDOM_INT64)
+#ifdef WITH_HALF_PRECISION
+DEFINE_FILL_VALUE(half, _Float16, f16val, RANDOM_SINGLE)
+#endif
+
+#define RANDOM_VEC_DOUBLE(z, vec) (__builtin_convertvector((z) >> 11, vec) * 0x1.0p-53)
+#define RANDOM_VEC_SINGLE(z, vec) (__builtin_convertvector((z) >> 40, vec) * 0x1.0p-24f)
+#define RANDOM_VEC_INT(z, vec) (__builtin_convertvector((z) >> 33, vec))
+#define RANDOM_VEC_INT64(z, vec) (__builtin_convertvector((z) >> 1, vec))
+
+DEFINE_FILL_VECTOR(double, double, dval, RANDOM_VEC_DOUBLE)
+DEFINE_FILL_VECTOR(float, float, fval, RANDOM_VEC_SINGLE)
+DEFINE_FILL_VECTOR(int, int, ival, RANDOM_VEC_INT)
+DEFINE_FILL_VECTOR(int64, int64_t, i64val, RANDOM_VEC_INT64)
+
+/* Random index in [0, bound) from the splitmix64 stream of the chase generator */
+static inline size_t _chase_random(uint64_t seed, uint64_t* counter, size_t bound)
+{
+    (*counter)++;
+    return (size_t)(_fill_mix(seed + *counter * FILL_GAMMA) % bound);
+}
+
+static void _chase_shuffle(size_t* list, size_t len, uint64_t seed, uint64_t* counter)
+{
+    for (size_t i = len; i > 1; i--)
+    {
+        size_t j = _chase_random(seed, counter, i);
+        size_t tmp = list[i - 1];
+        list[i - 1] = list[j];
+        list[j] = tmp;
+    }
+}
+
+/* The first four bits of the van der Corput sequence, vdc(j) = _chase_bitrev(j) / 16 */
+static inline size_t _chase_bitrev(size_t j)
+{
+    return ((j & 1) << 3) | ((j & 2) << 1) | ((j & 4) >> 1) | ((j & 8) >> 3);
+}
+
+int fill_chase(int64_t* ptr, size_t count, StreamChaseOrder order, uint64_t seed)
+{
+    const size_t node_elems = CHASE_NODE_BYTES / sizeof(int64_t);
+    const size_t page_nodes = CHASE_PAGE_BYTES / CHASE_NODE_BYTES;
+    size_t n = count / node_elems;
+    uint64_t counter = 0;
+    size_t len = 0;
+    if ((!ptr) || order < CHASE_ORDER_RANDOM || order >= MAX_CHASE_ORDER)
+    {
+        return -EINVAL;
+    }
+    memset(ptr, 0, count * sizeof(int64_t));
+    if (n < 2)
+    {
+        return 0;
+    }
+    size_t num_pages = (n + page_nodes - 1) / page_nodes;
+    size_t* seq = malloc(n * sizeof(size_t));
+    size_t* pages = malloc(num_pages * sizeof(size_t));
+    if ((!seq) || (!pages))
+    {
+        free(seq);
+        free(pages);
+        return -ENOMEM;
+    }
+    for (size_t p = 0; p < num_pages; p++)
+    {
+        pages[p] = p;
+    }
+    switch (order)
+    {
+        case CHASE_ORDER_RANDOM:
+            for (size_t i = 0; i < n; i++)
+            {
+                seq[i] = i;
+            }
+            _chase_shuffle(seq, n, seed, &counter);
+            break;
+        case CHASE_ORDER_PAGE:
+            _chase_shuffle(pages, num_pages, seed, &counter);
+            for (size_t p = 0; p < num_pages; p++)
+            {
+                size_t begin = len;
+                for (size_t l = 0; l < page_nodes && pages[p] * page_nodes + l < n; l++)
+                {
+                    seq[len++] = pages[p] * page_nodes + l;
+                }
+                _chase_shuffle(&seq[begin], len - begin, seed, &counter);
+            }
+            break;
+        case CHASE_ORDER_TLB:
+            for (size_t l = 0; l < page_nodes; l++)
+            {
+                _chase_shuffle(pages, num_pages, seed, &counter);
+                for (size_t p = 0; p < num_pages; p++)
+                {
+                    if (pages[p] * page_nodes + l < n)
+                    {
+                        seq[len++] = pages[p] * page_nodes + l;
+                    }
+                }
+            }
+            break;
+        default:
+            break;
+    }
+    free(pages);
+
+    /* Chain starts: a power of two of nodes, so their positions are distinct */
+    size_t pos[CHASE_MAX_CHAINS];
+    size_t m = 1;
+    while (m * 2 <= n && m * 2 <= CHASE_MAX_CHAINS)
+    {
+        m *= 2;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        if (seq[i] < m)
+        {
+            pos[seq[i]] = i;
+        }
+    }
+    for (size_t j = 0; j < m; j++)
+    {
+        size_t target = n * _chase_bitrev(j) / CHASE_MAX_CHAINS;
+        size_t moved = seq[target];
+        seq[target] = j;
+        seq[pos[j]] = moved;
+        if (moved < m)
+        {
+            pos[moved] = pos[j];
+        }
+        pos[j] = target;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        ptr[seq[i] * node_elems] = (int64_t)(seq[(i + 1) % n] * CHASE_NODE_BYTES);
+    }
+    free(seq);
+    return 0;
+}
+
+int fill_stream(void* ptr, TestConfigStreamType type, size_t first, size_t count, const StreamFill* fill)
+{
+    if ((!ptr) || (!fill) || fill->mode < STREAM_FILL_CONSTANT || fill->mode >= MAX_STREAM_FILL)
+    {
+        return -EINVAL;
+    }
+    if (fill->mode == STREAM_FILL_PATTERN && (fill->num_pattern <= 0 || fill->num_pattern > STREAM_FILL_MAX_PATTERN))
+    {
+        return -EINVAL;
+    }
+    if (fill->mode == STREAM_FILL_CHASE)
+    {
+        /* The offsets are relative to ptr, every filled range is a cycle of its own */
+        if (type != TEST_STREAM_TYPE_INT64)
+        {
+            return -EINVAL;
+        }
+        return fill_chase((int64_t*)ptr, count, fill->order, fill->seed + first);
+    }
+    switch (type)
+    {
+        case TEST_STREAM_TYPE_DOUBLE:
+            _fill_double((double*)ptr, first, count, fill);
+            break;
+        case TEST_STREAM_TYPE_SINGLE:
+            _fill_float((float*)ptr, first, count, fill);
+            break;
+        case TEST_STREAM_TYPE_INT:
+            _fill_int((int*)ptr, first, count, fill);
+            break;
+        case TEST_STREAM_TYPE_INT64:
+            _fill_int64((int64_t*)ptr, first, count, fill);
+            break;
+#ifdef WITH_HALF_PRECISION
+        case TEST_STREAM_TYPE_HALF:
+            for (size_t i = 0; i < count; i++)
+            {
+                ((_Float16*)ptr)[i] = _fill_value_half(first + i, fill);
+            }
+            break;
+#endif
+        default:
+            return -EINVAL;
+    }
+    return 0;
+}
@@ -0,0 +1,542 @@
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "formula.h"
+#include "bstrlib.h"
+#include "bstrlib_helper.h"
+#include "error.h"
+
+typedef enum {
+    FORMULA_FUNC_ABS = 0,
+    FORMULA_FUNC_FLOOR,
+    FORMULA_FUNC_CEIL,
+    FORMULA_FUNC_SIN,
+    FORMULA_FUNC_COS,
+    FORMULA_FUNC_TAN,
+    FORMULA_FUNC_ASIN,
+    FORMULA_FUNC_ACOS,
+    FORMULA_FUNC_ATAN,
+    FORMULA_FUNC_SQRT,
+    FORMULA_FUNC_CBRT,
+    FORMULA_FUNC_LOG,
+    FORMULA_FUNC_EXP,
+    FORMULA_FUNC_MIN,
+    FORMULA_FUNC_MAX,
+    FORMULA_FUNC_SUM,
+    FORMULA_FUNC_MEAN,
+    FORMULA_FUNC_MEDIAN,
+    FORMULA_FUNC_VAR,
+} FormulaFunction;
+
+/* The functions of the calculator, the ones after min take any number of arguments */
+static const struct {
+    const char* name;
+    FormulaFunction func;
+} _formula_funcs[] = {
+    {"abs", FORMULA_FUNC_ABS},
+    {"floor", FORMULA_FUNC_FLOOR},
+    {"ceil", FORMULA_FUNC_CEIL},
+    {"sin", FORMULA_FUNC_SIN},
+    {"cos", FORMULA_FUNC_COS},
+    {"tan", FORMULA_FUNC_TAN},
+    {"asin", FORMULA_FUNC_ASIN},
+    {"arcsin", FORMULA_FUNC_ASIN},
+    {"acos", FORMULA_FUNC_ACOS},
+    {"arccos", FORMULA_FUNC_ACOS},
+    {"atan", FORMULA_FUNC_ATAN},
+    {"arctan", FORMULA_FUNC_ATAN},
+    {"sqrt", FORMULA_FUNC_SQRT},
+    {"cbrt", FORMULA_FUNC_CBRT},
+    {"log", FORMULA_FUNC_LOG},
+    {"exp", FORMULA_FUNC_EXP},
+    {"min", FORMULA_FUNC_MIN},
+    {"max", FORMULA_FUNC_MAX},
+    {"sum", FORMULA_FUNC_SUM},
+    {"avg", FORMULA_FUNC_MEAN},
+    {"mean", FORMULA_FUNC_MEAN},
+    {"median", FORMULA_FUNC_MEDIAN},
+    {"var", FORMULA_FUNC_VAR},
+};
+static const int _formula_num_funcs = sizeof(_formula_funcs) / sizeof(_formula_funcs[0]);
+
+typedef struct {
+    const char* expr;
+    int len;
+    int pos;
+    struct bstrList* names;
+    Formula* formula;
+    int max_ops;
+    int depth;
+    int err;
+} FormulaParser;
+
+static int _word_char(char c)
+{
+    return (isalnum((unsigned char)c) || c == '_');
+}
+
+static void _skip_spaces(FormulaParser* p)
+{
+    while (p->pos < p->len && isspace((unsigned char)p->expr[p->pos]))
+    {
+        p->pos++;
+    }
+}
+
+static void _parse_error(FormulaParser* p, const char* msg)
+{
+    if (p->err == 0)
+    {
+        p->err = -EINVAL;
+        errno = EINVAL;
+        ERROR_PRINT("%s at position %d in formula '%s'", msg, p->pos, p->expr);
+    }
+}
+
+static void _emit(FormulaParser* p, FormulaOpcode op, int arg, int count, double value)
+{
+    Formula* f = p->formula;
+    if (p->err != 0)
+    {
+        return;
+    }
+    if (f->num_ops == p->max_ops)
+    {
+        int max_ops = (p->max_ops > 0 ? 2 * p->max_ops : 16);
+        FormulaOp* tmp = realloc(f->ops, max_ops * sizeof(FormulaOp));
+        if (!tmp)
+        {
+            p->err = -ENOMEM;
+            return;
+        }
+        f->ops = tmp;
+        p->max_ops = max_ops;
+    }
+    FormulaOp* o = &f->ops[f->num_ops++];
+    o->op = op;
+    o->arg = arg;
+    o->count = count;
+    o->value = value;
+    switch (op)
+    {
+        case FORMULA_OP_CONST:
+        case FORMULA_OP_SLOT:
+            p->depth++;
+            break;
+        case FORMULA_OP_NEG:
+            break;
+        case FORMULA_OP_FUNC:
+            p->depth -= count - 1;
+            break;
+        default:
+            p->depth--;
+            break;
+    }
+    if (p->depth > f->depth)
+    {
+        f->depth = p->depth;
+    }
+}
+
+/* Slot of the longest name at the current position that is not part of a longer word */
+static int _match_name(FormulaParser* p)
+{
+    int slot = -1;
+    int length = 0;
+    const char* cur = p->expr + p->pos;
+    for (int i = 0; p->names && i < p->names->qty; i++)
+    {
+        bstring name = p->names->entry[i];
+        int l = blength(name);
+        if (l <= length || l > p->len - p->pos || strncmp(cur, bdata(name), l) != 0)
+        {
+            continue;
+        }
+        if (p->pos > 0 && _word_char(p->expr[p->pos - 1]) && _word_char(bchar(name, 0)))
+        {
+            continue;
+        }
+        if (p->pos + l < p->len && _word_char(p->expr[p->pos + l]) && _word_char(bchar(name, l - 1)))
+        {
+            continue;
+        }
+        slot = i;
+        length = l;
+    }
+    p->pos += length;
+    return slot;
+}
+
+static void _parse_expr(FormulaParser* p);
+
+static void _parse_call(FormulaParser* p, FormulaFunction func)
+{
+    int count = 0;
+    p->pos++;
+    _skip_spaces(p);
+    if (p->pos < p->len && p->expr[p->pos] == ')')
+    {
+        _parse_error(p, "Function input missing");
+        return;
+    }
+    while (p->err == 0)
+    {
+        _parse_expr(p);
+        count++;
+        _skip_spaces(p);
+        if (p->pos < p->len && p->expr[p->pos] == ',')
+        {
+            p->pos++;
+            continue;
+        }
+        if (p->pos < p->len && p->expr[p->pos] == ')')
+        {
+            p->pos++;
+            break;
+        }
+        _parse_error(p, "Missing ')'");
+    }
+    if (p->err != 0)
+    {
+        return;
+    }
+    if (func < FORMULA_FUNC_MIN && count != 1)
+    {
+        _parse_error(p, "Function takes one argument");
+    }
+    else if (count > FORMULA_MAX_ARGS)
+    {
+        _parse_error(p, "Too many function arguments");
+    }
+    _emit(p, FORMULA_OP_FUNC, func, count, 0.0);
+}
+
+static void _parse_primary(FormulaParser* p)
+{
+    _skip_spaces(p);
+    if (p->pos >= p->len)
+    {
+        _parse_error(p, "Operand missing");
+        return;
+    }
+    int slot = _match_name(p);
+    if (slot >= 0)
+    {
+        _emit(p, FORMULA_OP_SLOT, slot, 0, 0.0);
+        return;
+    }
+    char c = p->expr[p->pos];
+    if (isdigit((unsigned char)c) || c == '.')
+    {
+        char* end = NULL;
+        double value = strtod(p->expr + p->pos, &end);
+        if (end == p->expr + p->pos)
+        {
+            _parse_error(p, "Invalid number");
+            return;
+        }
+        p->pos = (int)(end - p->expr);
+        _emit(p, FORMULA_OP_CONST, 0, 0, value);
+        return;
+    }
+    if (c == '(')
+    {
+        p->pos++;
+        _parse_expr(p);
+        _skip_spaces(p);
+        if (p->pos >= p->len || p->expr[p->pos] != ')')
+        {
+            _parse_error(p, "Missing ')'");
+            return;
+        }
+        p->pos++;
+        return;
+    }
+    if (!_word_char(c))
+    {
+        _parse_error(p, "Unexpected character");
+        return;
+    }
+    int start = p->pos;
+    while (p->pos < p->len && _word_char(p->expr[p->pos]))
+    {
+        p->pos++;
+    }
+    int l = p->pos - start;
+    const char* word = p->expr + start;
+    _skip_spaces(p);
+    if (p->pos < p->len && p->expr[p->pos] == '(')
+    {
+        for (int i = 0; i < _formula_num_funcs; i++)
+        {
+            if ((int)strlen(_formula_funcs[i].name) == l && strncmp(word, _formula_funcs[i].name, l) == 0)
+            {
+                _parse_call(p, _formula_funcs[i].func);
+                return;
+            }
+        }
+    }
+    else if (l == 3 && strncmp(word, "nan", 3) == 0)
+    {
+        _emit(p, FORMULA_OP_CONST, 0, 0, NAN);
+        return;
+    }
+    else if (l == 3 && strncmp(word, "inf", 3) == 0)
+    {
+        _emit(p, FORMULA_OP_CONST, 0, 0, INFINITY);
+        return;
+    }
+    p->pos = start;
+    _parse_error(p, "Unknown name");
+}
+
+static void _parse_unary(FormulaParser* p)
+{
+    _skip_spaces(p);
+    if (p->pos < p->len && p->expr[p->pos] == '-')
+    {
+        p->pos++;
+        _parse_unary(p);
+        _emit(p, FORMULA_OP_NEG, 0, 0, 0.0);
+        return;
+    }
+    _parse_primary(p);
+}
+
+/* The power is right associative like in the calculator, -2^2 is 4 */
+static void _parse_power(FormulaParser* p)
+{
+    _parse_unary(p);
+    _skip_spaces(p);
+    if (p->err == 0 && p->pos < p->len && p->expr[p->pos] == '^')
+    {
+        p->pos++;
+        _parse_power(p);
+        _emit(p, FORMULA_OP_POW, 0, 0, 0.0);
+    }
+}
+
+static void _parse_term(FormulaParser* p)
+{
+    _parse_power(p);
+    _skip_spaces(p);
+    while (p->err == 0 && p->pos < p->len && strchr("*/%", p->expr[p->pos]))
+    {
+        char c = p->expr[p->pos++];
+        _parse_power(p);
+        _emit(p, (c == '*' ? FORMULA_OP_MUL : (c == '/' ? FORMULA_OP_DIV : FORMULA_OP_MOD)), 0, 0, 0.0);
+        _skip_spaces(p);
+    }
+}
+
+static void _parse_expr(FormulaParser* p)
+{
+    _parse_term(p);
+    _skip_spaces(p);
+    while (p->err == 0 && p->pos < p->len && (p->expr[p->pos] == '+' || p->expr[p->pos] == '-'))
+    {
+        char c = p->expr[p->pos++];
+        _parse_term(p);
+        _emit(p, (c == '+' ? FORMULA_OP_ADD : FORMULA_OP_SUB), 0, 0, 0.0);
+        _skip_spaces(p);
+    }
+}
+
+int formula_compile(const_bstring expr, struct bstrList* names, Formula* formula)
+{
+    if ((!expr) || (!formula))
+    {
+        return -EINVAL;
+    }
+    memset(formula, 0, sizeof(Formula));
+    FormulaParser p = {
+        .expr = (const char*)expr->data,
+        .len = blength(expr),
+        .pos = 0,
+        .names = names,
+        .formula = formula,
+        .max_ops = 0,
+        .depth = 0,
+        .err = 0,
+    };
+    if (p.len == 0 || !p.expr)
+    {
+        return -EINVAL;
+    }
+    _parse_expr(&p);
+    _skip_spaces(&p);
+    if (p.err == 0 && p.pos < p.len)
+    {
+        _parse_error(&p, p.expr[p.pos] == ')' ? "Unbalanced ')'" : "Unexpected character");
+    }
+    if (p.err != 0)
+    {
+        formula_free(formula);
+        return p.err;
+    }
+    return 0;
+}
+
+static int _compare_doubles(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double _call(FormulaFunction func, double* args, int count)
+{
+    double result = args[0];
+    switch (func)
+    {
+        case FORMULA_FUNC_ABS:
+            return fabs(result);
+        case FORMULA_FUNC_FLOOR:
+            return floor(result);
+        case FORMULA_FUNC_CEIL:
+            return ceil(result);
+        case FORMULA_FUNC_SIN:
+            return sin(result);
+        case FORMULA_FUNC_COS:
+            return cos(result);
+        case FORMULA_FUNC_TAN:
+            return tan(result);
+        case FORMULA_FUNC_ASIN:
+            return asin(result);
+        case FORMULA_FUNC_ACOS:
+            return acos(result);
+        case FORMULA_FUNC_ATAN:
+            return atan(result);
+        case FORMULA_FUNC_SQRT:
+            return sqrt(result);
+        case FORMULA_FUNC_CBRT:
+            return cbrt(result);
+        case FORMULA_FUNC_LOG:
+            return log(result);
+        case FORMULA_FUNC_EXP:
+            return exp(result);
+        case FORMULA_FUNC_MIN:
+            for (int i = 1; i < count; i++)
+            {
+                if (args[i] < result) result = args[i];
+            }
+            return result;
+        case FORMULA_FUNC_MAX:
+            for (int i = 1; i < count; i++)
+            {
+                if (args[i] > result) result = args[i];
+            }
+            return result;
+        case FORMULA_FUNC_SUM:
+        case FORMULA_FUNC_MEAN:
+            for (int i = 1; i < count; i++)
+            {
+                result += args[i];
+            }
+            return (func == FORMULA_FUNC_MEAN ? result / count : result);
+        case FORMULA_FUNC_MEDIAN:
+            /* The lower one of the two middle values for an even count like the calculator */
+            qsort(args, count, sizeof(double), _compare_doubles);
+            return args[(count + 1) / 2 - 1];
+        case FORMULA_FUNC_VAR:
+        {
+            double mean = 0.0;
+            double var = 0.0;
+            for (int i = 0; i < count; i++)
+            {
+                mean += args[i];
+            }
+            mean /= count;
+            for (int i = 0; i < count; i++)
+            {
+                var += (args[i] - mean) * (args[i] - mean);
+            }
+            return var / count;
+        }
+    }
+    return NAN;
+}
+
+int formula_eval(const Formula* formula, const double* slots, double* result)
+{
+    if ((!formula) || (!formula->ops) || (!result))
+    {
+        return -EINVAL;
+    }
+    int err = 0;
+    int top = 0;
+    double stack[formula->depth];
+    for (int i = 0; i < formula->num_ops; i++)
+    {
+        const FormulaOp* o = &formula->ops[i];
+        double l = 0.0;
+        double r = 0.0;
+        if (o->op >= FORMULA_OP_ADD && o->op <= FORMULA_OP_POW)
+        {
+            r = stack[--top];
+            l = stack[top - 1];
+        }
+        switch (o->op)
+        {
+            case FORMULA_OP_CONST:
+                stack[top++] = o->value;
+                break;
+            case FORMULA_OP_SLOT:
+                stack[top++] = (slots ? slots[o->arg] : NAN);
+                break;
+            case FORMULA_OP_NEG:
+                stack[top - 1] = -stack[top - 1];
+                break;
+            case FORMULA_OP_ADD:
+                stack[top - 1] = l + r;
+                break;
+            case FORMULA_OP_SUB:
+                stack[top - 1] = l - r;
+                break;
+            case FORMULA_OP_MUL:
+                stack[top - 1] = l * r;
+                break;
+            case FORMULA_OP_DIV:
+            case FORMULA_OP_MOD:
+                if (r == 0.0)
+                {
+                    stack[top - 1] = (l == 0.0 ? NAN : INFINITY);
+                    err = -EFAULT;
+                }
+                else if (o->op == FORMULA_OP_DIV)
+                {
+                    stack[top - 1] = l / r;
+                }
+                else
+                {
+                    stack[top - 1] = l - trunc(l / r) * r;
+                }
+                break;
+            case FORMULA_OP_POW:
+                stack[top - 1] = pow(l, r);
+                break;
+            case FORMULA_OP_FUNC:
+                top -= o->count;
+                stack[top] = _call((FormulaFunction)o->arg, &stack[top], o->count);
+                top++;
+                break;
+        }
+    }
+    *result = stack[0];
+    return err;
+}
+
+void formula_free(Formula* formula)
+{
+    if (formula)
+    {
+        free(formula->ops);
+        formula->ops = NULL;
+        formula->num_ops = 0;
+        formula->depth = 0;
+    }
+}
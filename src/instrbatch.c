@@ -0,0 +1,201 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "instrbatch.h"
+#include "bstrlib.h"
+#include "bstrlib_helper.h"
+#include "error.h"
+
+/* Splits at c and drops empty entries */
+static struct bstrList* _split_words(bstring str, char c)
+{
+    struct bstrList* words = bstrListCreate();
+    struct bstrList* tmp = bsplit(str, c);
+    for (int i = 0; i < tmp->qty; i++)
+    {
+        btrimws(tmp->entry[i]);
+        if (blength(tmp->entry[i]) > 0)
+        {
+            bstrListAdd(words, tmp->entry[i]);
+        }
+    }
+    bstrListDestroy(tmp);
+    return words;
+}
+
+static int _parse_form(bstring line, InstrForm* form)
+{
+    int err = 0;
+    bstring ops = NULL;
+    bstring flags = NULL;
+    int bar = bstrchr(line, '|');
+    if (bar != BSTR_ERR)
+    {
+        ops = bmidstr(line, 0, bar);
+        flags = bmidstr(line, bar + 1, blength(line) - bar - 1);
+    }
+    else
+    {
+        ops = bstrcpy(line);
+        flags = bfromcstr("");
+    }
+    btrimws(ops);
+    // Tabs separate like spaces
+    for (int i = 0; i < blength(ops); i++)
+    {
+        if (ops->data[i] == '\t') ops->data[i] = ' ';
+    }
+    int space = bstrchr(ops, ' ');
+    if (space == BSTR_ERR)
+    {
+        space = blength(ops);
+    }
+    bstring operands = bmidstr(ops, space, blength(ops) - space);
+    form->mnemonic = bmidstr(ops, 0, space);
+    form->operands = _split_words(operands, ',');
+    form->flags = _split_words(flags, ' ');
+    form->rmw = 0;
+    for (int i = form->flags->qty - 1; i >= 0; i--)
+    {
+        if (biseqcstr(form->flags->entry[i], INSTRBATCH_RMW_FLAG))
+        {
+            form->rmw = 1;
+            bstrListDel(form->flags, i);
+        }
+    }
+    if (form->operands->qty == 0 || form->operands->qty > INSTRBATCH_MAX_OPERANDS)
+    {
+        err = -EINVAL;
+    }
+    // An empty operand between two commas is a typo
+    struct bstrList* all = bsplit(operands, ',');
+    if (all->qty != form->operands->qty)
+    {
+        err = -EINVAL;
+    }
+    bstrListDestroy(all);
+    bdestroy(operands);
+    bdestroy(ops);
+    bdestroy(flags);
+    return err;
+}
+
+int instrbatch_parse(const_bstring spec, InstrForm** forms, int* errline)
+{
+    if ((!spec) || (!forms))
+    {
+        return -EINVAL;
+    }
+    int num_forms = 0;
+    struct bstrList* lines = bsplit(spec, '\n');
+    InstrForm* f = malloc((lines->qty + 1) * sizeof(InstrForm));
+    if (!f)
+    {
+        bstrListDestroy(lines);
+        return -ENOMEM;
+    }
+    for (int l = 0; l < lines->qty; l++)
+    {
+        btrimws(lines->entry[l]);
+        if (blength(lines->entry[l]) == 0 || bchar(lines->entry[l], 0) == '#')
+        {
+            continue;
+        }
+        int err = _parse_form(lines->entry[l], &f[num_forms]);
+        num_forms++;
+        if (err < 0)
+        {
+            if (errline) *errline = l + 1;
+            instrbatch_free(num_forms, f);
+            bstrListDestroy(lines);
+            return err;
+        }
+    }
+    bstrListDestroy(lines);
+    *forms = f;
+    return num_forms;
+}
+
+void instrbatch_free(int num_forms, InstrForm* forms)
+{
+    if (!forms)
+    {
+        return;
+    }
+    for (int i = 0; i < num_forms; i++)
+    {
+        bdestroy(forms[i].mnemonic);
+        bstrListDestroy(forms[i].operands);
+        bstrListDestroy(forms[i].flags);
+    }
+    free(forms);
+}
+
+int instrbatch_cpu_flags(const_bstring cpuinfo, struct bstrList** flags)
+{
+    struct tagbstring bflags = bsStatic("flags");
+    struct tagbstring bfeatures = bsStatic("Features");
+    if ((!cpuinfo) || (!flags))
+    {
+        return -EINVAL;
+    }
+    int err = -ENOENT;
+    struct bstrList* lines = bsplit(cpuinfo, '\n');
+    for (int l = 0; l < lines->qty && err != 0; l++)
+    {
+        int colon = bstrchr(lines->entry[l], ':');
+        if (colon == BSTR_ERR)
+        {
+            continue;
+        }
+        bstring key = bmidstr(lines->entry[l], 0, colon);
+        btrimws(key);
+        if (biseq(key, &bflags) || biseq(key, &bfeatures))
+        {
+            bstring value = bmidstr(lines->entry[l], colon + 1, blength(lines->entry[l]) - colon - 1);
+            *flags = _split_words(value, ' ');
+            bdestroy(value);
+            err = 0;
+        }
+        bdestroy(key);
+    }
+    bstrListDestroy(lines);
+    return err;
+}
+
+bstring instrbatch_missing_flag(InstrForm* form, struct bstrList* cpuflags)
+{
+    for (int i = 0; i < form->flags->qty; i++)
+    {
+        int found = 0;
+        for (int j = 0; cpuflags && j < cpuflags->qty && !found; j++)
+        {
+            found = biseqcaseless(form->flags->entry[i], cpuflags->entry[j]);
+        }
+        if (!found)
+        {
+            return form->flags->entry[i];
+        }
+    }
+    return NULL;
+}
+
+int instrbatch_dependency(InstrForm* form)
+{
+    for (int i = 1; i < form->operands->qty; i++)
+    {
+        if (biseq(form->operands->entry[0], form->operands->entry[i]))
+        {
+            return i + 1;
+        }
+    }
+    return (form->rmw ? 1 : 0);
+}
+
+bstring instrbatch_operands(InstrForm* form)
+{
+    struct tagbstring bspace = bsStatic(" ");
+    return bjoin(form->operands, &bspace);
+}
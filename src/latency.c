@@ -0,0 +1,213 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bstrlib.h"
+#include "bstrlib_helper.h"
+#include "error.h"
+#include "fill.h"
+#include "latency.h"
+#include "table.h"
+#include "timer.h"
+
+/*
+ * The timestamps around a single load: lfence keeps rdtsc from starting before the previous
+ * access is done, rdtscp waits until the load has completed.
+ */
+#if defined(__x86_64__) || defined(__i386__)
+static inline uint64_t _latency_start(void)
+{
+    uint32_t lo, hi;
+    __asm__ __volatile__("lfence\n\t"
+                         "rdtsc\n\t" : "=a" (lo), "=d" (hi) : : "memory");
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline uint64_t _latency_stop(void)
+{
+    uint32_t lo, hi, aux;
+    __asm__ __volatile__("rdtscp\n\t"
+                         "lfence\n\t" : "=a" (lo), "=d" (hi), "=c" (aux) : : "memory");
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static uint64_t _latency_freq(void)
+{
+    TimerDataLB timer;
+    if (lb_timer_init(TIMER_RDTSC, &timer) != 0)
+    {
+        return 0;
+    }
+    uint64_t freq = timer.ci.freq;
+    lb_timer_close(&timer);
+    return freq;
+}
+#else
+static inline uint64_t _latency_start(void)
+{
+    struct timespec ts;
+    __asm__ __volatile__("" ::: "memory");
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * NANOS_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint64_t _latency_stop(void)
+{
+    uint64_t t = _latency_start();
+    __asm__ __volatile__("" ::: "memory");
+    return t;
+}
+
+static uint64_t _latency_freq(void)
+{
+    return NANOS_PER_SEC;
+}
+#endif
+
+int latency_bucket(double ns)
+{
+    int bucket = 0;
+    double limit = 1.0;
+    while (ns >= limit && bucket < LATENCY_HIST_BUCKETS - 1)
+    {
+        bucket++;
+        limit *= 2.0;
+    }
+    return bucket;
+}
+
+bstring latency_bucket_name(int bucket)
+{
+    if (bucket < 0 || bucket >= LATENCY_HIST_BUCKETS)
+    {
+        return NULL;
+    }
+    if (bucket == 0)
+    {
+        return bfromcstr("<1 ns [%]");
+    }
+    if (bucket == LATENCY_HIST_BUCKETS - 1)
+    {
+        return bformat(">%d ns [%%]", 1 << (bucket - 1));
+    }
+    return bformat("%d-%d ns [%%]", 1 << (bucket - 1), 1 << bucket);
+}
+
+int latency_histogram(const int64_t* ptr, uint64_t samples, uint64_t* hist)
+{
+    if ((!ptr) || (!hist))
+    {
+        return -EINVAL;
+    }
+    uint64_t freq = _latency_freq();
+    if (freq == 0)
+    {
+        return -ENOTSUP;
+    }
+    uint64_t overhead = UINT64_MAX;
+    for (int r = 0; r < LATENCY_OVERHEAD_ROUNDS; r++)
+    {
+        uint64_t t0 = _latency_start();
+        uint64_t t1 = _latency_stop();
+        if (t1 - t0 < overhead)
+        {
+            overhead = t1 - t0;
+        }
+    }
+    int64_t offset = 0;
+    for (uint64_t s = 0; s < samples; s++)
+    {
+        uint64_t t0 = _latency_start();
+        offset = *(volatile const int64_t*)((const char*)ptr + offset);
+        uint64_t t1 = _latency_stop();
+        uint64_t ticks = t1 - t0;
+        ticks = (ticks > overhead ? ticks - overhead : 0);
+        hist[latency_bucket((double)ticks * NANOS_PER_SEC / (double)freq)]++;
+    }
+    return 0;
+}
+
+int latency_thread(RuntimeThreadConfig* thread)
+{
+    if ((!thread) || (!thread->data))
+    {
+        return -EINVAL;
+    }
+    memset(thread->data->latency, 0, sizeof(thread->data->latency));
+    thread->data->latency_samples = 0;
+    for (int s = 0; s < thread->num_streams; s++)
+    {
+        RuntimeStreamConfig* data = &thread->sdata[s];
+        if (data->fill.mode != STREAM_FILL_CHASE || !data->initialization || data->dims != 1)
+        {
+            continue;
+        }
+        int err = latency_histogram(thread->tstreams[s].tstream_ptr, LATENCY_HIST_SAMPLES, thread->data->latency);
+        if (err == 0)
+        {
+            thread->data->latency_samples = LATENCY_HIST_SAMPLES;
+        }
+        return err;
+    }
+    return 0;
+}
+
+static void _add_cell(struct bstrList* row, bstring value)
+{
+    bstrListAdd(row, value);
+    bdestroy(value);
+}
+
+int latency_table(RuntimeConfig* runcfg, Table** table)
+{
+    if ((!runcfg) || (!table))
+    {
+        return -EINVAL;
+    }
+    *table = NULL;
+    int err = 0;
+    for (int w = 0; w < runcfg->num_wgroups && err == 0; w++)
+    {
+        RuntimeWorkgroupConfig* wg = &runcfg->wgroups[w];
+        for (int t = 0; t < wg->num_threads && err == 0; t++)
+        {
+            thread_data_t data = wg->threads[t].data;
+            if ((!data) || data->latency_samples == 0)
+            {
+                continue;
+            }
+            if (!*table)
+            {
+                struct bstrList* bheaders = bstrListCreate();
+                bstrListAddChar(bheaders, "GLOBAL_ID");
+                bstrListAddChar(bheaders, "THREAD_CPU");
+                bstrListAddChar(bheaders, "accesses");
+                for (int b = 0; b < LATENCY_HIST_BUCKETS; b++)
+                {
+                    _add_cell(bheaders, latency_bucket_name(b));
+                }
+                err = table_create(bheaders, table);
+                bstrListDestroy(bheaders);
+                if (err != 0)
+                {
+                    *table = NULL;
+                    break;
+                }
+            }
+            struct bstrList* brow = bstrListCreate();
+            _add_cell(brow, bformat("%d", wg->threads[t].global_id));
+            _add_cell(brow, bformat("%d", data->hwthread));
+            _add_cell(brow, bformat("%" PRIu64, data->latency_samples));
+            for (int b = 0; b < LATENCY_HIST_BUCKETS; b++)
+            {
+                _add_cell(brow, bformat("%.15lf", 100.0 * (double)data->latency[b] / (double)data->latency_samples));
+            }
+            err = table_addrow(*table, brow);
+            bstrListDestroy(brow);
+        }
+    }
+    return err;
+}
@@ -0,0 +1,344 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/vfs.h>
+
+#include "error.h"
+#include "bstrlib.h"
+#include "bstrlib_helper.h"
+#include "pages.h"
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef HUGETLBFS_MAGIC
+#define HUGETLBFS_MAGIC 0x958458f6
+#endif
+
+/* Fallback if the kernel does not report the transparent huge page size */
+#define PAGES_THP_SIZE (2UL * 1024 * 1024)
+
+static const char* _allocation_names[MAX_STREAM_ALLOCATION] = {
+    [STREAM_ALLOCATION_HEAP] = "heap",
+    [STREAM_ALLOCATION_THP] = "thp",
+    [STREAM_ALLOCATION_NOTHP] = "nothp",
+    [STREAM_ALLOCATION_HUGETLB_2M] = "hugetlb2m",
+    [STREAM_ALLOCATION_HUGETLB_1G] = "hugetlb1g",
+    [STREAM_ALLOCATION_HUGETLBFS] = "hugetlbfs",
+};
+
+const char* allocation_name(StreamAllocation allocation)
+{
+    if (allocation < STREAM_ALLOCATION_HEAP || allocation >= MAX_STREAM_ALLOCATION)
+    {
+        return "unknown";
+    }
+    return _allocation_names[allocation];
+}
+
+int parse_allocation(bstring str, StreamAllocation* allocation, bstring path)
+{
+    struct tagbstring bhugetlbfs = bsStatic("hugetlbfs:");
+    if ((!str) || (!allocation))
+    {
+        return -EINVAL;
+    }
+    bstring bstr = bstrcpy(str);
+    btrimws(bstr);
+    int err = -EINVAL;
+    if (bstrnicmp(bstr, &bhugetlbfs, blength(&bhugetlbfs)) == BSTR_OK)
+    {
+        if (blength(bstr) > blength(&bhugetlbfs))
+        {
+            *allocation = STREAM_ALLOCATION_HUGETLBFS;
+            if (path)
+            {
+                bassignmidstr(path, bstr, blength(&bhugetlbfs), blength(bstr));
+            }
+            err = 0;
+        }
+    }
+    else
+    {
+        for (int a = STREAM_ALLOCATION_HEAP; a < MAX_STREAM_ALLOCATION; a++)
+        {
+            if (strcasecmp(bdata(bstr), _allocation_names[a]) == 0)
+            {
+                *allocation = (StreamAllocation)a;
+                if (path)
+                {
+                    btrunc(path, 0);
+                }
+                err = 0;
+                break;
+            }
+        }
+    }
+    bdestroy(bstr);
+    return err;
+}
+
+static size_t _round_up(size_t size, size_t align)
+{
+    return ((size + align - 1) / align) * align;
+}
+
+static size_t _thp_size()
+{
+    size_t size = PAGES_THP_SIZE;
+    FILE* fp = fopen("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", "r");
+    if (fp)
+    {
+        unsigned long long s = 0;
+        if (fscanf(fp, "%llu", &s) == 1 && s > 0)
+        {
+            size = (size_t)s;
+        }
+        fclose(fp);
+    }
+    return size;
+}
+
+/* First hugetlbfs mount point in /proc/mounts */
+static int _find_hugetlbfs(bstring dir)
+{
+    char line[1024];
+    char mnt[512];
+    char fstype[64];
+    int err = -ENOENT;
+    FILE* fp = fopen("/proc/mounts", "r");
+    if (!fp)
+    {
+        return -errno;
+    }
+    while (fgets(line, sizeof(line), fp))
+    {
+        if (sscanf(line, "%*s %511s %63s", mnt, fstype) == 2 && strcmp(fstype, "hugetlbfs") == 0)
+        {
+            bcatcstr(dir, mnt);
+            err = 0;
+            break;
+        }
+    }
+    fclose(fp);
+    return err;
+}
+
+static int _map_hugetlbfs(size_t size, bstring path, void** ptr, size_t* alloc_size)
+{
+    struct statfs fs;
+    int err = 0;
+    bstring dir = bfromcstr("");
+    if (path && blength(path) > 0)
+    {
+        bconcat(dir, path);
+    }
+    else
+    {
+        err = _find_hugetlbfs(dir);
+        if (err != 0)
+        {
+            bdestroy(dir);
+            return err;
+        }
+    }
+    if (statfs(bdata(dir), &fs) != 0)
+    {
+        err = -errno;
+        bdestroy(dir);
+        return err;
+    }
+    if (fs.f_type != HUGETLBFS_MAGIC)
+    {
+        bdestroy(dir);
+        return -EINVAL;
+    }
+    /* The block size of a hugetlbfs mount is its huge page size */
+    size_t len = _round_up(size, (size_t)fs.f_bsize);
+    bstring fname = bformat("%s/likwid-bench-XXXXXX", bdata(dir));
+    bdestroy(dir);
+    int fd = mkstemp(bdata(fname));
+    if (fd < 0)
+    {
+        err = -errno;
+        bdestroy(fname);
+        return err;
+    }
+    DEBUG_PRINT(DEBUGLEV_DEVELOP, "Mapping %zu bytes from %s", len, bdata(fname));
+    /* The file vanishes with the mapping */
+    unlink(bdata(fname));
+    bdestroy(fname);
+    if (ftruncate(fd, len) != 0)
+    {
+        err = -errno;
+        close(fd);
+        return err;
+    }
+    void* p = mmap(NULL, len, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+    {
+        err = -errno;
+        close(fd);
+        return err;
+    }
+    close(fd);
+    *ptr = p;
+    *alloc_size = len;
+    return 0;
+}
+
+/* Anonymous mapping with the start aligned to align, the unaligned head and tail are unmapped */
+static int _map_aligned(size_t len, size_t align, void** ptr)
+{
+    char* p = mmap(NULL, len + align, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+    {
+        return -errno;
+    }
+    char* start = (char*)_round_up((uintptr_t)p, align);
+    if (start > p)
+    {
+        munmap(p, start - p);
+    }
+    if (start + len < p + len + align)
+    {
+        munmap(start + len, (p + len + align) - (start + len));
+    }
+    *ptr = start;
+    return 0;
+}
+
+int alloc_pages(size_t size, StreamAllocation allocation, bstring path, void** ptr, size_t* alloc_size)
+{
+    int err = 0;
+    size_t len = 0;
+    size_t pagesize = (size_t)sysconf(_SC_PAGESIZE);
+    void* p = NULL;
+    if (size == 0 || (!ptr) || (!alloc_size))
+    {
+        return -EINVAL;
+    }
+    switch (allocation)
+    {
+        case STREAM_ALLOCATION_THP:
+            len = _round_up(size, _thp_size());
+            err = _map_aligned(len, _thp_size(), &p);
+            if (err == 0 && madvise(p, len, MADV_HUGEPAGE) != 0)
+            {
+                err = -errno;
+                munmap(p, len);
+            }
+            break;
+        case STREAM_ALLOCATION_NOTHP:
+            len = _round_up(size, pagesize);
+            err = _map_aligned(len, pagesize, &p);
+            if (err == 0 && madvise(p, len, MADV_NOHUGEPAGE) != 0)
+            {
+                err = -errno;
+                munmap(p, len);
+            }
+            break;
+        case STREAM_ALLOCATION_HUGETLB_2M:
+        case STREAM_ALLOCATION_HUGETLB_1G:
+        {
+            int shift = (allocation == STREAM_ALLOCATION_HUGETLB_2M ? 21 : 30);
+            len = _round_up(size, 1UL << shift);
+            /* Fails with ENOMEM if the huge page pool (nr_hugepages) is too small */
+            p = mmap(NULL, len, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB|(shift << MAP_HUGE_SHIFT), -1, 0);
+            if (p == MAP_FAILED)
+            {
+                err = -errno;
+            }
+            break;
+        }
+        case STREAM_ALLOCATION_HUGETLBFS:
+            return _map_hugetlbfs(size, path, ptr, alloc_size);
+        default:
+            return -EINVAL;
+    }
+    if (err != 0)
+    {
+        return err;
+    }
+    DEBUG_PRINT(DEBUGLEV_DEVELOP, "Mapped %zu bytes at %p with %s pages", len, p, allocation_name(allocation));
+    *ptr = p;
+    *alloc_size = len;
+    return 0;
+}
+
+void free_pages(void* ptr, size_t alloc_size)
+{
+    if (ptr && alloc_size > 0)
+    {
+        munmap(ptr, alloc_size);
+    }
+}
+
+int query_pagesize(void* ptr, size_t size, size_t* pagesize)
+{
+    char line[512];
+    uintptr_t start = (uintptr_t)ptr;
+    uintptr_t end = start + size;
+    int in_range = 0;
+    int found = 0;
+    size_t kernel_pagesize = 0;
+    size_t rss = 0;
+    size_t thp = 0;
+    if ((!ptr) || size == 0 || (!pagesize))
+    {
+        return -EINVAL;
+    }
+    FILE* fp = fopen("/proc/self/smaps", "r");
+    if (!fp)
+    {
+        return -errno;
+    }
+    /* The range may span several mappings, e.g. after mbind split the heap mapping */
+    while (fgets(line, sizeof(line), fp))
+    {
+        unsigned long long vstart = 0, vend = 0, value = 0;
+        if (sscanf(line, "%llx-%llx ", &vstart, &vend) == 2)
+        {
+            in_range = ((uintptr_t)vstart < end && (uintptr_t)vend > start);
+            found |= in_range;
+        }
+        else if (!in_range)
+        {
+            continue;
+        }
+        else if (sscanf(line, "KernelPageSize: %llu kB", &value) == 1)
+        {
+            if ((size_t)value * 1024 > kernel_pagesize)
+            {
+                kernel_pagesize = (size_t)value * 1024;
+            }
+        }
+        else if (sscanf(line, "Rss: %llu kB", &value) == 1)
+        {
+            rss += (size_t)value * 1024;
+        }
+        else if (sscanf(line, "AnonHugePages: %llu kB", &value) == 1)
+        {
+            thp += (size_t)value * 1024;
+        }
+    }
+    fclose(fp);
+    if (!found)
+    {
+        return -ENOENT;
+    }
+    *pagesize = kernel_pagesize;
+    if (thp > 0 && 2 * thp >= rss && _thp_size() > kernel_pagesize)
+    {
+        *pagesize = _thp_size();
+    }
+    return 0;
+}
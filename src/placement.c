@@ -0,0 +1,212 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+
+#include "error.h"
+#include "bstrlib.h"
+#include "bstrlib_helper.h"
+#include "placement.h"
+
+#define PLACEMENT_MASK_BITS (8 * sizeof(unsigned long))
+#define PLACEMENT_MASK_LENGTH (PLACEMENT_MAX_NODES / PLACEMENT_MASK_BITS)
+/* Pages per move_pages call when counting the pages per node */
+#define PLACEMENT_QUERY_CHUNK 4096
+
+static const char* _placement_names[MAX_STREAM_PLACEMENT] = {
+    [STREAM_PLACEMENT_DEFAULT] = "default",
+    [STREAM_PLACEMENT_LOCAL] = "local",
+    [STREAM_PLACEMENT_INTERLEAVE] = "interleave",
+    [STREAM_PLACEMENT_BIND] = "bind",
+    [STREAM_PLACEMENT_FIRSTTOUCH] = "firsttouch",
+};
+
+const char* placement_name(StreamPlacement placement)
+{
+    if (placement < STREAM_PLACEMENT_DEFAULT || placement >= MAX_STREAM_PLACEMENT)
+    {
+        return "unknown";
+    }
+    return _placement_names[placement];
+}
+
+int parse_placement(bstring str, StreamPlacement* placement, int* node)
+{
+    struct tagbstring bbind = bsStatic("bind:");
+    if ((!str) || (!placement) || (!node))
+    {
+        return -EINVAL;
+    }
+    bstring bstr = bstrcpy(str);
+    btrimws(bstr);
+    int err = -EINVAL;
+    if (bstrnicmp(bstr, &bbind, blength(&bbind)) == BSTR_OK)
+    {
+        char* end = NULL;
+        const char* cnode = bdata(bstr) + blength(&bbind);
+        long n = strtol(cnode, &end, 10);
+        if (end != cnode && *end == '\0' && n >= 0 && n < PLACEMENT_MAX_NODES)
+        {
+            *placement = STREAM_PLACEMENT_BIND;
+            *node = (int)n;
+            err = 0;
+        }
+    }
+    else
+    {
+        for (int p = STREAM_PLACEMENT_DEFAULT; p < MAX_STREAM_PLACEMENT; p++)
+        {
+            if (p != STREAM_PLACEMENT_BIND && strcasecmp(bdata(bstr), _placement_names[p]) == 0)
+            {
+                *placement = (StreamPlacement)p;
+                *node = -1;
+                err = 0;
+                break;
+            }
+        }
+    }
+    bdestroy(bstr);
+    return err;
+}
+
+int placement_max_node()
+{
+    int max_node = 0;
+    FILE* fp = fopen("/sys/devices/system/node/possible", "r");
+    if (fp)
+    {
+        char buf[256];
+        if (fgets(buf, sizeof(buf), fp))
+        {
+            /* The list looks like '0' or '0-3' or '0,2-3', the last number is the highest ID */
+            char* last = buf;
+            for (char* c = buf; *c != '\0'; c++)
+            {
+                if (*c == '-' || *c == ',')
+                {
+                    last = c + 1;
+                }
+            }
+            max_node = atoi(last);
+        }
+        fclose(fp);
+    }
+    if (max_node < 0 || max_node >= PLACEMENT_MAX_NODES)
+    {
+        max_node = PLACEMENT_MAX_NODES - 1;
+    }
+    return max_node;
+}
+
+int apply_placement(void* ptr, size_t size, StreamPlacement placement, int node, const int* nodes, int num_nodes)
+{
+    unsigned long mask[PLACEMENT_MASK_LENGTH];
+    int mode = MPOL_DEFAULT;
+    if ((!ptr) || size == 0)
+    {
+        return -EINVAL;
+    }
+    memset(mask, 0, sizeof(mask));
+    switch (placement)
+    {
+        case STREAM_PLACEMENT_DEFAULT:
+        case STREAM_PLACEMENT_FIRSTTOUCH:
+            return 0;
+        case STREAM_PLACEMENT_BIND:
+            if (node < 0 || node >= PLACEMENT_MAX_NODES)
+            {
+                return -EINVAL;
+            }
+            mode = MPOL_BIND;
+            mask[node / PLACEMENT_MASK_BITS] |= (1UL << (node % PLACEMENT_MASK_BITS));
+            break;
+        case STREAM_PLACEMENT_LOCAL:
+        case STREAM_PLACEMENT_INTERLEAVE:
+            if ((!nodes) || num_nodes <= 0)
+            {
+                return -EINVAL;
+            }
+            mode = (placement == STREAM_PLACEMENT_LOCAL ? MPOL_BIND : MPOL_INTERLEAVE);
+            for (int i = 0; i < num_nodes; i++)
+            {
+                if (nodes[i] < 0 || nodes[i] >= PLACEMENT_MAX_NODES)
+                {
+                    return -EINVAL;
+                }
+                mask[nodes[i] / PLACEMENT_MASK_BITS] |= (1UL << (nodes[i] % PLACEMENT_MASK_BITS));
+            }
+            break;
+        default:
+            return -EINVAL;
+    }
+    /* mbind works on whole pages, the first and last page may be shared with other allocations */
+    size_t pagesize = (size_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t)ptr & ~(pagesize - 1);
+    uintptr_t end = ((uintptr_t)ptr + size + pagesize - 1) & ~(pagesize - 1);
+    DEBUG_PRINT(DEBUGLEV_DEVELOP, "mbind %p - %p with policy %s", (void*)start, (void*)end, placement_name(placement));
+    /* The kernel ignores the last bit of maxnode, so pass one more than the mask holds */
+    if (syscall(SYS_mbind, (void*)start, end - start, mode, mask, PLACEMENT_MAX_NODES + 1, MPOL_MF_MOVE) != 0)
+    {
+        return -errno;
+    }
+    return 0;
+}
+
+int query_placement(void* ptr, size_t size, int max_node, size_t* pages_per_node, size_t* unmapped)
+{
+    if ((!ptr) || size == 0 || max_node < 0 || (!pages_per_node) || (!unmapped))
+    {
+        return -EINVAL;
+    }
+    size_t pagesize = (size_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t)ptr & ~(pagesize - 1);
+    uintptr_t end = ((uintptr_t)ptr + size + pagesize - 1) & ~(pagesize - 1);
+    size_t num_pages = (end - start) / pagesize;
+    void** pages = malloc(PLACEMENT_QUERY_CHUNK * sizeof(void*));
+    int* status = malloc(PLACEMENT_QUERY_CHUNK * sizeof(int));
+    if ((!pages) || (!status))
+    {
+        free(pages);
+        free(status);
+        return -ENOMEM;
+    }
+    memset(pages_per_node, 0, (max_node + 1) * sizeof(size_t));
+    *unmapped = 0;
+    int err = 0;
+    for (size_t p = 0; p < num_pages; p += PLACEMENT_QUERY_CHUNK)
+    {
+        size_t count = (num_pages - p < PLACEMENT_QUERY_CHUNK ? num_pages - p : PLACEMENT_QUERY_CHUNK);
+        for (size_t i = 0; i < count; i++)
+        {
+            pages[i] = (void*)(start + (p + i) * pagesize);
+        }
+        /* Without target nodes, move_pages only reports the node of each page in status */
+        if (syscall(SYS_move_pages, 0, count, pages, NULL, status, 0) != 0)
+        {
+            err = -errno;
+            break;
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            if (status[i] >= 0 && status[i] <= max_node)
+            {
+                pages_per_node[status[i]]++;
+            }
+            else
+            {
+                (*unmapped)++;
+            }
+        }
+    }
+    free(pages);
+    free(status);
+    return err;
+}
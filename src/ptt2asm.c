@@ -33,6 +33,7 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "map.h"
 #include "bstrlib.h"
@@ -123,6 +124,69 @@ static bstring get_name(bstring str)
     return s;
 }
 
+/*
+ * String of a keyword argument: the value of a parameter (from the command line or its
+ * default), the selected option of a tunable, a constant or a variable with the name or
+ * the argument itself. The returned string is not a copy.
+ */
+static bstring get_string(TestConfig_t config, bstring arg)
+{
+    bstring v = arg;
+    for (int i = 0; i < config->num_params; i++)
+    {
+        TestConfigParameter* p = &config->params[i];
+        if (bstrcmp(p->name, arg) == BSTR_OK)
+        {
+            v = (p->value ? p->value : p->defvalue);
+        }
+    }
+    for (int i = 0; i < config->num_tunables; i++)
+    {
+        TestConfigTunable* t = &config->tunables[i];
+        if (bstrcmp(t->name, arg) == BSTR_OK && t->selected >= 0 && t->selected < t->options->qty)
+        {
+            v = t->options->entry[t->selected];
+        }
+    }
+    for (int i = 0; i < config->num_constants; i++)
+    {
+        if (bstrcmp(config->constants[i].name, arg) == BSTR_OK)
+        {
+            v = config->constants[i].value;
+        }
+    }
+    for (int i = 0; i < config->num_vars; i++)
+    {
+        if (bstrcmp(config->vars[i].name, arg) == BSTR_OK)
+        {
+            v = config->vars[i].value;
+        }
+    }
+    return v;
+}
+
+/* Value of a keyword argument: a number or a name that get_string resolves to a number */
+static int get_value(TestConfig_t config, bstring arg, long* value)
+{
+    bstring v = get_string(config, arg);
+    if ((!v) || blength(v) == 0)
+    {
+        errno = EINVAL;
+        ERROR_PRINT("No value for keyword argument '%s'", bdata(arg));
+        return -EINVAL;
+    }
+    char* end = NULL;
+    long x = strtol(bdata(v), &end, 0);
+    if (end == bdata(v) || *end != '\0')
+    {
+        errno = EINVAL;
+        ERROR_PRINT("Value '%s' of keyword argument '%s' is not a number", bdata(v), bdata(arg));
+        return -EINVAL;
+    }
+    *value = x;
+    return 0;
+}
+
 static int has_prefix(bstring str, bstring prefix)
 {
     return ((bstrncmp(str, prefix, blength(prefix)) == BSTR_OK) && (bchar(str, blength(prefix)) == '('));
@@ -137,11 +201,18 @@ static int toComment(struct bstrList* inout, bstring str)
 
 #include "ptt_keyword_loop.h"
 #include "ptt_keyword_dummy.h"
+#include "ptt_keyword_prefetch.h"
+#include "ptt_keyword_unroll.h"
+#include "ptt_keyword_chain.h"
 
 
 static PttKeywordDefinition ptt_keys[] = {
     {.begin = "LOOP", .end = "LOOPEND", .parse = parse_loop},
     {.begin = "DUMMY", .end = "DUMMYEND", .parse = parse_dummy},
+    {.begin = "PREFETCH", .end = "PREFETCHEND", .parse = parse_prefetch},
+    {.begin = "UNROLL", .end = "UNROLLEND", .parse = parse_unroll},
+    {.begin = "BUILD_DEP_CHAIN", .end = "BUILD_DEP_CHAINEND", .parse = parse_dep_chain},
+    {.begin = "BUILD_INDEP_CHAIN", .end = "BUILD_INDEP_CHAINEND", .parse = parse_indep_chain},
     // Must be last line
     {.begin = NULL, .end = NULL, .parse = NULL}
 };
@@ -327,6 +398,19 @@ static int _analyse_keyword(TestConfig_t config, struct bstrList* openkeys, stru
     return err;
 }
 
+static void _add_used_registers(struct bstrList* code, struct bstrList* regs)
+{
+    for (int i = 0; i < code->qty; i++)
+    {
+        for (int j = 0; Registers[j].data[0] != '\0'; j++)
+        {
+            if (binstr(code->entry[i], 0, &Registers[j]) != BSTR_ERR)
+            {
+                bstrListAdd(regs, &Registers[j]);
+            }
+        }
+    }
+}
 
 int prepare_ptt(TestConfig_t config, struct bstrList* out, struct bstrList* regs)
 {
@@ -335,6 +419,7 @@ int prepare_ptt(TestConfig_t config, struct bstrList* out, struct bstrList* regs
     int round = 0;
     bstring dstring;
     struct tagbstring sep = bsStatic(", ");
+    struct tagbstring bprologue = bsStatic(PTT_PROLOGUE_PREFIX);
 
     // Check whether there is no code or no output list
     if (blength(config->code) == 0 || !out)
@@ -442,7 +527,17 @@ int prepare_ptt(TestConfig_t config, struct bstrList* out, struct bstrList* regs
     int done = 0;
     do {
         DEBUG_PRINT(DEBUGLEV_DEVELOP, "Round %d", round);
-        _analyse_keyword(config, openkeys, closekeys, pttin, pttout);
+        int err = _analyse_keyword(config, openkeys, closekeys, pttin, pttout);
+        if (err < 0)
+        {
+            // The keyword parsers print the reason, an incomplete kernel must not be built
+            bstrListDestroy(code);
+            bstrListDestroy(openkeys);
+            bstrListDestroy(closekeys);
+            bstrListDestroy(pttin);
+            bstrListDestroy(pttout);
+            return err;
+        }
         // Check if there are still opening or closing keywords in code
         int found = 0;
         for (int i = 0; i < pttout->qty; i++)
@@ -470,16 +565,7 @@ int prepare_ptt(TestConfig_t config, struct bstrList* out, struct bstrList* regs
             if (found) break;
         }
 
-        for (int i = 0; i < pttin->qty; i++)
-        {
-            for (int j = 0; j < Registers[j].data[0] != '\0'; j++)
-            {
-                if (binstr(pttin->entry[i], 0, &Registers[j]) != BSTR_ERR)
-                {
-                    bstrListAdd(regs, &Registers[j]);
-                }
-            }
-        }
+        _add_used_registers(pttin, regs);
         DEBUG_PRINT(DEBUGLEV_DEVELOP, "List of registers used before duplication removal");
         if (global_verbosity == DEBUGLEV_DEVELOP) bstrListPrint(regs);
         bstrListRemoveDup(regs);
@@ -505,10 +591,26 @@ int prepare_ptt(TestConfig_t config, struct bstrList* out, struct bstrList* regs
         round++;
     } while (!done);
 
-    // Add final parsing result to output list
+    // Registers generated by the keywords of the last round are used as well
+    _add_used_registers(pttout, regs);
+    bstrListRemoveDup(regs);
+
+    // Add final parsing result to output list, the prologue lines of the keywords first
+    for (int i = 0; i < pttout->qty; i++)
+    {
+        if (bstrncmp(pttout->entry[i], &bprologue, blength(&bprologue)) == BSTR_OK)
+        {
+            bstring line = bmidstr(pttout->entry[i], blength(&bprologue), blength(pttout->entry[i]));
+            bstrListAdd(out, line);
+            bdestroy(line);
+        }
+    }
     for (int i = 0; i < pttout->qty; i++)
     {
-        bstrListAdd(out, pttout->entry[i]);
+        if (bstrncmp(pttout->entry[i], &bprologue, blength(&bprologue)) != BSTR_OK)
+        {
+            bstrListAdd(out, pttout->entry[i]);
+        }
     }
 
     // Cleanup
@@ -519,9 +621,8 @@ int prepare_ptt(TestConfig_t config, struct bstrList* out, struct bstrList* regs
     return 0;
 }
 
-static int _generate_replacement_lists(RuntimeConfig* runcfg, RuntimeThreadConfig* thread, struct bstrList* keys, struct bstrList* values, int* maxKeyLength, struct bstrList* regsused)
+static int _generate_replacement_lists(TestConfig_t config, RuntimeThreadConfig* thread, struct bstrList* keys, struct bstrList* values, int* maxKeyLength, struct bstrList* regsused)
 {
-    TestConfig_t config = runcfg->tcfg;
     int maxs = 0;
     struct bstrList* regsavail = bstrListCreate();
     struct tagbstring bstrptr = bsStatic("#STREAMPTRFORREPLACMENT");
@@ -535,13 +636,7 @@ static int _generate_replacement_lists(RuntimeConfig* runcfg, RuntimeThreadConfi
     }
     for (int i = 0; i < regsused->qty; i++)
     {
-        for (int r = 0; r < regsavail->qty; r++)
-        {
-            if (bstrncmp(&Registers[r], regsused->entry[i], blength(&Registers[r])) == BSTR_OK)
-            {
-                bstrListRemove(regsavail, &Registers[r]);
-            }
-        }
+        bstrListRemove(regsavail, regsused->entry[i]);
     }
     DEBUG_PRINT(DEBUGLEV_DEVELOP, "List of registers available");
     if (global_verbosity == DEBUGLEV_DEVELOP) bstrListPrint(regsavail);
@@ -552,18 +647,52 @@ static int _generate_replacement_lists(RuntimeConfig* runcfg, RuntimeThreadConfi
     // - Infos from the command line parameters
     // - Infos about threading
     struct bstrList* blines = bstrListCreate();
+    struct bstrList* dimkeys = bstrListCreate();
     int str_count = 0;
     if (thread->num_streams > regsavail->qty)
     {
         ERROR_PRINT("The Number of streams %d is higher than the %d registers available", thread->num_streams, regsavail->qty);
         bstrListDestroy(regsavail);
         bstrListDestroy(blines);
+        bstrListDestroy(dimkeys);
         return -EINVAL;
     }
+    /*
+     * The per-thread data is passed to the kernel in an argument block, so all threads of a
+     * workgroup share the same code. Layout: one slot per stream pointer followed by one slot
+     * per distinct dimension size (#<dim>) in elements.
+     */
+    int max_args = thread->num_streams;
+    for (int s = 0; s < thread->num_streams; s++)
+    {
+        max_args += thread->sdata[s].dims;
+    }
+    if (thread->args)
+    {
+        free(thread->args);
+        thread->args = NULL;
+    }
+    thread->num_args = 0;
+    if (max_args > 0)
+    {
+        thread->args = malloc(max_args * sizeof(uint64_t));
+        if (!thread->args)
+        {
+            ERROR_PRINT("Failed to allocate memory for the kernel argument block");
+            bstrListDestroy(regsavail);
+            bstrListDestroy(blines);
+            bstrListDestroy(dimkeys);
+            return -ENOMEM;
+        }
+        memset(thread->args, 0, max_args * sizeof(uint64_t));
+    }
+    thread->num_args = thread->num_streams;
+    bstring argreg_line = NULL;
     for (int s = 0; s < thread->num_streams; s++)
     {
         RuntimeStreamConfig* data = &thread->sdata[s];
         RuntimeThreadStreamConfig* str = &thread->tstreams[s];
+        thread->args[s] = (uint64_t)(uintptr_t)str->tstream_ptr;
         for (int i = 0; i < regsavail->qty && data->name; i++)
         {
             str_count++;
@@ -572,13 +701,25 @@ static int _generate_replacement_lists(RuntimeConfig* runcfg, RuntimeThreadConfi
             bstring ptr = bformat("%p", str->tstream_ptr);
             bstrListAdd(values, reg);
 #if defined(__x86_64) || defined(__x86_64__)
-            bstring line = bformat("mov %s, %s", bdata(regsavail->entry[i]), bdata(ptr));
+            bstring line = bformat("mov %s, QWORD PTR [%s+%d]", bdata(regsavail->entry[i]), bdata(&RegisterArgs), s * (int)sizeof(uint64_t));
 #elif defined(__ARM_ARCH_8A) || defined(__aarch64__) || defined(__arm__)
             bstring line = bformat("ldr %s, =%s", bdata(regsavail->entry[i]), bdata(ptr));
 #elif defined(_ARCH_PPC) || defined(__powerpc) || defined(__ppc__) || defined(__PPC__)
             bstring line = bformat("mov %s, %s", bdata(regsavail->entry[i]), bdata(ptr)); // to be replaced
 #endif
+#if defined(__x86_64) || defined(__x86_64__)
+            // Overwriting the argument register must be the last load
+            if (bstrcmp(reg, &RegisterArgs) == BSTR_OK)
+            {
+                argreg_line = bstrcpy(line);
+            }
+            else
+            {
+                bstrListAdd(blines, line);
+            }
+#else
             bstrListAdd(blines, line);
+#endif
             if (bstrListRemove(regsavail, reg) == BSTR_OK)
             {
                 DEBUG_PRINT(DEBUGLEV_DEVELOP, "Register '%s' removed: List of registers available", bdata(reg));
@@ -590,17 +731,67 @@ static int _generate_replacement_lists(RuntimeConfig* runcfg, RuntimeThreadConfi
             break;
         }
 
-        TestConfigStream *tstr = &runcfg->tcfg->streams[s];
+        TestConfigStream *tstr = &config->streams[s];
         for (int d = 0; d < data->dims; d++)
         {
             bstring k = bformat("#%s", bdata(tstr->dims->entry[d]));
-            bstring v = bformat("%zu", str->tsizes[d]);
-            bstrListAdd(keys, k);
-            bstrListAdd(values, v);
+            int found = 0;
+            for (int j = 0; j < dimkeys->qty; j++)
+            {
+                if (bstrcmp(dimkeys->entry[j], k) == BSTR_OK)
+                {
+                    found = 1;
+                    break;
+                }
+            }
+            // The first stream with a dimension name defines its size, like the replacement did before
+            if (!found)
+            {
+#if defined(__x86_64) || defined(__x86_64__)
+                bstring v = bformat("QWORD PTR [%s-%d]", bdata(&RegisterBptr), ARG_LOCALS_OFFSET + dimkeys->qty * (int)sizeof(uint64_t));
+#else
+                bstring v = bformat("%zu", str->tsizes[d]);
+#endif
+                thread->args[thread->num_args] = (uint64_t)str->tsizes[d];
+                thread->num_args++;
+                bstrListAdd(dimkeys, k);
+                bstrListAdd(keys, k);
+                bstrListAdd(values, v);
+                bdestroy(v);
+            }
             bdestroy(k);
-            bdestroy(v);
         }
     }
+#if defined(__x86_64) || defined(__x86_64__)
+    if (dimkeys->qty > 0)
+    {
+        // Copy the sizes from the argument block into the stack frame, the scratch register is loaded later
+        struct bstrList* sizelines = bstrListCreate();
+        bstring line = bformat("sub %s, %d", bdata(&RegisterSptr), dimkeys->qty * (int)sizeof(uint64_t));
+        bstrListAdd(sizelines, line);
+        bdestroy(line);
+        for (int j = 0; j < dimkeys->qty; j++)
+        {
+            line = bformat("mov %s, QWORD PTR [%s+%d]", bdata(&RegisterScratch), bdata(&RegisterArgs), (thread->num_streams + j) * (int)sizeof(uint64_t));
+            bstrListAdd(sizelines, line);
+            bdestroy(line);
+            line = bformat("mov QWORD PTR [%s-%d], %s", bdata(&RegisterBptr), ARG_LOCALS_OFFSET + j * (int)sizeof(uint64_t), bdata(&RegisterScratch));
+            bstrListAdd(sizelines, line);
+            bdestroy(line);
+        }
+        for (int j = 0; j < blines->qty; j++)
+        {
+            bstrListAdd(sizelines, blines->entry[j]);
+        }
+        bstrListDestroy(blines);
+        blines = sizelines;
+    }
+    if (argreg_line)
+    {
+        bstrListAdd(blines, argreg_line);
+        bdestroy(argreg_line);
+    }
+#endif
     if (str_count > 0)
     {
         bstrListAdd(keys, &bstrptr);
@@ -611,6 +802,7 @@ static int _generate_replacement_lists(RuntimeConfig* runcfg, RuntimeThreadConfi
         if (global_verbosity == DEBUGLEV_DEVELOP) bstrListPrint(blines);
     }
     bstrListDestroy(blines);
+    bstrListDestroy(dimkeys);
 
     for (int i = 0; i < config->num_constants; i++)
     {
@@ -624,6 +816,15 @@ static int _generate_replacement_lists(RuntimeConfig* runcfg, RuntimeThreadConfi
         bstrListAdd(keys, var->name);
         bstrListAdd(values, var->value);
     }
+    for (int i = 0; i < config->num_tunables; i++)
+    {
+        TestConfigTunable *tun = &config->tunables[i];
+        if (tun->selected >= 0 && tun->selected < tun->options->qty)
+        {
+            bstrListAdd(keys, tun->name);
+            bstrListAdd(values, tun->options->entry[tun->selected]);
+        }
+    }
     // Get the max key length
     // In the replacement step, we iterate over the list and start with the longest keys
     // The reason is that short strings are likely substrings of others, like N (array length) and
@@ -639,20 +840,25 @@ static int _generate_replacement_lists(RuntimeConfig* runcfg, RuntimeThreadConfi
     return 0;
 }
 
-int generate_code(RuntimeConfig* runcfg, RuntimeThreadConfig* thread, struct bstrList* out)
+int generate_code(TestConfig_t config, RuntimeThreadConfig* thread, struct bstrList* out)
 {
-    TestConfig_t config = runcfg->tcfg;
     struct bstrList* tmp = bstrListCreate();
     struct bstrList* regsused = bstrListCreate();
     header(tmp, config->name);
-    prepare_ptt(config, tmp, regsused);
+    int err = prepare_ptt(config, tmp, regsused);
+    if (err < 0)
+    {
+        bstrListDestroy(tmp);
+        bstrListDestroy(regsused);
+        return err;
+    }
     footer(tmp, config->name);
 
     // Now we have the function code but still with variables
     struct bstrList* keys = bstrListCreate();
     struct bstrList* values = bstrListCreate();
     int maxLength = 0;
-    int err = _generate_replacement_lists(runcfg, thread, keys, values, &maxLength, regsused);
+    err = _generate_replacement_lists(config, thread, keys, values, &maxLength, regsused);
     
     for (int i = 0; i < tmp->qty; i++)
     {
@@ -235,10 +235,13 @@ int read_yaml_ptt(char* filename, TestConfig_t* config)
     struct tagbstring bstrdatatypedbl = bsStatic("double");
     struct tagbstring bstrdatatypesgl = bsStatic("single");
     struct tagbstring bstrdatatypeint = bsStatic("integer");
+    struct tagbstring bstrdatatypeint64 = bsStatic("int64");
     struct tagbstring bstrdimensions = bsStatic("dimensions");
     struct tagbstring bstrdimsizes = bsStatic("dimsizes");
     struct tagbstring bstropts = bsStatic("options");
     struct tagbstring bstrinit = bsStatic("initialization");
+    struct tagbstring bstrplacement = bsStatic("placement");
+    struct tagbstring bstrallocation = bsStatic("allocation");
     struct tagbstring bname = bsStatic("Name");
     struct tagbstring bdesc = bsStatic("Description");
     struct tagbstring blang = bsStatic("Language");
@@ -246,6 +249,7 @@ int read_yaml_ptt(char* filename, TestConfig_t* config)
     struct tagbstring bvars = bsStatic("Variables");
     struct tagbstring bmetrics = bsStatic("Metrics");
     struct tagbstring bparams = bsStatic("Parameters");
+    struct tagbstring btunables = bsStatic("Tunables");
     struct tagbstring bparamopts = bsStatic("options");
     struct tagbstring bparamdef = bsStatic("default");
     struct tagbstring bparamdesc = bsStatic("description");
@@ -294,6 +298,9 @@ int read_yaml_ptt(char* filename, TestConfig_t* config)
                         s->offsets = bstrListCreate();
                         s->sizes = bstrListCreate();
                         s->initialization = false;
+                        s->placement = NULL;
+                        s->allocation = NULL;
+                        s->binit = NULL;
                         bstring sv;
                         ret = read_keyvalue(streams->entry[j], &s->name, &sv);
                         if (ret == 0)
@@ -333,6 +340,12 @@ int read_yaml_ptt(char* filename, TestConfig_t* config)
                                             btrimws(s->btype);
                                             s->type = TEST_STREAM_TYPE_INT;
                                         }
+                                        else if (bstrnicmp(vv, &bstrdatatypeint64, blength(&bstrdatatypeint64)) == BSTR_OK)
+                                        {
+                                            s->btype = bstrcpy(vv);
+                                            btrimws(s->btype);
+                                            s->type = TEST_STREAM_TYPE_INT64;
+                                        }
                                         else
                                         {
                                             printf("Unknown stream type '%s'\n", bdata(vv));
@@ -341,6 +354,7 @@ int read_yaml_ptt(char* filename, TestConfig_t* config)
                                     else if (bstrnicmp(vk, &bstrinit, blength(&bstrinit)) == BSTR_OK)
                                     {
                                         btrimws(vv);
+                                        s->binit = bstrcpy(vv);
                                         srand(time(NULL));
                                         if (s->type == TEST_STREAM_TYPE_SINGLE)
                                         {
@@ -420,6 +434,16 @@ int read_yaml_ptt(char* filename, TestConfig_t* config)
                                         }
                                         bstrListDestroy(tmpl);
                                     }
+                                    if (bstrnicmp(vk, &bstrplacement, blength(&bstrplacement)) == BSTR_OK)
+                                    {
+                                        s->placement = bstrcpy(vv);
+                                        btrimws(s->placement);
+                                    }
+                                    if (bstrnicmp(vk, &bstrallocation, blength(&bstrallocation)) == BSTR_OK)
+                                    {
+                                        s->allocation = bstrcpy(vv);
+                                        btrimws(s->allocation);
+                                    }
                                     if (bstrnicmp(vk, &bthreadsoff, 7) == BSTR_OK)
                                     {
                                         read_yaml_ptt_list(vv, &s->offsets);
@@ -486,6 +510,7 @@ int read_yaml_ptt(char* filename, TestConfig_t* config)
                         p->name = NULL;
                         p->description = NULL;
                         p->defvalue = NULL;
+                        p->value = NULL;
                         p->options = bstrListCreate();
                         bstring pv;
                         ret = read_keyvalue(params->entry[l], &p->name, &pv);
@@ -523,6 +548,50 @@ int read_yaml_ptt(char* filename, TestConfig_t* config)
                 conf->num_params = params->qty;
                 bstrListDestroy(params);
             }
+            else if (bstrnicmp(k, &btunables, blength(&btunables)) == BSTR_OK)
+            {
+                struct bstrList* tunables = NULL;
+                read_obj(v, &tunables);
+                conf->tunables = malloc(tunables->qty * sizeof(TestConfigTunable));
+                if (conf->tunables)
+                {
+                    for (int l = 0; l < tunables->qty; l++)
+                    {
+                        TestConfigTunable *t = &conf->tunables[l];
+                        t->name = NULL;
+                        t->description = NULL;
+                        t->options = bstrListCreate();
+                        t->selected = 0;
+                        bstring tv;
+                        ret = read_keyvalue(tunables->entry[l], &t->name, &tv);
+                        if (ret == 0)
+                        {
+                            struct bstrList* tvars = NULL;
+                            read_obj(tv, &tvars);
+                            for (int m = 0; m < tvars->qty; m++)
+                            {
+                                bstring vk, vv;
+                                ret = read_keyvalue(tvars->entry[m], &vk, &vv);
+                                if (bstrnicmp(vk, &bparamdesc, blength(&bparamdesc)) == BSTR_OK)
+                                {
+                                    t->description = bstrcpy(vv);
+                                    btrimws(t->description);
+                                }
+                                else if (bstrnicmp(vk, &bparamopts, blength(&bparamopts)) == BSTR_OK)
+                                {
+                                    read_yaml_ptt_list(vv, &t->options);
+                                }
+                                bdestroy(vk);
+                                bdestroy(vv);
+                            }
+                            bstrListDestroy(tvars);
+                        }
+                        bdestroy(tv);
+                    }
+                    conf->num_tunables = tunables->qty;
+                }
+                bstrListDestroy(tunables);
+            }
             else if (bstrnicmp(k, &bflags, blength(&bflags)) == BSTR_OK)
             {
                 read_yaml_ptt_list(v, &conf->flags);
@@ -583,6 +652,9 @@ void close_streams(int num_streams, TestConfigStream* streams)
             if (s->dims) bstrListDestroy(s->dims);
             if (s->offsets) bstrListDestroy(s->offsets);
             if (s->sizes) bstrListDestroy(s->sizes);
+            if (s->placement) bdestroy(s->placement);
+            if (s->allocation) bdestroy(s->allocation);
+            if (s->binit) bdestroy(s->binit);
         }
         free(streams);
     }
@@ -601,11 +673,29 @@ void close_parameters(int num_params, TestConfigParameter* params)
             if (p->description) bdestroy(p->description);
             if (p->options) bstrListDestroy(p->options);
             if (p->defvalue) bdestroy(p->defvalue);
+            if (p->value) bdestroy(p->value);
         }
         free(params);
     }
 }
 
+void close_tunables(int num_tunables, TestConfigTunable* tunables)
+{
+    int i = 0;
+    if (num_tunables > 0 && tunables)
+    {
+        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Destroying %d tunables", num_tunables);
+        for (i = 0; i < num_tunables; i++)
+        {
+            TestConfigTunable* t = &tunables[i];
+            if (t->name) bdestroy(t->name);
+            if (t->description) bdestroy(t->description);
+            if (t->options) bstrListDestroy(t->options);
+        }
+        free(tunables);
+    }
+}
+
 void close_yaml_ptt(TestConfig_t config)
 {
     if (config)
@@ -632,6 +722,8 @@ void close_yaml_ptt(TestConfig_t config)
         close_streams(config->num_streams, config->streams);
         DEBUG_PRINT(DEBUGLEV_DEVELOP, "Destroying parameters in TestConfig");
         close_parameters(config->num_params, config->params);
+        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Destroying tunables in TestConfig");
+        close_tunables(config->num_tunables, config->tunables);
         DEBUG_PRINT(DEBUGLEV_DEVELOP, "Destroying flags in TestConfig");
         bstrListDestroy(config->flags);
         DEBUG_PRINT(DEBUGLEV_DEVELOP, "Destroying TestConfig");
@@ -2,6 +2,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
+#include <inttypes.h>
+#include <math.h>
 
 #ifndef WITH_BSTRING
 #define WITH_BSTRING
@@ -9,6 +11,7 @@
 #include "allocator.h"
 #include "map.h"
 #include "results.h"
+#include "symbols.h"
 #include "calculator.h"
 #include "bstrlib.h"
 #include "bstrlib_helper.h"
@@ -17,6 +20,8 @@
 #include "test_strings.h"
 #include "bitmask.h"
 
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+
 
 typedef struct {
     struct tagbstring key;
@@ -39,22 +44,6 @@ struct _replace_data {
     Map_t exclude;
 };
 
-static void* double_dup(double d)
-{
-    double* m = malloc(sizeof(double));
-    if (m)
-    {
-        *m = d;
-    }
-    return (void*)m;
-}
-
-static void bmap_free(mpointer val)
-{
-    bstring bstr = (bstring)val;
-    bdestroy(bstr);
-}
-
 /*static char* str_dup (const char *str)*/
 /*{*/
 /*    char *new_str;*/
@@ -100,180 +89,6 @@ static void bmap_free(mpointer val)
 
 
 
-/*int init_results(int num_threads, int *cpus)*/
-/*{*/
-/*    int i = 0, j = 0;*/
-/*    int err = 0;*/
-/*    if (!bench_results)*/
-/*    {*/
-/*        DEBUG_PRINT(DEBUGLEV_DEVELOP, Allocating result space);*/
-/*        BenchResults* tmp = malloc(sizeof(BenchResults));*/
-/*        if (tmp)*/
-/*        {*/
-/*            tmp->num_threads = num_threads;*/
-/*            DEBUG_PRINT(DEBUGLEV_DEVELOP, Allocating results for %d threads, num_threads);*/
-/*            tmp->threads = malloc(num_threads * sizeof(BenchThreadResults));*/
-/*            if (tmp->threads)*/
-/*            {*/
-/*                for (i = 0; i < tmp->num_threads; i++)*/
-/*                {*/
-/*                    tmp->threads[i].cpu = cpus[i];*/
-/*                    DEBUG_PRINT(DEBUGLEV_DEVELOP, Creating result map for thread %d (CPU %d), i, cpus[i]);*/
-/*                    err = init_bmap(&tmp->threads[i].results, free);*/
-/*                    if (err != 0)*/
-/*                    {*/
-/*                        DEBUG_PRINT(DEBUGLEV_DEVELOP, Error when creating result map for thread %d (CPU %d), i, cpus[i]);*/
-/*                        for (j = 0; j < i; j++)*/
-/*                        {*/
-/*                            destroy_bmap(tmp->threads[j].results);*/
-/*                            tmp->threads[j].results = NULL;*/
-/*                            destroy_bmap(tmp->threads[j].consts);*/
-/*                            tmp->threads[j].consts = NULL;*/
-/*                        }*/
-/*                        free(tmp->threads);*/
-/*                        free(tmp);*/
-/*                        return -ENOMEM;*/
-/*                    }*/
-/*                    DEBUG_PRINT(DEBUGLEV_DEVELOP, Creating constants map for thread %d (CPU %d), i, cpus[i]);*/
-/*                    err = init_bmap(&tmp->threads[i].consts, free);*/
-/*                    if (err != 0)*/
-/*                    {*/
-/*                        DEBUG_PRINT(DEBUGLEV_DEVELOP, Error when creating constants map for thread %d (CPU %d), i, cpus[i]);*/
-/*                        for (j = 0; j < i; j++)*/
-/*                        {*/
-/*                            destroy_bmap(tmp->threads[j].results);*/
-/*                            tmp->threads[j].results = NULL;*/
-/*                            destroy_bmap(tmp->threads[j].consts);*/
-/*                            tmp->threads[j].consts = NULL;*/
-/*                        }*/
-/*                        free(tmp->threads);*/
-/*                        free(tmp);*/
-/*                        return -ENOMEM;*/
-/*                    }*/
-/*                }*/
-/*            }*/
-/*            else*/
-/*            {*/
-/*                free(tmp);*/
-/*                return -ENOMEM;*/
-/*            }*/
-/*            DEBUG_PRINT(DEBUGLEV_DEVELOP, Creating formula map);*/
-/*            err = init_bmap(&tmp->formulas, bmap_free);*/
-/*            if (err)*/
-/*            {*/
-/*                DEBUG_PRINT(DEBUGLEV_DEVELOP, Error when creating formula map);*/
-/*                if (tmp->threads)*/
-/*                {*/
-/*                    for (j = 0; j < num_threads; j++)*/
-/*                    {*/
-/*                        destroy_bmap(tmp->threads[j].results);*/
-/*                        tmp->threads[j].results = NULL;*/
-/*                        destroy_bmap(tmp->threads[j].consts);*/
-/*                        tmp->threads[j].consts = NULL;*/
-/*                    }*/
-/*                    free(tmp->threads);*/
-/*                }*/
-/*                free(tmp);*/
-/*                return -ENOMEM;*/
-/*            }*/
-/*            DEBUG_PRINT(DEBUGLEV_DEVELOP, Creating constants map);*/
-/*            err = init_bmap(&tmp->consts, free);*/
-/*            if (err)*/
-/*            {*/
-/*                DEBUG_PRINT(DEBUGLEV_DEVELOP, Error when creating constants map);*/
-/*                destroy_bmap(tmp->formulas);*/
-/*                if (tmp->threads)*/
-/*                {*/
-/*                    for (j = 0; j < num_threads; j++)*/
-/*                    {*/
-/*                        destroy_bmap(tmp->threads[j].results);*/
-/*                        tmp->threads[j].results = NULL;*/
-/*                        destroy_bmap(tmp->threads[j].consts);*/
-/*                        tmp->threads[j].consts = NULL;*/
-/*                    }*/
-/*                    free(tmp->threads);*/
-/*                }*/
-/*                free(tmp);*/
-/*                return -ENOMEM;*/
-/*            }*/
-/*            bench_results = tmp;*/
-/*        }*/
-/*        else*/
-/*        {*/
-/*            return -ENOMEM;*/
-/*        }*/
-/*    }*/
-/*    calculator_init();*/
-/*    return 0;*/
-/*}*/
-
-/*int set_result(int thread, bstring name, double value)*/
-/*{*/
-/*    int err = 0;*/
-/*    if ((!bench_results) || (!name) || (thread < 0))*/
-/*    {*/
-/*        DEBUG_PRINT(DEBUGLEV_DEVELOP, Invalid arguments);*/
-/*        return -EINVAL;*/
-/*    }*/
-/*    if (thread > bench_results->num_threads)*/
-/*    {*/
-/*        DEBUG_PRINT(DEBUGLEV_DEVELOP, Invalid arguments);*/
-/*        return -EINVAL;*/
-/*    }*/
-/*    BenchThreadResults* result = &bench_results->threads[thread];*/
-/*    if (result)*/
-/*    {*/
-/*        double* dptr = NULL;*/
-/*        DEBUG_PRINT(DEBUGLEV_DEVELOP, Searching for result %s for thread %d (CPU %d), bdata(name), thread, result->cpu);*/
-/*        err = get_bmap_by_key(result->results, name, (void**)&dptr);*/
-/*        if (err == -ENOENT)*/
-/*        {*/
-/*            dptr = (double*)double_dup(value);*/
-/*            if (dptr)*/
-/*            {*/
-/*                //printf("Adding %s (%p) value %f (%p)\n", name, name, *dptr, dptr);*/
-/*                DEBUG_PRINT(DEBUGLEV_DEVELOP, Adding result %s = %f for thread %d (CPU %d), bdata(name), *dptr, thread, result->cpu);*/
-/*                err = add_bmap(result->results, name, (void*)dptr);*/
-/*                if (err < 0)*/
-/*                {*/
-/*                    ERROR_PRINT(Failed adding result %s = %f for thread %d (CPU %d), bdata(name), *dptr, thread, result->cpu);*/
-/*                    return err;*/
-/*                }*/
-/*            }*/
-/*        }*/
-/*        else*/
-/*        {*/
-/*            //printf("Set %s value from %f to %f (%p)\n", name, *dptr, value, dptr);*/
-/*            DEBUG_PRINT(DEBUGLEV_DEVELOP, Set result %s = %f for thread %d (CPU %d), bdata(name), value, thread, result->cpu);*/
-/*            *dptr = value;*/
-/*        }*/
-/*    }*/
-/*    return 0;*/
-/*}*/
-
-/*int set_result_for_all(bstring name, double value)*/
-/*{*/
-/*    int i = 0, j = 0, err = 0;*/
-/*    if ((!bench_results) || (!name))*/
-/*    {*/
-/*        return -EINVAL;*/
-/*    }*/
-/*    for (i = 0; i < bench_results->num_threads; i++)*/
-/*    {*/
-/*        err = set_result(i, name, value);*/
-/*        if (err)*/
-/*        {*/
-/*            for (j = i-1; j >= 0; j--)*/
-/*            {*/
-/*                BenchThreadResults* result = &bench_results->threads[j];*/
-/*                del_bmap(result->results, name);*/
-/*            }*/
-/*            return err;*/
-/*        }*/
-/*    }*/
-/*    return 0;*/
-/*}*/
-
 /*int add_formula(bstring name, bstring formula)*/
 /*{*/
 /*    int err = 0;*/
@@ -306,78 +121,6 @@ static void bmap_free(mpointer val)
 /*    return 0;*/
 /*}*/
 
-/*int add_const(bstring name, double constant)*/
-/*{*/
-/*    int err = 0;*/
-/*    if ((!bench_results) || (!name))*/
-/*    {*/
-/*        return -EINVAL;*/
-/*    }*/
-/*    double* f = NULL;*/
-/*    DEBUG_PRINT(DEBUGLEV_DEVELOP, Searching for constant %s, bdata(name));*/
-/*    err = get_bmap_by_key(bench_results->consts, name, (void**)&f);*/
-/*    if (err == -ENOENT)*/
-/*    {*/
-/*        f = (double*)double_dup(constant);*/
-/*        if (f)*/
-/*        {*/
-/*            DEBUG_PRINT(DEBUGLEV_DEVELOP, Adding constant %s -> %f, bdata(name), *f);*/
-/*            err = add_bmap(bench_results->consts, name, (void*)f);*/
-/*            if (err < 0)*/
-/*            {*/
-/*                ERROR_PRINT(Failed adding constant %s = %f, bdata(name), *f);*/
-/*                return err;*/
-/*            }*/
-/*        }*/
-/*    }*/
-/*    else*/
-/*    {*/
-/*        DEBUG_PRINT(DEBUGLEV_DEVELOP, Constant %s already exists, bdata(name));*/
-/*        return -EEXIST;*/
-/*    }*/
-/*    return 0;*/
-/*}*/
-
-/*int add_thread_const(int thread, bstring name, double constant)*/
-/*{*/
-/*    int err = 0;*/
-/*    if ((!bench_results) || (!name) || (thread < 0))*/
-/*    {*/
-/*        return -EINVAL;*/
-/*    }*/
-/*    if (thread > bench_results->num_threads)*/
-/*    {*/
-/*        return -EINVAL;*/
-/*    }*/
-/*    BenchThreadResults* result = &bench_results->threads[thread];*/
-/*    if (result)*/
-/*    {*/
-/*        double* f = NULL;*/
-/*        DEBUG_PRINT(DEBUGLEV_DEVELOP, Searching for thread constant %s, bdata(name));*/
-/*        err = get_bmap_by_key(result->consts, name, (void**)&f);*/
-/*        if (err == -ENOENT)*/
-/*        {*/
-/*            f = (double*)double_dup(constant);*/
-/*            if (f)*/
-/*            {*/
-/*                DEBUG_PRINT(DEBUGLEV_DEVELOP, Adding thread constant %s -> %f, bdata(name), *f);*/
-/*                err = add_bmap(result->consts, name, (void*)f);*/
-/*                if (err < 0)*/
-/*                {*/
-/*                    ERROR_PRINT(Failed adding thread constant %s = %f, bdata(name), *f);*/
-/*                    return err;*/
-/*                }*/
-/*            }*/
-/*        }*/
-/*        else*/
-/*        {*/
-/*            DEBUG_PRINT(DEBUGLEV_DEVELOP, Thread constant %s already exists, bdata(name));*/
-/*            return -EEXIST;*/
-/*        }*/
-/*    }*/
-/*    return 0;*/
-/*}*/
-
 /*int get_formula(int thread, bstring name, double* value)*/
 /*{*/
 /*    bstring formula;*/
@@ -454,379 +197,513 @@ static void bmap_free(mpointer val)
 
 int init_result(RuntimeWorkgroupResult* result)
 {
-    int err = 0;
-    result->values = NULL;
-    result->variables = NULL;
-    DEBUG_PRINT(DEBUGLEV_DEVELOP, "Creating values map");
-    err = init_bmap(&result->values, bmap_free);
-    if (err != 0)
+    if (!result)
     {
-        ERROR_PRINT("Creating values map failed");
-        result->values = NULL;
-        result->variables = NULL;
-        return err;
+        return -EINVAL;
+    }
+    /* The slots are allocated when the first name is set */
+    memset(result, 0, sizeof(RuntimeWorkgroupResult));
+    return 0;
+}
+
+/* Makes room for the slot of symbol id, new slots are empty */
+static int _reserve_slot(ResultSlots* slots, int id)
+{
+    if (id < slots->num_slots)
+    {
+        return 0;
     }
-    DEBUG_PRINT(DEBUGLEV_DEVELOP, "Creating variables map");
-    err = init_bmap(&result->variables, bmap_free);
+    int num_slots = MAX(id + 1, MAX(2 * slots->num_slots, 32));
+    uint8_t* types = realloc(slots->types, num_slots * sizeof(uint8_t));
+    if (types) slots->types = types;
+    ResultSlot* values = realloc(slots->slots, num_slots * sizeof(ResultSlot));
+    if (values) slots->slots = values;
+    bstring* texts = realloc(slots->texts, num_slots * sizeof(bstring));
+    if (texts) slots->texts = texts;
+    if ((!types) || (!values) || (!texts))
+    {
+        ERROR_PRINT("Failed to allocate %d result slots", num_slots);
+        return -ENOMEM;
+    }
+    memset(&slots->types[slots->num_slots], 0, (num_slots - slots->num_slots) * sizeof(uint8_t));
+    memset(&slots->texts[slots->num_slots], 0, (num_slots - slots->num_slots) * sizeof(bstring));
+    slots->num_slots = num_slots;
+    return 0;
+}
+
+static int _has_slot(ResultSlots* slots, int id)
+{
+    return (id >= 0 && id < slots->num_slots && slots->types[id] != RESULT_SLOT_EMPTY);
+}
+
+static int _set_slot(ResultSlots* slots, int id, ResultSlotType type, ResultSlot value, const_bstring text)
+{
+    if (id < 0)
+    {
+        return -EINVAL;
+    }
+    int err = _reserve_slot(slots, id);
     if (err != 0)
     {
-        ERROR_PRINT("Creating variables map failed");
-        destroy_bmap(result->values);
-        result->values = NULL;
-        result->variables = NULL;
         return err;
     }
-    DEBUG_PRINT(DEBUGLEV_DEVELOP, "Values %p Variables %p", result->values, result->variables);
+    if (slots->texts[id])
+    {
+        bdestroy(slots->texts[id]);
+        slots->texts[id] = NULL;
+    }
+    if (type == RESULT_SLOT_TEXT)
+    {
+        slots->texts[id] = bstrcpy(text);
+    }
+    slots->types[id] = type;
+    slots->slots[id] = value;
     return 0;
 }
 
-int add_value(RuntimeWorkgroupResult* result, bstring name, double value)
+/* Integers are stored as such, anything else as text with its number if it is one */
+static int _set_variable_slot(ResultSlots* slots, int id, const_bstring value)
 {
-    int err = 0;
-    bstring v = NULL;
-    if ((!result) || (!result->values) || (!name))
+    ResultSlot v;
+    char* end = NULL;
+    const char* cval = bdata(value);
+    if (!cval)
     {
         return -EINVAL;
     }
-    DEBUG_PRINT(DEBUGLEV_DEVELOP, "Searching for value %s", bdata(name));
-    err = get_bmap_by_key(result->values, name, (void**)&v);
-    if (err == -ENOENT)
+    errno = 0;
+    v.i = (int64_t)strtoll(cval, &end, 10);
+    if (end != cval && *end == '\0' && errno == 0)
     {
-        v = bformat("%.15lf", value);
-        if (v)
-        {
-            DEBUG_PRINT(DEBUGLEV_DEVELOP, "Adding value %s -> %s", bdata(name), bdata(v));
-            err = add_bmap(result->values, name, (void*)v);
-            if (err < 0)
-            {
-                ERROR_PRINT("Failed adding value %s = %s", bdata(name), bdata(v));
-                return err;
-            }
-        }
+        return _set_slot(slots, id, RESULT_SLOT_INT, v, NULL);
     }
-    else
+    v.d = strtod(cval, &end);
+    if (end == cval || *end != '\0')
     {
-        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Value %s already exists", bdata(name));
-        return -EEXIST;
+        v.d = NAN;
     }
-    return 0;
+    return _set_slot(slots, id, RESULT_SLOT_TEXT, v, value);
 }
 
-int update_value(RuntimeWorkgroupResult* result, bstring name, double value)
+static double _slot_number(ResultSlots* slots, int id)
+{
+    return (slots->types[id] == RESULT_SLOT_INT ? (double)slots->slots[id].i : slots->slots[id].d);
+}
+
+/* The slot as it is substituted into formulas and code */
+static bstring _slot_text(ResultSlots* slots, int id)
 {
-    int err = 0;
-    bstring v = NULL;
-    if ((!result) || (!result->values) || (!name))
+    switch (slots->types[id])
+    {
+        case RESULT_SLOT_DOUBLE:
+            return bformat("%.15lf", slots->slots[id].d);
+        case RESULT_SLOT_INT:
+            return bformat("%" PRId64, slots->slots[id].i);
+        case RESULT_SLOT_TEXT:
+            return bstrcpy(slots->texts[id]);
+        default:
+            return NULL;
+    }
+}
+
+int set_value_by_id(RuntimeWorkgroupResult* result, int id, double value)
+{
+    if (!result)
     {
         return -EINVAL;
     }
-    DEBUG_PRINT(DEBUGLEV_DEVELOP, "Searching for value %s", bdata(name));
-    bstring old_v = NULL;
-    err = get_bmap_by_key(result->values, name, (void**)&old_v);
-    if (err == 0)
+    ResultSlot v = {.d = value};
+    return _set_slot(&result->values, id, RESULT_SLOT_DOUBLE, v, NULL);
+}
+
+int get_value_by_id(RuntimeWorkgroupResult* result, int id, double* value)
+{
+    if ((!result) || (!value))
     {
-        v = bformat("%.15lf", value);
-        if (v)
-        {
-            DEBUG_PRINT(DEBUGLEV_DEVELOP, "Updating value %s -> %s", bdata(name), bdata(v));
-            err = update_bmap(result->values, name, (void*)v, (void**)&old_v);
-            bdestroy(old_v);
-            if (err < 0)
-            {
-                ERROR_PRINT("Failed updating value %s = %s", bdata(name), bdata(v));
-                return 0;
-            }
-        }
+        return -EINVAL;
     }
-    else
+    if (!_has_slot(&result->values, id))
     {
-        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Unable to update %s", bdata(name));
         return -ENOENT;
     }
+    *value = result->values.slots[id].d;
     return 0;
 }
 
-int add_variable(RuntimeWorkgroupResult* result, bstring name, bstring value)
+int set_variable_by_id(RuntimeWorkgroupResult* result, int id, int64_t value)
 {
-    int err = 0;
-    bstring v;
-    if ((!result) || (!result->variables) || (!name))
+    if (!result)
     {
         return -EINVAL;
     }
-    DEBUG_PRINT(DEBUGLEV_DEVELOP, "Searching for variable %s", bdata(name));
-    err = get_bmap_by_key(result->variables, name, (void**)&v);
-    if (err == -ENOENT)
+    ResultSlot v = {.i = value};
+    return _set_slot(&result->variables, id, RESULT_SLOT_INT, v, NULL);
+}
+
+int get_variable_by_id(RuntimeWorkgroupResult* result, int id, double* value)
+{
+    if ((!result) || (!value))
     {
-        v = bstrcpy(value);
-        if (v)
+        return -EINVAL;
+    }
+    if (!_has_slot(&result->variables, id))
+    {
+        return -ENOENT;
+    }
+    *value = _slot_number(&result->variables, id);
+    return 0;
+}
+
+bstring get_value_text(RuntimeWorkgroupResult* result, int id)
+{
+    if ((!result) || !_has_slot(&result->values, id))
+    {
+        return NULL;
+    }
+    return _slot_text(&result->values, id);
+}
+
+bstring get_variable_text(RuntimeWorkgroupResult* result, int id)
+{
+    if ((!result) || !_has_slot(&result->variables, id))
+    {
+        return NULL;
+    }
+    return _slot_text(&result->variables, id);
+}
+
+static void _foreach_slot(ResultSlots* slots, result_foreach_func func, mpointer user_data)
+{
+    for (int id = 0; id < slots->num_slots; id++)
+    {
+        if (slots->types[id] != RESULT_SLOT_EMPTY)
         {
-            DEBUG_PRINT(DEBUGLEV_DEVELOP, "Adding variable %s -> %s", bdata(name), bdata(v));
-            err = add_bmap(result->variables, name, (void*)v);
-            if (err < 0)
-            {
-                ERROR_PRINT("Failed adding variable %s = %s", bdata(name), bdata(v));
-                return err;
-            }
+            func(id, symbol_name(id), user_data);
         }
     }
-    else
+}
+
+void foreach_value(RuntimeWorkgroupResult* result, result_foreach_func func, mpointer user_data)
+{
+    if (result && func)
     {
-        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Variable %s already exists", bdata(name));
+        _foreach_slot(&result->values, func, user_data);
+    }
+}
+
+void foreach_variable(RuntimeWorkgroupResult* result, result_foreach_func func, mpointer user_data)
+{
+    if (result && func)
+    {
+        _foreach_slot(&result->variables, func, user_data);
+    }
+}
+
+int add_value(RuntimeWorkgroupResult* result, bstring name, double value)
+{
+    if ((!result) || (!name))
+    {
+        return -EINVAL;
+    }
+    int id = symbol_intern(name, symbol_hash(name));
+    if (_has_slot(&result->values, id))
+    {
+        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Value %s already exists", bdata(name));
         return -EEXIST;
     }
-    return 0;
+    DEBUG_PRINT(DEBUGLEV_DEVELOP, "Adding value %s -> %.15lf", bdata(name), value);
+    return set_value_by_id(result, id, value);
 }
 
-int update_variable(RuntimeWorkgroupResult* result, bstring name, bstring value)
+int update_value(RuntimeWorkgroupResult* result, bstring name, double value)
 {
-    int err = 0;
-    bstring v;
-    if ((!result) || (!result->variables) || (!name))
+    if ((!result) || (!name))
     {
         return -EINVAL;
     }
-    DEBUG_PRINT(DEBUGLEV_DEVELOP, "Searching for variable %s", bdata(name));
-    bstring old_v;
-    err = get_bmap_by_key(result->variables, name, (void**)&old_v);
-    if (err == 0)
+    int id = symbol_find(name, symbol_hash(name));
+    if (!_has_slot(&result->values, id))
     {
-        v = bstrcpy(value);
-        if (v)
-        {
-            DEBUG_PRINT(DEBUGLEV_DEVELOP, "Updating value %s -> %s", bdata(name), bdata(v));
-            err = update_bmap(result->variables, name, (void*)v, (void**)&old_v);
-            bdestroy(old_v);
-            if (err < 0)
-            {
-                ERROR_PRINT("Failed updating variable %s = %s", bdata(name), bdata(v));
-                return 0;
-            }
-        }
+        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Unable to update %s", bdata(name));
+        return -ENOENT;
     }
-    else
+    DEBUG_PRINT(DEBUGLEV_DEVELOP, "Updating value %s -> %.15lf", bdata(name), value);
+    return set_value_by_id(result, id, value);
+}
+
+int add_variable(RuntimeWorkgroupResult* result, bstring name, bstring value)
+{
+    if ((!result) || (!name) || (!value))
+    {
+        return -EINVAL;
+    }
+    int id = symbol_intern(name, symbol_hash(name));
+    if (_has_slot(&result->variables, id))
+    {
+        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Variable %s already exists", bdata(name));
+        return -EEXIST;
+    }
+    DEBUG_PRINT(DEBUGLEV_DEVELOP, "Adding variable %s -> %s", bdata(name), bdata(value));
+    return _set_variable_slot(&result->variables, id, value);
+}
+
+int update_variable(RuntimeWorkgroupResult* result, bstring name, bstring value)
+{
+    if ((!result) || (!name) || (!value))
+    {
+        return -EINVAL;
+    }
+    int id = symbol_find(name, symbol_hash(name));
+    if (!_has_slot(&result->variables, id))
     {
         DEBUG_PRINT(DEBUGLEV_DEVELOP, "Unable to update %s", bdata(name));
         return -ENOENT;
     }
-    return 0;
+    DEBUG_PRINT(DEBUGLEV_DEVELOP, "Updating variable %s -> %s", bdata(name), bdata(value));
+    return _set_variable_slot(&result->variables, id, value);
 }
 
 int get_value(RuntimeWorkgroupResult* result, bstring name, double* value)
 {
-    int err = 0;
-    bstring v = NULL;
-    if ((!result) || (!result->values) || (!name) || (!value))
+    if ((!result) || (!name) || (!value))
     {
         return -EINVAL;
     }
-    DEBUG_PRINT(DEBUGLEV_DEVELOP, "Searching for value %s", bdata(name));
-    err = get_bmap_by_key(result->values, name, (void**)&v);
-    if (err == -ENOENT || v == NULL)
+    int err = get_value_by_id(result, symbol_find(name, symbol_hash(name)), value);
+    if (err != 0)
     {
         ERROR_PRINT("Value for name %s does not exist", bdata(name));
-        return err;
     }
-    DEBUG_PRINT(DEBUGLEV_DEVELOP, "Retrived value for %s is %s", bdata(name), bdata(v));
-    char* endptr;
-    const char* cval = bdata(v);
-    *value = (double)strtold(cval, &endptr);
-    return 0;
+    return err;
 }
 
 int get_variable(RuntimeWorkgroupResult* result, bstring name, size_t* value)
 {
-    int err = 0;
-    bstring v = NULL;
-    if ((!result) || (!result->values) || (!name) || (!value))
+    if ((!result) || (!name) || (!value))
     {
         return -EINVAL;
     }
-    DEBUG_PRINT(DEBUGLEV_DEVELOP, "Searching for variable %s", bdata(name));
-    err = get_bmap_by_key(result->variables, name, (void**)&v);
-    if (err == -ENOENT || v == NULL)
+    int id = symbol_find(name, symbol_hash(name));
+    if (!_has_slot(&result->variables, id))
     {
         ERROR_PRINT("Variable for name %s does not exist", bdata(name));
-        return err;
+        return -ENOENT;
+    }
+    ResultSlots* slots = &result->variables;
+    if (slots->types[id] == RESULT_SLOT_INT)
+    {
+        *value = (size_t)slots->slots[id].i;
+    }
+    else
+    {
+        *value = (size_t)strtoumax(bdata(slots->texts[id]), NULL, 10);
     }
-    DEBUG_PRINT(DEBUGLEV_DEVELOP, "Retrived variable for %s is %s", bdata(name), bdata(v));
-    char* endptr;
-    const char* cval = bdata(v);
-    *value = (size_t)strtoumax(cval, &endptr, 10);
     return 0;
 }
 
-struct replace_all_data {
-    bstring formula;
-    struct bstrList* exclude;
-    Map_t map;
-};
+typedef struct {
+    int id;
+    int variable;
+    int order;
+    bstring name;
+} ReplaceEntry;
 
-static void replace_all_cb(mpointer key, mpointer value, mpointer user_data)
+typedef struct {
+    int num_entries;
+    ReplaceEntry* entries;
+    int variable;
+} ReplaceData;
+
+static void _replace_entry_cb(int id, bstring name, mpointer user_data)
 {
-    int err = 0;
-    bstring bkey = (bstring) key;
-    bstring bval = (bstring)value;
-    int* ival = (int*) value;
-    MapValue* val = NULL;
-    double* d = NULL;
-    struct replace_all_data* data = (struct replace_all_data*)user_data;
+    ReplaceData* data = (ReplaceData*)user_data;
+    ReplaceEntry* e = &data->entries[data->num_entries];
+    e->id = id;
+    e->variable = data->variable;
+    e->order = data->num_entries++;
+    e->name = name;
+}
 
-    if (data->exclude)
+/* Longer names first, so N does not replace a part of NUM_THREADS, variables before values */
+static int _compare_replace_entries(const void* a, const void* b)
+{
+    const ReplaceEntry* x = (const ReplaceEntry*)a;
+    const ReplaceEntry* y = (const ReplaceEntry*)b;
+    if (blength(x->name) != blength(y->name))
     {
-        for (int i = 0; i < data->exclude->qty; i++)
-        {
-            if (bstrcmp(data->exclude->entry[i], bkey) == BSTR_OK)
-            {
-                DEBUG_PRINT(DEBUGLEV_DETAIL, "Skipping excluded %s", bdata(bkey));
-                return;
-            }
-        }
+        return blength(y->name) - blength(x->name);
     }
+    return x->order - y->order;
+}
 
-    if (binstrcaseless(data->formula, 0, bkey) != BSTR_ERR)
+int replace_all(RuntimeWorkgroupResult* result, bstring formula, struct bstrList* exclude)
+{
+    if ((!result) || (!formula))
+    {
+        return -EINVAL;
+    }
+    ReplaceData data = {.num_entries = 0, .entries = NULL, .variable = 1};
+    data.entries = malloc(MAX(result->values.num_slots + result->variables.num_slots, 1) * sizeof(ReplaceEntry));
+    if (!data.entries)
+    {
+        return -ENOMEM;
+    }
+    DEBUG_PRINT(DEBUGLEV_DEVELOP, "Replacing variables and values");
+    foreach_variable(result, _replace_entry_cb, &data);
+    data.variable = 0;
+    foreach_value(result, _replace_entry_cb, &data);
+    qsort(data.entries, data.num_entries, sizeof(ReplaceEntry), _compare_replace_entries);
+    for (int i = 0; i < data.num_entries; i++)
     {
-        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Replacing '%s' with '%s' in '%s'", bdata(bkey), bdata(bval), bdata(data->formula));
-        err = bfindreplace(data->formula, bkey, bval, 0);
-        if (err != BSTR_OK)
+        ReplaceEntry* e = &data.entries[i];
+        int excluded = 0;
+        for (int j = 0; exclude && j < exclude->qty && !excluded; j++)
         {
-            ERROR_PRINT("Failed to replace %s in '%s'", bdata(bkey), bdata(data->formula));
+            excluded = (bstrcmp(exclude->entry[j], e->name) == BSTR_OK);
         }
-        if (data->exclude)
+        if (excluded)
         {
-            bstrListAdd(data->exclude, bkey);
+            DEBUG_PRINT(DEBUGLEV_DETAIL, "Skipping excluded %s", bdata(e->name));
+            continue;
+        }
+        if (binstrcaseless(formula, 0, e->name) != BSTR_ERR)
+        {
+            bstring bval = (e->variable ? get_variable_text(result, e->id) : get_value_text(result, e->id));
+            DEBUG_PRINT(DEBUGLEV_DEVELOP, "Replacing '%s' with '%s' in '%s'", bdata(e->name), bdata(bval), bdata(formula));
+            if (bfindreplace(formula, e->name, bval, 0) != BSTR_OK)
+            {
+                ERROR_PRINT("Failed to replace %s in '%s'", bdata(e->name), bdata(formula));
+            }
+            bdestroy(bval);
+            if (exclude)
+            {
+                bstrListAdd(exclude, e->name);
+            }
         }
     }
+    free(data.entries);
+    return 0;
 }
 
-
-
-int replace_all(RuntimeWorkgroupResult* result, bstring formula, struct bstrList* exclude)
+static void _print_value_cb(int id, bstring name, mpointer user_data)
 {
-    if ((!result) || (!result->values) || (!result->variables) || (!formula))
-    {
-        return -EINVAL;
-    }
-    struct replace_all_data data = {
-        .formula = bstrcpy(formula),
-        .exclude = exclude,
-        .map = result->variables,
-    };
-    DEBUG_PRINT(DEBUGLEV_DEVELOP, "Replacing variables");
-    foreach_in_bmap(result->variables, replace_all_cb, &data);
-    DEBUG_PRINT(DEBUGLEV_DEVELOP, "Replacing values");
-    data.map = result->values;
-    foreach_in_bmap(result->values, replace_all_cb, &data);
-    btrunc(formula, 0);
-    bconcat(formula, data.formula);
-    bdestroy(data.formula);
-    return 0;
+    RuntimeWorkgroupResult* result = (RuntimeWorkgroupResult*)user_data;
+    bstring bval = get_value_text(result, id);
+    printf("\t%s : %s\n", bdata(name), bdata(bval));
+    bdestroy(bval);
 }
 
-static void print_all_cb(mpointer key, mpointer value, mpointer user_data)
+static void _print_variable_cb(int id, bstring name, mpointer user_data)
 {
-    bstring bkey = (bstring) key;
-    bstring bval = (bstring)value;
-    printf("\t%s : %s\n", bdata(bkey), bdata(bval));
+    RuntimeWorkgroupResult* result = (RuntimeWorkgroupResult*)user_data;
+    bstring bval = get_variable_text(result, id);
+    printf("\t%s : %s\n", bdata(name), bdata(bval));
+    bdestroy(bval);
 }
 
 void print_result(RuntimeWorkgroupResult* result)
 {
     printf("Stored values:\n");
-    foreach_in_bmap(result->values, print_all_cb, NULL);
+    foreach_value(result, _print_value_cb, result);
     printf("Stored variables:\n");
-    foreach_in_bmap(result->variables, print_all_cb, NULL);
+    foreach_variable(result, _print_variable_cb, result);
 }
 
-void destroy_result(RuntimeWorkgroupResult* result)
+static void _destroy_slots(ResultSlots* slots)
 {
-    DEBUG_PRINT(DEBUGLEV_DEVELOP, "Values %p Variables %p", result->values, result->variables);
-    if (result->values)
+    for (int id = 0; slots->texts && id < slots->num_slots; id++)
     {
-        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Free values map");
-        destroy_bmap(result->values);
-        result->values = NULL;
+        bdestroy(slots->texts[id]);
     }
-    if (result->variables)
+    free(slots->types);
+    free(slots->slots);
+    free(slots->texts);
+    memset(slots, 0, sizeof(ResultSlots));
+}
+
+void destroy_result(RuntimeWorkgroupResult* result)
+{
+    if (!result)
     {
-        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Free variables map");
-        destroy_bmap(result->variables);
-        result->variables = NULL;
+        return;
     }
+    DEBUG_PRINT(DEBUGLEV_DEVELOP, "Free %d value and %d variable slots", result->values.num_slots, result->variables.num_slots);
+    _destroy_slots(&result->values);
+    _destroy_slots(&result->variables);
 }
 
 int fill_results(RuntimeConfig* runcfg)
 {
     int total_threads = 0;
 
-    for (int i = 0; i < runcfg->num_params; i++)
+    /* The workgroups may run different kernels, so the streams are those of each workgroup's kernel */
+    for (int w = 0; w < runcfg->num_wgroups; w++)
     {
-        RuntimeParameterConfig* p = &runcfg->params[i];
-        for (int s = 0; s < runcfg->tcfg->num_streams; s++)
+        RuntimeWorkgroupConfig *wgroup = &runcfg->wgroups[w];
+        for (int i = 0; i < runcfg->num_params; i++)
         {
-            TestConfigStream *istream = &runcfg->tcfg->streams[s];
-            for (int k = 0; k < istream->num_dims && k < istream->dims->qty; k++)
+            RuntimeParameterConfig* p = &runcfg->params[i];
+            for (int s = 0; s < wgroup->tcfg->num_streams; s++)
             {
-                bstring btmp = bstrcpy(istream->dims->entry[k]);
-                if (biseq(p->name, btmp) && blength(p->value) > 0)
+                TestConfigStream *istream = &wgroup->tcfg->streams[s];
+                for (int k = 0; k < istream->num_dims && k < istream->dims->qty; k++)
                 {
-                    DEBUG_PRINT(DEBUGLEV_DEVELOP, "Add runtime parameter %s", bdata(p->name));
-                    bstring barraysize = bformat("%zu", convertToBytes(p->value)); // array in Bytes
-                    add_variable(runcfg->global_results, btmp, barraysize);
-                    for (int w = 0; w < runcfg->num_wgroups; w++)
+                    bstring btmp = bstrcpy(istream->dims->entry[k]);
+                    if (biseq(p->name, btmp) && blength(p->value) > 0)
                     {
-                        RuntimeWorkgroupConfig *wgroup = &runcfg->wgroups[w];
+                        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Add runtime parameter %s", bdata(p->name));
+                        bstring barraysize = bformat("%zu", convertToBytes(p->value)); // array in Bytes
+                        add_variable(runcfg->global_results, btmp, barraysize);
                         for (int t = 0; t < wgroup->num_threads; t++)
                         {
                             add_variable(&wgroup->results[t], btmp, barraysize);
                         }
+                        bdestroy(barraysize);
                     }
-                    bdestroy(barraysize);
+                    bdestroy(btmp);
                 }
-                bdestroy(btmp);
             }
         }
     }
 
-    bstring biter;
-    if (runcfg->iterations >= 0)
+    /* The names are interned once, the per-thread variables are set by id */
+    int numthreads_id = symbol_intern(&bnumthreads, symbol_hash(&bnumthreads));
+    int groupid_id = symbol_intern(&bgroupid, symbol_hash(&bgroupid));
+    int globalid_id = symbol_intern(&bglobalid, symbol_hash(&bglobalid));
+    int threadid_id = symbol_intern(&bthreadid, symbol_hash(&bthreadid));
+    int threadcpu_id = symbol_intern(&bthreadcpu, symbol_hash(&bthreadcpu));
+    int iter_id = symbol_intern(&biterations, symbol_hash(&biterations));
+    if (numthreads_id < 0 || groupid_id < 0 || globalid_id < 0 || threadid_id < 0 || threadcpu_id < 0 || iter_id < 0)
     {
-	    biter = bformat("%zu", runcfg->iterations);
+        errno = ENOMEM;
+        ERROR_PRINT("Failed to intern the thread variables");
+        return -ENOMEM;
     }
-    else
-    {
-	    biter = bformat("%zu", 0);
-    }
-    // add_variable(runcfg->global_results, &biterations, biter);
+    int64_t iter = (runcfg->iterations >= 0 ? (int64_t)runcfg->iterations : 0);
     for (int i = 0; i < runcfg->num_wgroups; i++)
     {
         RuntimeWorkgroupConfig *wgroup = &runcfg->wgroups[i];
         for (int j = 0; j < wgroup->num_threads; j++)
         {
-            add_variable(&wgroup->results[j], &biterations, biter);
+            set_variable_by_id(&wgroup->results[j], iter_id, iter);
         }
-        bstring x = bformat("%d", wgroup->num_threads);
-        add_variable(wgroup->group_results, &bnumthreads, x);
-        bdestroy(x);
-        x = bformat("%d", i);
-        add_variable(wgroup->group_results, &bgroupid, x);
-        bdestroy(x);
+        set_variable_by_id(wgroup->group_results, numthreads_id, wgroup->num_threads);
+        set_variable_by_id(wgroup->group_results, groupid_id, i);
     }
-    bdestroy(biter);
 
-    for (int i = 0; i < runcfg->tcfg->num_constants; i++)
-    {
-        TestConfigVariable* v = &runcfg->tcfg->constants[i];
-        add_variable(runcfg->global_results, v->name, v->value);
-    }
-    for (int i = 0; i < runcfg->tcfg->num_vars; i++)
+    /* The global results keep the first value of constants and variables shared by several kernels */
+    for (int i = 0; i < runcfg->num_wgroups; i++)
     {
-        TestConfigVariable* v = &runcfg->tcfg->vars[i];
-        add_variable(runcfg->global_results, v->name, v->value);
-
-        for (int i = 0; i < runcfg->num_wgroups; i++)
+        RuntimeWorkgroupConfig *wgroup = &runcfg->wgroups[i];
+        for (int c = 0; c < wgroup->tcfg->num_constants; c++)
         {
-            RuntimeWorkgroupConfig *wgroup = &runcfg->wgroups[i];
+            TestConfigVariable* v = &wgroup->tcfg->constants[c];
+            add_variable(runcfg->global_results, v->name, v->value);
+        }
+        for (int c = 0; c < wgroup->tcfg->num_vars; c++)
+        {
+            TestConfigVariable* v = &wgroup->tcfg->vars[c];
+            add_variable(runcfg->global_results, v->name, v->value);
             for (int j = 0; j < wgroup->num_threads; j++)
             {
                 add_variable(&wgroup->results[j], v->name, v->value);
@@ -839,33 +716,16 @@ int fill_results(RuntimeConfig* runcfg)
 
         for (int j = 0; j < wgroup->num_threads; j++)
         {
-            bstring x = bformat("%d", wgroup->num_threads);
-            add_variable(&wgroup->results[j], &bnumthreads, x);
-            bdestroy(x);
-
-            x = bformat("%d", i);
-            add_variable(&wgroup->results[j], &bgroupid, x);
-            bdestroy(x);
-
-            int global_id = total_threads + j;
-            x = bformat("%d", global_id);
-            add_variable(&wgroup->results[j], &bglobalid, x);
-            bdestroy(x);
-
-            x = bformat("%d", j);
-            add_variable(&wgroup->results[j], &bthreadid, x);
-            bdestroy(x);
-
-            x = bformat("%d", wgroup->hwthreads[j]);
-            add_variable(&wgroup->results[j], &bthreadcpu, x);
-            bdestroy(x);
-
+            RuntimeWorkgroupResult* result = &wgroup->results[j];
+            set_variable_by_id(result, numthreads_id, wgroup->num_threads);
+            set_variable_by_id(result, groupid_id, i);
+            set_variable_by_id(result, globalid_id, total_threads + j);
+            set_variable_by_id(result, threadid_id, j);
+            set_variable_by_id(result, threadcpu_id, wgroup->hwthreads[j]);
         }
         total_threads += wgroup->num_threads;
     }
-    bstring x = bformat("%d", total_threads);
-    add_variable(runcfg->global_results, &bnumthreads, x);
-    bdestroy(x);
+    set_variable_by_id(runcfg->global_results, numthreads_id, total_threads);
 
     // The kv pairs is set to 5. If added any new to _SizeOfStreamType, increment the counter
     for (int i = 0; i < 5; i++)
@@ -879,9 +739,9 @@ int fill_results(RuntimeConfig* runcfg)
         size_t bytesperiter;
         get_variable(&wgroup->results[0], &bbytesperiter, &bytesperiter);
         // printf("bytesperiter: %zu\n", bytesperiter);
-        for (int s = 0; s < runcfg->tcfg->num_streams; s++)
+        for (int s = 0; s < wgroup->tcfg->num_streams; s++)
         {
-            TestConfigStream *istream = &runcfg->tcfg->streams[s];
+            TestConfigStream *istream = &wgroup->tcfg->streams[s];
             for (int k = 0; k < istream->num_dims && k < istream->dims->qty; k++)
             {
                 size_t rounddown_factor = bytesperiter * wgroup->num_threads * getsizeof(istream->type);
@@ -0,0 +1,236 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "bstrlib.h"
+#include "bstrlib_helper.h"
+#include "error.h"
+#include "scaling.h"
+#include "table.h"
+#include "topology.h"
+
+static const char* _scaling_names[MAX_SCALING] = {
+    [SCALING_NONE] = "none",
+    [SCALING_COMPACT] = "compact",
+    [SCALING_SCATTER] = "scatter",
+};
+
+const char* scaling_order_name(ScalingOrder order)
+{
+    if (order < SCALING_NONE || order >= MAX_SCALING)
+    {
+        return "unknown";
+    }
+    return _scaling_names[order];
+}
+
+int scaling_parse_order(const char* str, ScalingOrder* order)
+{
+    if ((!str) || (!order))
+    {
+        return -EINVAL;
+    }
+    for (int o = SCALING_COMPACT; o < MAX_SCALING; o++)
+    {
+        if (strcasecmp(str, _scaling_names[o]) == 0)
+        {
+            *order = (ScalingOrder)o;
+            return 0;
+        }
+    }
+    return -EINVAL;
+}
+
+/*
+ * Every entry gets the index of its domain (in order of first appearance) and its position in
+ * the domain, where the first hwthread of each core comes before the second one and so on.
+ * Sorting by position and then domain takes one hwthread of every domain per round.
+ */
+int scaling_scatter(int* list, const int* domains, const int* cores, int count)
+{
+    if ((!list) || (!domains) || (!cores) || count < 0)
+    {
+        return -EINVAL;
+    }
+    int* rank = malloc(count * sizeof(int));
+    int* domain = malloc(count * sizeof(int));
+    int* pos = malloc(count * sizeof(int));
+    int* out = malloc(count * sizeof(int));
+    if ((!rank) || (!domain) || (!pos) || (!out))
+    {
+        free(rank);
+        free(domain);
+        free(pos);
+        free(out);
+        return -ENOMEM;
+    }
+    int num_domains = 0;
+    for (int i = 0; i < count; i++)
+    {
+        rank[i] = 0;
+        domain[i] = -1;
+        for (int j = 0; j < i; j++)
+        {
+            if (domains[j] == domains[i])
+            {
+                domain[i] = domain[j];
+                rank[i] += (cores[j] == cores[i]);
+            }
+        }
+        if (domain[i] < 0)
+        {
+            domain[i] = num_domains++;
+        }
+    }
+    for (int i = 0; i < count; i++)
+    {
+        pos[i] = 0;
+        for (int j = 0; j < count; j++)
+        {
+            if (domain[j] == domain[i] && (rank[j] < rank[i] || (rank[j] == rank[i] && j < i)))
+            {
+                pos[i]++;
+            }
+        }
+    }
+    for (int i = 0; i < count; i++)
+    {
+        int idx = 0;
+        for (int j = 0; j < count; j++)
+        {
+            if (pos[j] < pos[i] || (pos[j] == pos[i] && domain[j] < domain[i]))
+            {
+                idx++;
+            }
+        }
+        out[idx] = list[i];
+    }
+    memcpy(list, out, count * sizeof(int));
+    free(rank);
+    free(domain);
+    free(pos);
+    free(out);
+    return 0;
+}
+
+int scaling_order_hwthreads(int* list, int count, ScalingOrder order)
+{
+    if ((!list) || count < 0)
+    {
+        return -EINVAL;
+    }
+    if (order != SCALING_SCATTER)
+    {
+        return 0;
+    }
+    int* domains = malloc(count * sizeof(int));
+    int* cores = malloc(count * sizeof(int));
+    if ((!domains) || (!cores))
+    {
+        free(domains);
+        free(cores);
+        return -ENOMEM;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        int core = list[i];
+        int socket = 0;
+        get_hwthread_location(list[i], &core, &socket);
+        domains[i] = get_hwthread_numa_id(list[i]);
+        if (domains[i] < 0)
+        {
+            /* Without NUMA information the sockets are the domains */
+            domains[i] = socket;
+        }
+        /* Core IDs repeat across the sockets */
+        cores[i] = socket * get_num_hw_threads() + core;
+    }
+    int err = scaling_scatter(list, domains, cores, count);
+    free(domains);
+    free(cores);
+    return err;
+}
+
+int scaling_saturation(const double* rates, int count, double fraction)
+{
+    if ((!rates) || count <= 0 || fraction <= 0.0 || fraction > 1.0)
+    {
+        return -EINVAL;
+    }
+    double peak = rates[0];
+    for (int p = 1; p < count; p++)
+    {
+        if (rates[p] > peak)
+        {
+            peak = rates[p];
+        }
+    }
+    for (int p = 0; p < count; p++)
+    {
+        if (rates[p] >= fraction * peak)
+        {
+            return p;
+        }
+    }
+    return count - 1;
+}
+
+int scaling_table(struct bstrList* metrics, int num_points, const int* hwthreads, const double* rates, Table** table)
+{
+    if ((!metrics) || (!hwthreads) || (!rates) || (!table) || num_points <= 0)
+    {
+        return -EINVAL;
+    }
+    struct bstrList* bheaders = bstrListCreate();
+    bstring btmp = bfromcstr("threads");
+    bstrListAdd(bheaders, btmp);
+    bdestroy(btmp);
+    btmp = bfromcstr("hwthread");
+    bstrListAdd(bheaders, btmp);
+    bdestroy(btmp);
+    for (int m = 0; m < metrics->qty; m++)
+    {
+        bstrListAdd(bheaders, metrics->entry[m]);
+        btmp = bformat("%s per thread", bdata(metrics->entry[m]));
+        bstrListAdd(bheaders, btmp);
+        bdestroy(btmp);
+        btmp = bformat("%s efficiency", bdata(metrics->entry[m]));
+        bstrListAdd(bheaders, btmp);
+        bdestroy(btmp);
+    }
+    int err = table_create(bheaders, table);
+    bstrListDestroy(bheaders);
+    if (err != 0)
+    {
+        return err;
+    }
+    for (int p = 0; p < num_points && err == 0; p++)
+    {
+        struct bstrList* brow = bstrListCreate();
+        btmp = bformat("%d", p + 1);
+        bstrListAdd(brow, btmp);
+        bdestroy(btmp);
+        btmp = bformat("%d", hwthreads[p]);
+        bstrListAdd(brow, btmp);
+        bdestroy(btmp);
+        for (int m = 0; m < metrics->qty; m++)
+        {
+            double rate = rates[p * metrics->qty + m];
+            double single = rates[m];
+            btmp = bformat("%.15lf", rate);
+            bstrListAdd(brow, btmp);
+            bdestroy(btmp);
+            btmp = bformat("%.15lf", rate / (p + 1));
+            bstrListAdd(brow, btmp);
+            bdestroy(btmp);
+            btmp = bformat("%.15lf", (single > 0.0 ? rate / ((p + 1) * single) : 0.0));
+            bstrListAdd(brow, btmp);
+            bdestroy(btmp);
+        }
+        err = table_addrow(*table, brow);
+        bstrListDestroy(brow);
+    }
+    return err;
+}
@@ -0,0 +1,299 @@
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "stats.h"
+
+/* Two-sided 95% quantiles of Student's t distribution for 1 to 30 degrees of freedom */
+static const double _tquantiles[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+};
+
+static int _num_tquantiles = sizeof(_tquantiles) / sizeof(_tquantiles[0]);
+
+static int _compare_uint64(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static double _percentile(const uint64_t* sorted, int count, double p)
+{
+    double rank = p * (double)(count - 1);
+    int lower = (int)rank;
+    if (lower >= count - 1)
+    {
+        return (double)sorted[count - 1];
+    }
+    double frac = rank - (double)lower;
+    return (double)sorted[lower] + frac * ((double)sorted[lower + 1] - (double)sorted[lower]);
+}
+
+double sample_tquantile(int count)
+{
+    int df = count - 1;
+    if (df < 1)
+    {
+        return 0.0;
+    }
+    if (df <= _num_tquantiles)
+    {
+        return _tquantiles[df - 1];
+    }
+    /* Cornish-Fisher expansion around the normal quantile, accurate to 1e-3 beyond the table */
+    const double z = 1.959964;
+    return z + (z * z * z + z) / (4.0 * df) + (5 * pow(z, 5) + 16 * pow(z, 3) + 3 * z) / (96.0 * df * df);
+}
+
+double sample_relerror(int count, double mean, double m2)
+{
+    if (count < STATS_MIN_SAMPLES || mean <= 0.0)
+    {
+        return -1.0;
+    }
+    double stddev = sqrt(m2 / (double)(count - 1));
+    return sample_tquantile(count) * stddev / sqrt((double)count) / mean;
+}
+
+int sample_stats(const uint64_t* samples, int count, SampleStats* stats)
+{
+    if ((!samples) || (!stats) || (count <= 0))
+    {
+        return -EINVAL;
+    }
+    uint64_t* sorted = malloc(count * sizeof(uint64_t));
+    if (!sorted)
+    {
+        return -ENOMEM;
+    }
+    memcpy(sorted, samples, count * sizeof(uint64_t));
+    qsort(sorted, count, sizeof(uint64_t), _compare_uint64);
+
+    double mean = 0.0;
+    double m2 = 0.0;
+    for (int i = 0; i < count; i++)
+    {
+        double delta = (double)sorted[i] - mean;
+        mean += delta / (double)(i + 1);
+        m2 += delta * ((double)sorted[i] - mean);
+    }
+
+    memset(stats, 0, sizeof(SampleStats));
+    stats->count = count;
+    stats->min = (double)sorted[0];
+    stats->max = (double)sorted[count - 1];
+    stats->median = _percentile(sorted, count, 0.5);
+    stats->p5 = _percentile(sorted, count, 0.05);
+    stats->p95 = _percentile(sorted, count, 0.95);
+    stats->mean = mean;
+    if (count > 1)
+    {
+        stats->stddev = sqrt(m2 / (double)(count - 1));
+        stats->ci = sample_tquantile(count) * stats->stddev / sqrt((double)count);
+    }
+    free(sorted);
+    return 0;
+}
+
+int sample_overlap(const uint64_t* starts, const uint64_t* stops, int count, OverlapStats* stats)
+{
+    if ((!starts) || (!stops) || (!stats) || (count <= 0))
+    {
+        return -EINVAL;
+    }
+    uint64_t first_start = starts[0];
+    uint64_t last_start = starts[0];
+    uint64_t first_stop = stops[0];
+    uint64_t last_stop = stops[0];
+    for (int i = 0; i < count; i++)
+    {
+        if (stops[i] < starts[i])
+        {
+            return -EINVAL;
+        }
+        first_start = (starts[i] < first_start ? starts[i] : first_start);
+        last_start = (starts[i] > last_start ? starts[i] : last_start);
+        first_stop = (stops[i] < first_stop ? stops[i] : first_stop);
+        last_stop = (stops[i] > last_stop ? stops[i] : last_stop);
+    }
+    memset(stats, 0, sizeof(OverlapStats));
+    stats->start_skew = (double)(last_start - first_start);
+    stats->stop_skew = (double)(last_stop - first_stop);
+    stats->overlap = (first_stop > last_start ? (double)(first_stop - last_start) : 0.0);
+    stats->span = (double)(last_stop - first_start);
+    return 0;
+}
+
+static const char* _aggregation_names[MAX_AGGREGATION] = {
+    [AGGREGATION_MIN] = "min",
+    [AGGREGATION_MAX] = "max",
+    [AGGREGATION_SUM] = "sum",
+    [AGGREGATION_MEDIAN] = "median",
+    [AGGREGATION_MEAN] = "mean",
+    [AGGREGATION_STDDEV] = "stddev",
+    [AGGREGATION_HMEAN] = "hmean",
+    [AGGREGATION_PERCENTILE] = "p",
+};
+
+int sample_parse_aggregation(const char* name, SampleAggregation* agg)
+{
+    if ((!name) || (!agg))
+    {
+        return -EINVAL;
+    }
+    for (int a = AGGREGATION_MIN; a < AGGREGATION_PERCENTILE; a++)
+    {
+        if (strcasecmp(name, _aggregation_names[a]) == 0)
+        {
+            agg->type = (AggregationType)a;
+            agg->percentile = 0.0;
+            return 0;
+        }
+    }
+    if ((name[0] == 'p' || name[0] == 'P') && name[1] != '\0')
+    {
+        char* end = NULL;
+        double p = strtod(&name[1], &end);
+        if (*end == '\0' && p >= 0.0 && p <= 100.0)
+        {
+            agg->type = AGGREGATION_PERCENTILE;
+            agg->percentile = p / 100.0;
+            return 0;
+        }
+    }
+    return -EINVAL;
+}
+
+/* Partitioning of Wirth's algorithm, runs of equal values do not degrade it */
+double sample_select(double* values, int count, int k)
+{
+    int left = 0;
+    int right = count - 1;
+    while (left < right)
+    {
+        double pivot = values[k];
+        int i = left;
+        int j = right;
+        do
+        {
+            while (values[i] < pivot) i++;
+            while (pivot < values[j]) j--;
+            if (i <= j)
+            {
+                double tmp = values[i];
+                values[i] = values[j];
+                values[j] = tmp;
+                i++;
+                j--;
+            }
+        } while (i <= j);
+        if (j < k) left = i;
+        if (k < i) right = j;
+    }
+    return values[k];
+}
+
+static double _select_percentile(double* values, int count, double p)
+{
+    double rank = p * (double)(count - 1);
+    int lower = (int)rank;
+    double value = sample_select(values, count, lower);
+    if (lower >= count - 1)
+    {
+        return value;
+    }
+    /* The next rank is the smallest value after the selected one */
+    double next = values[lower + 1];
+    for (int i = lower + 2; i < count; i++)
+    {
+        next = (values[i] < next ? values[i] : next);
+    }
+    return value + (rank - (double)lower) * (next - value);
+}
+
+int sample_aggregate(const SampleAggregation* agg, double* values, int count, double* result)
+{
+    if ((!agg) || (!values) || (!result))
+    {
+        return -EINVAL;
+    }
+    int n = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (!isnan(values[i]))
+        {
+            values[n++] = values[i];
+        }
+    }
+    if (n == 0)
+    {
+        return -EINVAL;
+    }
+    double value = values[0];
+    switch (agg->type)
+    {
+        case AGGREGATION_MIN:
+            for (int i = 1; i < n; i++)
+            {
+                value = (values[i] < value ? values[i] : value);
+            }
+            break;
+        case AGGREGATION_MAX:
+            for (int i = 1; i < n; i++)
+            {
+                value = (values[i] > value ? values[i] : value);
+            }
+            break;
+        case AGGREGATION_SUM:
+        case AGGREGATION_MEAN:
+            for (int i = 1; i < n; i++)
+            {
+                value += values[i];
+            }
+            if (agg->type == AGGREGATION_MEAN)
+            {
+                value /= (double)n;
+            }
+            break;
+        case AGGREGATION_MEDIAN:
+            value = sample_select(values, n, (n - 1) / 2);
+            break;
+        case AGGREGATION_STDDEV:
+        {
+            double mean = 0.0;
+            double m2 = 0.0;
+            for (int i = 0; i < n; i++)
+            {
+                double delta = values[i] - mean;
+                mean += delta / (double)(i + 1);
+                m2 += delta * (values[i] - mean);
+            }
+            value = (n > 1 ? sqrt(m2 / (double)(n - 1)) : 0.0);
+            break;
+        }
+        case AGGREGATION_HMEAN:
+        {
+            double inverse = 0.0;
+            for (int i = 0; i < n && !isnan(inverse); i++)
+            {
+                /* A zero rate makes the harmonic mean zero, it is undefined for negative ones */
+                inverse = (values[i] < 0.0 ? NAN : inverse + 1.0 / values[i]);
+            }
+            value = (double)n / inverse;
+            break;
+        }
+        case AGGREGATION_PERCENTILE:
+            value = _select_percentile(values, n, agg->percentile);
+            break;
+        default:
+            return -EINVAL;
+    }
+    *result = value;
+    return 0;
+}
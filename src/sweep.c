@@ -0,0 +1,221 @@
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bstrlib.h"
+#include "bstrlib_helper.h"
+#include "error.h"
+#include "helper.h"
+#include "sweep.h"
+
+int sweep_value(const_bstring str, size_t* value, int* has_unit)
+{
+    char* endptr = NULL;
+    const char* s = bdata(str);
+    if ((!s) || (s[0] < '0') || (s[0] > '9'))
+    {
+        return -EINVAL;
+    }
+    errno = 0;
+    unsigned long long v = strtoull(s, &endptr, 10);
+    if (errno != 0)
+    {
+        return -EINVAL;
+    }
+    if (*endptr == '\0')
+    {
+        *value = (size_t)v;
+        *has_unit = 0;
+        return 0;
+    }
+    *value = convertToBytes(str);
+    *has_unit = 1;
+    return (*value > 0 || v == 0 ? 0 : -EINVAL);
+}
+
+static int _sweep_add(struct bstrList* points, size_t value, int bytes)
+{
+    if (points->qty >= SWEEP_MAX_POINTS)
+    {
+        errno = E2BIG;
+        ERROR_PRINT("Sweep has more than %d points", SWEEP_MAX_POINTS);
+        return -E2BIG;
+    }
+    bstring p = (bytes ? bformat("%zuB", value) : bformat("%zu", value));
+    bstrListAdd(points, p);
+    bdestroy(p);
+    return 0;
+}
+
+static int _sweep_list(struct bstrList* items, struct bstrList* points)
+{
+    for (int i = 0; i < items->qty; i++)
+    {
+        size_t value = 0;
+        int unit = 0;
+        btrimws(items->entry[i]);
+        if (sweep_value(items->entry[i], &value, &unit) != 0)
+        {
+            errno = EINVAL;
+            ERROR_PRINT("Invalid point '%s' in sweep", bdata(items->entry[i]));
+            return -EINVAL;
+        }
+        if (points->qty >= SWEEP_MAX_POINTS)
+        {
+            errno = E2BIG;
+        ERROR_PRINT("Sweep has more than %d points", SWEEP_MAX_POINTS);
+            return -E2BIG;
+        }
+        bstrListAdd(points, items->entry[i]);
+    }
+    return 0;
+}
+
+static int _sweep_range(struct bstrList* items, struct bstrList* points)
+{
+    size_t start = 0;
+    size_t end = 0;
+    size_t increment = 0;
+    double factor = SWEEP_DEFAULT_FACTOR;
+    int start_unit = 0;
+    int end_unit = 0;
+    int step_unit = 0;
+    for (int i = 0; i < items->qty; i++)
+    {
+        btrimws(items->entry[i]);
+    }
+    if (sweep_value(items->entry[0], &start, &start_unit) != 0 || sweep_value(items->entry[1], &end, &end_unit) != 0 || start > end)
+    {
+        errno = EINVAL;
+        ERROR_PRINT("Invalid sweep range from '%s' to '%s'", bdata(items->entry[0]), bdata(items->entry[1]));
+        return -EINVAL;
+    }
+    if (items->qty == 3)
+    {
+        bstring step = bstrcpy(items->entry[2]);
+        char c = bchar(step, 0);
+        int err = 0;
+        if (c == 'x' || c == 'X' || c == '*')
+        {
+            char* endptr = NULL;
+            factor = strtod(bdata(step) + 1, &endptr);
+            err = (endptr == bdata(step) + 1 || *endptr != '\0' || !(factor > 1.0)) ? -EINVAL : 0;
+        }
+        else
+        {
+            if (c == '+')
+            {
+                bdelete(step, 0, 1);
+            }
+            err = sweep_value(step, &increment, &step_unit);
+            err = (err == 0 && increment == 0 ? -EINVAL : err);
+        }
+        bdestroy(step);
+        if (err != 0)
+        {
+            errno = EINVAL;
+            ERROR_PRINT("Invalid sweep step '%s'", bdata(items->entry[2]));
+            return -EINVAL;
+        }
+    }
+    int bytes = start_unit || end_unit || step_unit;
+    size_t value = start;
+    while (value <= end)
+    {
+        int err = _sweep_add(points, value, bytes);
+        if (err != 0)
+        {
+            return err;
+        }
+        size_t next = 0;
+        if (increment > 0)
+        {
+            next = value + increment;
+        }
+        else
+        {
+            double scaled = round((double)value * factor);
+            /* Small values must still make progress, e.g. 1:10:x1.5 */
+            next = (scaled >= (double)SIZE_MAX ? SIZE_MAX : (size_t)scaled);
+            next = (next <= value ? value + 1 : next);
+        }
+        if (next <= value)
+        {
+            break;
+        }
+        value = next;
+    }
+    return 0;
+}
+
+int sweep_parse(const_bstring str, struct bstrList** points)
+{
+    int err = 0;
+    if ((!str) || (!points))
+    {
+        return -EINVAL;
+    }
+    bstring value = bstrcpy(str);
+    btrimws(value);
+    struct bstrList* out = bstrListCreate();
+    if (blength(value) == 0)
+    {
+        err = -EINVAL;
+    }
+    else if (bstrchr(value, ',') != BSTR_ERR)
+    {
+        struct bstrList* items = bsplit(value, ',');
+        err = _sweep_list(items, out);
+        bstrListDestroy(items);
+    }
+    else if (bstrchr(value, ':') != BSTR_ERR)
+    {
+        struct bstrList* items = bsplit(value, ':');
+        if (items->qty == 2 || items->qty == 3)
+        {
+            err = _sweep_range(items, out);
+        }
+        else
+        {
+            errno = EINVAL;
+            ERROR_PRINT("Invalid sweep '%s', use <start>:<end>[:<step>]", bdata(value));
+            err = -EINVAL;
+        }
+        bstrListDestroy(items);
+    }
+    else
+    {
+        bstrListAdd(out, value);
+    }
+    bdestroy(value);
+    if (err != 0)
+    {
+        bstrListDestroy(out);
+        return err;
+    }
+    *points = out;
+    return out->qty;
+}
+
+int sweep_largest(struct bstrList* points)
+{
+    int largest = 0;
+    size_t max = 0;
+    if ((!points) || (points->qty == 0))
+    {
+        return -EINVAL;
+    }
+    for (int i = 0; i < points->qty; i++)
+    {
+        size_t value = 0;
+        int unit = 0;
+        if (sweep_value(points->entry[i], &value, &unit) == 0 && value > max)
+        {
+            max = value;
+            largest = i;
+        }
+    }
+    return largest;
+}
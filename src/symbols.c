@@ -0,0 +1,175 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "symbols.h"
+#include "bstrlib.h"
+#include "bstrlib_helper.h"
+
+/*
+ * Open addressing table with linear probing. The buckets hold symbol IDs (-1 if empty) and
+ * have at least twice as many entries as there are symbols, so probes stay short.
+ */
+typedef struct {
+    int num_symbols;
+    int max_symbols;
+    bstring* names;
+    uint32_t* hashes;
+    int num_buckets;
+    int* buckets;
+} SymbolTable;
+
+static SymbolTable _symbols = {0, 0, NULL, NULL, 0, NULL};
+/* Results of the threads are filled from several threads */
+static pthread_mutex_t _symbols_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* 32-bit FNV-1a */
+uint32_t symbol_hash(const_bstring name)
+{
+    uint32_t hash = 2166136261u;
+    for (int i = 0; name && i < blength(name); i++)
+    {
+        hash ^= (uint32_t)name->data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static int _find(const_bstring name, uint32_t hash, int* bucket)
+{
+    if (_symbols.num_buckets == 0)
+    {
+        return -ENOENT;
+    }
+    int mask = _symbols.num_buckets - 1;
+    for (int b = (int)(hash & (uint32_t)mask); ; b = (b + 1) & mask)
+    {
+        int id = _symbols.buckets[b];
+        if (id < 0)
+        {
+            if (bucket) *bucket = b;
+            return -ENOENT;
+        }
+        if (_symbols.hashes[id] == hash && biseq(_symbols.names[id], name))
+        {
+            return id;
+        }
+    }
+}
+
+static int _grow()
+{
+    if (_symbols.num_symbols == _symbols.max_symbols)
+    {
+        int max_symbols = (_symbols.max_symbols > 0 ? 2 * _symbols.max_symbols : 64);
+        bstring* names = realloc(_symbols.names, max_symbols * sizeof(bstring));
+        if (names) _symbols.names = names;
+        uint32_t* hashes = realloc(_symbols.hashes, max_symbols * sizeof(uint32_t));
+        if (hashes) _symbols.hashes = hashes;
+        if ((!names) || (!hashes))
+        {
+            return -ENOMEM;
+        }
+        _symbols.max_symbols = max_symbols;
+    }
+    if (2 * (_symbols.num_symbols + 1) > _symbols.num_buckets)
+    {
+        int num_buckets = (_symbols.num_buckets > 0 ? 2 * _symbols.num_buckets : 128);
+        int* buckets = malloc(num_buckets * sizeof(int));
+        if (!buckets)
+        {
+            return -ENOMEM;
+        }
+        for (int b = 0; b < num_buckets; b++)
+        {
+            buckets[b] = -1;
+        }
+        for (int id = 0; id < _symbols.num_symbols; id++)
+        {
+            int b = (int)(_symbols.hashes[id] & (uint32_t)(num_buckets - 1));
+            while (buckets[b] >= 0)
+            {
+                b = (b + 1) & (num_buckets - 1);
+            }
+            buckets[b] = id;
+        }
+        free(_symbols.buckets);
+        _symbols.buckets = buckets;
+        _symbols.num_buckets = num_buckets;
+    }
+    return 0;
+}
+
+int symbol_intern(const_bstring name, uint32_t hash)
+{
+    if ((!name) || (!name->data))
+    {
+        return -EINVAL;
+    }
+    pthread_mutex_lock(&_symbols_lock);
+    int id = _find(name, hash, NULL);
+    if (id == -ENOENT)
+    {
+        int bucket = 0;
+        id = _grow();
+        if (id == 0)
+        {
+            /* The buckets may have been rebuilt */
+            _find(name, hash, &bucket);
+            id = _symbols.num_symbols++;
+            _symbols.names[id] = bstrcpy(name);
+            _symbols.hashes[id] = hash;
+            _symbols.buckets[bucket] = id;
+        }
+    }
+    pthread_mutex_unlock(&_symbols_lock);
+    return id;
+}
+
+int symbol_find(const_bstring name, uint32_t hash)
+{
+    if ((!name) || (!name->data))
+    {
+        return -EINVAL;
+    }
+    pthread_mutex_lock(&_symbols_lock);
+    int id = _find(name, hash, NULL);
+    pthread_mutex_unlock(&_symbols_lock);
+    return id;
+}
+
+bstring symbol_name(int id)
+{
+    bstring name = NULL;
+    pthread_mutex_lock(&_symbols_lock);
+    if (id >= 0 && id < _symbols.num_symbols)
+    {
+        name = _symbols.names[id];
+    }
+    pthread_mutex_unlock(&_symbols_lock);
+    return name;
+}
+
+int symbol_count()
+{
+    pthread_mutex_lock(&_symbols_lock);
+    int count = _symbols.num_symbols;
+    pthread_mutex_unlock(&_symbols_lock);
+    return count;
+}
+
+void symbol_reset()
+{
+    pthread_mutex_lock(&_symbols_lock);
+    for (int id = 0; id < _symbols.num_symbols; id++)
+    {
+        bdestroy(_symbols.names[id]);
+    }
+    free(_symbols.names);
+    free(_symbols.hashes);
+    free(_symbols.buckets);
+    memset(&_symbols, 0, sizeof(SymbolTable));
+    pthread_mutex_unlock(&_symbols_lock);
+}
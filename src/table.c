@@ -21,6 +21,7 @@ int table_destroy(Table* table)
     bstrListDestroy(table->headers);
     bstrListDestroy(table->rows);
     free(table->col_widths);
+    free(table->keep_format);
     free(table);
     return 0;
 }
@@ -43,6 +44,12 @@ int table_create(struct bstrList* headers, Table** table)
         return -ENOMEM;
     }
     memset(itable->col_widths, 0, itable->num_cols * sizeof(int));
+    itable->keep_format = (int*)calloc(itable->num_cols, sizeof(int));
+    if (!itable->keep_format)
+    {
+        ERROR_PRINT("Failed to allocate memory for Table coloumn formats");
+        return -ENOMEM;
+    }
     for (int c = 0; c < itable->num_cols; c++)
     {
         itable->col_widths[c] = blength(headers->entry[c]);
@@ -51,6 +58,21 @@ int table_create(struct bstrList* headers, Table** table)
     return 0;
 }
 
+/*
+ * Numbers in the column are printed as they are added instead of with the table format,
+ * for columns whose values the caller formats with a common precision.
+ */
+int table_keep_format(Table* table, int col)
+{
+    if (!table || col < 0 || col >= table->num_cols)
+    {
+        ERROR_PRINT("Invalid Table or coloumn");
+        return -EINVAL;
+    }
+    table->keep_format[col] = 1;
+    return 0;
+}
+
 int table_addrow(Table* table, struct bstrList* row)
 {
     if (!table)
@@ -71,7 +93,7 @@ int table_addrow(Table* table, struct bstrList* row)
         if (c > 0) bconchar(brow, '|');
         bstring btmp = bstrcpy(row->entry[c]);
 
-        if (bisinteger(btmp))
+        if (!table->keep_format[c] && bisinteger(btmp))
         {
             int ivalue;
             if (batoi(btmp, &ivalue) == BSTR_OK && ivalue >= 0)
@@ -86,7 +108,7 @@ int table_addrow(Table* table, struct bstrList* row)
                 bdestroy(btmpd);
             }
         }
-        else if (bisnumber(btmp))
+        else if (!table->keep_format[c] && bisnumber(btmp))
         {
             int ivalue;
             double dvalue;
@@ -102,6 +124,15 @@ int table_addrow(Table* table, struct bstrList* row)
                 bdestroy(btmpd);
             }
         }
+        else
+        {
+            // Labels like names and preformatted columns are kept as they are
+            bconcat(brow, btmp);
+            if (blength(btmp) > table->col_widths[c])
+            {
+                table->col_widths[c] = blength(btmp);
+            }
+        }
 
         bdestroy(btmp);
     }
@@ -364,7 +395,8 @@ int table_to_json(FILE* output, Table* table, const char* fname, const char* tna
         for (int c = 0; c < table->num_cols; c++)
         {
             write_indent(file, indent);
-            fprintf(file, "\"%s\": %s", bdata(table->headers->entry[c]), bdata(cells->entry[c]));
+            const char* quote = (bisnumber(cells->entry[c]) ? "" : "\"");
+            fprintf(file, "\"%s\": %s%s%s", bdata(table->headers->entry[c]), quote, bdata(cells->entry[c]), quote);
             if (c < table->num_cols - 1)
             {
                 fprintf(file, ",");
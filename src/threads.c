@@ -17,6 +17,7 @@
 #include <errno.h>
 #include <sys/time.h>
 #include <sys/syscall.h>
+#include <linux/futex.h>
 
 #include "test_strings.h"
 #include "test_types.h"
@@ -25,11 +26,13 @@
 #include "bstrlib.h"
 #include "bstrlib_helper.h"
 #include "allocator.h"
+#include "barrier.h"
 #include "calculator.h"
 #include "results.h"
 #include "bench.h"
 #include "dynload.h"
 #include "bitmask.h"
+#include "latency.h"
 
 
 #if defined(_GNU_SOURCE) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 4)) && HAS_SCHEDAFFINITY
@@ -44,6 +47,10 @@
 #define gettid() getpid()
 #endif
 
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+
+
 
 size_t _linear_offset(int ndims, const off_t* offsets, const size_t* dimsizes, const size_t size)
 {
@@ -74,8 +81,12 @@ int destroy_threads(int num_wgroups, RuntimeWorkgroupConfig* wgroups)
     {
         RuntimeWorkgroupConfig* wg = &wgroups[w];
         DEBUG_PRINT(DEBUGLEV_DEVELOP, "Destroying threads for workgroup %3d", w);
-        pthread_barrier_destroy(&wg->barrier.barrier);
-        pthread_barrierattr_destroy(&wg->barrier.b_attr);
+        barrier_destroy(&wg->barrier);
+        if (wg->dispatch)
+        {
+            free(wg->dispatch);
+            wg->dispatch = NULL;
+        }
         if (wg->threads)
         {
             for (int i = 0; i < wg->num_threads; i++)
@@ -83,17 +94,7 @@ int destroy_threads(int num_wgroups, RuntimeWorkgroupConfig* wgroups)
                 DEBUG_PRINT(DEBUGLEV_DEVELOP, "Destroying hwthread %3d for workgroup %3d", wg->threads[i].data->hwthread, w);
                 if (wg->threads[i].command)
                 {
-                    if (wg->threads[i].command->init_val)
-                    {
-                        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Destroying init_val for hwthread %3d", wg->threads[i].data->hwthread);
-                        free(wg->threads[i].command->init_val);
-                        wg->threads[i].command->init_val = NULL;
-                    }
                     pthread_attr_destroy(&wg->threads[i].command->attr);
-                    pthread_mutex_destroy(&wg->threads[i].command->mutex);
-                    pthread_mutexattr_destroy(&wg->threads[i].command->m_attr);
-                    pthread_cond_destroy(&wg->threads[i].command->cond);
-                    pthread_condattr_destroy(&wg->threads[i].command->c_attr);
                     DEBUG_PRINT(DEBUGLEV_DEVELOP, "Destroying commands for hwthread %3d", wg->threads[i].data->hwthread);
                     free(wg->threads[i].command);
                     wg->threads[i].command = NULL;
@@ -114,10 +115,26 @@ int destroy_threads(int num_wgroups, RuntimeWorkgroupConfig* wgroups)
                     DEBUG_PRINT(DEBUGLEV_DEVELOP, "Destroying hwthread %3d codelines", wg->threads[i].data->hwthread);
                     bstrListDestroy(wg->threads[i].codelines);
                 }
+                if (wg->threads[i].args)
+                {
+                    DEBUG_PRINT(DEBUGLEV_DEVELOP, "Destroying hwthread %3d kernel arguments", wg->threads[i].data->hwthread);
+                    free(wg->threads[i].args);
+                    wg->threads[i].args = NULL;
+                    wg->threads[i].num_args = 0;
+                }
                 wg->threads[i].sdata = NULL;
                 if (wg->threads[i].data)
                 {
                     DEBUG_PRINT(DEBUGLEV_DEVELOP, "Destroying data for hwthread %3d", wg->threads[i].data->hwthread);
+                    if (wg->threads[i].data->samples)
+                    {
+                        free(wg->threads[i].data->samples);
+                        wg->threads[i].data->samples = NULL;
+                    }
+                    free(wg->threads[i].data->starts);
+                    free(wg->threads[i].data->stops);
+                    wg->threads[i].data->starts = NULL;
+                    wg->threads[i].data->stops = NULL;
                     free(wg->threads[i].data);
                     wg->threads[i].data = NULL;
                 }
@@ -243,7 +260,6 @@ int initialize_local(RuntimeThreadConfig* thread, RuntimeStreamConfig* data, int
     {
         RuntimeThreadStreamConfig* str = &thread->tstreams[s];
         // DEBUG_PRINT(DEBUGLEV_DEVELOP, dims: %d, sdata->dims);
-        data->init_val = thread->command->init_val;
         RuntimeStreamConfig tmp = *data;
         tmp.dims = data->dims;
         tmp.ptr = (char*)str->tstream_ptr;
@@ -272,11 +288,9 @@ int initialize_local(RuntimeThreadConfig* thread, RuntimeStreamConfig* data, int
             DEBUG_PRINT(DEBUGLEV_DEVELOP, "dimsize: [%zu][%zu][%zu]", tmp.dimsizes[0], tmp.dimsizes[1], tmp.dimsizes[2]);
             printf("hwthread %3d initializing Array %s Elements: %6zu Size: [%6zu][%6zu][%6zu] Offset: [%15jd][%15jd][%15jd]\n", thread_id, bdata(data->name), elems_per_t, tmp.dimsizes[0], tmp.dimsizes[1], tmp.dimsizes[2], tmp.offsets[0], tmp.offsets[1], tmp.offsets[2]);
         }
-        tmp.type = data->type;
-        tmp.init = init_function;
-        tmp.init_val = data->init_val;
-
-        err = initialize_arrays(&tmp);
+        // The part of the thread is contiguous, its first element gives the index in the stream
+        size_t first = (size_t)((char*)str->tstream_ptr - (char*)data->ptr) / getsizeof(data->type);
+        err = initialize_range(data, str->tstream_ptr, first, getstreamelems(&tmp));
         if (err != 0)
         {
             ERROR_PRINT("Initialization failed for stream %d", s);
@@ -287,53 +301,166 @@ int initialize_local(RuntimeThreadConfig* thread, RuntimeStreamConfig* data, int
     return err;
 }
 
+/*
+ * Streams without per-thread parts are split evenly between the threads of the workgroup,
+ * so every thread touches the pages of its share first. The chunks are rounded to cache
+ * lines to keep threads from writing into the same line.
+ */
 int initialize_global(RuntimeThreadConfig* thread, RuntimeStreamConfig* data, int s)
 {
-    int err = 0;
+    size_t elems = getstreamelems(data);
+    size_t line = CL_SIZE / getsizeof(data->type);
+    size_t chunk = ((elems / thread->num_threads + line - 1) / line) * line;
+    size_t first = MIN(elems, chunk * thread->local_id);
+    size_t count = (thread->local_id == thread->num_threads - 1 ? elems - first : MIN(chunk, elems - first));
+    if (thread->local_id == 0)
     {
-        RuntimeThreadStreamConfig* str = &thread->tstreams[s];
-        data->init_val = thread->sdata[s].init_val;
-        RuntimeStreamConfig tmp = *data;
-        tmp.ptr = (char*)str->tstream_ptr;
-        tmp.dims = data->dims;
-        for (int k = 0; k < data->dims; k++)
+        if (data->dims == 1)
         {
-            // fprintf(stdout, "sizes: %zu ,offsets: %jd\n", str->tsizes[k], str->toffsets[k]);
-            tmp.dimsizes[k] = (size_t)str->tsizes[k] * getsizeof(data->type);
-            tmp.offsets[k] = (size_t)str->toffsets[k] * getsizeof(data->type);
-            // fprintf(stdout, "tmpsizes: %zu ,offsets: %jd\n", tmp.dimsizes[k], tmp.offsets[k]);
+            printf("global initializing Array %s Elements: %6zu Size: [%zu] Threads: %d\n", bdata(data->name), elems, data->dimsizes[0], thread->num_threads);
         }
-        if (tmp.dims == 1)
+        else if (data->dims == 2)
         {
-            DEBUG_PRINT(DEBUGLEV_DEVELOP, "global initializing array %s with total elements: %zu offset: %jd", bdata(data->name), getstreamelems(data), tmp.offsets[0]);
-            DEBUG_PRINT(DEBUGLEV_DEVELOP, "dimsize: %zu", tmp.dimsizes[0]);
-            printf("global initializing Array %s Elements: %6zu Size: [%zu] Offset: [%jd]\n", bdata(data->name), getstreamelems(data), tmp.dimsizes[0], tmp.offsets[0]);
+            printf("global initializing Array %s Elements: %6zu Size: [%zu][%zu] Threads: %d\n", bdata(data->name), elems, data->dimsizes[0], data->dimsizes[1], thread->num_threads);
         }
-        else if (tmp.dims == 2)
+        else if (data->dims == 3)
         {
-            DEBUG_PRINT(DEBUGLEV_DEVELOP, "global initializing array %s with total elements: %zu offset: [%jd][%jd]", bdata(data->name), getstreamelems(data), tmp.offsets[0], tmp.offsets[1]);
-            DEBUG_PRINT(DEBUGLEV_DEVELOP, "dimsize: [%zu][%zu]", tmp.dimsizes[0], tmp.dimsizes[1]);
-            printf("global initializing Array %s Elements: %6zu Size: [%zu][%zu] Offset: [%jd][%jd]\n", bdata(data->name), getstreamelems(data), tmp.dimsizes[0], tmp.dimsizes[1], tmp.offsets[0], tmp.offsets[1]);
+            printf("global initializing Array %s Elements: %6zu Size: [%zu][%zu][%zu] Threads: %d\n", bdata(data->name), elems, data->dimsizes[0], data->dimsizes[1], data->dimsizes[2], thread->num_threads);
         }
-        else if (tmp.dims == 3)
+    }
+    DEBUG_PRINT(DEBUGLEV_DEVELOP, "hwthread %3d initializing elements %zu - %zu of array %s", thread->data->hwthread, first, first + count, bdata(data->name));
+    if (count == 0)
+    {
+        return 0;
+    }
+    int err = initialize_range(data, (char*)data->ptr + first * getsizeof(data->type), first, count);
+    if (err != 0)
+    {
+        ERROR_PRINT("Failed to initialize for stream %d", s);
+    }
+    return err;
+}
+
+static uint64_t _dispatch_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static long _futex(uint32_t* addr, int op, uint32_t val, const struct timespec* timeout)
+{
+    return syscall(SYS_futex, addr, op, val, timeout, NULL, 0);
+}
+
+/*
+ * Waits until the generation of the dispatch moves past seen. The thread polls for
+ * DISPATCH_SPIN rounds, which covers back-to-back commands, and sleeps on the futex after.
+ * Registering as sleeper before checking the generation again pairs with the check of the
+ * sleepers in broadcast_cmd, so either the thread sees the new generation or it is woken.
+ */
+static int _wait_dispatch(RuntimeThreadConfig* thread, uint32_t seen)
+{
+    int err = 0;
+    thread_dispatch_t* d = thread->dispatch;
+    for (int i = 0; i < DISPATCH_SPIN; i++)
+    {
+        if (__atomic_load_n(&d->generation, __ATOMIC_ACQUIRE) != seen)
         {
-            DEBUG_PRINT(DEBUGLEV_DEVELOP, "global initializing array %s with total elements: %zu offset: [%jd][%jd][%jd]", bdata(data->name), getstreamelems(data), tmp.offsets[0], tmp.offsets[1], tmp.offsets[2]);
-            DEBUG_PRINT(DEBUGLEV_DEVELOP, "dimsize: [%zu][%zu][%zu]", tmp.dimsizes[0], tmp.dimsizes[1], tmp.dimsizes[2]);
-            printf("global initializing Array %s Elements: %6zu Size: [%zu][%zu][%zu] Offset: [%jd][%jd][%jd]\n", bdata(data->name), getstreamelems(data), tmp.dimsizes[0], tmp.dimsizes[1], tmp.dimsizes[2], tmp.offsets[0], tmp.offsets[1], tmp.offsets[2]);
+            return 0;
         }
-        tmp.type = data->type;
-        tmp.init = init_function;
-        tmp.init_val = thread->command->init_val;
-
-        err = initialize_arrays(&tmp);
-        if (err != 0)
+        CPU_RELAX();
+    }
+    uint64_t deadline = _dispatch_now() + TIMEOUT_SECONDS * 1000000000ULL;
+    __atomic_add_fetch(&d->sleepers, 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&d->generation, __ATOMIC_SEQ_CST) == seen)
+    {
+        uint64_t now = _dispatch_now();
+        if (now >= deadline)
         {
-            ERROR_PRINT("Failed to initialize for stream %d", s);
-            return err;
+            err = -ETIMEDOUT;
+            break;
         }
-        // print_arrays(data);
+        struct timespec ts = {.tv_sec = (deadline - now) / 1000000000ULL, .tv_nsec = (deadline - now) % 1000000000ULL};
+        DEBUG_PRINT(DEBUGLEV_DEVELOP, "hwthread %3d with global thread %3d is waiting for command", thread->data->hwthread, thread->global_id);
+        if (_futex(&d->generation, FUTEX_WAIT_PRIVATE, seen, &ts) != 0 && errno != EAGAIN && errno != EINTR && errno != ETIMEDOUT)
+        {
+            err = -errno;
+            break;
+        }
+    }
+    __atomic_sub_fetch(&d->sleepers, 1, __ATOMIC_SEQ_CST);
+    return err;
+}
+
+/* Publishes the completed generations and wakes the main thread if it sleeps in _wait_completed */
+static void _signal_completed(RuntimeThreadConfig* thread, uint32_t seen)
+{
+    __atomic_store_n(&thread->command->completed, seen, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&thread->command->waiters, __ATOMIC_SEQ_CST) > 0)
+    {
+        _futex(&thread->command->completed, FUTEX_WAKE_PRIVATE, INT_MAX, NULL);
     }
+}
 
+/*
+ * Waits until the thread completed the generation target. A command may run for any time, so
+ * the wait has no deadline while the thread works. Only a thread that completed everything it
+ * picked up but does not pick up the next command for TIMEOUT_SECONDS is considered stuck. The
+ * main thread polls for DISPATCH_SPIN rounds and sleeps on the futex of the completions after,
+ * so it does not take cycles from a worker on the same hwthread.
+ */
+static int _wait_completed(RuntimeThreadConfig* thread, uint32_t target)
+{
+    int err = 0;
+    RuntimeThreadCommand* c = thread->command;
+    for (int i = 0; i < DISPATCH_SPIN; i++)
+    {
+        if ((int32_t)(__atomic_load_n(&c->completed, __ATOMIC_ACQUIRE) - target) >= 0)
+        {
+            return 0;
+        }
+        CPU_RELAX();
+    }
+    uint64_t deadline = 0;
+    __atomic_add_fetch(&c->waiters, 1, __ATOMIC_SEQ_CST);
+    while (1)
+    {
+        uint32_t completed = __atomic_load_n(&c->completed, __ATOMIC_SEQ_CST);
+        if ((int32_t)(completed - target) >= 0)
+        {
+            break;
+        }
+        struct timespec ts;
+        struct timespec* timeout = NULL;
+        if (__atomic_load_n(&c->started, __ATOMIC_ACQUIRE) == completed)
+        {
+            /* Idle with commands pending, it has to pick up the next one in time */
+            uint64_t now = _dispatch_now();
+            if (deadline == 0)
+            {
+                deadline = now + TIMEOUT_SECONDS * 1000000000ULL;
+            }
+            if (now >= deadline)
+            {
+                err = -ETIMEDOUT;
+                break;
+            }
+            ts.tv_sec = (deadline - now) / 1000000000ULL;
+            ts.tv_nsec = (deadline - now) % 1000000000ULL;
+            timeout = &ts;
+        }
+        else
+        {
+            deadline = 0;
+        }
+        if (_futex(&c->completed, FUTEX_WAIT_PRIVATE, completed, timeout) != 0 && errno != EAGAIN && errno != EINTR && errno != ETIMEDOUT)
+        {
+            err = -errno;
+            break;
+        }
+    }
+    __atomic_sub_fetch(&c->waiters, 1, __ATOMIC_SEQ_CST);
     return err;
 }
 
@@ -341,43 +468,43 @@ void* _func_t(void* arg)
 {
     RuntimeThreadConfig* thread = (RuntimeThreadConfig*)arg;
     bool keep_running = true;
+    uint32_t seen = 0;
     // printf("hwthread %3d Global Thread %3d running\n", thread->data->hwthread, thread->global_id);
     DEBUG_PRINT(DEBUGLEV_DEVELOP, "hwthread %3d with global thread %3d is running", thread->data->hwthread, thread->global_id);
     while (keep_running)
     {
-        pthread_mutex_lock(&thread->command->mutex);
-        while(thread->command->head == NULL)
+        uint64_t ready = _dispatch_now();
+        int werr = _wait_dispatch(thread, seen);
+        if (werr != 0)
         {
-            struct timespec ts;
-            clock_gettime(CLOCK_REALTIME, &ts);
-            ts.tv_sec += TIMEOUT_SECONDS;
-            DEBUG_PRINT(DEBUGLEV_DEVELOP, "hwthread %3d with global thread %3d is waiting for command", thread->data->hwthread, thread->global_id);
-            int err = pthread_cond_timedwait(&thread->command->cond, &thread->command->mutex, &ts);
-            if (err != 0)
+            if (werr == -ETIMEDOUT)
             {
-                if (err == ETIMEDOUT)
-                {
-                    ERROR_PRINT("hwthread %3d timedout waiting for command", thread->data->hwthread);
-                }
-                else
-                {
-                    ERROR_PRINT("hwthread %3d failed to wait for command: %s", thread->data->hwthread, strerror(err));
-                }
-                pthread_mutex_unlock(&thread->command->mutex);
-                goto exit_thread;
+                ERROR_PRINT("hwthread %3d timedout waiting for command", thread->data->hwthread);
             }
-            // pthread_cond_wait(&thread->command->cond, &thread->command->mutex);
+            else
+            {
+                ERROR_PRINT("hwthread %3d failed to wait for command: %s", thread->data->hwthread, strerror(-werr));
+            }
+            goto exit_thread;
+        }
+        thread_dispatch_slot_t* slot = &thread->dispatch->slots[seen % THREAD_DISPATCH_SLOTS];
+        LikwidThreadCommand c_cmd = slot->cmd;
+        if (thread->local_id >= slot->num_threads)
+        {
+            /* Parked by a thread scaling run, the thread neither works nor meets the others at the barrier */
+            seen++;
+            __atomic_store_n(&thread->command->started, seen, __ATOMIC_RELEASE);
+            _signal_completed(thread, seen);
+            continue;
         }
-        Queue* q = thread->command->head;
-        LikwidThreadCommand c_cmd = q->cmd;
-        thread->command->head = q->next;
-        if (thread->command->head == NULL)
+        thread->command->cmd = c_cmd;
+        if (c_cmd >= LIKWID_THREAD_COMMAND_EXIT && c_cmd < MAX_LIKWID_THREAD_COMMAND)
         {
-            thread->command->tail = NULL;
+            /* Commands issued while the thread was busy count from the end of the previous one */
+            thread->command->latency[c_cmd] = _dispatch_now() - MAX(ready, slot->issued);
         }
-        free(q);
-        q = NULL;
-        pthread_mutex_unlock(&thread->command->mutex);
+        seen++;
+        __atomic_store_n(&thread->command->started, seen, __ATOMIC_RELEASE);
 
         // DEBUG_PRINT(DEBUGLEV_DEVELOP, "hwthread %3d with global thread %3d received cmd %3d", thread->data->hwthread, thread->global_id, c_cmd);
 
@@ -387,10 +514,9 @@ void* _func_t(void* arg)
                 for (int s = 0; s < thread->num_streams; s++)
                 {
                     RuntimeStreamConfig* data = &thread->sdata[s];
-                    if (thread->global_id == 0 && !(data->initialization))
+                    if (!(data->initialization))
                     {
                         DEBUG_PRINT(DEBUGLEV_DEVELOP, "Global Initialization on hwthread %3d with global thread %3d", thread->data->hwthread, thread->global_id);
-                        printf("Global Initialization on %s hwthread %3d with global thread %3d\n", bdata(data->name), thread->data->hwthread, thread->global_id);
                         int err = initialize_global(thread, data, s);
                         if (err != 0)
                         {
@@ -415,15 +541,17 @@ void* _func_t(void* arg)
 
             case LIKWID_THREAD_COMMAND_RUN:
                 DEBUG_PRINT(DEBUGLEV_DEVELOP, "hwthread %3d with global thread %3d is set with RUN command", thread->data->hwthread, thread->global_id);
-                pthread_mutex_lock(&thread->command->mutex);
-                thread->command->done = 1;
-                pthread_cond_signal(&thread->command->cond);
-                pthread_mutex_unlock(&thread->command->mutex);
                 int err = run_benchmark(thread);
                 if (err != 0)
                 {
                     ERROR_PRINT("Running benchmark kernel failed for hwthread %3d with global thread %3d", thread->data->hwthread, thread->global_id);
                 }
+                /* Pointer-chase streams are walked once more with every access timed */
+                err = latency_thread(thread);
+                if (err != 0)
+                {
+                    ERROR_PRINT("Latency histogram failed for hwthread %3d with global thread %3d", thread->data->hwthread, thread->global_id);
+                }
                 break;
 
             case LIKWID_THREAD_COMMAND_EXIT:
@@ -439,75 +567,93 @@ void* _func_t(void* arg)
                 break;
         }
 
-        /* signal for completion */
-        pthread_mutex_lock(&thread->command->mutex);
-        thread->command->done = 1;
-        pthread_cond_signal(&thread->command->cond);
-        pthread_mutex_unlock(&thread->command->mutex);
         /* wait at the barrier */
-        pthread_barrier_wait(&thread->barrier->barrier);
+        barrier_wait(thread->barrier, thread->local_id);
+        /* signal for completion after the barrier, so the main thread may set it up again */
+        _signal_completed(thread, seen);
     }
 
 exit_thread:
-    pthread_barrier_wait(&thread->barrier->barrier);
-    pthread_mutex_lock(&thread->command->mutex);
-    thread->command->done = 1;
-    pthread_cond_signal(&thread->command->cond);
-    pthread_mutex_unlock(&thread->command->mutex);
+    barrier_wait(thread->barrier, thread->local_id);
+    _signal_completed(thread, seen);
     DEBUG_PRINT(DEBUGLEV_DEVELOP, "hwthread %3d with global thread %3d has completed", thread->data->hwthread, thread->global_id);
-    pthread_barrier_wait(&thread->barrier->barrier);
+    barrier_wait(thread->barrier, thread->local_id);
     pthread_exit(NULL);
     return NULL;
 }
 
-int send_cmd(LikwidThreadCommand cmd, RuntimeThreadConfig* thread)
+/*
+ * Publishes cmd to all threads of the workgroup with one store of the generation. The
+ * main thread only waits if the slowest thread is THREAD_DISPATCH_SLOTS commands behind.
+ */
+int broadcast_cmd(LikwidThreadCommand cmd, RuntimeWorkgroupConfig* wg)
 {
-    int err = 0;
-    if (thread == NULL)
-    {   
+    if ((!wg) || (!wg->dispatch) || (!wg->threads))
+    {
         return -EINVAL;
     }
-
-    Queue* q = (Queue*)malloc(sizeof(Queue));
-    if (q == NULL)
+    thread_dispatch_t* d = wg->dispatch;
+    uint32_t gen = __atomic_load_n(&d->generation, __ATOMIC_RELAXED);
+    for (int i = 0; i < wg->max_threads; i++)
     {
-        ERROR_PRINT("Failed to allocate memory for New Command");
-        return -ENOMEM;
+        /* The slot of gen is free once the thread completed the command that used it before */
+        int err = _wait_completed(&wg->threads[i], gen - THREAD_DISPATCH_SLOTS + 1);
+        if (err != 0)
+        {
+            ERROR_PRINT("hwthread %3d does not take commands", wg->threads[i].data->hwthread);
+            return err;
+        }
     }
-    q->cmd = cmd;
-    q->next = NULL;
-
-    err = pthread_mutex_lock(&thread->command->mutex);
-    if (err != 0)
+    thread_dispatch_slot_t* slot = &d->slots[gen % THREAD_DISPATCH_SLOTS];
+    slot->cmd = cmd;
+    slot->num_threads = wg->num_threads;
+    slot->issued = _dispatch_now();
+    __atomic_store_n(&d->generation, gen + 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&d->sleepers, __ATOMIC_SEQ_CST) > 0)
     {
-        ERROR_PRINT("Failed to lock mutex for hwthread %d with error %s", thread->data->hwthread, strerror(err));
-        return err;
+        _futex(&d->generation, FUTEX_WAKE_PRIVATE, INT_MAX, NULL);
     }
+    return 0;
+}
 
-    if (thread->command->tail == NULL)
+/*
+ * Waits until all threads of the workgroup completed the commands broadcast so far. The threads
+ * signal the completion after the closing barrier, so no thread is inside the barrier afterwards.
+ */
+int wait_cmds(RuntimeWorkgroupConfig* wg)
+{
+    if ((!wg) || (!wg->dispatch) || (!wg->threads))
     {
-        thread->command->head = thread->command->tail = q;
+        return -EINVAL;
     }
-    else
+    uint32_t gen = __atomic_load_n(&wg->dispatch->generation, __ATOMIC_RELAXED);
+    for (int i = 0; i < wg->max_threads; i++)
     {
-        thread->command->tail->next = q;
-        thread->command->tail = q;
+        int err = _wait_completed(&wg->threads[i], gen);
+        if (err != 0)
+        {
+            ERROR_PRINT("hwthread %3d does not pick up its commands", wg->threads[i].data->hwthread);
+            return err;
+        }
     }
-    /* Initially when threads are created it is created with done status as 1
-     * once after creation, as we send the cmd - the status is set to 0
-     * later invocation changes the status to 1
-     * */
-    thread->command->done = 0;
-    err = pthread_cond_signal(&thread->command->cond);
-    if (err != 0)
+    return 0;
+}
+
+/* Time from the broadcast of a command, or the end of the previous one, until each thread picked it up */
+void report_dispatch(RuntimeWorkgroupConfig* wg)
+{
+    if ((!wg) || (!wg->threads) || global_verbosity < DEBUGLEV_DETAIL)
     {
-        ERROR_PRINT("Failed to signal condition for hwthread %d with error %s", thread->data->hwthread, strerror(err));
-        pthread_mutex_unlock(&thread->command->mutex);
-        free(q);
-        return err;
+        return;
+    }
+    for (int i = 0; i < wg->num_threads; i++)
+    {
+        RuntimeThreadConfig* thread = &wg->threads[i];
+        printf("hwthread %3d dispatch latency [us]: INITIALIZE %10.3f RUN %10.3f EXIT %10.3f\n", thread->data->hwthread,
+               thread->command->latency[LIKWID_THREAD_COMMAND_INITIALIZE] * 1e-3,
+               thread->command->latency[LIKWID_THREAD_COMMAND_RUN] * 1e-3,
+               thread->command->latency[LIKWID_THREAD_COMMAND_EXIT] * 1e-3);
     }
-    pthread_mutex_unlock(&thread->command->mutex);
-    return err;
 }
 
 int join_threads(int num_wgroups, RuntimeWorkgroupConfig* wgroups)
@@ -568,12 +714,227 @@ int create_threads(int num_wgroups, RuntimeWorkgroupConfig* wgroups)
     return 0;
 }
 
+/*
+ * Sizes, offsets and pointers of the thread's part of every stream. They are evaluated from the
+ * sizes and offsets formulas of the kernel file with the current dimension sizes of the streams.
+ */
+static int _update_thread_streams(RuntimeConfig* runcfg, RuntimeWorkgroupConfig* wg, RuntimeThreadConfig* thread)
+{
+    int err = 0;
+    bstring btid = bformat("%d", (thread->local_id % thread->num_threads));
+    bstring bthreads = bformat("%d", wg->num_threads);
+    // Iterating over the streams
+    // Useful in case streams are of various dimensions and to capture each threads offsets and sizes
+    // (explicitly every tstreams in thread command is stored)
+    for (int s = 0; s < wg->num_streams; s++)
+    {
+        RuntimeThreadStreamConfig* str = &thread->tstreams[s];
+        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Calculations for streams%d: %s", s, bdata(thread->sdata[s].name));
+        TestConfigStream *istream = &wg->tcfg->streams[s];
+        RuntimeWorkgroupResult t_results;
+        err = init_result(&t_results);
+        if (err != 0)
+        {
+            ERROR_PRINT("Unable to initialize thread results");
+            bdestroy(bthreads);
+            bdestroy(btid);
+            return err;
+        }
+        // With first touch placement, every thread initializes its part like for perthread streams
+        thread->sdata[s].initialization = istream->initialization || (thread->sdata[s].placement == STREAM_PLACEMENT_FIRSTTOUCH);
+        // printf("thread: %d, stream: %d, initialize bool: %d\n", i, s, thread->sdata->initialization);
+        for (int k = 0; k < istream->num_dims && k < istream->dims->qty; k++)
+        {
+            size_t elems = (double)thread->sdata[s].dimsizes[k] / getsizeof(thread->sdata[s].type); // the dim is converted to elements for calculations
+            // printf("elems: %zu \n", elems);
+            add_value(&t_results, istream->dims->entry[k], (double)elems);
+            add_variable(&t_results, &bnumthreads, bthreads);
+            add_variable(&t_results, &bthreadid, btid);
+        }
+        for (int k = 0; k < istream->num_dims && k < istream->dims->qty; k++)
+        {
+            size_t elems = (double)thread->sdata[s].dimsizes[k] / getsizeof(thread->sdata[s].type); // the dim is converted to elements for calculations
+            bstring bsizes = bstrcpy(istream->sizes->entry[k]);
+            bstring boffsets = bstrcpy(istream->offsets->entry[k]);
+            if (DEBUGLEV_DEVELOP == global_verbosity)
+            {
+                printf("The hwthread %3d results are\n", wg->hwthreads[thread->local_id]);
+                print_result(&t_results);
+            }
+            replace_all(&t_results, bsizes, NULL);
+            replace_all(&t_results, boffsets, NULL);
+            // printf("After replace sizes: %s\n", bdata(bsizes));
+            // printf("After replace offsets: %s\n", bdata(boffsets));
+            double sizes_value = 0.0;
+            double offsets_value = 0.0;
+            err = calculator_calc(bdata(bsizes), &sizes_value);
+            if (err == 0)
+            {
+                DEBUG_PRINT(DEBUGLEV_DEVELOP, "Calculated formula '%s' - sizes value: %lf", bdata(bsizes), sizes_value);
+            }
+            else
+            {
+                ERROR_PRINT("Error calculating sizes for formula '%s'", bdata(bsizes));
+            }
+            err = calculator_calc(bdata(boffsets), &offsets_value);
+            if (err == 0)
+            {
+                DEBUG_PRINT(DEBUGLEV_DEVELOP, "Calculated formula '%s' - offsets value: %lf", bdata(boffsets), offsets_value);
+            }
+            else
+            {
+                ERROR_PRINT("Error calculating sizes for formula '%s'", bdata(boffsets));
+            }
+            str->tsizes[k] = (size_t)sizes_value;
+            str->toffsets[k] = (off_t)offsets_value;
+            /*
+            // * the below may be not necessary as no need take care due to a round down
+            if (thread->sdata[s].dims == 1)
+            {
+                if ((thread->local_id % thread->num_threads) == thread->num_threads - 1)
+                {
+                    str->tsizes[k] = (size_t)(getstreamelems(&thread->sdata[s]) - str->toffsets[k]);
+                }
+            }
+            */
+            /*
+            // the below is also not neccessary as round down is already made
+            DEBUG_PRINT(DEBUGLEV_INFO, "thread: %d stream: %d tsizes[%d]: %zu toffsets[%d]: %jd", i, s, k, str->tsizes[k], k, str->toffsets[k]);
+            if ((str->tsizes[k] % bytesperiter != 0) || (str->toffsets[k] % bytesperiter != 0))
+            {
+                if (thread->local_id == 0 && s == 0) WARN_PRINT("SANITIZING A rounddown is applied on each thread sizes and offsets as %s is set to %zu", bdata(&bbytesperiter), bytesperiter);
+                if (!is_multipleof_pow2(str->tsizes[k], bytesperiter))
+                {
+                    rounddown_nbits_pow2(&str->tsizes[k], str->tsizes[k], bytesperiter);
+                    rounddown_nbits_pow2(&str->toffsets[k], str->toffsets[k], bytesperiter);
+                }
+                else if (!is_multipleof_nbits(str->tsizes[k], bytesperiter))
+                {
+                    rounddown_nbits(&str->tsizes[k], str->tsizes[k], bytesperiter);
+                    // roundnearest_nbits(&str->toffsets, str->toffsets, bytesperiter);
+                    rounddown_nbits(&str->toffsets[k], str->toffsets[k], bytesperiter);
+                }
+            }
+            DEBUG_PRINT(DEBUGLEV_INFO, "After rounddown - thread: %d stream: %d tsizes[%d]: %zu toffsets[%d]: %zu", i, s, k, str->tsizes[k], k, str->toffsets[k]);
+            */
+            bdestroy(bsizes);
+            bdestroy(boffsets);
+        }
+        str->tstream_ptr = (void*)((char*) thread->sdata[s].ptr + (_linear_offset(thread->sdata[s].dims, str->toffsets, str->tsizes, getsizeof(thread->sdata[s].type))));
+        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Stream Ptr for hwthread %d-%s: %p and offset ptr: %p", thread->data->hwthread, bdata(thread->sdata[s].name), thread->sdata[s].ptr, (void*)str->tstream_ptr);
+                destroy_result(&t_results);
+    }
+    bdestroy(bthreads);
+    bdestroy(btid);
+    return 0;
+}
+
+/* Validates the sizes and offsets of each thread and its stream pointers */
+static int _check_thread_streams(RuntimeConfig* runcfg)
+{
+    for (int w = 0; w < runcfg->num_wgroups; w++)
+    {
+        RuntimeWorkgroupConfig* wg = &runcfg->wgroups[w];
+        for (int i = 0; i < wg->num_threads; i++)
+        {
+            RuntimeThreadConfig* thread = &wg->threads[i];
+            for (int s = 0; s < wg->num_streams; s++)
+            {
+                RuntimeThreadStreamConfig* str = &thread->tstreams[s];
+                TestConfigStream *istream = &wg->tcfg->streams[s];
+                for (int k = 0; k < istream->num_dims && k < istream->dims->qty; k++)
+                {
+                    if (str->tsizes[k] == 0)
+                    {
+                        ERROR_PRINT("hwthread: %d , stream: %s - After round down of sizes: %zu is invalid. Increase the size of the array", i, bdata(thread->sdata[s].name), str->tsizes[k]);
+                        return -EINVAL;
+                    }
+                    if (!_ptr_in_range(thread->sdata[s].ptr, getstreambytes(&thread->sdata[s]), str->tstream_ptr, str->tsizes[k] * getsizeof(thread->sdata[s].type)))
+                    {
+                        // DEBUG_PRINT(DEBUGLEV_INFO, "Base Ptr: %p, Size: %zu, Access Size: %zu, Offset Ptr: %p", thread->sdata[s].ptr, getstreambytes(&thread->sdata[s]), str->tsizes[k] * getsizeof(thread->sdata[s].type), str->tstream_ptr);
+                        ERROR_PRINT("hwthread: %d , stream: %s - Out of Bounds for each threads sizes: %zu and offset ptr: %p. Try increasing the size of arrays!", i, bdata(thread->sdata[s].name), str->tsizes[k] * getsizeof(thread->sdata[s].type), str->tstream_ptr);
+                        return -EINVAL;
+                    }
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+/*
+ * Sets up the start barrier over the threads of all workgroups. The threads are identified by
+ * their global id, so the tree barrier follows the hwthreads of all workgroups.
+ */
+static int _init_sync(RuntimeConfig* runcfg, int total_threads)
+{
+    int* hwthreads = malloc(total_threads * sizeof(int));
+    runcfg->sync = malloc(sizeof(thread_sync_t));
+    if ((!hwthreads) || (!runcfg->sync))
+    {
+        ERROR_PRINT("Failed to allocate memory for the start barrier of all workgroups");
+        free(hwthreads);
+        free(runcfg->sync);
+        runcfg->sync = NULL;
+        return -ENOMEM;
+    }
+    memset(runcfg->sync, 0, sizeof(thread_sync_t));
+    for (int w = 0; w < runcfg->num_wgroups; w++)
+    {
+        RuntimeWorkgroupConfig* wg = &runcfg->wgroups[w];
+        for (int i = 0; i < wg->num_threads; i++)
+        {
+            hwthreads[wg->threads[i].global_id] = wg->hwthreads[i];
+        }
+    }
+    int err = barrier_init(&runcfg->sync->barrier, runcfg->barrier, total_threads, hwthreads);
+    free(hwthreads);
+    if (err != 0)
+    {
+        free(runcfg->sync);
+        runcfg->sync = NULL;
+        return err;
+    }
+    for (int w = 0; w < runcfg->num_wgroups; w++)
+    {
+        RuntimeWorkgroupConfig* wg = &runcfg->wgroups[w];
+        for (int i = 0; i < wg->num_threads; i++)
+        {
+            wg->threads[i].sync = runcfg->sync;
+        }
+    }
+    return 0;
+}
+
+/* Called before the threads of all workgroups are sent the run command */
+void start_sync(RuntimeConfig* runcfg)
+{
+    if (runcfg->sync)
+    {
+        int total_threads = 0;
+        for (int w = 0; w < runcfg->num_wgroups; w++)
+        {
+            total_threads += runcfg->wgroups[w].num_threads;
+        }
+        __atomic_store_n(&runcfg->sync->running, total_threads, __ATOMIC_RELEASE);
+    }
+}
+
+void destroy_sync(RuntimeConfig* runcfg)
+{
+    if (runcfg->sync)
+    {
+        barrier_destroy(&runcfg->sync->barrier);
+        free(runcfg->sync);
+        runcfg->sync = NULL;
+    }
+}
+
 int update_threads(RuntimeConfig* runcfg)
 {
     int err = 0;
     size_t iter;
     int total_threads = 0;
-    TestConfigStream* t = runcfg->tcfg->streams;
 
     bstring brun_iters = bformat("%ld", runcfg->iterations);
     // printf("Num Workgroups: %d\n", runcfg->num_wgroups);
@@ -588,27 +949,22 @@ int update_threads(RuntimeConfig* runcfg)
             goto free;
         }
 
-        err = pthread_barrierattr_init(&wg->barrier.b_attr);
+        wg->max_threads = wg->num_threads;
+        err = barrier_init(&wg->barrier, runcfg->barrier, wg->num_threads, wg->hwthreads);
         if (err != 0)
         {
-            ERROR_PRINT("Failed to initialize barrier attribute %s", strerror(err));
             goto free;
         }
 
-        err = pthread_barrierattr_setpshared(&wg->barrier.b_attr, PTHREAD_PROCESS_PRIVATE);
+        err = posix_memalign((void**)&wg->dispatch, THREAD_DISPATCH_ALIGN, sizeof(thread_dispatch_t));
         if (err != 0)
         {
-            ERROR_PRINT("Failed to set barrier attributes %s", strerror(err));
-            pthread_barrierattr_destroy(&wg->barrier.b_attr);
-            goto free;
-        }
-
-        err = pthread_barrier_init(&wg->barrier.barrier, &wg->barrier.b_attr, wg->num_threads);
-        if (err != 0)
-        {
-            ERROR_PRINT("Failed to initialize barrier %s", strerror(err));
+            ERROR_PRINT("Failed to allocate memory for command dispatch");
+            wg->dispatch = NULL;
+            err = -ENOMEM;
             goto free;
         }
+        memset(wg->dispatch, 0, sizeof(thread_dispatch_t));
 
         // size_t bytesperiter;
         // get_variable(&wg->results[0], &bbytesperiter, &bytesperiter);
@@ -638,8 +994,6 @@ int update_threads(RuntimeConfig* runcfg)
             }
             memset(thread->testconfig, 0, sizeof(RuntimeTestConfig));
 
-            thread->command->head = thread->command->tail = NULL;
-
             err = pthread_attr_init(&thread->command->attr);
             if (err != 0)
             {
@@ -647,16 +1001,7 @@ int update_threads(RuntimeConfig* runcfg)
                 goto free;
             }
             pthread_attr_setdetachstate(&thread->command->attr, PTHREAD_CREATE_JOINABLE);
-
-            pthread_mutexattr_init(&thread->command->m_attr);
-            pthread_condattr_init(&thread->command->c_attr);
-
-            pthread_mutexattr_settype(&thread->command->m_attr, PTHREAD_MUTEX_RECURSIVE);
-            pthread_condattr_setpshared(&thread->command->c_attr, PTHREAD_PROCESS_PRIVATE);
-
-            pthread_mutex_init(&thread->command->mutex, &thread->command->m_attr);
-            pthread_cond_init(&thread->command->cond, &thread->command->c_attr);
-            thread->command->done = 1;
+            thread->dispatch = wg->dispatch;
             thread->num_streams = wg->num_streams;
             thread->sdata = wg->streams;
             thread->tstreams = (RuntimeThreadStreamConfig*)malloc(wg->num_streams * sizeof(RuntimeThreadStreamConfig));
@@ -672,139 +1017,23 @@ int update_threads(RuntimeConfig* runcfg)
              * for (int s = 0; s < thread->command->tstreams->dims; s++)
              *     printf("tstreams dimsizes: %d\n", thread->command->tstreams->dimsizes[s]);
              */
-            thread->command->init_val = malloc(getsizeof(thread->sdata->type));
-            switch(thread->sdata->type)
-            {
-                case TEST_STREAM_TYPE_SINGLE:
-                    *(float*)thread->command->init_val = thread->sdata->data.fval;
-                    break;
-                case TEST_STREAM_TYPE_DOUBLE:
-                    *(double*)thread->command->init_val = thread->sdata->data.dval;
-                    break;
-                case TEST_STREAM_TYPE_INT:
-                    *(int*)thread->command->init_val = thread->sdata->data.ival;
-                    break;
-#ifdef WITH_HALF_PRECISION
-                case TEST_STREAM_TYPE_HALF:
-                    *(_Float16*)thread->command->init_val = thread->sdata->data.f16val;
-                    break;
-#endif
-                case TEST_STREAM_TYPE_INT64:
-                    *(int64_t*)thread->command->init_val = thread->sdata->data.i64val;
-                    break;
-            }
-
             thread->num_threads = wg->num_threads;
             thread->local_id = i;
             thread->global_id = total_threads + i;
 
-            bstring btid = bformat("%d", (thread->local_id % thread->num_threads));
-            bstring bthreads = bformat("%d", wg->num_threads);
-            // Iterating over the streams
-            // Useful in case streams are of various dimensions and to capture each threads offsets and sizes
-            // (explicitly every tstreams in thread command is stored)
-            for (int s = 0; s < wg->num_streams; s++)
+            err = _update_thread_streams(runcfg, wg, thread);
+            if (err != 0)
             {
-                RuntimeThreadStreamConfig* str = &thread->tstreams[s];
-                DEBUG_PRINT(DEBUGLEV_DEVELOP, "Calculations for streams%d: %s", s, bdata(thread->sdata[s].name));
-                TestConfigStream *istream = &runcfg->tcfg->streams[s];
-                RuntimeWorkgroupResult t_results;
-                err = init_result(&t_results);
-                if (err != 0)
-                {
-                    ERROR_PRINT("Unable to initialize thread results");
-                    return err;
-                }
-                thread->sdata[s].initialization = istream->initialization;
-                // printf("thread: %d, stream: %d, initialize bool: %d\n", i, s, thread->sdata->initialization);
-                for (int k = 0; k < istream->num_dims && k < istream->dims->qty; k++)
-                {
-                    size_t elems = (double)thread->sdata[s].dimsizes[k] / getsizeof(thread->sdata[s].type); // the dim is converted to elements for calculations
-                    // printf("elems: %zu \n", elems);
-                    add_value(&t_results, istream->dims->entry[k], (double)elems);
-                    add_variable(&t_results, &bnumthreads, bthreads);
-                    add_variable(&t_results, &bthreadid, btid);
-                }
-                for (int k = 0; k < istream->num_dims && k < istream->dims->qty; k++)
-                {
-                    size_t elems = (double)thread->sdata[s].dimsizes[k] / getsizeof(thread->sdata[s].type); // the dim is converted to elements for calculations
-                    bstring bsizes = bstrcpy(istream->sizes->entry[k]);
-                    bstring boffsets = bstrcpy(istream->offsets->entry[k]);
-                    if (DEBUGLEV_DEVELOP == global_verbosity)
-                    {
-                        printf("The hwthread %3d results are\n", wg->hwthreads[i]);
-                        print_result(&t_results);
-                    }
-                    replace_all(&t_results, bsizes, NULL);
-                    replace_all(&t_results, boffsets, NULL);
-                    // printf("After replace sizes: %s\n", bdata(bsizes));
-                    // printf("After replace offsets: %s\n", bdata(boffsets));
-                    double sizes_value = 0.0;
-                    double offsets_value = 0.0;
-                    err = calculator_calc(bdata(bsizes), &sizes_value);
-                    if (err == 0)
-                    {
-                        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Calculated formula '%s' - sizes value: %lf", bdata(bsizes), sizes_value);
-                    }
-                    else
-                    {
-                        ERROR_PRINT("Error calculating sizes for formula '%s'", bdata(bsizes));
-                    }
-                    err = calculator_calc(bdata(boffsets), &offsets_value);
-                    if (err == 0)
-                    {
-                        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Calculated formula '%s' - offsets value: %lf", bdata(boffsets), offsets_value);
-                    }
-                    else
-                    {
-                        ERROR_PRINT("Error calculating sizes for formula '%s'", bdata(boffsets));
-                    }
-                    str->tsizes[k] = (size_t)sizes_value;
-                    str->toffsets[k] = (off_t)offsets_value;
-                    /*
-                    // * the below may be not necessary as no need take care due to a round down
-                    if (thread->sdata[s].dims == 1)
-                    {
-                        if ((thread->local_id % thread->num_threads) == thread->num_threads - 1)
-                        {
-                            str->tsizes[k] = (size_t)(getstreamelems(&thread->sdata[s]) - str->toffsets[k]);
-                        }
-                    }
-                    */
-                    /*
-                    // the below is also not neccessary as round down is already made
-                    DEBUG_PRINT(DEBUGLEV_INFO, "thread: %d stream: %d tsizes[%d]: %zu toffsets[%d]: %jd", i, s, k, str->tsizes[k], k, str->toffsets[k]);
-                    if ((str->tsizes[k] % bytesperiter != 0) || (str->toffsets[k] % bytesperiter != 0))
-                    {
-                        if (thread->local_id == 0 && s == 0) WARN_PRINT("SANITIZING A rounddown is applied on each thread sizes and offsets as %s is set to %zu", bdata(&bbytesperiter), bytesperiter);
-                        if (!is_multipleof_pow2(str->tsizes[k], bytesperiter))
-                        {
-                            rounddown_nbits_pow2(&str->tsizes[k], str->tsizes[k], bytesperiter);
-                            rounddown_nbits_pow2(&str->toffsets[k], str->toffsets[k], bytesperiter);
-                        }
-                        else if (!is_multipleof_nbits(str->tsizes[k], bytesperiter))
-                        {
-                            rounddown_nbits(&str->tsizes[k], str->tsizes[k], bytesperiter);
-                            // roundnearest_nbits(&str->toffsets, str->toffsets, bytesperiter);
-                            rounddown_nbits(&str->toffsets[k], str->toffsets[k], bytesperiter);
-                        }
-                    }
-                    DEBUG_PRINT(DEBUGLEV_INFO, "After rounddown - thread: %d stream: %d tsizes[%d]: %zu toffsets[%d]: %zu", i, s, k, str->tsizes[k], k, str->toffsets[k]);
-                    */
-                    bdestroy(bsizes);
-                    bdestroy(boffsets);
-                }
-                str->tstream_ptr = (void*)((char*) thread->sdata[s].ptr + (_linear_offset(thread->sdata[s].dims, str->toffsets, str->tsizes, getsizeof(thread->sdata[s].type))));
-                DEBUG_PRINT(DEBUGLEV_DEVELOP, "Stream Ptr for wg%d thread%d-%s: %p and offset ptr: %p", w, i, bdata(thread->sdata[s].name), thread->sdata[s].ptr, (void*)str->tstream_ptr);
-                // printf("Stream Ptr for wg%d thread%d-%s: %p and offset ptr: %p\n", w, i, bdata(thread->sdata[s].name), thread->sdata[s].ptr, (void*)str->tstream_ptr);
-                destroy_result(&t_results);
+                goto free;
             }
-            bdestroy(bthreads);
-            bdestroy(btid);
             thread->codelines = NULL;
+            thread->num_args = 0;
+            thread->args = NULL;
+            thread->timer = runcfg->timer;
             thread->runtime = runcfg->runtime;
             thread->cycles = 0;
             thread->barrier = &wg->barrier;
+            thread->sync = NULL;
             // printf("Num threads: %d\n", group->num_threads);
             thread->data = (_thread_data*)malloc(sizeof(_thread_data));
             if (!thread->data)
@@ -820,46 +1049,116 @@ int update_threads(RuntimeConfig* runcfg)
             thread->data->iters = runcfg->iterations;
             thread->data->cycles = 0;
             thread->data->min_runtime = 0;
+            // The sample buffer is allocated here, so the timed repetitions do not allocate
+            thread->data->max_samples = runcfg->repetitions;
+            thread->data->relerror = runcfg->relerror;
+            thread->data->num_samples = 0;
+            thread->data->samples = (uint64_t*)malloc(runcfg->repetitions * sizeof(uint64_t));
+            thread->data->starts = (uint64_t*)malloc(runcfg->repetitions * sizeof(uint64_t));
+            thread->data->stops = (uint64_t*)malloc(runcfg->repetitions * sizeof(uint64_t));
+            if ((!thread->data->samples) || (!thread->data->starts) || (!thread->data->stops))
+            {
+                ERROR_PRINT("Failed to allocate memory for %d runtime samples", runcfg->repetitions);
+                err = -ENOMEM;
+                goto free;
+            }
             // printf("Threadid: %d\n", thread->data->hwthread);
         }
 
         total_threads += wg->num_threads;
     }
     bdestroy(brun_iters);
+    if (runcfg->num_wgroups > 1)
+    {
+        err = _init_sync(runcfg, total_threads);
+        if (err != 0)
+        {
+            goto free;
+        }
+    }
     // Validate the sizes and offsets for each thread and its stream pointers before proceeding further
+    err = _check_thread_streams(runcfg);
+    if (err != 0)
+    {
+        goto free;
+    }
+
+    return 0;
+
+free:
+    destroy_threads(runcfg->num_wgroups, runcfg->wgroups);
+    return err;
+}
+
+/*
+ * Prepares the threads for the next point of a parameter sweep. The streams keep their memory,
+ * only the thread's part of each stream is evaluated again. The iterations are calibrated again
+ * if they were not given on the command line.
+ */
+int refresh_threads(RuntimeConfig* runcfg)
+{
+    int err = 0;
+    bstring brun_iters = bformat("%ld", runcfg->iterations);
     for (int w = 0; w < runcfg->num_wgroups; w++)
     {
         RuntimeWorkgroupConfig* wg = &runcfg->wgroups[w];
         for (int i = 0; i < wg->num_threads; i++)
         {
             RuntimeThreadConfig* thread = &wg->threads[i];
-            for (int s = 0; s < wg->num_streams; s++)
+            update_variable(&wg->results[i], &biterations, brun_iters);
+            err = _update_thread_streams(runcfg, wg, thread);
+            if (err != 0)
             {
-                RuntimeThreadStreamConfig* str = &thread->tstreams[s];
-                TestConfigStream *istream = &runcfg->tcfg->streams[s];
-                for (int k = 0; k < istream->num_dims && k < istream->dims->qty; k++)
-                {
-                    if (str->tsizes[k] == 0)
-                    {
-                        ERROR_PRINT("hwthread: %d , stream: %s - After round down of sizes: %zu is invalid. Increase the size of the array", i, bdata(thread->sdata[s].name), str->tsizes[k]);
-                        err = -EINVAL;
-                        goto free;
-                    }
-                    if (!_ptr_in_range(thread->sdata[s].ptr, getstreambytes(&thread->sdata[s]), str->tstream_ptr, str->tsizes[k] * getsizeof(thread->sdata[s].type)))
-                    {
-                        // DEBUG_PRINT(DEBUGLEV_INFO, "Base Ptr: %p, Size: %zu, Access Size: %zu, Offset Ptr: %p", thread->sdata[s].ptr, getstreambytes(&thread->sdata[s]), str->tsizes[k] * getsizeof(thread->sdata[s].type), str->tstream_ptr);
-                        ERROR_PRINT("hwthread: %d , stream: %s - Out of Bounds for each threads sizes: %zu and offset ptr: %p. Try increasing the size of arrays!", i, bdata(thread->sdata[s].name), str->tsizes[k] * getsizeof(thread->sdata[s].type), str->tstream_ptr);
-                        err = -EINVAL;
-                        goto free;
-                    }
-                }
+                bdestroy(brun_iters);
+                return err;
             }
+            thread->runtime = runcfg->runtime;
+            thread->cycles = 0;
+            thread->data->iters = runcfg->iterations;
+            thread->data->cycles = 0;
+            thread->data->freq = 0;
+            thread->data->min_runtime = 0;
+            thread->data->num_samples = 0;
         }
     }
+    bdestroy(brun_iters);
+    return _check_thread_streams(runcfg);
+}
 
+/*
+ * Lets the first num_threads threads of the pool take part in the following commands, the others
+ * only acknowledge them. Must be called after wait_cmds, because the barrier is set up again for
+ * the new number of threads. The functions of all threads are closed, the code may depend on the
+ * number of threads and the functions of parked threads may belong to other threads.
+ */
+int scale_threads(RuntimeConfig* runcfg, RuntimeWorkgroupConfig* wg, int num_threads)
+{
+    if ((!wg) || (!wg->threads) || num_threads <= 0 || num_threads > wg->max_threads)
+    {
+        return -EINVAL;
+    }
+    if (num_threads == wg->num_threads)
+    {
+        return 0;
+    }
+    barrier_destroy(&wg->barrier);
+    int err = barrier_init(&wg->barrier, runcfg->barrier, num_threads, wg->hwthreads);
+    if (err != 0)
+    {
+        return err;
+    }
+    DEBUG_PRINT(DEBUGLEV_DEVELOP, "Workgroup %s runs with %d of %d threads", bdata(wg->str), num_threads, wg->max_threads);
+    wg->num_threads = num_threads;
+    for (int i = 0; i < wg->max_threads; i++)
+    {
+        RuntimeThreadConfig* thread = &wg->threads[i];
+        thread->num_threads = num_threads;
+        /* The reduction slots of the new barrier start at zero */
+        thread->data->reductions = 0;
+        if (thread->testconfig)
+        {
+            close_function(thread);
+        }
+    }
     return 0;
-
-free:
-    destroy_threads(runcfg->num_wgroups, runcfg->wgroups);
-    return err;
 }
@@ -3,6 +3,9 @@
 #endif
 #include <errno.h>
 #include <inttypes.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -16,11 +19,13 @@
 #include <linux/perf_event.h>
 #include <linux/hw_breakpoint.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <sys/syscall.h>
 #include <sys/types.h>
 
 #include "error.h"
 #include "timer.h"
+#include "cachedir.h"
 
 #ifdef __linux__
 #define gettid() syscall(SYS_gettid)
@@ -73,6 +78,13 @@ static inline uint64_t _rdtscp()
     return ((uint64_t)hi << 32) | lo;
 }
 
+static inline uint64_t _rdpmc(uint32_t counter)
+{
+    uint32_t lo, hi;
+    __asm__ __volatile__("rdpmc" : "=a" (lo), "=d" (hi) : "c" (counter) : "memory");
+    return ((uint64_t)hi << 32) | lo;
+}
+
 static inline uint64_t _rd_tsc()
 {
     if (_has_rdtscp())
@@ -167,6 +179,12 @@ static uint64_t _get_time_in_ns(void)
     return ns;
 }
 
+/* The clock is system-wide, so timestamps of threads on different hwthreads are comparable */
+uint64_t lb_timer_timestamp(void)
+{
+    return _get_time_in_ns();
+}
+
 int lb_timer_as_resolution(TimerDataLB* tdata, uint64_t* resolution)
 {
     if (!tdata || !resolution)
@@ -194,6 +212,7 @@ static inline uint64_t _rd_counter(TimerDataLB* tdata)
         case TIMER_CLOCK_GETTIME:
             return _get_time_in_ns();
         case TIMER_RDTSC:
+        case TIMER_PERF_EVENT:
 #if defined(__x86_64) || defined(__i386__) || defined(__x86_64__)
             return _rd_tsc();
 #elif defined(__aarch64__) || defined(__arm__)
@@ -208,53 +227,646 @@ static inline uint64_t _rd_counter(TimerDataLB* tdata)
     return 0ULL;
 }
 
-static inline uint64_t _rd_freq(TimerDataLB* tdata)
+static char* _freq_source_names[MAX_TIMER_FREQ_SOURCE] = {
+    [TIMER_FREQ_SOURCE_NONE] = "none",
+    [TIMER_FREQ_SOURCE_CACHE] = "cache",
+    [TIMER_FREQ_SOURCE_CPUID] = "cpuid",
+    [TIMER_FREQ_SOURCE_SYSFS] = "sysfs",
+    [TIMER_FREQ_SOURCE_PERF] = "perf",
+    [TIMER_FREQ_SOURCE_ARCH] = "arch",
+    [TIMER_FREQ_SOURCE_REGRESSION] = "regression",
+};
+
+const char* lb_timer_freq_source_name(TimerFreqSource source)
 {
-    if (!tdata)
+    if (source < 0 || source >= MAX_TIMER_FREQ_SOURCE)
     {
-        return 0ULL;
+        return _freq_source_names[TIMER_FREQ_SOURCE_NONE];
+    }
+    return _freq_source_names[source];
+}
+
+static inline uint64_t _rd_calib_counter(void)
+{
+#if defined(__x86_64) || defined(__i386__) || defined(__x86_64__)
+    return _rd_tsc();
+#elif defined(__aarch64__) || defined(__arm__)
+    return _rd_ct();
+#elif defined(__powerpc) || defined(__ppc__) || defined(__PPC__)
+    return _rd_timebase();
+#else
+    return 0ULL;
+#endif
+}
+
+static int _read_boot_id(char* buf, size_t len)
+{
+    FILE* fp = fopen(TIMER_BOOT_ID_FILE, "r");
+    if (!fp)
+    {
+        return -errno;
+    }
+    if (!fgets(buf, len, fp))
+    {
+        fclose(fp);
+        return -EIO;
+    }
+    fclose(fp);
+    buf[strcspn(buf, "\n")] = '\0';
+    return (strlen(buf) > 0 ? 0 : -EIO);
+}
+
+/* Path of the state file in the cache folder of the user */
+static int _freq_cache_file(char* folder, size_t flen, char* file, size_t len)
+{
+    int err = cachedir_user_folder(folder, flen);
+    if (err < 0)
+    {
+        return err;
+    }
+    err = snprintf(file, len, "%s/%s", folder, TIMER_FREQ_CACHE_NAME);
+    if (err < 0 || (size_t)err >= len)
+    {
+        return -ENAMETOOLONG;
+    }
+    return 0;
+}
+
+static int _freq_from_cache(TimerFreqInfo* info)
+{
+    char boot_id[64];
+    char cached_id[64];
+    char folder[PATH_MAX];
+    char file[PATH_MAX];
+    uint64_t freq = 0ULL;
+    uint64_t ci = 0ULL;
+    int source = 0;
+    int err = _read_boot_id(boot_id, sizeof(boot_id));
+    if (err == 0)
+    {
+        err = _freq_cache_file(folder, sizeof(folder), file, sizeof(file));
+    }
+    if (err < 0)
+    {
+        return err;
     }
-    static uint64_t freq = 0ULL;
-    uint64_t sum = 0ULL;
-    const int iters = 10;
-    uint64_t measure[iters];
-    uint64_t start = 0ULL;
-    uint64_t end = 0ULL;
-    if (freq == 0ULL)
+    // Only a file of the user that nobody else can modify is trusted
+    err = cachedir_check(folder);
+    if (err == 0)
     {
-        switch(tdata->type)
+        err = cachedir_check(file);
+    }
+    if (err < 0)
+    {
+        return err;
+    }
+    FILE* fp = fopen(file, "r");
+    if (!fp)
+    {
+        return -ENOENT;
+    }
+    err = fscanf(fp, "%63s %" SCNu64 " %" SCNu64 " %d", cached_id, &freq, &ci, &source);
+    fclose(fp);
+    if (err != 4 || strcmp(cached_id, boot_id) != 0 || freq == 0ULL)
+    {
+        return -ENOENT;
+    }
+    info->freq = freq;
+    info->ci = ci;
+    info->source = TIMER_FREQ_SOURCE_CACHE;
+    DEBUG_PRINT(DEBUGLEV_DEVELOP, "Cached timer frequency %" PRIu64 " Hz (determined by %s)", freq, lb_timer_freq_source_name(source));
+    return 0;
+}
+
+static int _freq_to_cache(TimerFreqInfo* info)
+{
+    char boot_id[64];
+    char folder[PATH_MAX];
+    char file[PATH_MAX];
+    char tmpfile[PATH_MAX + 8];
+    int err = _read_boot_id(boot_id, sizeof(boot_id));
+    if (err == 0)
+    {
+        err = _freq_cache_file(folder, sizeof(folder), file, sizeof(file));
+    }
+    if (err == 0)
+    {
+        err = cachedir_create(folder);
+    }
+    if (err < 0)
+    {
+        return err;
+    }
+    // Write a new file and rename it, concurrent runs never read a partial file
+    snprintf(tmpfile, sizeof(tmpfile), "%s.XXXXXX", file);
+    int fd = mkstemp(tmpfile);
+    if (fd < 0)
+    {
+        return -errno;
+    }
+    FILE* fp = fdopen(fd, "w");
+    if (!fp)
+    {
+        err = -errno;
+        close(fd);
+        unlink(tmpfile);
+        return err;
+    }
+    fprintf(fp, "%s %" PRIu64 " %" PRIu64 " %d\n", boot_id, info->freq, info->ci, info->source);
+    fclose(fp);
+    if (rename(tmpfile, file) != 0)
+    {
+        err = -errno;
+        unlink(tmpfile);
+        return err;
+    }
+    return 0;
+}
+
+#if defined(__x86_64) || defined(__i386__) || defined(__x86_64__)
+/*
+ * Hypervisors that define the timing leaf 0x40000010. Other hypervisors (Hyper-V, Xen)
+ * use the leaves above 0x40000000 for something else.
+ */
+static const char* _timing_leaf_hypervisors[] = {
+    "VMwareVMware",
+    "KVMKVMKVM\0\0\0",
+};
+
+static int _hypervisor_has_timing_leaf(uint32_t maxleaf, uint32_t ebx, uint32_t ecx, uint32_t edx)
+{
+    char signature[12];
+    if (maxleaf < 0x40000010)
+    {
+        return 0;
+    }
+    memcpy(&signature[0], &ebx, sizeof(uint32_t));
+    memcpy(&signature[4], &ecx, sizeof(uint32_t));
+    memcpy(&signature[8], &edx, sizeof(uint32_t));
+    for (size_t i = 0; i < sizeof(_timing_leaf_hypervisors)/sizeof(_timing_leaf_hypervisors[0]); i++)
+    {
+        if (memcmp(signature, _timing_leaf_hypervisors[i], sizeof(signature)) == 0)
         {
-            case TIMER_CLOCK_GETTIME:
-                freq = 0ULL;
-                break;
-            case TIMER_RDTSC:
+            return 1;
+        }
+    }
+    return 0;
+}
+#endif
+
+static int _freq_from_cpuid(TimerFreqInfo* info)
+{
 #if defined(__x86_64) || defined(__i386__) || defined(__x86_64__)
-                for (int i = 0; i < iters; i++)
-                {
-                    start = _rd_tsc();
-                    lb_timer_sleep(NANOS_PER_SEC);
-                    end = _rd_tsc();
-                    measure[i] = end - start;
-                    sum += measure[i];
-                }
-                freq = (double)sum / iters;
-#elif defined(__aarch64__) || defined(__arm__)
-                freq = _rd_cf();
+    uint32_t reg[4];
+    _cpuid(reg, 0x1, 0);
+    if (reg[2] & (1U << 31))
+    {
+        // Hypervisor timing leaf (VMware, KVM with invtsc): TSC frequency in kHz
+        _cpuid(reg, 0x40000000, 0);
+        if (_hypervisor_has_timing_leaf(reg[0], reg[1], reg[2], reg[3]))
+        {
+            _cpuid(reg, 0x40000010, 0);
+            if (reg[0] != 0)
+            {
+                info->freq = (uint64_t)reg[0] * 1000ULL;
+                info->ci = 500ULL;
+                info->source = TIMER_FREQ_SOURCE_CPUID;
+                return 0;
+            }
+        }
+    }
+    _cpuid(reg, 0x0, 0);
+    uint32_t maxleaf = reg[0];
+    if (maxleaf < 0x15)
+    {
+        return -ENOTSUP;
+    }
+    // Leaf 0x15: TSC/crystal ratio in EBX/EAX, crystal frequency in ECX
+    _cpuid(reg, 0x15, 0);
+    uint32_t denominator = reg[0];
+    uint32_t numerator = reg[1];
+    uint32_t crystal = reg[2];
+    if (denominator == 0 || numerator == 0)
+    {
+        return -ENOTSUP;
+    }
+    if (crystal != 0)
+    {
+        // Nominal value, the tolerance of the crystal is not reported
+        info->freq = ((uint64_t)crystal * numerator) / denominator;
+        info->ci = 0ULL;
+        info->source = TIMER_FREQ_SOURCE_CPUID;
+        return 0;
+    }
+    if (maxleaf >= 0x16)
+    {
+        // No crystal frequency, the TSC runs at the base frequency of leaf 0x16 (in MHz)
+        _cpuid(reg, 0x16, 0);
+        if ((reg[0] & 0xFFFF) != 0)
+        {
+            info->freq = (uint64_t)(reg[0] & 0xFFFF) * 1000000ULL;
+            info->ci = 500000ULL;
+            info->source = TIMER_FREQ_SOURCE_CPUID;
+            return 0;
+        }
+    }
+#endif
+    return -ENOTSUP;
+}
+
+static int _freq_from_sysfs(TimerFreqInfo* info)
+{
+#if defined(__x86_64) || defined(__i386__) || defined(__x86_64__)
+    uint64_t khz = 0ULL;
+    FILE* fp = fopen(TIMER_SYSFS_TSC_KHZ_FILE, "r");
+    if (!fp)
+    {
+        return -ENOENT;
+    }
+    int ret = fscanf(fp, "%" SCNu64, &khz);
+    fclose(fp);
+    if (ret != 1 || khz == 0ULL)
+    {
+        return -EINVAL;
+    }
+    info->freq = khz * 1000ULL;
+    info->ci = 500ULL;
+    info->source = TIMER_FREQ_SOURCE_SYSFS;
+    return 0;
+#else
+    return -ENOTSUP;
+#endif
+}
+
+/*
+ * The kernel exports its TSC-to-ns conversion (derived from tsc_khz) in the first page of
+ * a perf event mapping: ns = (cycles * time_mult) >> time_shift.
+ */
+static int _freq_from_perf(TimerFreqInfo* info)
+{
+#if (defined(__x86_64) || defined(__i386__) || defined(__x86_64__)) && defined(__linux__)
+    struct perf_event_attr attr;
+    long pagesize = sysconf(_SC_PAGESIZE);
+    uint32_t seq = 0;
+    uint16_t time_shift = 0;
+    uint32_t time_mult = 0;
+    int cap_user_time = 0;
+    memset(&attr, 0, sizeof(struct perf_event_attr));
+    attr.size = sizeof(struct perf_event_attr);
+    attr.type = PERF_TYPE_SOFTWARE;
+    attr.config = PERF_COUNT_SW_DUMMY;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.disabled = 1;
+    int fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fd < 0)
+    {
+        return -errno;
+    }
+    struct perf_event_mmap_page* page = mmap(NULL, pagesize, PROT_READ, MAP_SHARED, fd, 0);
+    if (page == MAP_FAILED)
+    {
+        int err = -errno;
+        close(fd);
+        return err;
+    }
+    do
+    {
+        seq = page->lock;
+        __sync_synchronize();
+        cap_user_time = page->cap_user_time;
+        time_shift = page->time_shift;
+        time_mult = page->time_mult;
+        __sync_synchronize();
+    } while (page->lock != seq);
+    munmap(page, pagesize);
+    close(fd);
+    if (!cap_user_time || time_mult == 0)
+    {
+        return -ENOTSUP;
+    }
+    info->freq = (uint64_t)((((__uint128_t)NANOS_PER_SEC) << time_shift) / time_mult);
+    // time_mult is rounded to an integer
+    info->ci = (info->freq + 2 * (uint64_t)time_mult - 1) / (2 * (uint64_t)time_mult);
+    info->source = TIMER_FREQ_SOURCE_PERF;
+    return 0;
+#else
+    return -ENOTSUP;
+#endif
+}
+
+static int _freq_from_arch(TimerFreqInfo* info)
+{
+#if defined(__aarch64__) || defined(__arm__)
+    info->freq = _rd_cf();
 #elif defined(__powerpc) || defined(__ppc__) || defined(__PPC__)
-                for (int i = 0; i < iters; i++)
-                {
-                    start = _rd_timebase();
-                    lb_timer_sleep(NANOS_PER_SEC);
-                    end = _rd_timebase();
-                    measure[i] = end - start;
-                    sum += measure[i];
-                }
-                freq = (double)sum / iters;
+    info->freq = __ppc_get_timebase_freq();
+#else
+    return -ENOTSUP;
 #endif
-                break;
+    if (info->freq == 0ULL)
+    {
+        return -ENOTSUP;
+    }
+    info->ci = 0ULL;
+    info->source = TIMER_FREQ_SOURCE_ARCH;
+    return 0;
+}
+
+/*
+ * Read the counter between two clock reads, the tightest of a few tries is used.
+ * The midpoint of the clock reads is the time of the counter value.
+ */
+static void _bracket_sample(double* ns, double* count)
+{
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < TIMER_CALIB_BRACKET_TRIES; i++)
+    {
+        uint64_t t0 = _get_time_in_ns();
+        uint64_t c = _rd_calib_counter();
+        uint64_t t1 = _get_time_in_ns();
+        if (t1 >= t0 && t1 - t0 < best)
+        {
+            best = t1 - t0;
+            *ns = (double)t0 + (double)(t1 - t0) / 2.0;
+            *count = (double)c;
         }
     }
-    return freq;
+}
+
+/*
+ * Least squares fit of counter over clock time. Each round takes TIMER_CALIB_SAMPLES samples
+ * with twice the spacing of the previous one until the 95% confidence interval of the slope
+ * is below TIMER_CALIB_TARGET_PPM.
+ */
+static int _freq_from_regression(TimerFreqInfo* info)
+{
+    double x[TIMER_CALIB_SAMPLES];
+    double y[TIMER_CALIB_SAMPLES];
+    uint64_t spacing = TIMER_CALIB_SPACING_NS;
+    double freq = 0.0;
+    double ci = 0.0;
+    if (_rd_calib_counter() == 0ULL)
+    {
+        return -ENOTSUP;
+    }
+    for (int r = 0; r < TIMER_CALIB_MAX_ROUNDS; r++)
+    {
+        double xmean = 0.0, ymean = 0.0, sxx = 0.0, sxy = 0.0, sse = 0.0;
+        for (int i = 0; i < TIMER_CALIB_SAMPLES; i++)
+        {
+            _bracket_sample(&x[i], &y[i]);
+            if (i < TIMER_CALIB_SAMPLES - 1)
+            {
+                lb_timer_sleep(spacing);
+            }
+        }
+        // Relative to the first sample to keep the precision of the doubles
+        for (int i = TIMER_CALIB_SAMPLES - 1; i >= 0; i--)
+        {
+            x[i] -= x[0];
+            y[i] -= y[0];
+            xmean += x[i];
+            ymean += y[i];
+        }
+        xmean /= TIMER_CALIB_SAMPLES;
+        ymean /= TIMER_CALIB_SAMPLES;
+        for (int i = 0; i < TIMER_CALIB_SAMPLES; i++)
+        {
+            sxx += (x[i] - xmean) * (x[i] - xmean);
+            sxy += (x[i] - xmean) * (y[i] - ymean);
+        }
+        if (sxx <= 0.0)
+        {
+            return -EINVAL;
+        }
+        double slope = sxy / sxx;
+        for (int i = 0; i < TIMER_CALIB_SAMPLES; i++)
+        {
+            double e = y[i] - ymean - slope * (x[i] - xmean);
+            sse += e * e;
+        }
+        // Normal approximation of the t quantile, close enough for 30 degrees of freedom
+        double se = sqrt(sse / (TIMER_CALIB_SAMPLES - 2) / sxx);
+        freq = slope * NANOS_PER_SEC;
+        ci = 1.96 * se * NANOS_PER_SEC;
+        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Calibration round %d: %.0f Hz +- %.0f Hz (spacing %" PRIu64 " ns)", r, freq, ci, spacing);
+        if (ci <= freq * TIMER_CALIB_TARGET_PPM * 1e-6)
+        {
+            break;
+        }
+        spacing *= 2;
+    }
+    if (freq <= 0.0)
+    {
+        return -EINVAL;
+    }
+    info->freq = (uint64_t)(freq + 0.5);
+    info->ci = (uint64_t)(ci + 0.5);
+    info->source = TIMER_FREQ_SOURCE_REGRESSION;
+    return 0;
+}
+
+int lb_timer_freq_from_source(TimerFreqSource source, TimerFreqInfo* info)
+{
+    if (!info)
+    {
+        return -EINVAL;
+    }
+    switch (source)
+    {
+        case TIMER_FREQ_SOURCE_CACHE:
+            return _freq_from_cache(info);
+        case TIMER_FREQ_SOURCE_CPUID:
+            return _freq_from_cpuid(info);
+        case TIMER_FREQ_SOURCE_SYSFS:
+            return _freq_from_sysfs(info);
+        case TIMER_FREQ_SOURCE_PERF:
+            return _freq_from_perf(info);
+        case TIMER_FREQ_SOURCE_ARCH:
+            return _freq_from_arch(info);
+        case TIMER_FREQ_SOURCE_REGRESSION:
+            return _freq_from_regression(info);
+        default:
+            return -EINVAL;
+    }
+    return -EINVAL;
+}
+
+static TimerFreqInfo _freq_info = {0ULL, 0ULL, TIMER_FREQ_SOURCE_NONE};
+static int _freq_error = 0;
+static pthread_once_t _freq_once = PTHREAD_ONCE_INIT;
+
+static void _calibrate_once(void)
+{
+    _freq_error = -ENOTSUP;
+    for (int s = TIMER_FREQ_SOURCE_CACHE; s < MAX_TIMER_FREQ_SOURCE; s++)
+    {
+        TimerFreqInfo info = {0ULL, 0ULL, TIMER_FREQ_SOURCE_NONE};
+        int err = lb_timer_freq_from_source(s, &info);
+        if (err == 0)
+        {
+            _freq_info = info;
+            _freq_error = 0;
+            break;
+        }
+        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Timer frequency source %s not usable: %s", lb_timer_freq_source_name(s), strerror(-err));
+    }
+    if (_freq_error == 0)
+    {
+        DEBUG_PRINT(DEBUGLEV_DETAIL, "Timer frequency %" PRIu64 " Hz +- %" PRIu64 " Hz (%s)", _freq_info.freq, _freq_info.ci, lb_timer_freq_source_name(_freq_info.source));
+        if (_freq_info.source != TIMER_FREQ_SOURCE_CACHE)
+        {
+            int err = _freq_to_cache(&_freq_info);
+            if (err < 0)
+            {
+                DEBUG_PRINT(DEBUGLEV_DEVELOP, "Cannot write timer frequency cache %s: %s", TIMER_FREQ_CACHE_NAME, strerror(-err));
+            }
+        }
+    }
+}
+
+/*
+ * Determine the frequency of the TIMER_RDTSC counter once per process, the first usable source
+ * in TimerFreqSource order wins. The result is kept in a state file until the next reboot.
+ */
+int lb_timer_calibrate(TimerFreqInfo* info)
+{
+    if (!info)
+    {
+        return -EINVAL;
+    }
+    pthread_once(&_freq_once, _calibrate_once);
+    *info = _freq_info;
+    return _freq_error;
+}
+
+static inline uint64_t _rd_freq(TimerDataLB* tdata)
+{
+    TimerFreqInfo info;
+    if (!tdata || (tdata->type != TIMER_RDTSC && tdata->type != TIMER_PERF_EVENT))
+    {
+        return 0ULL;
+    }
+    if (lb_timer_calibrate(&info) != 0)
+    {
+        return 0ULL;
+    }
+    return info.freq;
+}
+
+static void _perf_close_counters(TimerDataLB* tdata)
+{
+    long pagesize = sysconf(_SC_PAGESIZE);
+    for (int i = 0; i < TIMER_PERF_NUM_COUNTERS; i++)
+    {
+        TimerPerfCounter* c = &tdata->perf[i];
+        if (c->page)
+        {
+            munmap(c->page, pagesize);
+            c->page = NULL;
+        }
+        if (c->fd >= 0)
+        {
+            close(c->fd);
+        }
+        c->fd = -1;
+    }
+}
+
+static int _perf_open_counter(TimerPerfCounter* c, uint64_t config, int group_fd)
+{
+    struct perf_event_attr attr;
+    long pagesize = sysconf(_SC_PAGESIZE);
+    memset(&attr, 0, sizeof(struct perf_event_attr));
+    attr.size = sizeof(struct perf_event_attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    // Kernels run in user space, this also works with perf_event_paranoid = 2
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    c->fd = syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+    if (c->fd < 0)
+    {
+        c->fd = -1;
+        return -errno;
+    }
+    // Without the mapping, the counter is read with read()
+    c->page = mmap(NULL, pagesize, PROT_READ, MAP_SHARED, c->fd, 0);
+    if (c->page == MAP_FAILED)
+    {
+        c->page = NULL;
+    }
+    return 0;
+}
+
+static int _perf_open_counters(TimerDataLB* tdata)
+{
+    for (int i = 0; i < TIMER_PERF_NUM_COUNTERS; i++)
+    {
+        tdata->perf[i].fd = -1;
+    }
+    int err = _perf_open_counter(&tdata->perf[TIMER_PERF_CYCLES], PERF_COUNT_HW_CPU_CYCLES, -1);
+    if (err < 0)
+    {
+        return err;
+    }
+    // Same group, so both counters are scheduled together
+    err = _perf_open_counter(&tdata->perf[TIMER_PERF_REF_CYCLES], PERF_COUNT_HW_REF_CPU_CYCLES, tdata->perf[TIMER_PERF_CYCLES].fd);
+    if (err < 0)
+    {
+        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Reference cycles not available: %s", strerror(-err));
+    }
+    return 0;
+}
+
+/*
+ * Fast path: while the event is active, the count is the kernel's offset plus the
+ * sign-extended hardware counter read with rdpmc (perf_event_open(2), "Userspace counting").
+ */
+static inline uint64_t _perf_read(TimerPerfCounter* c)
+{
+    uint64_t value = 0ULL;
+    if (c->fd < 0)
+    {
+        return 0ULL;
+    }
+#if defined(__x86_64) || defined(__i386__) || defined(__x86_64__)
+    struct perf_event_mmap_page* pc = (struct perf_event_mmap_page*)c->page;
+    if (pc)
+    {
+        uint32_t seq = 0;
+        uint32_t idx = 0;
+        do
+        {
+            seq = pc->lock;
+            __asm__ __volatile__("" : : : "memory");
+            idx = pc->index;
+            value = pc->offset;
+            if (pc->cap_user_rdpmc && idx)
+            {
+                int64_t pmc = (int64_t)_rdpmc(idx - 1);
+                pmc <<= (64 - pc->pmc_width);
+                pmc >>= (64 - pc->pmc_width);
+                value += pmc;
+            }
+            else
+            {
+                idx = 0;
+            }
+            __asm__ __volatile__("" : : : "memory");
+        } while (pc->lock != seq);
+        if (idx)
+        {
+            return value;
+        }
+    }
+#endif
+    if (read(c->fd, &value, sizeof(uint64_t)) != sizeof(uint64_t))
+    {
+        return 0ULL;
+    }
+    return value;
 }
 
 int lb_timer_init(TimerEvents type, TimerDataLB* tdata)
@@ -266,19 +878,41 @@ int lb_timer_init(TimerEvents type, TimerDataLB* tdata)
     int err = 0;
     memset(tdata, 0ULL, sizeof(TimerDataLB));
     tdata->type              = type;
+    for (int i = 0; i < TIMER_PERF_NUM_COUNTERS; i++)
+    {
+        tdata->perf[i].fd = -1;
+    }
     tdata->ci.freq = _rd_freq(tdata);
     err = (tdata->ci.freq == 0ULL) ? 0 : ((tdata->ci.freq > 0ULL) ? 0 : -ENOTSUP);
+    if (err == 0 && type == TIMER_PERF_EVENT)
+    {
+        err = _perf_open_counters(tdata);
+        if (err < 0)
+        {
+            _perf_close_counters(tdata);
+        }
+    }
     return err;
 }
 
 void lb_timer_start(TimerDataLB* tdata)
 {
+    if (tdata->type == TIMER_PERF_EVENT)
+    {
+        tdata->perf[TIMER_PERF_REF_CYCLES].start = _perf_read(&tdata->perf[TIMER_PERF_REF_CYCLES]);
+        tdata->perf[TIMER_PERF_CYCLES].start = _perf_read(&tdata->perf[TIMER_PERF_CYCLES]);
+    }
     tdata->start.uint64 = _rd_counter(tdata);
 }
 
 void lb_timer_stop(TimerDataLB* tdata)
 {
     tdata->stop.uint64 = _rd_counter(tdata);
+    if (tdata->type == TIMER_PERF_EVENT)
+    {
+        tdata->perf[TIMER_PERF_CYCLES].stop = _perf_read(&tdata->perf[TIMER_PERF_CYCLES]);
+        tdata->perf[TIMER_PERF_REF_CYCLES].stop = _perf_read(&tdata->perf[TIMER_PERF_REF_CYCLES]);
+    }
 }
 
 int lb_timer_as_ns(TimerDataLB* tdata, uint64_t *ns)
@@ -301,6 +935,7 @@ int lb_timer_as_ns(TimerDataLB* tdata, uint64_t *ns)
             *ns = diff;
             return 0;
         case TIMER_RDTSC:
+        case TIMER_PERF_EVENT:
             if (tdata->ci.freq != 0ULL)
             {
                 *ns = (uint64_t) (((__int128_t)diff * NANOS_PER_SEC) / tdata->ci.freq);
@@ -338,6 +973,57 @@ int lb_timer_as_cycles(TimerDataLB* tdata, uint64_t* cycles)
             // printf("cycles diff: %llu, stop: %llu, start: %llu\n", diff, tdata->stop.uint64, tdata->start.uint64);
             *cycles = diff;
             return 0;
+        case TIMER_PERF_EVENT:
+            if (tdata->perf[TIMER_PERF_CYCLES].stop <= tdata->perf[TIMER_PERF_CYCLES].start)
+            {
+                return -EINVAL;
+            }
+            *cycles = tdata->perf[TIMER_PERF_CYCLES].stop - tdata->perf[TIMER_PERF_CYCLES].start;
+            return 0;
+        default:
+            return -EINVAL;
+    }
+    return 0;
+}
+
+/*
+ * TIMER_RDTSC reports the counter frequency. TIMER_PERF_EVENT reports the average core
+ * frequency while the thread was running: core cycles over reference cycles (which tick
+ * with the TSC) or, without reference cycles, core cycles over the elapsed time.
+ */
+int lb_timer_as_freq(TimerDataLB* tdata, uint64_t* freq)
+{
+    uint64_t cycles = 0ULL;
+    uint64_t ns = 0ULL;
+    if (!tdata || !freq)
+    {
+        return -EINVAL;
+    }
+    switch(tdata->type)
+    {
+        case TIMER_CLOCK_GETTIME:
+            *freq = 0ULL;
+            return -ENOTSUP;
+        case TIMER_RDTSC:
+            *freq = tdata->ci.freq;
+            return 0;
+        case TIMER_PERF_EVENT:
+            if (lb_timer_as_cycles(tdata, &cycles) != 0)
+            {
+                return -EINVAL;
+            }
+            TimerPerfCounter* ref = &tdata->perf[TIMER_PERF_REF_CYCLES];
+            if (ref->fd >= 0 && ref->stop > ref->start)
+            {
+                *freq = (uint64_t)(((__uint128_t)cycles * tdata->ci.freq) / (ref->stop - ref->start));
+                return 0;
+            }
+            if (lb_timer_as_ns(tdata, &ns) != 0 || ns == 0ULL)
+            {
+                return -EINVAL;
+            }
+            *freq = (uint64_t)(((__uint128_t)cycles * NANOS_PER_SEC) / ns);
+            return 0;
         default:
             return -EINVAL;
     }
@@ -346,7 +1032,65 @@ int lb_timer_as_cycles(TimerDataLB* tdata, uint64_t* cycles)
 
 int lb_timer_supports_cycles(TimerEvents type)
 {
-    return (type == TIMER_RDTSC);
+    return (type == TIMER_RDTSC || type == TIMER_PERF_EVENT);
+}
+
+int lb_timer_has_type(TimerEvents type)
+{
+    TimerDataLB tdata;
+    int err = 0;
+    switch (type)
+    {
+        case TIMER_CLOCK_GETTIME:
+            return 1;
+        case TIMER_RDTSC:
+#if defined(__x86_64) || defined(__i386__) || defined(__x86_64__) || defined(__aarch64__) || defined(__arm__) || defined(__powerpc) || defined(__ppc__) || defined(__PPC__)
+            return 1;
+#else
+            return 0;
+#endif
+        case TIMER_PERF_EVENT:
+            memset(&tdata, 0, sizeof(TimerDataLB));
+            tdata.type = type;
+            err = _perf_open_counters(&tdata);
+            _perf_close_counters(&tdata);
+            return (err == 0);
+        default:
+            return 0;
+    }
+    return 0;
+}
+
+static char* _timer_type_names[] = {
+    [TIMER_CLOCK_GETTIME] = "gettime",
+    [TIMER_RDTSC] = "rdtsc",
+    [TIMER_PERF_EVENT] = "perf",
+};
+
+const char* lb_timer_type_name(TimerEvents type)
+{
+    if (type < TIMER_CLOCK_GETTIME || type > TIMER_PERF_EVENT)
+    {
+        return NULL;
+    }
+    return _timer_type_names[type];
+}
+
+int lb_timer_parse_type(const char* name, TimerEvents* type)
+{
+    if (!name || !type)
+    {
+        return -EINVAL;
+    }
+    for (int t = TIMER_CLOCK_GETTIME; t <= TIMER_PERF_EVENT; t++)
+    {
+        if (strcmp(name, _timer_type_names[t]) == 0)
+        {
+            *type = (TimerEvents)t;
+            return 0;
+        }
+    }
+    return -EINVAL;
 }
 
 
@@ -379,6 +1123,10 @@ int lb_timer_sleep(uint64_t nanoseconds)
 
 void lb_timer_close(TimerDataLB* tdata)
 {
+    if (tdata->type == TIMER_PERF_EVENT)
+    {
+        _perf_close_counters(tdata);
+    }
     tdata->type              = TIMER_CLOCK_GETTIME;
     memset(tdata, 0ULL, sizeof(TimerDataLB));
 }
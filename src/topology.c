@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include <errno.h>
 #include <string.h>
+#include <strings.h>
 #include <unistd.h>
 #include <dirent.h>
 #include <sys/stat.h>
@@ -21,6 +22,7 @@
 #include "path.h"
 #include "test_strings.h"
 #include "test_types.h"
+#include "topology.h"
 
 #define TOPO_MIN(a,b) ((a) < (b) ? (a) : (b))
 
@@ -776,6 +778,110 @@ int print_hwthreads()
     return 0;
 }
 
+int get_hwthread_numa_id(int os_id)
+{
+    for (int i = 0; _hwthreads && i < _num_hwthreads; i++)
+    {
+        if (_hwthreads[i].os_id == os_id)
+        {
+            return _hwthreads[i].numa_id;
+        }
+    }
+    return -ENODEV;
+}
+
+int get_hwthread_location(int os_id, int* core_id, int* socket_id)
+{
+    for (int i = 0; _hwthreads && i < _num_hwthreads; i++)
+    {
+        if (_hwthreads[i].os_id == os_id)
+        {
+            *core_id = _hwthreads[i].core_id;
+            *socket_id = _hwthreads[i].socket_id;
+            return 0;
+        }
+    }
+    return -ENODEV;
+}
+
+static const char* _domain_names[MAX_DOMAIN] = {
+    [DOMAIN_NONE] = "none",
+    [DOMAIN_SOCKET] = "socket",
+    [DOMAIN_NUMA] = "numa",
+    [DOMAIN_CORE] = "core",
+};
+
+const char* domain_level_name(DomainLevel level)
+{
+    if (level < DOMAIN_NONE || level >= MAX_DOMAIN)
+    {
+        return "unknown";
+    }
+    return _domain_names[level];
+}
+
+int parse_domain_level(const char* str, DomainLevel* level)
+{
+    if ((!str) || (!level))
+    {
+        return -EINVAL;
+    }
+    for (int l = DOMAIN_SOCKET; l < MAX_DOMAIN; l++)
+    {
+        if (strcasecmp(str, _domain_names[l]) == 0)
+        {
+            *level = (DomainLevel)l;
+            return 0;
+        }
+    }
+    return -EINVAL;
+}
+
+int get_hwthread_domain(int os_id, DomainLevel level)
+{
+    int core = 0;
+    int socket = 0;
+    int err = get_hwthread_location(os_id, &core, &socket);
+    if (err != 0)
+    {
+        return err;
+    }
+    switch (level)
+    {
+        case DOMAIN_SOCKET:
+            return socket;
+        case DOMAIN_NUMA:
+        {
+            /* Without NUMA information the sockets are the domains */
+            int numa = get_hwthread_numa_id(os_id);
+            return (numa >= 0 ? numa : socket);
+        }
+        case DOMAIN_CORE:
+            /* Core IDs repeat across the sockets */
+            return socket * get_num_hw_threads() + core;
+        default:
+            return -EINVAL;
+    }
+}
+
+int get_usable_hwthreads(int* list, int length)
+{
+    int count = 0;
+    int ret = check_hwthreads();
+    if (ret != 0)
+    {
+        return ret;
+    }
+    for (int i = 0; i < _num_hwthreads && count < length; i++)
+    {
+        if (_hwthreads[i].usable == 1)
+        {
+            list[count++] = _hwthreads[i].os_id;
+        }
+    }
+    return count;
+}
+
 void destroy_hwthreads()
 {
     if (_hwthreads)
@@ -1725,19 +1831,19 @@ int _read_cpuinfo(RuntimeConfig* runcfg)
         for (int t = 0; t < wg->num_threads; t++)
         {
             struct bstrList* flist = bsplit(cpu_info[wg->hwthreads[t]].ProcInfo.flags, ' ');
-            // printf("flags qty: %d\n", runcfg->tcfg->flags->qty);
+            // printf("flags qty: %d\n", wg->tcfg->flags->qty);
             int found = 0;
-            if (runcfg->tcfg->flags->qty > 0 && flist->qty > 0)
+            if (wg->tcfg->flags->qty > 0 && flist->qty > 0)
             {
-                for (int i = 0; i < runcfg->tcfg->flags->qty; i++)
+                for (int i = 0; i < wg->tcfg->flags->qty; i++)
                 {
-                    btrimws(runcfg->tcfg->flags->entry[i]);
+                    btrimws(wg->tcfg->flags->entry[i]);
                     for (int j = 0; j < flist->qty; j++)
                     {
                         btrimws(flist->entry[j]);
-                        if (blength(runcfg->tcfg->flags->entry[i]) > 0 && biseqcaseless(runcfg->tcfg->flags->entry[i], flist->entry[j]))
+                        if (blength(wg->tcfg->flags->entry[i]) > 0 && biseqcaseless(wg->tcfg->flags->entry[i], flist->entry[j]))
                         {
-                            DEBUG_PRINT(DEBUGLEV_DEVELOP, "Flag %s found on hwthread %d", bdata(runcfg->tcfg->flags->entry[i]), wg->hwthreads[t]);
+                            DEBUG_PRINT(DEBUGLEV_DEVELOP, "Flag %s found on hwthread %d", bdata(wg->tcfg->flags->entry[i]), wg->hwthreads[t]);
                             found++;
                         }
 
@@ -1747,7 +1853,7 @@ int _read_cpuinfo(RuntimeConfig* runcfg)
 
             }
 
-            if (found == runcfg->tcfg->flags->qty)
+            if (found == wg->tcfg->flags->qty)
             {
                 cpu_info[wg->hwthreads[t]].ProcInfo.flags_found = bstrcpy(&btrue);
             }
@@ -1756,10 +1862,10 @@ int _read_cpuinfo(RuntimeConfig* runcfg)
                 cpu_info[wg->hwthreads[t]].ProcInfo.flags_found = bstrcpy(&bfalse);
             }
 
-            if (found != runcfg->tcfg->flags->qty)
+            if (found != wg->tcfg->flags->qty)
             {
-                ERROR_PRINT("Flags not found on the system. Check the flags give in the test: %s", bdata(runcfg->testname));
-                bstrListPrint(runcfg->tcfg->flags);
+                ERROR_PRINT("Flags not found on the system. Check the flags give in the test: %s", bdata(wg->testname));
+                bstrListPrint(wg->tcfg->flags);
                 bstrListDestroy(flist);
                 return -EINVAL;
             }
@@ -1,4 +1,6 @@
 #include <inttypes.h>
+#include <limits.h>
+#include <math.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -13,12 +15,21 @@
 #include "workgroups.h"
 #include "topology.h"
 #include "results.h"
+#include "symbols.h"
 #include "allocator.h"
 #include "map.h"
-#include "calculator.h"
+#include "placement.h"
+#include "pages.h"
+#include "fill.h"
+#include "formula.h"
+#include "stats.h"
 #include "table.h"
 #include "test_strings.h"
+#include "read_yaml_ptt.h"
+#include "timer.h"
 
+#undef MIN
+#define MIN(a, b) ((a < b) ? (a) : (b))
 #undef MAX
 #define MAX(a, b) ((a > b) ? (a) : (b))
 
@@ -48,6 +59,7 @@ void delete_workgroup(RuntimeConfig* runcfg, RuntimeWorkgroupConfig* wg)
         bdestroy(wg->str);
         wg->str = NULL;
     }
+    release_workgroup_kernel(runcfg, wg);
     if (runcfg->global_results)
     {
         destroy_result(runcfg->global_results);
@@ -70,6 +82,7 @@ void release_streams(int num_wgroups, RuntimeWorkgroupConfig* wgroups)
                     DEBUG_PRINT(DEBUGLEV_DEVELOP, "Releasing workgroup %d %dd arrays for stream %s", w, wg->streams[s].dims, bdata(wg->streams[s].name));
                     release_arrays(&wg->streams[s]);
                     bdestroy(wg->streams[s].name);
+                    bdestroy(wg->streams[s].allocation_path);
                 }
                 free(wg->streams);
                 wg->streams = NULL;
@@ -124,17 +137,22 @@ int allocate_workgroup_stuff(RuntimeConfig* runcfg, int detailed, RuntimeWorkgro
         num_stats = stats2_count;
     }
 
-    runcfg->global_results = malloc(sizeof(RuntimeWorkgroupResult));
+    /* The global results are shared by all workgroups */
     if (!runcfg->global_results)
     {
-        ERROR_PRINT("Unable to allocate memory for global results");
-        return -ENOMEM;
-    }
-    err = init_result(runcfg->global_results);
-    if (err < 0)
-    {
-        free(runcfg->global_results);
-        return err;
+        runcfg->global_results = malloc(sizeof(RuntimeWorkgroupResult));
+        if (!runcfg->global_results)
+        {
+            ERROR_PRINT("Unable to allocate memory for global results");
+            return -ENOMEM;
+        }
+        err = init_result(runcfg->global_results);
+        if (err < 0)
+        {
+            free(runcfg->global_results);
+            runcfg->global_results = NULL;
+            return err;
+        }
     }
 
     double value = 0.0;
@@ -164,6 +182,10 @@ int allocate_workgroup_stuff(RuntimeConfig* runcfg, int detailed, RuntimeWorkgro
         {
             add_value(&wg->results[j], &bstats[s], value);
         }
+        for (int s = 0; runcfg->repetitions > 1 && s < stats3_count; s++)
+        {
+            add_value(&wg->results[j], &bstats3[s], value);
+        }
     }
     wg->group_results = malloc(sizeof(RuntimeWorkgroupResult));
     if (!wg->group_results)
@@ -231,58 +253,400 @@ int resolve_workgroups(RuntimeConfig* runcfg, int detailed, int num_wgroups, Run
     return 0;
 }
 
+/* Discards the results of all threads and workgroups, e.g. before the thread count changes */
+void release_results(RuntimeConfig* runcfg)
+{
+    if (runcfg->global_results)
+    {
+        destroy_result(runcfg->global_results);
+        free(runcfg->global_results);
+        runcfg->global_results = NULL;
+    }
+    for (int w = 0; w < runcfg->num_wgroups; w++)
+    {
+        RuntimeWorkgroupConfig* wg = &runcfg->wgroups[w];
+        if (wg->results)
+        {
+            for (int t = 0; t < wg->num_threads; t++)
+            {
+                destroy_result(&wg->results[t]);
+            }
+            free(wg->results);
+            wg->results = NULL;
+        }
+        if (wg->group_results)
+        {
+            destroy_result(wg->group_results);
+            free(wg->group_results);
+            wg->group_results = NULL;
+        }
+    }
+}
+
+/* Replaces the results with empty ones, e.g. before the next point of a sweep */
+int reset_results(RuntimeConfig* runcfg)
+{
+    release_results(runcfg);
+    for (int w = 0; w < runcfg->num_wgroups; w++)
+    {
+        int err = allocate_workgroup_stuff(runcfg, runcfg->detailed, &runcfg->wgroups[w]);
+        if (err != 0)
+        {
+            return err;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Loads the kernels selected with -w <group>@<kernel>, the other workgroups share the kernel of
+ * -t. The parameters on the command line are those of the -t kernel, so the kernel of a
+ * workgroup can only use parameters that the -t kernel has as well.
+ */
+int resolve_workgroup_kernels(RuntimeConfig* runcfg)
+{
+    for (int w = 0; w < runcfg->num_wgroups; w++)
+    {
+        RuntimeWorkgroupConfig* wg = &runcfg->wgroups[w];
+        if ((!wg->testname) || biseq(wg->testname, runcfg->testname))
+        {
+            bdestroy(wg->testname);
+            wg->testname = bstrcpy(runcfg->testname);
+            wg->tcfg = runcfg->tcfg;
+            continue;
+        }
+        bstring path = bformat("%s/%s.yaml", bdata(runcfg->kernelfolder), bdata(wg->testname));
+        if (access(bdata(path), R_OK))
+        {
+            errno = ENOENT;
+            ERROR_PRINT("Test %s of workgroup %d does not exist in folder %s", bdata(wg->testname), w + 1, bdata(runcfg->kernelfolder));
+            bdestroy(path);
+            return -ENOENT;
+        }
+        DEBUG_PRINT(DEBUGLEV_DETAIL, "Using kernel file %s for workgroup %d", bdata(path), w + 1);
+        int err = read_yaml_ptt(bdata(path), &wg->tcfg);
+        bdestroy(path);
+        if (err < 0)
+        {
+            wg->tcfg = NULL;
+            ERROR_PRINT("Error reading kernel %s of workgroup %d", bdata(wg->testname), w + 1);
+            return err;
+        }
+        for (int i = 0; i < wg->tcfg->num_params; i++)
+        {
+            int found = 0;
+            for (int j = 0; j < runcfg->num_params && !found; j++)
+            {
+                found = biseq(runcfg->params[j].name, wg->tcfg->params[i].name);
+            }
+            if (!found)
+            {
+                errno = EINVAL;
+                ERROR_PRINT("Kernel %s of workgroup %d needs parameter %s, which kernel %s does not have", bdata(wg->testname), w + 1, bdata(wg->tcfg->params[i].name), bdata(runcfg->testname));
+                return -EINVAL;
+            }
+        }
+    }
+    return 0;
+}
+
+void release_workgroup_kernel(RuntimeConfig* runcfg, RuntimeWorkgroupConfig* wg)
+{
+    if (wg->tcfg && wg->tcfg != runcfg->tcfg)
+    {
+        close_yaml_ptt(wg->tcfg);
+    }
+    wg->tcfg = NULL;
+    bdestroy(wg->testname);
+    wg->testname = NULL;
+}
+
+/*
+ * Per-stream settings come from a key of the stream in the YAML file. The command line
+ * option overrides it, either for all streams (e.g. 'interleave') or for single streams
+ * (e.g. 'STR0=bind:0,STR2=local'). Returns NULL if the stream has no setting.
+ */
+static bstring _stream_setting(bstring yaml, bstring cli, bstring name)
+{
+    bstring setting = NULL;
+    if (yaml && blength(yaml) > 0)
+    {
+        setting = bstrcpy(yaml);
+    }
+    if (cli && blength(cli) > 0)
+    {
+        struct bstrList* entries = bsplit(cli, ',');
+        for (int i = 0; i < entries->qty; i++)
+        {
+            int eq = bstrchr(entries->entry[i], '=');
+            if (eq != BSTR_ERR)
+            {
+                bstring ename = bmidstr(entries->entry[i], 0, eq);
+                btrimws(ename);
+                int match = (bstrcmp(ename, name) == BSTR_OK);
+                bdestroy(ename);
+                if (!match)
+                {
+                    continue;
+                }
+            }
+            if (setting)
+            {
+                bdestroy(setting);
+            }
+            setting = bmidstr(entries->entry[i], eq + 1, blength(entries->entry[i]));
+        }
+        bstrListDestroy(entries);
+    }
+    return setting;
+}
+
+static int _resolve_placement(RuntimeConfig* runcfg, TestConfigStream* istream, RuntimeStreamConfig* ostream)
+{
+    int err = 0;
+    ostream->placement = STREAM_PLACEMENT_DEFAULT;
+    ostream->placement_node = -1;
+    bstring setting = _stream_setting(istream->placement, runcfg->placement, istream->name);
+    if (setting)
+    {
+        err = parse_placement(setting, &ostream->placement, &ostream->placement_node);
+        if (err != 0)
+        {
+            ERROR_PRINT("Invalid placement '%s' for stream %s", bdata(setting), bdata(istream->name));
+        }
+        bdestroy(setting);
+    }
+    return err;
+}
+
+static int _resolve_allocation(RuntimeConfig* runcfg, TestConfigStream* istream, RuntimeStreamConfig* ostream)
+{
+    int err = 0;
+    ostream->allocation = STREAM_ALLOCATION_HEAP;
+    ostream->allocation_path = bfromcstr("");
+    bstring setting = _stream_setting(istream->allocation, runcfg->allocation, istream->name);
+    if (setting)
+    {
+        err = parse_allocation(setting, &ostream->allocation, ostream->allocation_path);
+        if (err != 0)
+        {
+            ERROR_PRINT("Invalid allocation '%s' for stream %s", bdata(setting), bdata(istream->name));
+        }
+        bdestroy(setting);
+    }
+    return err;
+}
+
+/*
+ * The command line accepts only the fill modes, the constants and rand of the YAML file are
+ * read with the stream type when the file is loaded.
+ */
+static int _resolve_fill(RuntimeConfig* runcfg, TestConfigStream* istream, RuntimeStreamConfig* ostream)
+{
+    int err = 0;
+    memset(&ostream->fill, 0, sizeof(StreamFill));
+    ostream->fill.mode = STREAM_FILL_CONSTANT;
+    ostream->fill.value = istream->data;
+    bstring setting = _stream_setting(NULL, runcfg->initialization, istream->name);
+    if (setting)
+    {
+        err = parse_fill(setting, &ostream->fill);
+        if (err != 0)
+        {
+            errno = EINVAL;
+            ERROR_PRINT("Invalid initialization '%s' for stream %s", bdata(setting), bdata(istream->name));
+            err = -EINVAL;
+        }
+        bdestroy(setting);
+    }
+    else if (istream->binit)
+    {
+        err = parse_fill(istream->binit, &ostream->fill);
+        if (err == -ENOENT)
+        {
+            err = 0;
+        }
+        else if (err != 0)
+        {
+            ERROR_PRINT("Invalid initialization '%s' for stream %s", bdata(istream->binit), bdata(istream->name));
+        }
+    }
+    if (err == 0 && ostream->fill.mode == STREAM_FILL_CHASE && (istream->type != TEST_STREAM_TYPE_INT64 || !istream->initialization))
+    {
+        /* The offsets of the cycle are relative to the part of the thread */
+        errno = EINVAL;
+        ERROR_PRINT("Initialization chase of stream %s needs the datatype int64 and the perthread option", bdata(istream->name));
+        err = -EINVAL;
+    }
+    return err;
+}
+
+static int _apply_placement(RuntimeWorkgroupConfig* wg, RuntimeStreamConfig* stream)
+{
+    int num_nodes = 0;
+    int* nodes = malloc(wg->num_threads * sizeof(int));
+    if (!nodes)
+    {
+        return -ENOMEM;
+    }
+    for (int t = 0; t < wg->num_threads; t++)
+    {
+        int node = get_hwthread_numa_id(wg->hwthreads[t]);
+        int known = (node < 0);
+        for (int n = 0; n < num_nodes && !known; n++)
+        {
+            known = (nodes[n] == node);
+        }
+        if (!known)
+        {
+            nodes[num_nodes++] = node;
+        }
+    }
+    size_t size = (size_t)((char*)stream->ptr - (char*)stream->base_ptr) + getstreambytes(stream);
+    if (stream->alloc_size > 0)
+    {
+        /* Separate mappings are placed as a whole, mbind requires huge page aligned ranges for them */
+        size = stream->alloc_size;
+    }
+    int err = apply_placement(stream->base_ptr, size, stream->placement, stream->placement_node, nodes, num_nodes);
+    free(nodes);
+    return err;
+}
+
+int report_placement(RuntimeWorkgroupConfig* wg)
+{
+    int max_node = placement_max_node();
+    size_t* pages = malloc((max_node + 1) * sizeof(size_t));
+    if (!pages)
+    {
+        return -ENOMEM;
+    }
+    for (int s = 0; s < wg->num_streams; s++)
+    {
+        RuntimeStreamConfig* stream = &wg->streams[s];
+        size_t unmapped = 0;
+        if ((!stream->base_ptr) || (stream->placement == STREAM_PLACEMENT_DEFAULT && global_verbosity < DEBUGLEV_INFO))
+        {
+            continue;
+        }
+        size_t size = (size_t)((char*)stream->ptr - (char*)stream->base_ptr) + getstreambytes(stream);
+        int err = query_placement(stream->base_ptr, size, max_node, pages, &unmapped);
+        if (err != 0)
+        {
+            ERROR_PRINT("Cannot query NUMA placement of stream %s: %s", bdata(stream->name), strerror(-err));
+            free(pages);
+            return err;
+        }
+        printf("Placement of %s (%s", bdata(stream->name), placement_name(stream->placement));
+        if (stream->placement == STREAM_PLACEMENT_BIND)
+        {
+            printf(":%d", stream->placement_node);
+        }
+        printf("):");
+        for (int n = 0; n <= max_node; n++)
+        {
+            if (pages[n] > 0)
+            {
+                printf(" node%d %zu pages", n, pages[n]);
+            }
+        }
+        if (unmapped > 0)
+        {
+            printf(" unmapped %zu pages", unmapped);
+        }
+        printf("\n");
+    }
+    free(pages);
+    return 0;
+}
+
+/* Evaluates the dimension sizes of the stream from the current global results */
+static int _stream_dimsizes(RuntimeConfig* runcfg, RuntimeWorkgroupConfig* wg, TestConfigStream* istream, RuntimeStreamConfig* ostream)
+{
+    ostream->dims = 0;
+    for (int k = 0; k < istream->num_dims && k < istream->dims->qty; k++)
+    {
+        bstring t = bstrcpy(istream->dims->entry[k]);
+        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Stream %s: dimsize before %s", bdata(istream->name), bdata(t));
+        /* The sizes are rounded for the kernel of each workgroup, so its own results come first */
+        replace_all(&wg->results[0], t, NULL);
+        replace_all(runcfg->global_results, t, NULL);
+        size_t res = 0;
+        int c = sscanf(bdata(t), "%zu", &res);
+        if (c == 1)
+        {
+            ostream->dimsizes[k] = res;
+        }
+        if (res == 0)
+        {
+            ERROR_PRINT("Invalid dimension size %s -> %zu after conversion", bdata(istream->dims->entry[k]), res);
+            bdestroy(t);
+            return -EINVAL;
+        }
+        DEBUG_PRINT(DEBUGLEV_DEVELOP, "Stream %s: dimsize after %zu", bdata(istream->name), ostream->dimsizes[k]);
+        ostream->dims++;
+        bdestroy(t);
+    }
+    return 0;
+}
+
 int manage_streams(RuntimeWorkgroupConfig* wg, RuntimeConfig* runcfg)
 {
     int err = 0;
-    DEBUG_PRINT(DEBUGLEV_DEVELOP, "Allocating %d streams", runcfg->tcfg->num_streams);
-    wg->streams = malloc(runcfg->tcfg->num_streams * sizeof(RuntimeStreamConfig));
+    DEBUG_PRINT(DEBUGLEV_DEVELOP, "Allocating %d streams", wg->tcfg->num_streams);
+    wg->streams = malloc(wg->tcfg->num_streams * sizeof(RuntimeStreamConfig));
     if (!wg->streams)
     {
         ERROR_PRINT("Unable to allocate memory for Streams");
         return -ENOMEM;
     }
-    memset(wg->streams, 0, runcfg->tcfg->num_streams * sizeof(RuntimeStreamConfig));
+    memset(wg->streams, 0, wg->tcfg->num_streams * sizeof(RuntimeStreamConfig));
 
-    for (int j = 0; j < runcfg->tcfg->num_streams; j++)
+    for (int j = 0; j < wg->tcfg->num_streams; j++)
     {
-        TestConfigStream *istream = &runcfg->tcfg->streams[j];
+        TestConfigStream *istream = &wg->tcfg->streams[j];
         RuntimeStreamConfig* ostream = &wg->streams[j];
         if (istream && ostream)
         {
             ostream->name = bstrcpy(istream->name);
+            err = _resolve_placement(runcfg, istream, ostream);
+            if (err == 0)
+            {
+                err = _resolve_allocation(runcfg, istream, ostream);
+            }
+            if (err == 0)
+            {
+                err = _resolve_fill(runcfg, istream, ostream);
+            }
+            if (err != 0)
+            {
+                return err;
+            }
             ostream->type = istream->type;
             ostream->data = istream->data;
-            ostream->dims = 0;
-            for (int k = 0; k < istream->num_dims && k < istream->dims->qty; k++)
-            {
-                bstring t = bstrcpy(istream->dims->entry[k]);
-                DEBUG_PRINT(DEBUGLEV_DEVELOP, "Stream %d: dimsize before %s", j, bdata(t));
-                replace_all(runcfg->global_results, t, NULL);
-                size_t res = 0;
-                int c = sscanf(bdata(t), "%zu", &res);
-                if (c == 1)
-                {
-                    ostream->dimsizes[k] = res;
-                }
-                if (res == 0)
-                {
-                    ERROR_PRINT("Invalid dimension size %s -> %zu after conversion", bdata(istream->dims->entry[k]), res);
-                    bdestroy(t);
-                    return -EINVAL;
-                }
-                DEBUG_PRINT(DEBUGLEV_DEVELOP, "Stream %d: dimsize after %zu", j, ostream->dimsizes[k]);
-                ostream->dims++;
-                bdestroy(t);
+            err = _stream_dimsizes(runcfg, wg, istream, ostream);
+            if (err != 0)
+            {
+                return err;
             }
             // printf("name: %s, type: %d, dims: %d\n", bdata(ostream->name), ostream->type, ostream->dims);
         }
     }
 
 
-    wg->num_streams = runcfg->tcfg->num_streams;
+    wg->num_streams = wg->tcfg->num_streams;
     for (int j = 0; j < wg->num_streams; j++)
     {
         err = allocate_arrays(&wg->streams[j]);
+        wg->streams[j].capacity = (err == 0 ? getstreambytes(&wg->streams[j]) : 0);
+        if (err == 0 && wg->streams[j].placement != STREAM_PLACEMENT_DEFAULT)
+        {
+            err = _apply_placement(wg, &wg->streams[j]);
+            if (err < 0)
+            {
+                ERROR_PRINT("Cannot apply %s placement to stream %s: %s", placement_name(wg->streams[j].placement), bdata(wg->streams[j].name), strerror(-err));
+            }
+        }
         if (err < 0)
         {
             release_arrays(&wg->streams[j]);
@@ -296,84 +660,476 @@ int manage_streams(RuntimeWorkgroupConfig* wg, RuntimeConfig* runcfg)
     return 0;
 }
 
-void collect_keys_func(mpointer key, mpointer value, mpointer user_data)
+/*
+ * Adapts the streams to the dimension sizes of the next point of a sweep. Arrays that fit into
+ * the memory of the stream are carved out of it, larger ones replace the memory.
+ */
+int resize_streams(RuntimeWorkgroupConfig* wg, RuntimeConfig* runcfg)
+{
+    for (int j = 0; j < wg->num_streams; j++)
+    {
+        TestConfigStream *istream = &wg->tcfg->streams[j];
+        RuntimeStreamConfig* stream = &wg->streams[j];
+        int err = _stream_dimsizes(runcfg, wg, istream, stream);
+        if (err != 0)
+        {
+            return err;
+        }
+        size_t bytes = getstreambytes(stream);
+        if (bytes <= stream->capacity)
+        {
+            DEBUG_PRINT(DEBUGLEV_DEVELOP, "Stream %s uses %zu of %zu Bytes", bdata(stream->name), bytes, stream->capacity);
+            continue;
+        }
+        release_arrays(stream);
+        stream->capacity = 0;
+        err = allocate_arrays(stream);
+        if (err == 0 && stream->placement != STREAM_PLACEMENT_DEFAULT)
+        {
+            err = _apply_placement(wg, stream);
+            if (err < 0)
+            {
+                ERROR_PRINT("Cannot apply %s placement to stream %s: %s", placement_name(stream->placement), bdata(stream->name), strerror(-err));
+            }
+        }
+        if (err < 0)
+        {
+            return err;
+        }
+        stream->capacity = bytes;
+    }
+    return 0;
+}
+
+void collect_keys_func(int id, bstring name, mpointer user_data)
 {
-    bstring bkey = (bstring) key;
     struct bstrList* keys = (struct bstrList*) user_data;
-    bstrListAdd(keys, bkey);
+    bstrListAdd(keys, name);
 }
 
 void collect_keys(RuntimeWorkgroupResult* result, struct bstrList* sl)
 {
-    foreach_in_bmap(result->values, collect_keys_func, sl);
+    foreach_value(result, collect_keys_func, sl);
 }
 
-int _aggregate_results(struct bstrList* bkeys, struct bstrList** bvalues, RuntimeWorkgroupResult* res)
+/* Metrics of the kernels of other workgroups are missing, look before get_value() complains */
+static int _has_value(RuntimeWorkgroupResult* result, bstring name)
 {
-    /*
-    for (int i = 0; i < bkeys->qty; i++)
+    double v = 0.0;
+    return (get_value_by_id(result, symbol_find(name, symbol_hash(name)), &v) == 0);
+}
+
+/* Index of key in keys at or after first, -1 if it is not there */
+static int _find_key(struct bstrList* keys, int first, bstring key)
+{
+    for (int k = first; k < keys->qty; k++)
     {
-        printf("%s", bdata(bkeys->entry[i]));
-        bstrListPrint(bvalues[i]);
+        if (biseq(keys->entry[k], key))
+        {
+            return k;
+        }
     }
-    printf("\n");
-    */
+    return -1;
+}
+
+/* Adds the keys of result that are not yet in sl */
+static void _collect_new_keys(RuntimeWorkgroupResult* result, struct bstrList* sl)
+{
+    struct bstrList* keys = bstrListCreate();
+    collect_keys(result, keys);
+    for (int k = 0; k < keys->qty; k++)
+    {
+        if (_find_key(sl, 0, keys->entry[k]) < 0)
+        {
+            bstrListAdd(sl, keys->entry[k]);
+        }
+    }
+    bstrListDestroy(keys);
+}
+
+static int _set_value(RuntimeWorkgroupResult* res, bstring key, double value)
+{
+    return set_value_by_id(res, symbol_intern(key, symbol_hash(key)), value);
+}
+
+/*
+ * The threads keep the timestamps of every repetition, but the fastest repetition differs
+ * between the threads and the workgroups may stop after a different number of repetitions.
+ * Selects the repetition run by all threads with the shortest window from the first start to
+ * the last stop as start and stop of each thread, so the skew and overlap compare the same
+ * episode. Like min_runtime of a single thread, it is the best case of the repetitions, so the
+ * [concurrent] rates divide the volume by a window of the same repetition and equal the
+ * per-thread rates of a single thread.
+ */
+static void _common_repetition(int num_wgroups, RuntimeWorkgroupConfig* wgroups)
+{
+    int reps = INT_MAX;
+    for (int w = 0; w < num_wgroups; w++)
+    {
+        for (int t = 0; t < wgroups[w].num_threads; t++)
+        {
+            _thread_data* data = wgroups[w].threads[t].data;
+            int num = ((data->starts && data->stops) ? data->num_samples : 0);
+            reps = MIN(reps, num);
+        }
+    }
+    if (reps <= 0 || reps == INT_MAX)
+    {
+        return;
+    }
+    int best = 0;
+    uint64_t best_span = UINT64_MAX;
+    for (int r = 0; r < reps; r++)
+    {
+        uint64_t first = UINT64_MAX;
+        uint64_t last = 0;
+        for (int w = 0; w < num_wgroups; w++)
+        {
+            for (int t = 0; t < wgroups[w].num_threads; t++)
+            {
+                first = MIN(first, wgroups[w].threads[t].data->starts[r]);
+                last = MAX(last, wgroups[w].threads[t].data->stops[r]);
+            }
+        }
+        if (last > first && last - first < best_span)
+        {
+            best = r;
+            best_span = last - first;
+        }
+    }
+    for (int w = 0; w < num_wgroups; w++)
+    {
+        for (int t = 0; t < wgroups[w].num_threads; t++)
+        {
+            _thread_data* data = wgroups[w].threads[t].data;
+            data->start = data->starts[best];
+            data->stop = data->stops[best];
+        }
+    }
+    DEBUG_PRINT(DEBUGLEV_DEVELOP, "Timestamps of repetition %d of %d for the skew analysis", best, reps);
+}
+
+/*
+ * Skew and overlap of the common repetition of all threads of the given workgroups. The
+ * per-thread metrics divide the volume of each thread by its own runtime, so their sum
+ * assumes that all threads ran at the same time. For every rate metric (unit ending in
+ * "/s]"), the "[concurrent]" value divides the volume of all threads by the window from
+ * the first start to the last stop instead, which is the same if the threads overlap
+ * completely and lower by the share of the window in which not all threads were running.
+ */
+static int _overlap_results(struct bstrList* metrics, int num_wgroups, RuntimeWorkgroupConfig* wgroups, uint64_t origin, RuntimeWorkgroupResult* res)
+{
+    static struct tagbstring btime = bsStatic("time");
+    static struct tagbstring brate = bsStatic("/s]");
     int err = 0;
-    static struct tagbstring bcomma = bsStatic(",");
-    for (int id = 0; id < bkeys->qty; id++)
-    {
-        bstring key = bstrcpy(bkeys->entry[id]);
-        bstring formula = bjoin(bvalues[id], &bcomma);
-        for (int a = 0; a < aggregations.num_aggregations; a++)
-        {
-            bstring bkey = bformat("%s[%s]", bdata(key), bdata(&aggregations.baggregations[a]));
-            bstring full_formula = bformat("%s(%s)", bdata(&aggregations.baggregations[a]), bdata(formula));
-            // printf("key: %s, full formula: %s, len: %d\n", bdata(bkey), bdata(full_formula), blength(full_formula));
-            double calc_result;
-            err = calculator_calc(bdata(full_formula), &calc_result);
-            if (err == 0)
+    int count = 0;
+    for (int w = 0; w < num_wgroups; w++)
+    {
+        count += wgroups[w].num_threads;
+    }
+    uint64_t* starts = malloc(count * sizeof(uint64_t));
+    uint64_t* stops = malloc(count * sizeof(uint64_t));
+    if ((!starts) || (!stops))
+    {
+        ERROR_PRINT("Unable to allocate memory for thread timestamps");
+        free(starts);
+        free(stops);
+        return -ENOMEM;
+    }
+    count = 0;
+    for (int w = 0; w < num_wgroups; w++)
+    {
+        for (int t = 0; t < wgroups[w].num_threads; t++)
+        {
+            starts[count] = wgroups[w].threads[t].data->start;
+            stops[count] = wgroups[w].threads[t].data->stop;
+            count++;
+        }
+    }
+    OverlapStats stats;
+    err = sample_overlap(starts, stops, count, &stats);
+    free(starts);
+    free(stops);
+    if (err != 0)
+    {
+        ERROR_PRINT("No valid start and stop timestamps of the threads");
+        return err;
+    }
+    struct tagbstring bstart_skew = bsStatic("start skew [s]");
+    struct tagbstring bstop_skew = bsStatic("stop skew [s]");
+    struct tagbstring boverlap = bsStatic("overlap window [s]");
+    _set_value(res, &bstart_skew, stats.start_skew / NANOS_PER_SEC);
+    _set_value(res, &bstop_skew, stats.stop_skew / NANOS_PER_SEC);
+    _set_value(res, &boverlap, stats.overlap / NANOS_PER_SEC);
+    DEBUG_PRINT(DEBUGLEV_DETAIL, "%d threads starting %.0lfns after %" PRIu64 "ns, overlap %.0lfns of %.0lfns", count, stats.start_skew, origin, stats.overlap, stats.span);
+
+    for (int i = 0; i < metrics->qty && stats.span > 0; i++)
+    {
+        bstring name = metrics->entry[i];
+        double volume = 0.0;
+        int found = 0;
+        if (binstr(name, 0, &brate) == BSTR_ERR)
+        {
+            continue;
+        }
+        for (int w = 0; w < num_wgroups; w++)
+        {
+            for (int t = 0; t < wgroups[w].num_threads; t++)
             {
-                // printf("calc result: %f\n", calc_result);
-                err = add_value(res, bkey, calc_result);
-                if (err != 0)
+                double rate = 0.0;
+                double time = 0.0;
+                if (_has_value(&wgroups[w].results[t], name) && get_value(&wgroups[w].results[t], name, &rate) == 0 && get_value(&wgroups[w].results[t], &btime, &time) == 0)
                 {
-                    ERROR_PRINT("Unable to add value to the results");
+                    volume += rate * time;
+                    found = 1;
                 }
             }
-            else
+        }
+        if (!found)
+        {
+            /* The metric belongs to the kernel of another workgroup */
+            continue;
+        }
+        bstring bkey = bformat("%s[concurrent]", bdata(name));
+        _set_value(res, bkey, volume / (stats.span / NANOS_PER_SEC));
+        bdestroy(bkey);
+    }
+    return 0;
+}
+
+/* Where the value of a name in the metric formulas of a workgroup comes from for a thread */
+typedef enum {
+    METRIC_SLOT_CONSTANT = 0,
+    METRIC_SLOT_MEASURED,
+    METRIC_SLOT_METRIC,
+    METRIC_SLOT_VARIABLE,
+    METRIC_SLOT_VALUE,
+} MetricSlotSource;
+
+typedef struct {
+    struct bstrList* names;
+    MetricSlotSource* sources;
+    int* index;
+    double* values;
+    int max_slots;
+} MetricSlots;
+
+typedef struct {
+    MetricSlots* slots;
+    MetricSlotSource source;
+    RuntimeWorkgroupResult* result;
+    int variables;
+    int err;
+} MetricSlotsData;
+
+/* A name keeps the first source it is added with */
+static int _add_slot(MetricSlots* slots, bstring name, MetricSlotSource source, int index, double value)
+{
+    if (_find_key(slots->names, 0, name) >= 0)
+    {
+        return 0;
+    }
+    if (slots->names->qty == slots->max_slots)
+    {
+        int max_slots = (slots->max_slots > 0 ? 2 * slots->max_slots : 32);
+        MetricSlotSource* sources = realloc(slots->sources, max_slots * sizeof(MetricSlotSource));
+        if (sources) slots->sources = sources;
+        int* index = realloc(slots->index, max_slots * sizeof(int));
+        if (index) slots->index = index;
+        double* values = realloc(slots->values, max_slots * sizeof(double));
+        if (values) slots->values = values;
+        if ((!sources) || (!index) || (!values))
+        {
+            return -ENOMEM;
+        }
+        slots->max_slots = max_slots;
+    }
+    int s = slots->names->qty;
+    bstrListAdd(slots->names, name);
+    slots->sources[s] = source;
+    slots->index[s] = index;
+    slots->values[s] = value;
+    return 0;
+}
+
+/* Variables are numbers, anything else is evaluated as a formula without names */
+static double _constant_value(bstring value)
+{
+    char* end = NULL;
+    double d = strtod(bdata(value), &end);
+    if (end != bdata(value) && *end == '\0')
+    {
+        return d;
+    }
+    Formula f;
+    d = NAN;
+    if (formula_compile(value, NULL, &f) == 0)
+    {
+        formula_eval(&f, NULL, &d);
+        formula_free(&f);
+    }
+    return d;
+}
+
+/* The slots of variables and values of the threads keep the symbol ID of their name */
+static void _add_slot_cb(int id, bstring name, mpointer user_data)
+{
+    MetricSlotsData* data = (MetricSlotsData*)user_data;
+    double d = NAN;
+    if (data->source == METRIC_SLOT_CONSTANT)
+    {
+        bstring value = (data->variables ? get_variable_text(data->result, id) : get_value_text(data->result, id));
+        d = _constant_value(value);
+        bdestroy(value);
+    }
+    if (_add_slot(data->slots, name, data->source, id, d) < 0)
+    {
+        data->err = -ENOMEM;
+    }
+}
+
+/*
+ * The names the metric formulas of a workgroup can use, in the order in which the formulas
+ * were substituted before: the variables of the kernel, the global results, which are the
+ * same for all threads, and the variables, measured values, metrics and other values of
+ * each thread, whose slots are filled per thread.
+ */
+static int _metric_slots(RuntimeConfig* runcfg, RuntimeWorkgroupConfig* wg, struct bstrList* bkeys, int num_measured, MetricSlots* slots)
+{
+    TestConfig_t cfg = wg->tcfg;
+    MetricSlotsData data = {.slots = slots, .source = METRIC_SLOT_CONSTANT, .err = 0};
+    memset(slots, 0, sizeof(MetricSlots));
+    slots->names = bstrListCreate();
+    if (!slots->names)
+    {
+        return -ENOMEM;
+    }
+    for (int i = 0; i < cfg->num_vars && data.err == 0; i++)
+    {
+        data.err = _add_slot(slots, cfg->vars[i].name, METRIC_SLOT_CONSTANT, -1, _constant_value(cfg->vars[i].value));
+    }
+    data.result = runcfg->global_results;
+    data.variables = 1;
+    foreach_variable(data.result, _add_slot_cb, &data);
+    data.variables = 0;
+    foreach_value(data.result, _add_slot_cb, &data);
+    data.source = METRIC_SLOT_VARIABLE;
+    data.result = &wg->results[0];
+    foreach_variable(data.result, _add_slot_cb, &data);
+    for (int id = 0; id < num_measured && data.err == 0; id++)
+    {
+        data.err = _add_slot(slots, bkeys->entry[id], METRIC_SLOT_MEASURED, id, NAN);
+    }
+    for (int i = 0; i < cfg->num_metrics && data.err == 0; i++)
+    {
+        data.err = _add_slot(slots, cfg->metrics[i].name, METRIC_SLOT_METRIC, i, NAN);
+    }
+    data.source = METRIC_SLOT_VALUE;
+    foreach_value(data.result, _add_slot_cb, &data);
+    return data.err;
+}
+
+/* Reads the per-thread slots, the metrics are set while they are evaluated */
+static void _fill_metric_slots(MetricSlots* slots, RuntimeWorkgroupResult* result, const double* measured)
+{
+    for (int s = 0; s < slots->names->qty; s++)
+    {
+        switch (slots->sources[s])
+        {
+            case METRIC_SLOT_CONSTANT:
+                break;
+            case METRIC_SLOT_MEASURED:
+                slots->values[s] = measured[slots->index[s]];
+                break;
+            case METRIC_SLOT_METRIC:
+                slots->values[s] = NAN;
+                break;
+            case METRIC_SLOT_VARIABLE:
+                if (get_variable_by_id(result, slots->index[s], &slots->values[s]) != 0)
+                {
+                    slots->values[s] = NAN;
+                }
+                break;
+            case METRIC_SLOT_VALUE:
+                if (get_value_by_id(result, slots->index[s], &slots->values[s]) != 0)
+                {
+                    slots->values[s] = NAN;
+                }
+                break;
+        }
+    }
+}
+
+static void _free_metric_slots(MetricSlots* slots)
+{
+    bstrListDestroy(slots->names);
+    free(slots->sources);
+    free(slots->index);
+    free(slots->values);
+    memset(slots, 0, sizeof(MetricSlots));
+}
+
+/*
+ * Adds '<key>[<aggregation>]' to res for every key and aggregation. The values of key id are
+ * values[id * stride] to values[id * stride + count - 1], nan marks threads without the key.
+ */
+static int _aggregate_results(struct bstrList* bkeys, struct bstrList* baggregations, const double* values, int stride, int count, RuntimeWorkgroupResult* res)
+{
+    int err = 0;
+    struct tagbstring bdefault = bsStatic(STATS_DEFAULT_AGGREGATIONS);
+    struct bstrList* baggs = (baggregations ? bstrListCopy(baggregations) : bsplit(&bdefault, ','));
+    SampleAggregation* aggs = malloc(baggs->qty * sizeof(SampleAggregation));
+    double* scratch = malloc(MAX(count, 1) * sizeof(double));
+    if ((!aggs) || (!scratch))
+    {
+        free(aggs);
+        free(scratch);
+        bstrListDestroy(baggs);
+        return -ENOMEM;
+    }
+    for (int a = 0; a < baggs->qty; a++)
+    {
+        if (sample_parse_aggregation(bdata(baggs->entry[a]), &aggs[a]) != 0)
+        {
+            ERROR_PRINT("Unknown aggregation %s", bdata(baggs->entry[a]));
+            err = -EINVAL;
+        }
+    }
+    for (int id = 0; id < bkeys->qty && err == 0; id++)
+    {
+        for (int a = 0; a < baggs->qty; a++)
+        {
+            double result = 0.0;
+            /* The selection reorders the values, every aggregation gets its own copy */
+            memcpy(scratch, &values[id * stride], count * sizeof(double));
+            if (sample_aggregate(&aggs[a], scratch, count, &result) != 0)
+            {
+                /* A metric of a kernel that runs in other workgroups */
+                break;
+            }
+            bstring bkey = bformat("%s[%s]", bdata(bkeys->entry[id]), bdata(baggs->entry[a]));
+            err = add_value(res, bkey, result);
+            if (err != 0)
             {
-                ERROR_PRINT("Error calculating formula: %s", bdata(full_formula));
+                ERROR_PRINT("Unable to add value to the results");
             }
-            bdestroy(full_formula);
             bdestroy(bkey);
         }
-        bdestroy(formula);
-        bdestroy(key);
     }
+    free(aggs);
+    free(scratch);
+    bstrListDestroy(baggs);
     return err;
 }
 
 int update_results(RuntimeConfig* runcfg, int num_wgroups, RuntimeWorkgroupConfig* wgroups)
 {
     int err = 0;
-    int max_len = 0;
     // struct tagbstring mbytes = bsStatic("[MByte/s]");
-    struct bstrList* tmp_tcfg_keys = bstrListCreate();
-    struct bstrList* tmp_tcfg_values = bstrListCreate();
-    TestConfig_t cfg = runcfg->tcfg;
-    for (int i = 0; i < cfg->num_vars; i++)
-    {
-        TestConfigVariable* v = &cfg->vars[i];
-        bstrListAdd(tmp_tcfg_keys, v->name);
-        bstrListAdd(tmp_tcfg_values, v->value);
-        int l = blength(v->name);
-        if (l > max_len) max_len = l;
-    }
 
     struct bstrList* bkeys = bstrListCreate();
     struct bstrList* bkeys_sorted = NULL;
-    struct bstrList** bgrp_values = NULL;
-    struct bstrList** bvalues = NULL;
+    double* grp_values = NULL;
     if (!bkeys)
     {
         ERROR_PRINT("Unable to allocate memory for keys");
@@ -391,38 +1147,68 @@ int update_results(RuntimeConfig* runcfg, int num_wgroups, RuntimeWorkgroupConfi
     }
     bstrListSort(bkeys, &bkeys_sorted);
     bstrListDestroy(bkeys);
-    for (int i = 0; i < cfg->num_metrics; i++)
+    /*
+     * The metrics of all kernels follow the measured values. A metric of several kernels is
+     * aggregated over all of their threads, the other ones only over the threads that have them.
+     */
+    int num_measured = bkeys_sorted->qty;
+    for (int w = 0; w < num_wgroups; w++)
     {
-        TestConfigVariable* m = &cfg->metrics[i];
-        bstrListAdd(bkeys_sorted, m->name);
+        TestConfig_t cfg = wgroups[w].tcfg;
+        for (int i = 0; i < cfg->num_metrics; i++)
+        {
+            if (_find_key(bkeys_sorted, num_measured, cfg->metrics[i].name) < 0)
+            {
+                bstrListAdd(bkeys_sorted, cfg->metrics[i].name);
+            }
+        }
     }
-    bgrp_values = calloc(bkeys_sorted->qty, sizeof(struct bstrList*));
-    if (!bgrp_values)
+    struct bstrList* bmetrics = bstrListCreate();
+    for (int id = num_measured; id < bkeys_sorted->qty; id++)
+    {
+        bstrListAdd(bmetrics, bkeys_sorted->entry[id]);
+    }
+    /*
+     * The values of all threads are aggregated as doubles: key id of the t-th thread of all
+     * workgroups is grp_values[id * total_threads + t], nan if the thread has no such key
+     */
+    int total_threads = 0;
+    for (int w = 0; w < num_wgroups; w++)
+    {
+        total_threads += wgroups[w].num_threads;
+    }
+    grp_values = malloc(MAX(bkeys_sorted->qty * total_threads, 1) * sizeof(double));
+    if (!grp_values)
     {
         ERROR_PRINT("Unable to allocate memory for group values");
         bstrListDestroy(bkeys_sorted);
+        bstrListDestroy(bmetrics);
         return -ENOMEM;
     }
-    for (int id = 0; id < bkeys_sorted->qty; id++)
+    for (int i = 0; i < bkeys_sorted->qty * total_threads; i++)
     {
-        bgrp_values[id] = bstrListCreate();
-        if (!bgrp_values[id])
-        {
-            ERROR_PRINT("Unable to allocate memory for each group values");
-            for (int j = 0; j < id; j++)
-            {
-                bstrListDestroy(bgrp_values[j]);
-            }
-            free(bgrp_values);
-            bstrListDestroy(bkeys_sorted);
-            return -ENOMEM;
-        }
+        grp_values[i] = NAN;
     }
+    int offset = 0;
 
     /*
      * The below loops are just to update the iteration for each thread results
      * and as they were not necessary for stats reporting
      */
+    /* The timestamps of the threads are reported relative to the first start of all workgroups */
+    static struct tagbstring bstart = bsStatic("start [s]");
+    static struct tagbstring bstop = bsStatic("stop [s]");
+    uint64_t origin = UINT64_MAX;
+    _common_repetition(num_wgroups, wgroups);
+    for (int w = 0; w < num_wgroups; w++)
+    {
+        for (int t = 0; t < wgroups[w].num_threads; t++)
+        {
+            origin = MIN(origin, wgroups[w].threads[t].data->start);
+        }
+    }
+    int iter_id = symbol_intern(&biterations, symbol_hash(&biterations));
+    int cycles_id = symbol_intern(&bcycles, symbol_hash(&bcycles));
     struct bstrList* blist1 = bstrListCreate();
     struct bstrList* blist2 = bstrListCreate();
     for (int w = 0; w < num_wgroups; w++)
@@ -434,15 +1220,19 @@ int update_results(RuntimeConfig* runcfg, int num_wgroups, RuntimeWorkgroupConfi
             RuntimeWorkgroupResult* result = &wg->results[t];
             if (wg->hwthreads[t] == thread->data->hwthread)
             {
-                bstring val = bformat("%zu", thread->data->iters);
-                err = update_variable(result, &biterations, val);
+                err = set_variable_by_id(result, iter_id, (int64_t)thread->data->iters);
                 if (err == 0)
                 {
+                    bstring val = bformat("%zu", thread->data->iters);
                     bstrListAdd(blist1, val);
                     bstrListAdd(blist2, val);
                     DEBUG_PRINT(DEBUGLEV_DEVELOP, "Variable updated for hwthread %d for key %s with value %s", thread->data->hwthread, bdata(&biterations), bdata(val));
+                    bdestroy(val);
                 }
-                bdestroy(val);
+                // The cycles of the kernel call are available to the metrics, e.g. cycles per instruction
+                set_variable_by_id(result, cycles_id, (int64_t)thread->data->cycles);
+                _set_value(result, &bstart, (double)(thread->data->start - origin) / NANOS_PER_SEC);
+                _set_value(result, &bstop, (double)(thread->data->stop - origin) / NANOS_PER_SEC);
             }
         }
     }
@@ -462,90 +1252,101 @@ int update_results(RuntimeConfig* runcfg, int num_wgroups, RuntimeWorkgroupConfi
     for (int w = 0; w < num_wgroups; w++)
     {
         RuntimeWorkgroupConfig* wg = &wgroups[w];
-        bvalues = calloc(bkeys_sorted->qty, sizeof(struct bstrList*));
-        if (!bvalues)
+        TestConfig_t cfg = wg->tcfg;
+        /* The formulas are compiled once per workgroup and evaluated for each thread */
+        MetricSlots slots;
+        err = _metric_slots(runcfg, wg, bkeys_sorted, num_measured, &slots);
+        Formula* programs = calloc(cfg->num_metrics + 1, sizeof(Formula));
+        int* metric_slots = calloc(cfg->num_metrics + 1, sizeof(int));
+        if (err < 0 || (!programs) || (!metric_slots))
         {
-            ERROR_PRINT("Unable to allocate memory for values of %d workgroup", w);
+            ERROR_PRINT("Unable to allocate memory for metric formulas of %d workgroup", w);
+            _free_metric_slots(&slots);
+            free(programs);
+            free(metric_slots);
+            free(grp_values);
             bstrListDestroy(bkeys_sorted);
+            bstrListDestroy(bmetrics);
             return -ENOMEM;
         }
-        for (int id = 0; id < bkeys_sorted->qty; id++)
+        for (int i = 0; i < cfg->num_metrics; i++)
         {
-            bvalues[id] = bstrListCreate();
-            if (!bvalues[id])
+            TestConfigVariable* m = &cfg->metrics[i];
+            if (formula_compile(m->value, slots.names, &programs[i]) < 0)
             {
-                ERROR_PRINT("Unable to allocate memory for each values");
-                for (int j = 0; j < id; j++)
-                {
-                    bstrListDestroy(bvalues[j]);
-                }
-                free(bvalues);
-                bstrListDestroy(bkeys_sorted);
-                return -ENOMEM;
+                ERROR_PRINT("Error compiling formula of %s: %s", bdata(m->name), bdata(m->value));
             }
+            int s = _find_key(slots.names, 0, m->name);
+            metric_slots[i] = (s >= 0 && slots.sources[s] == METRIC_SLOT_METRIC ? s : -1);
         }
-
         for (int t = 0; t < wg->num_threads; t++)
         {
             RuntimeThreadConfig* thread = &wg->threads[t];
             RuntimeWorkgroupResult* result = &wg->results[t];
             if (wg->hwthreads[t] == thread->data->hwthread)
             {
-                // values in the list should be added as per sorted keys max 3 as per stats count from test_strings header
-                double values[3];
+                // values in the list should be added as per sorted keys max 3 + 8 as per stats count from test_strings header
+                double values[11];
+                int num_values = 0;
                 if (runcfg->detailed == 1)
                 {
-                    values[0] = (double)thread->data->cycles;
-                    values[1] = (double)thread->data->freq;
+                    values[num_values++] = (double)thread->data->cycles;
+                    values[num_values++] = (double)thread->data->freq;
                     // values[2] = (double)thread->data->iters;
-                    values[2] = thread->runtime;
+                    values[num_values++] = thread->runtime;
                 }
                 else
                 {
                     // values[0] = (double)thread->data->iters;
-                    values[0] = thread->runtime;
+                    values[num_values++] = thread->runtime;
                 }
-                for (int id = 0; id < bkeys_sorted->qty - cfg->num_metrics; id ++)
+                if (runcfg->repetitions > 1)
+                {
+                    SampleStats stats;
+                    memset(&stats, 0, sizeof(SampleStats));
+                    err = sample_stats(thread->data->samples, thread->data->num_samples, &stats);
+                    if (err != 0)
+                    {
+                        ERROR_PRINT("No runtime samples for hwthread %d", thread->data->hwthread);
+                    }
+                    values[num_values++] = stats.ci / NANOS_PER_SEC;
+                    values[num_values++] = stats.mean / NANOS_PER_SEC;
+                    values[num_values++] = stats.median / NANOS_PER_SEC;
+                    values[num_values++] = stats.min / NANOS_PER_SEC;
+                    values[num_values++] = stats.p5 / NANOS_PER_SEC;
+                    values[num_values++] = stats.p95 / NANOS_PER_SEC;
+                    values[num_values++] = (double)stats.count;
+                    values[num_values++] = stats.stddev / NANOS_PER_SEC;
+                }
+                for (int id = 0; id < num_measured; id ++)
                 {
                     double value = values[id];
-                    bstring t_value = bformat("%.15lf", value);
-                    // printf("t_value: %s\n", bdata(t_value));
                     err = update_value(result, bkeys_sorted->entry[id], value);
                     if (err == 0)
                     {
                         DEBUG_PRINT(DEBUGLEV_DEVELOP, "Value updated for hwthread %d for key %s with value %.15lf", thread->data->hwthread, bdata(bkeys_sorted->entry[id]), value);
                     }
-                    bstrListAdd(bvalues[id], t_value);
-                    bstrListAdd(bgrp_values[id], t_value);
-                    bdestroy(t_value);
+                    grp_values[id * total_threads + offset + t] = value;
                 }
+                _fill_metric_slots(&slots, result, values);
                 for (int i = 0; i < cfg->num_metrics; i++)
                 {
                     TestConfigVariable* m = &cfg->metrics[i];
-                    double val;
+                    int id = _find_key(bkeys_sorted, num_measured, m->name);
+                    double val = NAN;
                     bstring bcpy = bstrcpy(m->name);
-                    bstring btmp = bstrcpy(m->value);
-                    // For replacing values from longest variables
-                    for (int l = max_len; l >= 1; l--)
+                    if (programs[i].ops)
                     {
-                        for (int k = 0; k < tmp_tcfg_keys->qty; k++)
+                        err = formula_eval(&programs[i], slots.values, &val);
+                        if (err != 0)
                         {
-                            if (blength(tmp_tcfg_keys->entry[k]) == l && binstr(btmp, 0, tmp_tcfg_keys->entry[k]) != BSTR_ERR)
-                            {
-                                DEBUG_PRINT(DEBUGLEV_DEVELOP, "Replacing '%s' with '%s' in '%s'", bdata(tmp_tcfg_keys->entry[k]), bdata(tmp_tcfg_values->entry[k]), bdata(btmp));
-                                bfindreplace(btmp, tmp_tcfg_keys->entry[k], tmp_tcfg_values->entry[k], 0);
-                            }
+                            ERROR_PRINT("Error calculating formula: %s", bdata(m->value));
                         }
                     }
-                    // printf("bcpy: %s\n", bdata(btmp));
-                    replace_all(runcfg->global_results, btmp, NULL);
-                    replace_all(result, btmp, NULL);
-                    err = calculator_calc(bdata(btmp), &val);
-                    if (err != 0)
+                    if (metric_slots[i] >= 0)
                     {
-                        ERROR_PRINT("Error calculating formula: %s", bdata(btmp));
+                        slots.values[metric_slots[i]] = val;
                     }
-                    // printf("bcpy: %s, value: %lf\n", bdata(btmp), val);
                     /*
                      * the conversion has been removed as user should know when to convert them explicity based on units they needed/required
                     if (binstrcaseless(bcpy, 0, &mbytes) != BSTR_ERR)
@@ -559,45 +1360,62 @@ int update_results(RuntimeConfig* runcfg, int num_wgroups, RuntimeWorkgroupConfi
                     }
                     */
                     add_value(result, bcpy, val);
-                    bstring bval = bformat("%15lf", val);
-                    bstrListAdd(bvalues[bkeys_sorted->qty + i - cfg->num_metrics], bval);
-                    bstrListAdd(bgrp_values[bkeys_sorted->qty + i - cfg->num_metrics], bval);
-                    bdestroy(bval);
+                    grp_values[id * total_threads + offset + t] = val;
                     bdestroy(bcpy);
-                    bdestroy(btmp);
                 }
             }
         }
 
-        err = _aggregate_results(bkeys_sorted, bvalues, wg->group_results);
+        err = _aggregate_results(bkeys_sorted, runcfg->aggregations, &grp_values[offset], total_threads, wg->num_threads, wg->group_results);
         if (err != 0)
         {
             ERROR_PRINT("Error in aggregation of group results for workgroup %d", w);
         }
-        for (int id = 0; id < bkeys_sorted->qty; id ++)
+        for (int i = 0; i < cfg->num_metrics; i++)
+        {
+            formula_free(&programs[i]);
+        }
+        free(programs);
+        free(metric_slots);
+        _free_metric_slots(&slots);
+        err = _overlap_results(bmetrics, 1, wg, origin, wg->group_results);
+        if (err != 0)
         {
-            bstrListDestroy(bvalues[id]);
+            ERROR_PRINT("Error in overlap analysis of workgroup %d", w);
         }
-        free(bvalues);
+        /* The page size is a property of the stream, so it is reported per workgroup */
+        for (int s = 0; s < wg->num_streams; s++)
+        {
+            RuntimeStreamConfig* stream = &wg->streams[s];
+            size_t pagesize = 0;
+            size_t size = (size_t)((char*)stream->ptr - (char*)stream->base_ptr) + getstreambytes(stream);
+            if (stream->base_ptr && query_pagesize(stream->base_ptr, size, &pagesize) == 0)
+            {
+                bstring bkey = bformat("pagesize %s [B]", bdata(stream->name));
+                add_value(wg->group_results, bkey, (double)pagesize);
+                bdestroy(bkey);
+            }
+        }
+        offset += wg->num_threads;
         if (DEBUGLEV_DEVELOP == global_verbosity)
         {
             printf("Below are the results after initialization of Group Results for Workgroup: %d\n", w);
             print_workgroup(wg);
         }
     }
-    err = _aggregate_results(bkeys_sorted, bgrp_values, runcfg->global_results);
+    err = _aggregate_results(bkeys_sorted, runcfg->aggregations, grp_values, total_threads, total_threads, runcfg->global_results);
     if (err != 0)
     {
         ERROR_PRINT("Error in aggregation of global results");
     }
-    for (int id = 0; id < bkeys_sorted->qty; id ++)
+    err = _overlap_results(bmetrics, num_wgroups, wgroups, origin, runcfg->global_results);
+    if (err != 0)
     {
-        bstrListDestroy(bgrp_values[id]);
+        ERROR_PRINT("Error in overlap analysis of all workgroups");
     }
-    free(bgrp_values);
+    free(grp_values);
     bstrListDestroy(bkeys_sorted);
-    bstrListDestroy(tmp_tcfg_keys);
-    bstrListDestroy(tmp_tcfg_values);
+    bstrListDestroy(bmetrics);
     return err;
 }
 
@@ -629,6 +1447,7 @@ void print_workgroup(RuntimeWorkgroupConfig* wg)
 
 int update_table(RuntimeConfig* runcfg, Table** thread, Table** wgroup, Table** global, int* max_cols, int transpose)
 {
+    static struct tagbstring bnovalue = bsStatic("-");
     struct bstrList* bthread_keys = bstrListCreate();
     struct bstrList* bwgroup_keys = bstrListCreate();
     struct bstrList* bglobal_keys = bstrListCreate();
@@ -639,8 +1458,12 @@ int update_table(RuntimeConfig* runcfg, Table** thread, Table** wgroup, Table**
     Table* iwgroup = NULL;
     Table* iglobal = NULL;
 
-    collect_keys(&runcfg->wgroups[0].results[0], bthread_keys);
-    collect_keys(&runcfg->wgroups[0].group_results[0], bwgroup_keys);
+    /* Workgroups running different kernels have different metrics, the tables get all of them */
+    for (int w = 0; w < runcfg->num_wgroups; w++)
+    {
+        _collect_new_keys(&runcfg->wgroups[w].results[0], bthread_keys);
+        _collect_new_keys(&runcfg->wgroups[w].group_results[0], bwgroup_keys);
+    }
     collect_keys(runcfg->global_results, bglobal_keys);
 
     bstrListAdd(bthread_keys, &bthreadid);
@@ -691,12 +1514,17 @@ int update_table(RuntimeConfig* runcfg, Table** thread, Table** wgroup, Table**
                 else
                 {
                     double val;
-                    if (get_value(result, bthread_keys_sorted->entry[k], &val) == 0)
+                    if (_has_value(result, bthread_keys_sorted->entry[k]) && get_value(result, bthread_keys_sorted->entry[k], &val) == 0)
                     {
                         bstring bval = bformat("%.15lf", val);
                         bstrListAdd(btmp1, bval);
                         bdestroy(bval);
                     }
+                    else
+                    {
+                        /* Not a metric of the kernel of this workgroup, the cell stays empty */
+                        bstrListAdd(btmp1, &bnovalue);
+                    }
                 }
             }
             table_addrow(ithread, btmp1);
@@ -719,12 +1547,16 @@ int update_table(RuntimeConfig* runcfg, Table** thread, Table** wgroup, Table**
             else
             {
                 double val;
-                if (get_value(wg->group_results, bwgroup_keys_sorted->entry[k], &val) == 0)
+                if (_has_value(wg->group_results, bwgroup_keys_sorted->entry[k]) && get_value(wg->group_results, bwgroup_keys_sorted->entry[k], &val) == 0)
                 {
                     bstring bval = bformat("%.15lf", val);
                     bstrListAdd(btmp2, bval);
                     bdestroy(bval);
                 }
+                else
+                {
+                    bstrListAdd(btmp2, &bnovalue);
+                }
             }
         }
         table_addrow(iwgroup, btmp2);
@@ -747,7 +1579,7 @@ int update_table(RuntimeConfig* runcfg, Table** thread, Table** wgroup, Table**
         else
         {
             double val;
-            if (get_value(runcfg->global_results, bglobal_keys_sorted->entry[k], &val) == 0)
+            if (_has_value(runcfg->global_results, bglobal_keys_sorted->entry[k]) && get_value(runcfg->global_results, bglobal_keys_sorted->entry[k], &val) == 0)
             {
                 bstring bval = bformat("%.15lf", val);
                 bstrListAdd(btmp3, bval);
@@ -771,3 +1603,214 @@ int update_table(RuntimeConfig* runcfg, Table** thread, Table** wgroup, Table**
     bstrListDestroy(bwgroup_keys_sorted);
     bstrListDestroy(bglobal_keys_sorted);
 }
+
+/*
+ * Aggregates the values of the threads per domain of the topology level of runcfg->domains.
+ * The table has one row per domain, ordered by domain ID, with the aggregations of all values
+ * of the thread results.
+ */
+int domain_table(RuntimeConfig* runcfg, Table** table)
+{
+    static struct tagbstring bnovalue = bsStatic("-");
+    if ((!runcfg) || (!table))
+    {
+        return -EINVAL;
+    }
+    *table = NULL;
+    if (runcfg->domains == DOMAIN_NONE)
+    {
+        return 0;
+    }
+    struct tagbstring bdefault = bsStatic(STATS_DEFAULT_AGGREGATIONS);
+    struct bstrList* baggs = (runcfg->aggregations ? bstrListCopy(runcfg->aggregations) : bsplit(&bdefault, ','));
+    struct bstrList* bkeys = bstrListCreate();
+    struct bstrList* bkeys_sorted = NULL;
+    int total_threads = 0;
+    for (int w = 0; w < runcfg->num_wgroups; w++)
+    {
+        _collect_new_keys(&runcfg->wgroups[w].results[0], bkeys);
+        total_threads += runcfg->wgroups[w].num_threads;
+    }
+    bstrListSort(bkeys, &bkeys_sorted);
+    bstrListDestroy(bkeys);
+    int num_keys = bkeys_sorted->qty;
+    int* domains = malloc(MAX(total_threads, 1) * sizeof(int));
+    double* values = malloc(MAX(num_keys * total_threads, 1) * sizeof(double));
+    double* dvalues = malloc(MAX(num_keys * total_threads, 1) * sizeof(double));
+    if ((!domains) || (!values) || (!dvalues))
+    {
+        free(domains);
+        free(values);
+        free(dvalues);
+        bstrListDestroy(baggs);
+        bstrListDestroy(bkeys_sorted);
+        return -ENOMEM;
+    }
+    int t = 0;
+    for (int w = 0; w < runcfg->num_wgroups; w++)
+    {
+        RuntimeWorkgroupConfig* wg = &runcfg->wgroups[w];
+        for (int i = 0; i < wg->num_threads; i++, t++)
+        {
+            domains[t] = get_hwthread_domain(wg->hwthreads[i], runcfg->domains);
+            for (int k = 0; k < num_keys; k++)
+            {
+                values[k * total_threads + t] = NAN;
+                if (_has_value(&wg->results[i], bkeys_sorted->entry[k]))
+                {
+                    get_value(&wg->results[i], bkeys_sorted->entry[k], &values[k * total_threads + t]);
+                }
+            }
+        }
+    }
+
+    struct bstrList* bheaders = bstrListCreate();
+    bstrListAddChar(bheaders, "DOMAIN");
+    bstrListAdd(bheaders, &bnumthreads);
+    for (int k = 0; k < num_keys; k++)
+    {
+        for (int a = 0; a < baggs->qty; a++)
+        {
+            bstring bkey = bformat("%s[%s]", bdata(bkeys_sorted->entry[k]), bdata(baggs->entry[a]));
+            bstrListAdd(bheaders, bkey);
+            bdestroy(bkey);
+        }
+    }
+    int err = table_create(bheaders, table);
+    int last = -1;
+    while (err == 0)
+    {
+        /* The next larger domain ID, threads without topology information have none */
+        int domain = -1;
+        for (t = 0; t < total_threads; t++)
+        {
+            if (domains[t] > last && (domain < 0 || domains[t] < domain))
+            {
+                domain = domains[t];
+            }
+        }
+        if (domain < 0)
+        {
+            break;
+        }
+        last = domain;
+        int count = 0;
+        for (t = 0; t < total_threads; t++)
+        {
+            count += (domains[t] == domain);
+        }
+        for (int k = 0; k < num_keys; k++)
+        {
+            int i = 0;
+            for (t = 0; t < total_threads; t++)
+            {
+                if (domains[t] == domain)
+                {
+                    dvalues[k * count + i++] = values[k * total_threads + t];
+                }
+            }
+        }
+        RuntimeWorkgroupResult result;
+        err = init_result(&result);
+        if (err != 0)
+        {
+            break;
+        }
+        err = _aggregate_results(bkeys_sorted, baggs, dvalues, count, count, &result);
+        struct bstrList* brow = bstrListCreate();
+        bstring bval = bformat("%s %d", domain_level_name(runcfg->domains), domain);
+        bstrListAdd(brow, bval);
+        bdestroy(bval);
+        bval = bformat("%d", count);
+        bstrListAdd(brow, bval);
+        bdestroy(bval);
+        for (int h = 2; h < bheaders->qty; h++)
+        {
+            double val = 0.0;
+            if (_has_value(&result, bheaders->entry[h]) && get_value(&result, bheaders->entry[h], &val) == 0)
+            {
+                bval = bformat("%.15lf", val);
+                bstrListAdd(brow, bval);
+                bdestroy(bval);
+            }
+            else
+            {
+                bstrListAdd(brow, &bnovalue);
+            }
+        }
+        if (err == 0)
+        {
+            err = table_addrow(*table, brow);
+        }
+        bstrListDestroy(brow);
+        destroy_result(&result);
+    }
+    if (err != 0 && *table)
+    {
+        table_destroy(*table);
+        *table = NULL;
+    }
+    bstrListDestroy(bheaders);
+    bstrListDestroy(baggs);
+    bstrListDestroy(bkeys_sorted);
+    free(domains);
+    free(values);
+    free(dvalues);
+    return err;
+}
+
+/*
+ * Appends the global results of one point of a sweep to the sweep table. The table is created
+ * at the first point with the swept parameter and the global result keys as columns.
+ */
+int add_sweep_row(RuntimeConfig* runcfg, bstring param, size_t value, Table** table)
+{
+    int err = 0;
+    if (!*table)
+    {
+        struct bstrList* bkeys = bstrListCreate();
+        struct bstrList* bkeys_sorted = NULL;
+        collect_keys(runcfg->global_results, bkeys);
+        bstrListAdd(bkeys, &bnumthreads);
+        bstrListSort(bkeys, &bkeys_sorted);
+        bstrListDestroy(bkeys);
+        struct bstrList* bheaders = bstrListCreate();
+        bstrListAdd(bheaders, param);
+        for (int k = 0; k < bkeys_sorted->qty; k++)
+        {
+            bstrListAdd(bheaders, bkeys_sorted->entry[k]);
+        }
+        bstrListDestroy(bkeys_sorted);
+        err = table_create(bheaders, table);
+        bstrListDestroy(bheaders);
+        if (err != 0)
+        {
+            return err;
+        }
+    }
+    Table* t = *table;
+    struct bstrList* brow = bstrListCreate();
+    bstring bval = bformat("%zu", value);
+    bstrListAdd(brow, bval);
+    bdestroy(bval);
+    for (int k = 1; k < t->headers->qty; k++)
+    {
+        if (biseq(t->headers->entry[k], &bnumthreads))
+        {
+            size_t val = 0;
+            get_variable(runcfg->global_results, t->headers->entry[k], &val);
+            bval = bformat("%zu", val);
+        }
+        else
+        {
+            double val = 0.0;
+            get_value(runcfg->global_results, t->headers->entry[k], &val);
+            bval = bformat("%.15lf", val);
+        }
+        bstrListAdd(brow, bval);
+        bdestroy(bval);
+    }
+    err = table_addrow(t, brow);
+    bstrListDestroy(brow);
+    return err;
+}
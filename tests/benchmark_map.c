@@ -4,6 +4,12 @@
 #include <time.h>
 
 #include <map.h>
+#include <bstrlib.h>
+#include <symbols.h>
+#include <results.h>
+#include <error.h>
+
+int global_verbosity = DEBUGLEV_ONLY_ERROR;
 
 
 
@@ -309,6 +315,98 @@ int run_umap(int count)
     return 0;
 }
 
+/* Result names are interned once, afterwards values are set and read by symbol ID */
+int run_symbols(int count)
+{
+    bstring* names = malloc(count * sizeof(bstring));
+    uint32_t* hashes = malloc(count * sizeof(uint32_t));
+    int* ids = malloc(count * sizeof(int));
+    if ((!names) || (!hashes) || (!ids))
+    {
+        free(names);
+        free(hashes);
+        free(ids);
+        return -1;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        names[i] = bformat("%0d", i);
+        hashes[i] = symbol_hash(names[i]);
+    }
+
+    printf("#count intern find setbyid getbyid setbmap getbmap\n");
+    for (int i = 100; i <= count; i += 100) {
+        struct timespec s, e;
+        RuntimeWorkgroupResult result;
+        Map_t bmap;
+        double d = 0;
+        printf("%d ", i);
+        symbol_reset();
+        clock_gettime(CLOCK_MONOTONIC, &s);
+        for (int j = 0; j < i; j++)
+        {
+            ids[j] = symbol_intern(names[j], hashes[j]);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &e);
+        printf("%f ", (e.tv_sec - s.tv_sec)+((e.tv_nsec - s.tv_nsec)*1E-9));
+        clock_gettime(CLOCK_MONOTONIC, &s);
+        for (int j = 0; j < i; j++)
+        {
+            if (symbol_find(names[j], hashes[j]) != ids[j])
+                printf("Ba!\n");
+        }
+        clock_gettime(CLOCK_MONOTONIC, &e);
+        printf("%f ", (e.tv_sec - s.tv_sec)+((e.tv_nsec - s.tv_nsec)*1E-9));
+
+        init_result(&result);
+        clock_gettime(CLOCK_MONOTONIC, &s);
+        for (int j = 0; j < i; j++)
+        {
+            set_value_by_id(&result, ids[j], (double)j);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &e);
+        printf("%f ", (e.tv_sec - s.tv_sec)+((e.tv_nsec - s.tv_nsec)*1E-9));
+        clock_gettime(CLOCK_MONOTONIC, &s);
+        for (int j = 0; j < i; j++)
+        {
+            if (get_value_by_id(&result, ids[j], &d) != 0 || d != (double)j)
+                printf("Ba!\n");
+        }
+        clock_gettime(CLOCK_MONOTONIC, &e);
+        printf("%f ", (e.tv_sec - s.tv_sec)+((e.tv_nsec - s.tv_nsec)*1E-9));
+        destroy_result(&result);
+
+        /* The same values as text in a bmap like the results were stored before */
+        init_bmap(&bmap, (void (*)(mpointer))bdestroy);
+        clock_gettime(CLOCK_MONOTONIC, &s);
+        for (int j = 0; j < i; j++)
+        {
+            add_bmap(bmap, names[j], bformat("%.15lf", (double)j));
+        }
+        clock_gettime(CLOCK_MONOTONIC, &e);
+        printf("%f ", (e.tv_sec - s.tv_sec)+((e.tv_nsec - s.tv_nsec)*1E-9));
+        clock_gettime(CLOCK_MONOTONIC, &s);
+        for (int j = 0; j < i; j++)
+        {
+            bstring v = NULL;
+            get_bmap_by_key(bmap, names[j], (void**)&v);
+            if ((!v) || strtod(bdata(v), NULL) != (double)j)
+                printf("Ba!\n");
+        }
+        clock_gettime(CLOCK_MONOTONIC, &e);
+        printf("%f ", (e.tv_sec - s.tv_sec)+((e.tv_nsec - s.tv_nsec)*1E-9));
+        destroy_bmap(bmap);
+        printf("\n");
+    }
+    symbol_reset();
+
+    for (int i = 0; i < count; i++) bdestroy(names[i]);
+    free(names);
+    free(hashes);
+    free(ids);
+    return 0;
+}
+
 int main(int argc, char* argv[])
 {
     printf("Running benchmark for string map (smap)\n");
@@ -320,6 +418,9 @@ int main(int argc, char* argv[])
     printf("Running benchmark for uint64_t map (umap)\n");
     run_umap(20000);
     printf("\n");
+    printf("Running benchmark for interned names and result slots (symbols)\n");
+    run_symbols(20000);
+    printf("\n");
     return 0;
 }
 
@@ -76,7 +76,6 @@ int test_stream_config(TestStreamConfig* tconfig)
                 print_array(tconfig->config.offsets, tconfig->config.dims);
                 printf("\nId: %d\n", tconfig->config.id);
                 printf("Array Datatype: %s\n", get_stream_typename(tconfig->config.type));
-                tconfig->config.init = init_function;
                 initialize_arrays(&tconfig->config);
                 print_arrays(&tconfig->config);
                 release_arrays(&tconfig->config);
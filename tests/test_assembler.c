@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include "error.h"
+#include "bstrlib.h"
+#include "bstrlib_helper.h"
+#include "assembler.h"
+
+int global_verbosity = DEBUGLEV_ONLY_ERROR;
+
+#define SEPARATOR "---------------------------------------\n"
+#define MAX_ENCODING_LENGTH 16
+
+typedef struct {
+    char* instruction;
+    int length;
+    unsigned char expected[MAX_ENCODING_LENGTH];
+    int expected_error;
+} TestCase;
+
+/* Expected bytes taken from the GNU assembler */
+static TestCase encoding_tests[] = {
+    {"push rbp", 1, {0x55}, 0},
+    {"push r12", 2, {0x41, 0x54}, 0},
+    {"pop r15", 2, {0x41, 0x5f}, 0},
+    {"mov rbp, rsp", 3, {0x48, 0x89, 0xe5}, 0},
+    {"mov rax, QWORD PTR [rbp-48]", 4, {0x48, 0x8b, 0x45, 0xd0}, 0},
+    {"mov QWORD PTR [rbp-56], rax", 4, {0x48, 0x89, 0x45, 0xc8}, 0},
+    {"mov rbx, QWORD PTR [rdi+8]", 4, {0x48, 0x8b, 0x5f, 0x08}, 0},
+    {"mov r12, QWORD PTR [rsp]", 4, {0x4c, 0x8b, 0x24, 0x24}, 0},
+    {"mov rax, 42", 7, {0x48, 0xc7, 0xc0, 0x2a, 0x00, 0x00, 0x00}, 0},
+    {"mov rax, 0x123456789", 10, {0x48, 0xb8, 0x89, 0x67, 0x45, 0x23, 0x01, 0x00, 0x00, 0x00}, 0},
+    {"xor rax, rax", 3, {0x48, 0x31, 0xc0}, 0},
+    {"add rax, 4", 4, {0x48, 0x83, 0xc0, 0x04}, 0},
+    {"add rbx, 256", 7, {0x48, 0x81, 0xc3, 0x00, 0x01, 0x00, 0x00}, 0},
+    {"cmp rax, rdi", 3, {0x48, 0x39, 0xf8}, 0},
+    {"sub rsp, 8", 4, {0x48, 0x83, 0xec, 0x08}, 0},
+    {"lea rsp, [rbp-40]", 4, {0x48, 0x8d, 0x65, 0xd8}, 0},
+    {"lea rax, [r13]", 4, {0x49, 0x8d, 0x45, 0x00}, 0},
+    {"movsd xmm0, [rbx + rax * 8 + 8]", 6, {0xf2, 0x0f, 0x10, 0x44, 0xc3, 0x08}, 0},
+    {"movapd [rcx + rax * 8], xmm9", 6, {0x66, 0x44, 0x0f, 0x29, 0x0c, 0xc1}, 0},
+    {"addpd xmm0, xmm1", 4, {0x66, 0x0f, 0x58, 0xc1}, 0},
+    {"movntdqa xmm2, [r8]", 6, {0x66, 0x41, 0x0f, 0x38, 0x2a, 0x10}, 0},
+    {"movq mm0, [rbx + rax * 8]", 4, {0x0f, 0x6f, 0x04, 0xc3}, 0},
+    {"movntq [rcx], mm1", 3, {0x0f, 0xe7, 0x09}, 0},
+    {"vmovapd ymm0, [rbx + rax * 8 + 32]", 6, {0xc5, 0xfd, 0x28, 0x44, 0xc3, 0x20}, 0},
+    {"vmovapd [r9 + rax * 8], ymm12", 6, {0xc4, 0x41, 0x7d, 0x29, 0x24, 0xc1}, 0},
+    {"vaddpd ymm1, ymm2, ymm3", 4, {0xc5, 0xed, 0x58, 0xcb}, 0},
+    {"vfmadd213pd ymm0, ymm1, [rbx + rax * 8]", 6, {0xc4, 0xe2, 0xf5, 0xa8, 0x04, 0xc3}, 0},
+    {"vmulsd xmm4, xmm5, xmm13", 5, {0xc4, 0xc1, 0x53, 0x59, 0xe5}, 0},
+    {"ret", 1, {0xc3}, 0},
+    {"vmovapd zmm0, [rbx + rax * 8]", 0, {0x00}, -ENOTSUP},
+    {"vpdpbusd ymm0, ymm1, ymm2", 0, {0x00}, -ENOTSUP},
+    {"mov rax, [rbx + rsp * 2]", 0, {0x00}, -EINVAL},
+};
+
+static int run_encoding_tests(TestCase* tests, int num_tests)
+{
+    int pass_count = 0;
+    int fail_count = 0;
+    struct tagbstring bfunc = bsStatic("func");
+    printf(SEPARATOR);
+    printf("Running encoding tests\n");
+    for (int i = 0; i < num_tests; i++)
+    {
+        void* buffer = NULL;
+        size_t size = 0;
+        void* function = NULL;
+        struct bstrList* code = bstrListCreate();
+        bstrListAddChar(code, ".text");
+        bstrListAddChar(code, "func:");
+        bstrListAddChar(code, tests[i].instruction);
+        int err = assemble_code(code, &bfunc, &buffer, &size, &function);
+        if (err != tests[i].expected_error)
+        {
+            printf("Test %2d: FAIL (%s, expected error %d, actual %d)\n", i + 1, tests[i].instruction, tests[i].expected_error, err);
+            fail_count++;
+        }
+        else if (err == 0 && memcmp(function, tests[i].expected, tests[i].length) != 0)
+        {
+            printf("Test %2d: FAIL (%s, wrong encoding:", i + 1, tests[i].instruction);
+            for (int j = 0; j < tests[i].length; j++)
+            {
+                printf(" %02x", ((unsigned char*)function)[j]);
+            }
+            printf(")\n");
+            fail_count++;
+        }
+        else
+        {
+            printf("Test %2d: PASS (%s)\n", i + 1, tests[i].instruction);
+            pass_count++;
+        }
+        if (err == 0)
+        {
+            release_code(buffer, size);
+        }
+        bstrListDestroy(code);
+    }
+    printf("Total: \t%d Passed: \t%d Failed: \t%d\n", num_tests, pass_count, fail_count);
+    return fail_count;
+}
+
+static int run_execution_test()
+{
+    int fail_count = 0;
+    void* buffer = NULL;
+    size_t size = 0;
+    void* function = NULL;
+    double arr[8] = {1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0};
+    uint64_t args[2] = {(uint64_t)(uintptr_t)arr, 8};
+    struct tagbstring bfunc = bsStatic("sum");
+    struct bstrList* code = bstrListCreate();
+    printf(SEPARATOR);
+    printf("Running execution test\n");
+    /* Sums up an array scaled by a value from the data section, with a backward loop branch */
+    bstrListAddChar(code, ".intel_syntax noprefix");
+    bstrListAddChar(code, ".data\n.align 64\nSCALE:\n.double 2.0, 2.0");
+    bstrListAddChar(code, ".text");
+    bstrListAddChar(code, ".global sum");
+    bstrListAddChar(code, "sum :");
+    bstrListAddChar(code, "mov rcx, QWORD PTR [rdi]");
+    bstrListAddChar(code, "mov rdx, QWORD PTR [rdi+8]");
+    bstrListAddChar(code, "xorpd xmm0, xmm0");
+    bstrListAddChar(code, "xor rax, rax");
+    bstrListAddChar(code, ".align 16");
+    bstrListAddChar(code, "loop:");
+    bstrListAddChar(code, "addsd xmm0, [rcx + rax * 8] # inline comment");
+    bstrListAddChar(code, "add rax, 1");
+    bstrListAddChar(code, "cmp rax, rdx");
+    bstrListAddChar(code, "jl loop");
+    bstrListAddChar(code, "mulsd xmm0, [rip + SCALE]");
+    bstrListAddChar(code, "ret");
+    bstrListAddChar(code, ".size sum, .-sum");
+    int err = assemble_code(code, &bfunc, &buffer, &size, &function);
+    if (err == 0)
+    {
+        double (*sum)(uint64_t*) = (double (*)(uint64_t*))function;
+        double result = sum(args);
+        if (result == 72.0)
+        {
+            printf("Test  1: PASS (result %f)\n", result);
+        }
+        else
+        {
+            printf("Test  1: FAIL (expected 72.0, actual %f)\n", result);
+            fail_count++;
+        }
+        release_code(buffer, size);
+    }
+    else
+    {
+        printf("Test  1: FAIL (assembly failed with %d)\n", err);
+        fail_count++;
+    }
+    bstrListDestroy(code);
+    return fail_count;
+}
+
+int main()
+{
+    int fail_count = 0;
+#if defined(__x86_64) || defined(__x86_64__)
+    fail_count += run_encoding_tests(encoding_tests, sizeof(encoding_tests)/sizeof(TestCase));
+    fail_count += run_execution_test();
+#endif
+    return (fail_count > 0 ? 1 : 0);
+}
@@ -0,0 +1,180 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "error.h"
+#include "bstrlib.h"
+#include "bstrlib_helper.h"
+#include "autotune.h"
+#include "read_yaml_ptt.h"
+#include "test_types.h"
+
+int global_verbosity = DEBUGLEV_ONLY_ERROR;
+
+#define SEPARATOR "---------------------------------------\n"
+
+static struct tagbstring cpuinfo_a = bsStatic("processor\t: 0\nvendor_id\t: GenuineIntel\nmodel name\t: Test CPU A\ncpu MHz\t\t: 2100.000\n\nprocessor\t: 1\nmodel name\t: Test CPU A\n");
+static struct tagbstring cpuinfo_a_freq = bsStatic("processor\t: 0\nvendor_id\t: GenuineIntel\nmodel name\t: Test CPU A\ncpu MHz\t\t: 3400.000\n");
+static struct tagbstring cpuinfo_b = bsStatic("processor\t: 0\nvendor_id\t: GenuineIntel\nmodel name\t: Test CPU B\ncpu MHz\t\t: 2100.000\n");
+static struct tagbstring cpuinfo_none = bsStatic("processor\t: 0\ncpu MHz\t\t: 2100.000\n");
+
+static int run_yaml_tests()
+{
+    TestConfig_t cfg = NULL;
+    printf(SEPARATOR);
+    printf("Running tunable parser tests\n");
+    int failed = (read_yaml_ptt("../kernels/x86_64/triad_avx_tune.yaml", &cfg) != 0);
+    if (!failed)
+    {
+        failed += (cfg->num_tunables != 2);
+        failed += (cfg->num_tunables == 2 && (strcmp(bdata(cfg->tunables[0].name), "STORE_INST") != 0 || cfg->tunables[0].options->qty != 2));
+        failed += (cfg->num_tunables == 2 && (strcmp(bdata(cfg->tunables[1].name), "PF_DIST") != 0 || cfg->tunables[1].options->qty != 4));
+        failed += (cfg->num_tunables == 2 && strcmp(bdata(cfg->tunables[0].options->entry[1]), "vmovntpd") != 0);
+        failed += (autotune_num_variants(cfg) != 8);
+        close_yaml_ptt(cfg);
+    }
+    printf("Tunables of triad_avx_tune: %s\n", failed ? "FAIL" : "PASS");
+    return (failed > 0);
+}
+
+static void _add_tunable(TestConfigTunable* t, const char* name, const char* options)
+{
+    struct tagbstring boptions;
+    btfromcstr(boptions, options);
+    t->name = bfromcstr(name);
+    t->description = NULL;
+    t->options = bsplit(&boptions, ',');
+    t->selected = 0;
+}
+
+static int run_variant_tests(TestConfig_t cfg)
+{
+    int fail_count = 0;
+    printf(SEPARATOR);
+    printf("Running variant tests\n");
+
+    int failed = (autotune_num_variants(cfg) != 6);
+    bstring name = autotune_variant_name(cfg);
+    failed += (!name || strcmp(bdata(name), "STORE=vmovapd,DIST=0") != 0);
+    bdestroy(name);
+    printf("Default variant: %s\n", failed ? "FAIL" : "PASS");
+    fail_count += (failed > 0);
+
+    /* The first tunable changes fastest */
+    failed = (autotune_select(cfg, 3) != 0);
+    name = autotune_variant_name(cfg);
+    failed += (!name || strcmp(bdata(name), "STORE=vmovntpd,DIST=256") != 0);
+    bdestroy(name);
+    failed += (autotune_select(cfg, 6) != -EINVAL);
+    failed += (autotune_select(cfg, -1) != -EINVAL);
+    printf("Select variants: %s\n", failed ? "FAIL" : "PASS");
+    fail_count += (failed > 0);
+
+    struct tagbstring bvariant = bsStatic("DIST=512, STORE=vmovapd");
+    struct tagbstring bunknown = bsStatic("STORE=vmovupd,DIST=512");
+    struct tagbstring bpartial = bsStatic("STORE=vmovntpd");
+    failed = (autotune_apply(cfg, &bvariant) != 0);
+    failed += (cfg->tunables[0].selected != 0 || cfg->tunables[1].selected != 2);
+    failed += (autotune_apply(cfg, &bunknown) != -EINVAL);
+    failed += (autotune_apply(cfg, &bpartial) != -EINVAL);
+    /* Invalid variants keep the selection */
+    failed += (cfg->tunables[0].selected != 0 || cfg->tunables[1].selected != 2);
+    printf("Apply variants: %s\n", failed ? "FAIL" : "PASS");
+    fail_count += (failed > 0);
+    return fail_count;
+}
+
+static int run_fingerprint_tests()
+{
+    uint64_t a = 0, a_freq = 0, a_threads = 0, b = 0, none = 0;
+    printf(SEPARATOR);
+    printf("Running fingerprint tests\n");
+    int failed = (autotune_fingerprint(&cpuinfo_a, 2, &a) != 0);
+    failed += (autotune_fingerprint(&cpuinfo_a_freq, 2, &a_freq) != 0);
+    failed += (autotune_fingerprint(&cpuinfo_a, 4, &a_threads) != 0);
+    failed += (autotune_fingerprint(&cpuinfo_b, 2, &b) != 0);
+    failed += (a != a_freq || a == a_threads || a == b);
+    failed += (autotune_fingerprint(&cpuinfo_none, 2, &none) != -ENOENT);
+    failed += (autotune_fingerprint(&cpuinfo_a, 0, &a) != -EINVAL);
+    printf("Machine fingerprints: %s\n", failed ? "FAIL" : "PASS");
+    return (failed > 0);
+}
+
+static int run_store_tests(TestConfig_t cfg)
+{
+    char file[] = "/tmp/test_autotune_XXXXXX";
+    printf(SEPARATOR);
+    printf("Running store tests\n");
+    int fd = mkstemp(file);
+    if (fd < 0)
+    {
+        printf("Store and load: FAIL\n");
+        return 1;
+    }
+    close(fd);
+    unlink(file);
+
+    int failed = (autotune_load(file, 1, cfg) != -ENOENT);
+    failed += (autotune_select(cfg, 5) != 0);
+    failed += (autotune_store(file, 1, cfg, 100.0) != 0);
+    failed += (autotune_select(cfg, 2) != 0);
+    failed += (autotune_store(file, 2, cfg, 200.0) != 0);
+    /* Storing again replaces the line of the machine */
+    failed += (autotune_select(cfg, 4) != 0);
+    failed += (autotune_store(file, 1, cfg, 50.0) != 0);
+    failed += (autotune_select(cfg, 0) != 0);
+    failed += (autotune_load(file, 1, cfg) != 0);
+    failed += (cfg->tunables[0].selected != 0 || cfg->tunables[1].selected != 2);
+    failed += (autotune_load(file, 2, cfg) != 0);
+    failed += (cfg->tunables[0].selected != 0 || cfg->tunables[1].selected != 1);
+    failed += (autotune_load(file, 3, cfg) != -ENOENT);
+    bstring content = read_file(file);
+    struct bstrList* lines = bsplit(content, '\n');
+    failed += (lines->qty != 3 || blength(lines->entry[2]) != 0);
+    bstrListDestroy(lines);
+    bdestroy(content);
+
+    /* A file that others can write is not trusted */
+    failed += (chmod(file, 0666) != 0);
+    failed += (autotune_load(file, 1, cfg) != -EPERM);
+    failed += (chmod(file, 0600) != 0);
+
+    /* A stored variant with an option the kernel does not have anymore is ignored */
+    bstrListDestroy(cfg->tunables[1].options);
+    struct tagbstring boptions = bsStatic("0,1024");
+    cfg->tunables[1].options = bsplit(&boptions, ',');
+    failed += (autotune_load(file, 1, cfg) != -ENOENT);
+    unlink(file);
+    printf("Store and load: %s\n", failed ? "FAIL" : "PASS");
+    return (failed > 0);
+}
+
+int main()
+{
+    int fail_count = 0;
+    TestConfig cfg;
+    TestConfigTunable tunables[2];
+    memset(&cfg, 0, sizeof(TestConfig));
+    cfg.name = bfromcstr("test_kernel");
+    _add_tunable(&tunables[0], "STORE", "vmovapd,vmovntpd");
+    _add_tunable(&tunables[1], "DIST", "0,256,512");
+    cfg.tunables = tunables;
+    cfg.num_tunables = 2;
+
+    fail_count += run_yaml_tests();
+    fail_count += run_variant_tests(&cfg);
+    fail_count += run_fingerprint_tests();
+    fail_count += run_store_tests(&cfg);
+
+    for (int i = 0; i < 2; i++)
+    {
+        bdestroy(tunables[i].name);
+        bstrListDestroy(tunables[i].options);
+    }
+    bdestroy(cfg.name);
+    return (fail_count > 0 ? 1 : 0);
+}
@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "error.h"
+#include "barrier.h"
+#include "topology.h"
+
+int global_verbosity = DEBUGLEV_ONLY_ERROR;
+
+#define SEPARATOR "---------------------------------------\n"
+#define TEST_EPISODES 200
+
+typedef struct {
+    char* str;
+    int expected_error;
+    BarrierType type;
+} TestParseBarrier;
+
+static TestParseBarrier parse_tests[] = {
+    {"pthread", 0, BARRIER_PTHREAD},
+    {"central", 0, BARRIER_CENTRAL},
+    {"Tree", 0, BARRIER_TREE},
+    {"dissemination", 0, BARRIER_DISSEMINATION},
+    {"butterfly", -EINVAL, BARRIER_PTHREAD},
+    {"", -EINVAL, BARRIER_PTHREAD},
+};
+
+typedef struct {
+    thread_barrier_t* barrier;
+    int id;
+    int num_threads;
+    int* arrived;
+    int* failures;
+} TestThread;
+
+static int run_parse_tests(TestParseBarrier* tests, int num_tests)
+{
+    int fail_count = 0;
+    printf(SEPARATOR);
+    printf("Running barrier parser tests\n");
+    for (int i = 0; i < num_tests; i++)
+    {
+        BarrierType type = BARRIER_PTHREAD;
+        int err = barrier_parse_type(tests[i].str, &type);
+        int failed = (err != tests[i].expected_error || (err == 0 && type != tests[i].type));
+        if (failed)
+        {
+            printf("\t'%s': expected %d (%s), actual %d (%s)\n", tests[i].str, tests[i].expected_error,
+                   barrier_type_name(tests[i].type), err, barrier_type_name(type));
+        }
+        printf("Test %2d: %s\n", i + 1, failed ? "FAIL" : "PASS");
+        fail_count += failed;
+    }
+    return fail_count;
+}
+
+/*
+ * Every thread counts its arrival and checks after the barrier that all threads of the
+ * episode arrived. The second barrier keeps the next episode from starting too early.
+ */
+static void* test_thread(void* arg)
+{
+    TestThread* t = (TestThread*)arg;
+    for (int e = 0; e < TEST_EPISODES; e++)
+    {
+        __atomic_add_fetch(t->arrived, 1, __ATOMIC_RELAXED);
+        barrier_wait(t->barrier, t->id);
+        if (__atomic_load_n(t->arrived, __ATOMIC_RELAXED) != (e + 1) * t->num_threads)
+        {
+            __atomic_add_fetch(t->failures, 1, __ATOMIC_RELAXED);
+        }
+        barrier_wait(t->barrier, t->id);
+    }
+    return NULL;
+}
+
+static int run_barrier(BarrierType type, int num_threads, const int* hwthreads)
+{
+    thread_barrier_t barrier;
+    int arrived = 0;
+    int failures = 0;
+    pthread_t threads[8];
+    TestThread args[8];
+    if (barrier_init(&barrier, type, num_threads, hwthreads) != 0)
+    {
+        return 1;
+    }
+    for (int i = 0; i < num_threads; i++)
+    {
+        args[i].barrier = &barrier;
+        args[i].id = i;
+        args[i].num_threads = num_threads;
+        args[i].arrived = &arrived;
+        args[i].failures = &failures;
+        pthread_create(&threads[i], NULL, test_thread, &args[i]);
+    }
+    for (int i = 0; i < num_threads; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    barrier_destroy(&barrier);
+    return (failures > 0 || arrived != TEST_EPISODES * num_threads);
+}
+
+static int run_barrier_tests()
+{
+    int fail_count = 0;
+    int thread_counts[] = {1, 2, 5, 8};
+    /* All threads on the same hwthread form a core node below the root */
+    int same_core[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    check_hwthreads();
+    printf(SEPARATOR);
+    printf("Running barrier tests\n");
+    for (int t = BARRIER_PTHREAD; t < MAX_BARRIER; t++)
+    {
+        for (int c = 0; c < (int)(sizeof(thread_counts)/sizeof(thread_counts[0])); c++)
+        {
+            int failed = run_barrier((BarrierType)t, thread_counts[c], NULL);
+            if (t == BARRIER_TREE)
+            {
+                failed += run_barrier((BarrierType)t, thread_counts[c], same_core);
+            }
+            printf("Barrier %s with %d threads: %s\n", barrier_type_name((BarrierType)t), thread_counts[c], failed ? "FAIL" : "PASS");
+            fail_count += (failed > 0);
+        }
+    }
+    thread_barrier_t barrier;
+    int failed = (barrier_init(&barrier, BARRIER_CENTRAL, 0, NULL) != -EINVAL);
+    failed += (barrier_init(&barrier, MAX_BARRIER, 2, NULL) != -EINVAL);
+    printf("Invalid barriers: %s\n", failed ? "FAIL" : "PASS");
+    fail_count += (failed > 0);
+    destroy_hwthreads();
+    return fail_count;
+}
+
+int main()
+{
+    int fail_count = 0;
+    fail_count += run_parse_tests(parse_tests, sizeof(parse_tests)/sizeof(TestParseBarrier));
+    fail_count += run_barrier_tests();
+    return (fail_count > 0 ? 1 : 0);
+}
@@ -75,18 +75,41 @@ int main(int argc, char* argv) {
     tconfig->sdata[0].offsets[0] = 0;
     tconfig->sdata[0].type = TEST_STREAM_TYPE_INT;
     tconfig->num_streams = 1;
+    tconfig->num_args = 0;
+    tconfig->args = NULL;
+    tconfig->timer = TIMER_RDTSC;
     tconfig->command->cmdfunc.run = (BenchFuncPrototype)myfunc;
     tconfig->command->cmd = LIKWID_THREAD_COMMAND_RUN;
 
     data->hwthread = 0;
     data->iters = 1000;
     data->min_runtime = 10;
+    data->max_samples = 5;
+    data->samples = malloc(data->max_samples * sizeof(uint64_t));
     tconfig->data = data;
 
     tconfig->barrier = NULL;
+    tconfig->sync = NULL;
     printf("running benchmark\n");
     run_benchmark(tconfig);
     printf("benchmark finished in %f seconds\n", tconfig->runtime);
+    if (data->num_samples != data->max_samples)
+    {
+        printf("benchmark ran %d instead of %d repetitions\n", data->num_samples, data->max_samples);
+        return 1;
+    }
+
+    printf("running benchmark with calibration of the iterations\n");
+    data->iters = 0;
+    tconfig->runtime = 0.2;
+    run_benchmark(tconfig);
+    printf("benchmark calibrated to %" PRIu64 " iterations and finished in %f seconds\n", data->iters, tconfig->runtime);
+    if (tconfig->runtime < 0.1 || tconfig->runtime > 0.4)
+    {
+        printf("calibrated runtime is not close to the target of 0.2 seconds\n");
+        return 1;
+    }
+    free(data->samples);
     free(tconfig->sdata[0].ptr);
     free(tconfig->sdata);
     free(tconfig->command);
@@ -0,0 +1,84 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "cachedir.h"
+
+static int all = 0;
+static int success = 0;
+
+static void _check(int ok, const char* what)
+{
+    all++;
+    if (ok)
+    {
+        success++;
+    }
+    else
+    {
+        printf("Failed: %s\n", what);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    char base[] = "/tmp/test_cachedir_XXXXXX";
+    char folder[256];
+    char file[256];
+    char link[256];
+    char user[1024];
+    struct stat st;
+
+    if (!mkdtemp(base))
+    {
+        printf("Cannot create temporary folder\n");
+        return 1;
+    }
+    snprintf(folder, sizeof(folder), "%s/a/b/", base);
+    snprintf(file, sizeof(file), "%s/a/b/object.o", base);
+    snprintf(link, sizeof(link), "%s/link", base);
+
+    _check(cachedir_check(folder) == -ENOENT, "missing folder");
+    _check(cachedir_create(folder) == 0, "create folder");
+    _check(stat(folder, &st) == 0 && (st.st_mode & 0777) == 0700, "folder mode 0700");
+    _check(cachedir_create(folder) == 0, "create existing folder");
+
+    FILE* fp = fopen(file, "w");
+    if (fp) fclose(fp);
+    chmod(file, 0644);
+    _check(cachedir_check(file) == 0, "file of the user");
+    chmod(file, 0664);
+    _check(cachedir_check(file) == -EPERM, "file writable by group");
+    chmod(file, 0646);
+    _check(cachedir_check(file) == -EPERM, "file writable by others");
+
+    chmod(folder, 0777);
+    _check(cachedir_create(folder) == -EPERM, "existing folder writable by others");
+    chmod(folder, 0700);
+
+    _check(symlink(folder, link) == 0, "create symlink");
+    _check(cachedir_check(link) == -EPERM, "symlink");
+    strcat(link, "/");
+    _check(cachedir_check(link) == -EPERM, "symlink with trailing slash");
+
+    setenv("XDG_CACHE_HOME", "/xdg", 1);
+    _check(cachedir_user_folder(user, sizeof(user)) == 0 && strcmp(user, "/xdg/" CACHEDIR_NAME) == 0, "folder below XDG_CACHE_HOME");
+    setenv("XDG_CACHE_HOME", "relative", 1);
+    setenv("HOME", "/home/user", 1);
+    _check(cachedir_user_folder(user, sizeof(user)) == 0 && strcmp(user, "/home/user/.cache/" CACHEDIR_NAME) == 0, "folder below HOME");
+    _check(cachedir_user_folder(user, 8) == -ENAMETOOLONG, "too small buffer");
+
+    char cmd[512];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", base);
+    if (system(cmd) != 0)
+    {
+        printf("Cannot remove %s\n", base);
+    }
+
+    printf("All\tSuccess\tFail\n");
+    printf("%d\t%d\t%d\n", all, success, all - success);
+    return (all != success);
+}
@@ -0,0 +1,369 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include "error.h"
+#include "bstrlib.h"
+#include "fill.h"
+
+int global_verbosity = DEBUGLEV_ONLY_ERROR;
+
+#define SEPARATOR "---------------------------------------\n"
+/* Not a multiple of the vector width, so every fill has a scalar tail */
+#define TEST_ELEMS 1003
+
+typedef struct {
+    char* str;
+    int expected_error;
+    StreamFillMode mode;
+    double start;
+    double step;
+    uint64_t seed;
+    int num_pattern;
+    StreamChaseOrder order;
+} TestParseFill;
+
+static TestParseFill parse_tests[] = {
+    {"linear", 0, STREAM_FILL_LINEAR, 0.0, 1.0, 0, 0},
+    {" Linear:2.5 ", 0, STREAM_FILL_LINEAR, 2.5, 1.0, 0, 0},
+    {"linear:1:-0.5", 0, STREAM_FILL_LINEAR, 1.0, -0.5, 0, 0},
+    {"linear:1:2:3", -ENOENT, STREAM_FILL_CONSTANT, 0.0, 0.0, 0, 0},
+    {"linear:x", -EINVAL, STREAM_FILL_CONSTANT, 0.0, 0.0, 0, 0},
+    {"random", 0, STREAM_FILL_RANDOM, 0.0, 0.0, 0, 0},
+    {"random:42", 0, STREAM_FILL_RANDOM, 0.0, 0.0, 42, 0},
+    {"random:abc", -EINVAL, STREAM_FILL_CONSTANT, 0.0, 0.0, 0, 0},
+    {"pattern:1:2:3", 0, STREAM_FILL_PATTERN, 0.0, 0.0, 0, 3},
+    {"pattern", -ENOENT, STREAM_FILL_CONSTANT, 0.0, 0.0, 0, 0},
+    {"pattern:1:b", -EINVAL, STREAM_FILL_CONSTANT, 0.0, 0.0, 0, 0},
+    {"1.5", -ENOENT, STREAM_FILL_CONSTANT, 0.0, 0.0, 0, 0},
+    {"rand", -ENOENT, STREAM_FILL_CONSTANT, 0.0, 0.0, 0, 0},
+    {"chase", 0, STREAM_FILL_CHASE, 0.0, 0.0, 0, 0, CHASE_ORDER_RANDOM},
+    {"Chase:TLB:7", 0, STREAM_FILL_CHASE, 0.0, 0.0, 7, 0, CHASE_ORDER_TLB},
+    {"chase:page", 0, STREAM_FILL_CHASE, 0.0, 0.0, 0, 0, CHASE_ORDER_PAGE},
+    {"chase:zigzag", -EINVAL, STREAM_FILL_CONSTANT, 0.0, 0.0, 0, 0},
+    {"chase:tlb:x", -EINVAL, STREAM_FILL_CONSTANT, 0.0, 0.0, 0, 0},
+};
+
+static int run_parse_tests(TestParseFill* tests, int num_tests)
+{
+    int fail_count = 0;
+    printf(SEPARATOR);
+    printf("Running fill parser tests\n");
+    for (int i = 0; i < num_tests; i++)
+    {
+        StreamFill fill;
+        memset(&fill, 0, sizeof(StreamFill));
+        bstring bstr = bfromcstr(tests[i].str);
+        int err = parse_fill(bstr, &fill);
+        int failed = (err != tests[i].expected_error);
+        if (!failed)
+        {
+            failed = (fill.mode != tests[i].mode || fill.start != tests[i].start || fill.step != tests[i].step ||
+                      fill.seed != tests[i].seed || fill.num_pattern != tests[i].num_pattern ||
+                      (fill.mode == STREAM_FILL_CHASE && fill.order != tests[i].order));
+        }
+        if (failed)
+        {
+            printf("\t'%s': expected %d (%s), actual %d (%s)\n", tests[i].str, tests[i].expected_error,
+                   fill_name(tests[i].mode), err, fill_name(fill.mode));
+        }
+        printf("Test %2d: %s\n", i + 1, failed ? "FAIL" : "PASS");
+        fail_count += failed;
+        bdestroy(bstr);
+    }
+    return fail_count;
+}
+
+static double reference_value(size_t idx, const StreamFill* fill, double constant)
+{
+    switch (fill->mode)
+    {
+        case STREAM_FILL_LINEAR:
+            return fill->start + (double)idx * fill->step;
+        case STREAM_FILL_PATTERN:
+            return fill->pattern[idx % fill->num_pattern];
+        default:
+            return constant;
+    }
+}
+
+/*
+ * Fills the array at an unaligned position in one call and in three pieces with odd
+ * boundaries. Both must agree element by element, which covers the scalar head and tail
+ * of the vector loops and the independence from the split between threads.
+ */
+static int check_split(TestConfigStreamType type, size_t elemsize, const StreamFill* fill, void** result)
+{
+    char* whole = malloc((TEST_ELEMS + 1) * elemsize);
+    char* parts = malloc((TEST_ELEMS + 1) * elemsize);
+    size_t bounds[4] = {0, 13, 500, TEST_ELEMS};
+    int failed = (!whole) || (!parts);
+    if (!failed)
+    {
+        failed = (fill_stream(whole + elemsize, type, 0, TEST_ELEMS, fill) != 0);
+        for (int p = 0; p < 3 && !failed; p++)
+        {
+            failed = (fill_stream(parts + (bounds[p] + 1) * elemsize, type, bounds[p], bounds[p + 1] - bounds[p], fill) != 0);
+        }
+        failed = failed || (memcmp(whole + elemsize, parts + elemsize, TEST_ELEMS * elemsize) != 0);
+    }
+    free(parts);
+    *result = whole;
+    return failed;
+}
+
+static int run_fill_tests()
+{
+    int fail_count = 0;
+    StreamFill fills[4];
+    memset(fills, 0, sizeof(fills));
+    fills[0].mode = STREAM_FILL_CONSTANT;
+    fills[1].mode = STREAM_FILL_LINEAR;
+    fills[1].start = 3.0;
+    fills[1].step = 2.0;
+    fills[2].mode = STREAM_FILL_PATTERN;
+    fills[2].num_pattern = 4;
+    fills[2].pattern[0] = 1.0;
+    fills[2].pattern[1] = 2.0;
+    fills[2].pattern[2] = 4.0;
+    fills[2].pattern[3] = 8.0;
+    fills[3].mode = STREAM_FILL_PATTERN;
+    fills[3].num_pattern = 3;
+    fills[3].pattern[0] = 5.0;
+    fills[3].pattern[1] = 6.0;
+    fills[3].pattern[2] = 7.0;
+    printf(SEPARATOR);
+    printf("Running fill tests\n");
+    for (int f = 0; f < 4; f++)
+    {
+        void* ptr = NULL;
+        int failed = 0;
+
+        fills[f].value.dval = 1.5;
+        failed += check_split(TEST_STREAM_TYPE_DOUBLE, sizeof(double), &fills[f], &ptr);
+        for (size_t i = 0; i < TEST_ELEMS && ptr && !failed; i++)
+        {
+            failed = (((double*)ptr + 1)[i] != reference_value(i, &fills[f], 1.5));
+        }
+        free(ptr);
+
+        fills[f].value.fval = 1.5f;
+        failed += check_split(TEST_STREAM_TYPE_SINGLE, sizeof(float), &fills[f], &ptr);
+        for (size_t i = 0; i < TEST_ELEMS && ptr && !failed; i++)
+        {
+            failed = (((float*)ptr + 1)[i] != (float)reference_value(i, &fills[f], 1.5));
+        }
+        free(ptr);
+
+        fills[f].value.ival = 7;
+        failed += check_split(TEST_STREAM_TYPE_INT, sizeof(int), &fills[f], &ptr);
+        for (size_t i = 0; i < TEST_ELEMS && ptr && !failed; i++)
+        {
+            double ref = reference_value(i, &fills[f], 7);
+            failed = (((int*)ptr + 1)[i] != (int)ref);
+        }
+        free(ptr);
+
+        fills[f].value.i64val = 7;
+        failed += check_split(TEST_STREAM_TYPE_INT64, sizeof(int64_t), &fills[f], &ptr);
+        for (size_t i = 0; i < TEST_ELEMS && ptr && !failed; i++)
+        {
+            double ref = reference_value(i, &fills[f], 7);
+            failed = (((int64_t*)ptr + 1)[i] != (int64_t)ref);
+        }
+        free(ptr);
+
+        printf("Fill %s (%d): %s\n", fill_name(fills[f].mode), f, failed ? "FAIL" : "PASS");
+        fail_count += (failed > 0);
+    }
+    return fail_count;
+}
+
+static int run_random_tests()
+{
+    int fail_count = 0;
+    StreamFill fill;
+    void* ptr = NULL;
+    void* other = NULL;
+    memset(&fill, 0, sizeof(StreamFill));
+    fill.mode = STREAM_FILL_RANDOM;
+    fill.seed = 42;
+    printf(SEPARATOR);
+    printf("Running random fill tests\n");
+
+    int failed = check_split(TEST_STREAM_TYPE_DOUBLE, sizeof(double), &fill, &ptr);
+    double sum = 0.0;
+    for (size_t i = 0; i < TEST_ELEMS && ptr; i++)
+    {
+        double v = ((double*)ptr + 1)[i];
+        failed += (v < 0.0 || v >= 1.0);
+        sum += v;
+    }
+    /* The mean of TEST_ELEMS uniform values is far from the bounds */
+    failed += (sum / TEST_ELEMS < 0.4 || sum / TEST_ELEMS > 0.6);
+    fill.seed = 43;
+    failed += check_split(TEST_STREAM_TYPE_DOUBLE, sizeof(double), &fill, &other);
+    if (ptr && other)
+    {
+        failed += (memcmp(ptr, other, (TEST_ELEMS + 1) * sizeof(double)) == 0);
+    }
+    free(ptr);
+    free(other);
+    printf("Random double: %s\n", failed ? "FAIL" : "PASS");
+    fail_count += (failed > 0);
+
+    failed = check_split(TEST_STREAM_TYPE_SINGLE, sizeof(float), &fill, &ptr);
+    for (size_t i = 0; i < TEST_ELEMS && ptr; i++)
+    {
+        float v = ((float*)ptr + 1)[i];
+        failed += (v < 0.0f || v >= 1.0f);
+    }
+    free(ptr);
+    failed += check_split(TEST_STREAM_TYPE_INT, sizeof(int), &fill, &ptr);
+    for (size_t i = 0; i < TEST_ELEMS && ptr; i++)
+    {
+        failed += (((int*)ptr + 1)[i] < 0);
+    }
+    free(ptr);
+    failed += check_split(TEST_STREAM_TYPE_INT64, sizeof(int64_t), &fill, &ptr);
+    for (size_t i = 0; i < TEST_ELEMS && ptr; i++)
+    {
+        failed += (((int64_t*)ptr + 1)[i] < 0);
+    }
+    free(ptr);
+    printf("Random single, int and int64: %s\n", failed ? "FAIL" : "PASS");
+    fail_count += (failed > 0);
+
+    double d = 0.0;
+    fill.mode = STREAM_FILL_PATTERN;
+    fill.num_pattern = 0;
+    failed = (fill_stream(&d, TEST_STREAM_TYPE_DOUBLE, 0, 1, &fill) != -EINVAL);
+    failed += (fill_stream(NULL, TEST_STREAM_TYPE_DOUBLE, 0, 1, &fill) != -EINVAL);
+    printf("Invalid fills: %s\n", failed ? "FAIL" : "PASS");
+    fail_count += (failed > 0);
+    return fail_count;
+}
+
+/*
+ * Walks the cycle from node 0 and checks that it visits every node once. The step at which
+ * each node is reached is stored in steps, the number of steps that stay in the same page in
+ * same_page.
+ */
+static int check_cycle(const int64_t* ptr, size_t count, size_t n, size_t* steps, size_t* same_page)
+{
+    const size_t node_elems = CHASE_NODE_BYTES / sizeof(int64_t);
+    int failed = 0;
+    int64_t offset = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        steps[i] = n;
+    }
+    *same_page = 0;
+    for (size_t s = 0; s < n && !failed; s++)
+    {
+        size_t node = (size_t)offset / CHASE_NODE_BYTES;
+        failed += (offset < 0 || offset % CHASE_NODE_BYTES != 0 || node >= n || steps[node] != n);
+        if (!failed)
+        {
+            steps[node] = s;
+            int64_t next = ptr[node * node_elems];
+            *same_page += (next / CHASE_PAGE_BYTES == offset / CHASE_PAGE_BYTES);
+            offset = next;
+        }
+    }
+    failed += (offset != 0);
+    /* Only the first element of a node and none of the tail are set */
+    for (size_t e = 0; e < count; e++)
+    {
+        failed += (e % node_elems != 0 && ptr[e] != 0);
+        failed += (e >= n * node_elems && ptr[e] != 0);
+    }
+    return failed;
+}
+
+static int run_chase_tests()
+{
+    int fail_count = 0;
+    const size_t node_elems = CHASE_NODE_BYTES / sizeof(int64_t);
+    const size_t page_nodes = CHASE_PAGE_BYTES / CHASE_NODE_BYTES;
+    /* A partial last page, fewer nodes than chains, a single node */
+    size_t sizes[4] = {1000, 16, 3, 1};
+    printf(SEPARATOR);
+    printf("Running pointer-chase fill tests\n");
+    for (int o = CHASE_ORDER_RANDOM; o < MAX_CHASE_ORDER; o++)
+    {
+        int failed = 0;
+        for (int z = 0; z < 4; z++)
+        {
+            size_t n = sizes[z];
+            size_t count = n * node_elems + 3;
+            int64_t* ptr = malloc(count * sizeof(int64_t));
+            size_t* steps = malloc(n * sizeof(size_t));
+            size_t same_page = 0;
+            memset(ptr, 0xff, count * sizeof(int64_t));
+            failed += (fill_chase(ptr, count, (StreamChaseOrder)o, 42) != 0);
+            failed += check_cycle(ptr, count, n, steps, &same_page);
+            /* With K chains (a power of two), chain j starts n*j/K steps after chain 0 */
+            size_t m = 1;
+            while (m * 2 <= n && m * 2 <= CHASE_MAX_CHAINS)
+            {
+                m *= 2;
+            }
+            for (size_t k = 1; k <= m && !failed; k *= 2)
+            {
+                for (size_t j = 0; j < k; j++)
+                {
+                    size_t rev = 0;
+                    for (size_t b = 1, r = CHASE_MAX_CHAINS / 2; b < CHASE_MAX_CHAINS; b *= 2, r /= 2)
+                    {
+                        rev += (j & b) ? r : 0;
+                    }
+                    failed += (steps[j] != n * rev / CHASE_MAX_CHAINS);
+                }
+            }
+            /*
+             * Each move of a chain start changes the steps into and out of two places. A random
+             * cycle of 16 pages stays in the page for about 1/16 of the steps.
+             */
+            if (n == 1000 && o == CHASE_ORDER_PAGE)
+            {
+                failed += (same_page < n - (n / page_nodes + 1) - 4 * CHASE_MAX_CHAINS);
+            }
+            else if (n == 1000 && o == CHASE_ORDER_TLB)
+            {
+                failed += (same_page > 2 * CHASE_MAX_CHAINS);
+            }
+            free(ptr);
+            free(steps);
+        }
+        printf("Chase order %s: %s\n", chase_order_name((StreamChaseOrder)o), failed ? "FAIL" : "PASS");
+        fail_count += (failed > 0);
+    }
+
+    StreamFill fill;
+    memset(&fill, 0, sizeof(StreamFill));
+    fill.mode = STREAM_FILL_CHASE;
+    int64_t a[2 * CHASE_NODE_BYTES / sizeof(int64_t)];
+    int64_t b[2 * CHASE_NODE_BYTES / sizeof(int64_t)];
+    double d[2 * CHASE_NODE_BYTES / sizeof(double)];
+    int failed = (fill_stream(a, TEST_STREAM_TYPE_INT64, 0, 2 * node_elems, &fill) != 0);
+    failed += (fill_stream(b, TEST_STREAM_TYPE_INT64, 0, 2 * node_elems, &fill) != 0);
+    failed += (memcmp(a, b, sizeof(a)) != 0 || a[0] != CHASE_NODE_BYTES || a[node_elems] != 0);
+    failed += (fill_stream(d, TEST_STREAM_TYPE_DOUBLE, 0, 2 * node_elems, &fill) != -EINVAL);
+    failed += (fill_chase(a, 2 * node_elems, MAX_CHASE_ORDER, 0) != -EINVAL);
+    printf("Chase fill of streams: %s\n", failed ? "FAIL" : "PASS");
+    fail_count += (failed > 0);
+    return fail_count;
+}
+
+int main()
+{
+    int fail_count = 0;
+    fail_count += run_parse_tests(parse_tests, sizeof(parse_tests)/sizeof(TestParseFill));
+    fail_count += run_fill_tests();
+    fail_count += run_random_tests();
+    fail_count += run_chase_tests();
+    return (fail_count > 0 ? 1 : 0);
+}
@@ -0,0 +1,145 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <math.h>
+
+#include "error.h"
+#include "bstrlib.h"
+#include "bstrlib_helper.h"
+#include "formula.h"
+
+int global_verbosity = DEBUGLEV_ONLY_ERROR;
+
+typedef struct {
+    char* formula;
+    double result;
+    int err;
+} FormulaTest;
+
+/* Names and values of the slots, N is part of NUM_THREADS and ITER of BYTES_PER_ITER */
+static char* slot_names[] = {"N", "NUM_THREADS", "ITER", "BYTES_PER_ITER", "time", "freq [Hz]", "SIZEOF_INT", "SIZEOF_INT64"};
+static double slot_values[] = {1024, 4, 10, 64, 0.5, 2.0E9, 4, 8};
+
+static FormulaTest formula_tests[] = {
+    // Numbers and operators like the calculator
+    {"10", 10},
+    {".1", 0.1},
+    {"-2", -2},
+    {"1    +    1", 2},
+    {"2^2", 4},
+    {"2^3^2", 512},
+    {"-2^2", 4},
+    {"2^-1", 0.5},
+    {"8%3", 2},
+    {"2--2", 4},
+    {"2*-2", -4},
+    {"1+2*3-4/2", 5},
+    {"(((7)+(8)))", 15},
+    {"1.0E-06*(19)*256.0/2.000000e-06", 2432.0},
+    // Functions
+    {"sum(1,2,3,4,5,6,7,8,9,10)", 55},
+    {"sum(1.1+2.2,3.3+4.4)", 11},
+    {"min(3,1,2)", 1},
+    {"max(1,3,2)", 3},
+    {"avg(1,2,3,4)", 2.5},
+    {"median(1,2,3,4,5,6,7,8,9,10)", 5},
+    {"median(5,1,3)", 3},
+    {"var(1,2,3,4)", 1.25},
+    {"abs(-2.2)", 2.2},
+    {"sqrt(16)+floor(2.7)+ceil(2.2)", 9},
+    // Names
+    {"N/NUM_THREADS", 256},
+    {"ITER*BYTES_PER_ITER", 640},
+    {"1.0E-06*ITER*(N/NUM_THREADS)/time", 0.00512},
+    {"freq [Hz]*time", 1.0E9},
+    {"SIZEOF_INT64*SIZEOF_INT", 32},
+    {"max(N, ITER)", 1024},
+    // Division by zero gives inf or nan like the calculator
+    {"1/0", INFINITY, -EFAULT},
+    {"0.0/0.0", NAN, -EFAULT},
+    {"N%0", INFINITY, -EFAULT},
+    // Invalid formulas
+    {"", NAN, -EINVAL},
+    {"2+", NAN, -EINVAL},
+    {"+2", NAN, -EINVAL},
+    {"()", NAN, -EINVAL},
+    {"(2", NAN, -EINVAL},
+    {"2)", NAN, -EINVAL},
+    {"min()", NAN, -EINVAL},
+    {"abs(2.2,1.1)", NAN, -EINVAL},
+    {"sumi(1,2)", NAN, -EINVAL},
+    {"NN*2", NAN, -EINVAL},
+    {"N_PER_ITER", NAN, -EINVAL},
+    {NULL, 0.0}, // do not remove
+};
+
+static int _same(double a, double b)
+{
+    if (isnan(a) || isnan(b))
+    {
+        return isnan(a) && isnan(b);
+    }
+    if (isinf(a) || isinf(b))
+    {
+        return a == b;
+    }
+    return fabs(a - b) <= 1E-12 * fmax(1.0, fabs(b));
+}
+
+int main(int argc, char* argv[])
+{
+    int all = 0;
+    int success = 0;
+    struct bstrList* names = bstrListCreate();
+    for (int i = 0; i < sizeof(slot_names) / sizeof(slot_names[0]); i++)
+    {
+        bstrListAddChar(names, slot_names[i]);
+    }
+
+    for (FormulaTest* cur = &formula_tests[0]; cur->formula; cur++)
+    {
+        Formula f;
+        double result = NAN;
+        bstring bformula = bfromcstr(cur->formula);
+        int err = formula_compile(bformula, names, &f);
+        if (err == 0)
+        {
+            err = formula_eval(&f, slot_values, &result);
+            formula_free(&f);
+        }
+        bdestroy(bformula);
+        all++;
+        if (err != cur->err || (err != -EINVAL && !_same(result, cur->result)))
+        {
+            printf("Wrong result for '%s'. Reference %.15g (%d). Result %.15g (%d)\n", cur->formula, cur->result, cur->err, result, err);
+        }
+        else
+        {
+            success++;
+        }
+    }
+
+    /* The program is evaluated again with other slot values */
+    Formula f;
+    struct tagbstring bformula = bsStatic("ITER*BYTES_PER_ITER/time");
+    double values[] = {1024, 4, 20, 64, 0.25, 2.0E9, 4, 8};
+    double result = NAN;
+    all++;
+    if (formula_compile(&bformula, names, &f) == 0 && formula_eval(&f, slot_values, &result) == 0 && result == 1280.0 &&
+        formula_eval(&f, values, &result) == 0 && result == 5120.0)
+    {
+        success++;
+    }
+    else
+    {
+        printf("Wrong result for '%s' with other slot values\n", bdata(&bformula));
+    }
+    formula_free(&f);
+    bstrListDestroy(names);
+
+    printf("All\tSuccess\tFail\n");
+    printf("%d\t%d\t%d\n", all, success, all - success);
+    return (all != success);
+}
@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "error.h"
+#include "bstrlib.h"
+#include "bstrlib_helper.h"
+#include "instrbatch.h"
+
+int global_verbosity = DEBUGLEV_ONLY_ERROR;
+
+#define SEPARATOR "---------------------------------------\n"
+
+static struct tagbstring spec = bsStatic("# integer forms\nadd r64, r64\n\nimul\tr64, r64 \nvaddpd ymm, ymm, ymm | avx\nvfmadd231pd xmm, xmm, m128 | fma avx\n");
+static struct tagbstring cpuinfo_x86 = bsStatic("processor\t: 0\nmodel name\t: Test CPU\nflags\t\t: fpu sse2 avx fma\n\nprocessor\t: 1\nflags\t\t: fpu\n");
+static struct tagbstring cpuinfo_arm = bsStatic("processor\t: 0\nFeatures\t: fp asimd sve\n");
+static struct tagbstring cpuinfo_none = bsStatic("processor\t: 0\nmodel name\t: Test CPU\n");
+
+static int run_parse_tests()
+{
+    int failed = 0;
+    InstrForm* forms = NULL;
+    printf(SEPARATOR);
+    printf("Running parser tests\n");
+    int num_forms = instrbatch_parse(&spec, &forms, NULL);
+    failed += (num_forms != 4);
+    if (num_forms == 4)
+    {
+        failed += (strcmp(bdata(forms[0].mnemonic), "add") != 0 || forms[0].operands->qty != 2 || forms[0].flags->qty != 0);
+        failed += (strcmp(bdata(forms[1].mnemonic), "imul") != 0 || forms[1].operands->qty != 2);
+        failed += (strcmp(bdata(forms[2].mnemonic), "vaddpd") != 0 || forms[2].operands->qty != 3);
+        failed += (forms[2].flags->qty != 1 || strcmp(bdata(forms[2].flags->entry[0]), "avx") != 0);
+        failed += (forms[3].flags->qty != 2 || strcmp(bdata(forms[3].operands->entry[2]), "m128") != 0);
+        bstring operands = instrbatch_operands(&forms[2]);
+        failed += (strcmp(bdata(operands), "ymm ymm ymm") != 0);
+        bdestroy(operands);
+    }
+    instrbatch_free(num_forms, forms);
+    printf("Valid forms: %s\n", failed ? "FAIL" : "PASS");
+    return (failed > 0);
+}
+
+static int run_invalid_tests()
+{
+    int failed = 0;
+    const char* invalid[] = {
+        "add r64, r64\nnop\n",
+        "add r64, r64\n\nadd r64,, r64\n",
+        "op r64, r64, r64, r64, r64, r64\n",
+        "add r64, r64,\n",
+    };
+    int lines[] = {2, 3, 1, 1};
+    printf(SEPARATOR);
+    printf("Running invalid form tests\n");
+    for (int i = 0; i < 4; i++)
+    {
+        InstrForm* forms = NULL;
+        int errline = 0;
+        struct tagbstring bspec;
+        btfromcstr(bspec, invalid[i]);
+        int err = instrbatch_parse(&bspec, &forms, &errline);
+        if (err != -EINVAL || errline != lines[i])
+        {
+            printf("Unexpected result for form %d (expected -EINVAL in line %d, got %d in line %d)\n", i, lines[i], err, errline);
+            failed++;
+        }
+        if (err > 0)
+        {
+            instrbatch_free(err, forms);
+        }
+    }
+    printf("Invalid forms: %s\n", failed ? "FAIL" : "PASS");
+    return (failed > 0);
+}
+
+static int run_flag_tests()
+{
+    int failed = 0;
+    InstrForm* forms = NULL;
+    struct bstrList* flags = NULL;
+    printf(SEPARATOR);
+    printf("Running CPU flag tests\n");
+    int num_forms = instrbatch_parse(&spec, &forms, NULL);
+    failed += (instrbatch_cpu_flags(&cpuinfo_x86, &flags) != 0);
+    if (flags)
+    {
+        /* Only the flags of the first processor count */
+        failed += (flags->qty != 4);
+        failed += (num_forms != 4);
+        for (int f = 0; f < num_forms; f++)
+        {
+            failed += (instrbatch_missing_flag(&forms[f], flags) != NULL);
+        }
+        bstrListDestroy(flags);
+        flags = NULL;
+    }
+    failed += (instrbatch_cpu_flags(&cpuinfo_arm, &flags) != 0);
+    if (flags)
+    {
+        bstring missing = (num_forms == 4 ? instrbatch_missing_flag(&forms[3], flags) : NULL);
+        failed += (!missing || strcmp(bdata(missing), "fma") != 0);
+        failed += (num_forms == 4 && instrbatch_missing_flag(&forms[0], flags) != NULL);
+        bstrListDestroy(flags);
+        flags = NULL;
+    }
+    failed += (instrbatch_cpu_flags(&cpuinfo_none, &flags) != -ENOENT || flags != NULL);
+    /* Without known flags only forms without flags run */
+    failed += (num_forms == 4 && instrbatch_missing_flag(&forms[0], NULL) != NULL);
+    failed += (num_forms == 4 && instrbatch_missing_flag(&forms[2], NULL) == NULL);
+    instrbatch_free(num_forms, forms);
+    printf("CPU flags: %s\n", failed ? "FAIL" : "PASS");
+    return (failed > 0);
+}
+
+static int run_dependency_tests()
+{
+    int failed = 0;
+    InstrForm* forms = NULL;
+    struct tagbstring bspec = bsStatic("add r64, r64\nvaddpd ymm, ymm, ymm\nmovq xmm, r64\nvcvtsi2sd xmm, xmm, r64\nnot r64 | rmw\nvmovapd ymm, m256 | avx\nvpinsrq xmm, r64, xmm, imm\n");
+    printf(SEPARATOR);
+    printf("Running dependency tests\n");
+    int num_forms = instrbatch_parse(&bspec, &forms, NULL);
+    /* Pure writes of the destination have no dependency */
+    int expected[] = {2, 2, 0, 2, 1, 0, 3};
+    failed += (num_forms != 7);
+    /* The rmw marker is no CPU flag */
+    failed += (num_forms == 7 && (forms[4].flags->qty != 0 || !forms[4].rmw || forms[5].rmw || forms[5].flags->qty != 1));
+    for (int f = 0; f < num_forms && f < 7; f++)
+    {
+        if (instrbatch_dependency(&forms[f]) != expected[f])
+        {
+            printf("Unexpected dependency %d for %s (expected %d)\n", instrbatch_dependency(&forms[f]), bdata(forms[f].mnemonic), expected[f]);
+            failed++;
+        }
+    }
+    instrbatch_free(num_forms, forms);
+    printf("Dependencies: %s\n", failed ? "FAIL" : "PASS");
+    return (failed > 0);
+}
+
+int main()
+{
+    int fail_count = 0;
+    fail_count += run_parse_tests();
+    fail_count += run_invalid_tests();
+    fail_count += run_flag_tests();
+    fail_count += run_dependency_tests();
+    return (fail_count > 0 ? 1 : 0);
+}
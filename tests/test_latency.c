@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include "error.h"
+#include "bstrlib.h"
+#include "fill.h"
+#include "latency.h"
+#include "table.h"
+
+int global_verbosity = DEBUGLEV_ONLY_ERROR;
+
+#define SEPARATOR "---------------------------------------\n"
+#define TEST_NODES 512
+#define TEST_SAMPLES 10000
+
+typedef struct {
+    double ns;
+    int bucket;
+    char* name;
+} TestBucket;
+
+static TestBucket bucket_tests[] = {
+    {0.0, 0, "<1 ns [%]"},
+    {0.99, 0, "<1 ns [%]"},
+    {1.0, 1, "1-2 ns [%]"},
+    {3.5, 2, "2-4 ns [%]"},
+    {100.0, 7, "64-128 ns [%]"},
+    {1023.0, 10, "512-1024 ns [%]"},
+    {1024.0, 11, ">1024 ns [%]"},
+    {1.0e9, 11, ">1024 ns [%]"},
+};
+
+static int run_bucket_tests(TestBucket* tests, int num_tests)
+{
+    int fail_count = 0;
+    printf(SEPARATOR);
+    printf("Running latency bucket tests\n");
+    for (int i = 0; i < num_tests; i++)
+    {
+        int bucket = latency_bucket(tests[i].ns);
+        bstring bname = latency_bucket_name(bucket);
+        int failed = (bucket != tests[i].bucket || (!bname) || strcmp(bdata(bname), tests[i].name) != 0);
+        if (failed)
+        {
+            printf("\t%.2f ns: expected %d (%s), actual %d (%s)\n", tests[i].ns, tests[i].bucket, tests[i].name,
+                   bucket, (bname ? bdata(bname) : "none"));
+        }
+        printf("Test %2d: %s\n", i + 1, failed ? "FAIL" : "PASS");
+        fail_count += failed;
+        bdestroy(bname);
+    }
+    int failed = (latency_bucket_name(-1) != NULL || latency_bucket_name(LATENCY_HIST_BUCKETS) != NULL);
+    printf("Invalid buckets: %s\n", failed ? "FAIL" : "PASS");
+    fail_count += failed;
+    return fail_count;
+}
+
+static int run_histogram_tests()
+{
+    int fail_count = 0;
+    size_t count = TEST_NODES * CHASE_NODE_BYTES / sizeof(int64_t);
+    int64_t* ptr = NULL;
+    uint64_t hist[LATENCY_HIST_BUCKETS];
+    printf(SEPARATOR);
+    printf("Running latency histogram tests\n");
+
+    int failed = (posix_memalign((void**)&ptr, CHASE_NODE_BYTES, count * sizeof(int64_t)) != 0);
+    if (!failed)
+    {
+        failed += (fill_chase(ptr, count, CHASE_ORDER_RANDOM, 1) != 0);
+        memset(hist, 0, sizeof(hist));
+        failed += (latency_histogram(ptr, TEST_SAMPLES, hist) != 0);
+        uint64_t total = 0;
+        for (int b = 0; b < LATENCY_HIST_BUCKETS; b++)
+        {
+            total += hist[b];
+        }
+        failed += (total != TEST_SAMPLES);
+        /* The 32 kB cycle stays in the caches, most accesses take far less than a microsecond */
+        failed += (hist[LATENCY_HIST_BUCKETS - 1] > TEST_SAMPLES / 2);
+        free(ptr);
+    }
+    printf("Histogram of a cached cycle: %s\n", failed ? "FAIL" : "PASS");
+    fail_count += (failed > 0);
+
+    failed = (latency_histogram(NULL, TEST_SAMPLES, hist) != -EINVAL);
+    failed += (latency_thread(NULL) != -EINVAL);
+    failed += (latency_table(NULL, NULL) != -EINVAL);
+    printf("Invalid histograms: %s\n", failed ? "FAIL" : "PASS");
+    fail_count += (failed > 0);
+    return fail_count;
+}
+
+int main()
+{
+    int fail_count = 0;
+    fail_count += run_bucket_tests(bucket_tests, sizeof(bucket_tests)/sizeof(TestBucket));
+    fail_count += run_histogram_tests();
+    return (fail_count > 0 ? 1 : 0);
+}
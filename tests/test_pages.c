@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "error.h"
+#include "bstrlib.h"
+#include "pages.h"
+
+int global_verbosity = DEBUGLEV_ONLY_ERROR;
+
+#define SEPARATOR "---------------------------------------\n"
+#define TEST_SIZE (8 * 1024 * 1024 + 123)
+
+typedef struct {
+    char* str;
+    int expected_error;
+    StreamAllocation allocation;
+    char* path;
+} TestParseAllocation;
+
+static TestParseAllocation parse_tests[] = {
+    {"heap", 0, STREAM_ALLOCATION_HEAP, ""},
+    {"THP", 0, STREAM_ALLOCATION_THP, ""},
+    {" nothp ", 0, STREAM_ALLOCATION_NOTHP, ""},
+    {"hugetlb2m", 0, STREAM_ALLOCATION_HUGETLB_2M, ""},
+    {"hugetlb1g", 0, STREAM_ALLOCATION_HUGETLB_1G, ""},
+    {"hugetlbfs", 0, STREAM_ALLOCATION_HUGETLBFS, ""},
+    {"hugetlbfs:/dev/hugepages", 0, STREAM_ALLOCATION_HUGETLBFS, "/dev/hugepages"},
+    {"hugetlbfs:", -EINVAL, STREAM_ALLOCATION_HEAP, ""},
+    {"hugetlb", -EINVAL, STREAM_ALLOCATION_HEAP, ""},
+    {"", -EINVAL, STREAM_ALLOCATION_HEAP, ""},
+};
+
+static int run_parse_tests(TestParseAllocation* tests, int num_tests)
+{
+    int fail_count = 0;
+    printf(SEPARATOR);
+    printf("Running allocation parser tests\n");
+    for (int i = 0; i < num_tests; i++)
+    {
+        StreamAllocation allocation = STREAM_ALLOCATION_HEAP;
+        bstring path = bfromcstr("");
+        bstring bstr = bfromcstr(tests[i].str);
+        int err = parse_allocation(bstr, &allocation, path);
+        int failed = (err != tests[i].expected_error);
+        if (!failed && err == 0)
+        {
+            failed = (allocation != tests[i].allocation || strcmp(bdata(path), tests[i].path) != 0);
+        }
+        if (failed)
+        {
+            printf("\t'%s': expected %d (%s, '%s'), actual %d (%s, '%s')\n", tests[i].str,
+                   tests[i].expected_error, allocation_name(tests[i].allocation), tests[i].path,
+                   err, allocation_name(allocation), bdata(path));
+        }
+        printf("Test %2d: %s\n", i + 1, failed ? "FAIL" : "PASS");
+        fail_count += failed;
+        bdestroy(bstr);
+        bdestroy(path);
+    }
+    return fail_count;
+}
+
+static int run_alloc_tests()
+{
+    int fail_count = 0;
+    size_t pagesize = (size_t)sysconf(_SC_PAGESIZE);
+    StreamAllocation backends[] = {STREAM_ALLOCATION_THP, STREAM_ALLOCATION_NOTHP, STREAM_ALLOCATION_HUGETLB_2M};
+    printf(SEPARATOR);
+    printf("Running page allocation tests\n");
+    for (int i = 0; i < (int)(sizeof(backends)/sizeof(backends[0])); i++)
+    {
+        void* ptr = NULL;
+        size_t alloc_size = 0;
+        size_t obtained = 0;
+        int err = alloc_pages(TEST_SIZE, backends[i], NULL, &ptr, &alloc_size);
+        if (err == -ENOMEM && backends[i] == STREAM_ALLOCATION_HUGETLB_2M)
+        {
+            printf("No huge pages reserved, skipping %s\n", allocation_name(backends[i]));
+            continue;
+        }
+        int failed = (err != 0 || (!ptr) || alloc_size < TEST_SIZE || alloc_size % pagesize != 0);
+        if (!failed)
+        {
+            memset(ptr, 1, TEST_SIZE);
+            err = query_pagesize(ptr, TEST_SIZE, &obtained);
+            failed = (err != 0 || obtained < pagesize);
+            /* Huge pages are not guaranteed for THP, but excluding them is */
+            if (backends[i] == STREAM_ALLOCATION_NOTHP && obtained != pagesize)
+            {
+                failed = 1;
+            }
+            if (backends[i] == STREAM_ALLOCATION_HUGETLB_2M && obtained != 2 * 1024 * 1024)
+            {
+                failed = 1;
+            }
+            free_pages(ptr, alloc_size);
+        }
+        printf("Allocation with %s (page size %zu): %s\n", allocation_name(backends[i]), obtained, failed ? "FAIL" : "PASS");
+        fail_count += failed;
+    }
+
+    /* Regular heap memory is found in smaps, memory that is not mapped is not */
+    size_t obtained = 0;
+    char* heap = malloc(TEST_SIZE);
+    int failed = (!heap);
+    if (heap)
+    {
+        memset(heap, 1, TEST_SIZE);
+        failed = (query_pagesize(heap, TEST_SIZE, &obtained) != 0 || obtained < pagesize);
+        free(heap);
+    }
+    failed += (query_pagesize(NULL, TEST_SIZE, &obtained) != -EINVAL);
+    printf("Page size queries: %s\n", failed ? "FAIL" : "PASS");
+    fail_count += (failed > 0);
+    return fail_count;
+}
+
+int main()
+{
+    int fail_count = 0;
+    fail_count += run_parse_tests(parse_tests, sizeof(parse_tests)/sizeof(TestParseAllocation));
+    fail_count += run_alloc_tests();
+    return (fail_count > 0 ? 1 : 0);
+}
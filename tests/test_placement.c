@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "error.h"
+#include "bstrlib.h"
+#include "placement.h"
+
+int global_verbosity = DEBUGLEV_ONLY_ERROR;
+
+#define SEPARATOR "---------------------------------------\n"
+#define TEST_PAGES 64
+
+typedef struct {
+    char* str;
+    int expected_error;
+    StreamPlacement placement;
+    int node;
+} TestParsePlacement;
+
+static TestParsePlacement parse_tests[] = {
+    {"default", 0, STREAM_PLACEMENT_DEFAULT, -1},
+    {"local", 0, STREAM_PLACEMENT_LOCAL, -1},
+    {"Interleave", 0, STREAM_PLACEMENT_INTERLEAVE, -1},
+    {" firsttouch ", 0, STREAM_PLACEMENT_FIRSTTOUCH, -1},
+    {"bind:0", 0, STREAM_PLACEMENT_BIND, 0},
+    {"bind:12", 0, STREAM_PLACEMENT_BIND, 12},
+    {"bind", -EINVAL, STREAM_PLACEMENT_DEFAULT, -1},
+    {"bind:", -EINVAL, STREAM_PLACEMENT_DEFAULT, -1},
+    {"bind:1x", -EINVAL, STREAM_PLACEMENT_DEFAULT, -1},
+    {"bind:-1", -EINVAL, STREAM_PLACEMENT_DEFAULT, -1},
+    {"bind:100000", -EINVAL, STREAM_PLACEMENT_DEFAULT, -1},
+    {"numa", -EINVAL, STREAM_PLACEMENT_DEFAULT, -1},
+    {"", -EINVAL, STREAM_PLACEMENT_DEFAULT, -1},
+};
+
+static int run_parse_tests(TestParsePlacement* tests, int num_tests)
+{
+    int fail_count = 0;
+    printf(SEPARATOR);
+    printf("Running placement parser tests\n");
+    for (int i = 0; i < num_tests; i++)
+    {
+        StreamPlacement placement = STREAM_PLACEMENT_DEFAULT;
+        int node = -1;
+        bstring bstr = bfromcstr(tests[i].str);
+        int err = parse_placement(bstr, &placement, &node);
+        int failed = (err != tests[i].expected_error);
+        if (!failed && err == 0)
+        {
+            failed = (placement != tests[i].placement || node != tests[i].node);
+        }
+        if (failed)
+        {
+            printf("\t'%s': expected %d (%s, %d), actual %d (%s, %d)\n", tests[i].str,
+                   tests[i].expected_error, placement_name(tests[i].placement), tests[i].node,
+                   err, placement_name(placement), node);
+        }
+        printf("Test %2d: %s\n", i + 1, failed ? "FAIL" : "PASS");
+        fail_count += failed;
+        bdestroy(bstr);
+    }
+    return fail_count;
+}
+
+static int run_apply_tests()
+{
+    int fail_count = 0;
+    size_t pagesize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t size = TEST_PAGES * pagesize;
+    int max_node = placement_max_node();
+    int nodes[1] = {0};
+    printf(SEPARATOR);
+    printf("Running placement apply tests\n");
+    size_t* pages_per_node = malloc((max_node + 1) * sizeof(size_t));
+    char* ptr = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if ((!pages_per_node) || ptr == MAP_FAILED)
+    {
+        printf("Cannot allocate test buffers\n");
+        free(pages_per_node);
+        return 1;
+    }
+
+    /* Policies without memory policy are always fine */
+    fail_count += (apply_placement(ptr, size, STREAM_PLACEMENT_DEFAULT, -1, NULL, 0) != 0);
+    fail_count += (apply_placement(ptr, size, STREAM_PLACEMENT_FIRSTTOUCH, -1, NULL, 0) != 0);
+    /* Local and interleave need the nodes of the workgroup */
+    fail_count += (apply_placement(ptr, size, STREAM_PLACEMENT_LOCAL, -1, NULL, 0) != -EINVAL);
+    fail_count += (apply_placement(ptr, size, STREAM_PLACEMENT_BIND, -1, NULL, 0) != -EINVAL);
+    fail_count += (apply_placement(NULL, size, STREAM_PLACEMENT_BIND, 0, NULL, 0) != -EINVAL);
+    printf("Argument checks: %s\n", fail_count ? "FAIL" : "PASS");
+
+    int err = apply_placement(ptr, size, STREAM_PLACEMENT_BIND, 0, NULL, 0);
+    if (err == -ENOSYS || err == -EPERM)
+    {
+        printf("mbind not available (%s), skipping page placement checks\n", strerror(-err));
+    }
+    else if (err != 0)
+    {
+        printf("Bind to node 0 failed: %s\n", strerror(-err));
+        fail_count++;
+    }
+    else
+    {
+        size_t unmapped = 0;
+        /* Nothing touched yet, so all pages are unmapped */
+        err = query_placement(ptr, size, max_node, pages_per_node, &unmapped);
+        int failed = (err != 0 || unmapped != TEST_PAGES);
+        printf("Query untouched pages: %s\n", failed ? "FAIL" : "PASS");
+        fail_count += failed;
+
+        memset(ptr, 1, size);
+        err = query_placement(ptr, size, max_node, pages_per_node, &unmapped);
+        failed = (err != 0 || unmapped != 0 || pages_per_node[0] != TEST_PAGES);
+        printf("Query pages bound to node 0: %s\n", failed ? "FAIL" : "PASS");
+        fail_count += failed;
+
+        err = apply_placement(ptr + 1, size - 2, STREAM_PLACEMENT_INTERLEAVE, -1, nodes, 1);
+        failed = (err != 0);
+        printf("Interleave unaligned range: %s\n", failed ? "FAIL" : "PASS");
+        fail_count += failed;
+    }
+    munmap(ptr, size);
+    free(pages_per_node);
+    return fail_count;
+}
+
+int main()
+{
+    int fail_count = 0;
+    fail_count += run_parse_tests(parse_tests, sizeof(parse_tests)/sizeof(TestParsePlacement));
+    fail_count += run_apply_tests();
+    return (fail_count > 0 ? 1 : 0);
+}
@@ -12,12 +12,251 @@
 
 int global_verbosity = DEBUGLEV_DEVELOP;
 
+static int _count_lines(struct bstrList* code, const char* line)
+{
+    int count = 0;
+    for (int i = 0; i < code->qty; i++)
+    {
+        if (biseqcstr(code->entry[i], line)) count++;
+    }
+    return count;
+}
+
+/* The PREFETCH block adds one prefetch per cache line of an iteration to the first line of the loop */
+static int run_prefetch_tests(TestConfig_t tcfg)
+{
+    int failed = 0;
+    TestConfigParameter param;
+    memset(&param, 0, sizeof(TestConfigParameter));
+    param.name = bfromcstr("PF_DIST");
+    param.defvalue = bfromcstr("2");
+    tcfg->params = &param;
+    tcfg->num_params = 1;
+    bstring code = tcfg->code;
+
+    // int stream, 32 elements of 4 bytes per iteration are two cache lines
+    tcfg->code = bfromcstr("PREFETCH(pf, STR0, PF_DIST, t0)\nLOOP(loop, rax=0, <, rdi=N, 32)\nmovss xmm0, [STR0 + rax * 4]\nLOOPEND(loop)\nPREFETCHEND(pf)\n");
+    struct bstrList* out = bstrListCreate();
+    struct bstrList* regs = bstrListCreate();
+    failed += (prepare_ptt(tcfg, out, regs) != 0);
+#if defined(__x86_64) || defined(__x86_64__) || defined(__i386__)
+    // Distance in iterations, the default of the parameter
+    failed += (_count_lines(out, "prefetcht0 [STR0 + rax * 4 + 256]") != 1);
+    failed += (_count_lines(out, "prefetcht0 [STR0 + rax * 4 + 320]") != 1);
+    failed += (_count_lines(out, "# PREFETCHEND(pf)") != 1);
+    // The prefetches follow the loop label
+    for (int i = 0; i < out->qty; i++)
+    {
+        if (biseqcstr(out->entry[i], "loop:"))
+        {
+            failed += (i+1 >= out->qty || !biseqcstr(out->entry[i+1], "prefetcht0 [STR0 + rax * 4 + 256]"));
+        }
+    }
+#endif
+    bstrListDestroy(out);
+    bstrListDestroy(regs);
+
+    // The value from the command line overrides the default, the distance is given in cache lines
+    param.value = bfromcstr("3");
+    bdestroy(tcfg->code);
+    tcfg->code = bfromcstr("PREFETCH(pf, STR0, PF_DIST lines, nta)\nLOOP(loop, rax=0, <, rdi=N, 8)\nmovss xmm0, [STR0 + rax * 4]\nLOOPEND(loop)\nPREFETCHEND(pf)\n");
+    out = bstrListCreate();
+    regs = bstrListCreate();
+    failed += (prepare_ptt(tcfg, out, regs) != 0);
+#if defined(__x86_64) || defined(__x86_64__) || defined(__i386__)
+    failed += (_count_lines(out, "prefetchnta [STR0 + rax * 4 + 192]") != 1);
+#endif
+    bstrListDestroy(out);
+    bstrListDestroy(regs);
+
+    // Unknown streams, hints and distances fail
+    const char* invalid[] = {
+        "PREFETCH(pf, STR9, 2, t0)\nLOOP(loop, rax=0, <, rdi=N, 8)\nLOOPEND(loop)\nPREFETCHEND(pf)\n",
+        "PREFETCH(pf, STR0, 2, t9)\nLOOP(loop, rax=0, <, rdi=N, 8)\nLOOPEND(loop)\nPREFETCHEND(pf)\n",
+        "PREFETCH(pf, STR0, UNKNOWN, t0)\nLOOP(loop, rax=0, <, rdi=N, 8)\nLOOPEND(loop)\nPREFETCHEND(pf)\n",
+        "PREFETCH(pf, STR0, 2 bytes, t0)\nLOOP(loop, rax=0, <, rdi=N, 8)\nLOOPEND(loop)\nPREFETCHEND(pf)\n",
+        "PREFETCH(pf, STR0, 2, t0)\nmovss xmm0, [STR0]\nPREFETCHEND(pf)\n",
+        NULL
+    };
+    for (int i = 0; invalid[i] != NULL; i++)
+    {
+        bdestroy(tcfg->code);
+        tcfg->code = bfromcstr(invalid[i]);
+        out = bstrListCreate();
+        regs = bstrListCreate();
+        failed += (prepare_ptt(tcfg, out, regs) == 0);
+        bstrListDestroy(out);
+        bstrListDestroy(regs);
+    }
+
+    bdestroy(tcfg->code);
+    tcfg->code = code;
+    tcfg->params = NULL;
+    tcfg->num_params = 0;
+    bdestroy(param.name);
+    bdestroy(param.defvalue);
+    bdestroy(param.value);
+    printf("PREFETCH keyword: %s\n", failed ? "FAIL" : "PASS");
+    return (failed > 0);
+}
+
+/* UNROLL copies the loop body with renamed vector registers and displaced memory operands */
+static int run_unroll_tests(TestConfig_t tcfg)
+{
+    int failed = 0;
+    bstring code = tcfg->code;
+
+    // ymm15 is used before the loop and keeps its name, STR0 has int elements
+    tcfg->code = bfromcstr("vbroadcastss ymm15, [rip + SCALAR]\nUNROLL(u, 3)\nLOOP(loop, rax=0, <, rdi=N, 8)\nvmulps ymm2, ymm15, [STR0 + rax * 4]\nvmovaps [STR0 + rax * 4 + 32], ymm2\nvmovaps [STR0 + rax * 4 + OFF], ymm2\nLOOPEND(loop)\nUNROLLEND(u)\n");
+    struct bstrList* out = bstrListCreate();
+    struct bstrList* regs = bstrListCreate();
+    failed += (prepare_ptt(tcfg, out, regs) != 0);
+#if defined(__x86_64) || defined(__x86_64__)
+    failed += (_count_lines(out, "vmulps ymm2, ymm15, [STR0 + rax * 4]") != 1);
+    failed += (_count_lines(out, "vmovaps [STR0 + rax * 4 + 32], ymm2") != 1);
+    failed += (_count_lines(out, "vmulps ymm0, ymm15, [STR0 + rax * 4 + 32]") != 1);
+    failed += (_count_lines(out, "vmovaps [STR0 + rax * 4 + 64], ymm0") != 1);
+    failed += (_count_lines(out, "vmovaps [STR0 + rax * 4 + OFF + 32], ymm0") != 1);
+    failed += (_count_lines(out, "vmulps ymm1, ymm15, [STR0 + rax * 4 + 64]") != 1);
+    failed += (_count_lines(out, "vmovaps [STR0 + rax * 4 + 96], ymm1") != 1);
+    // The loop step covers all copies
+    failed += (_count_lines(out, "add rax, 24") != 1);
+#endif
+    bstrListDestroy(out);
+    bstrListDestroy(regs);
+
+    // UNROLL outside of PREFETCH, the prefetches are added for the unrolled loop step
+    bdestroy(tcfg->code);
+    tcfg->code = bfromcstr("UNROLL(u, 2)\nPREFETCH(pf, STR0, 1, t0)\nLOOP(loop, rax=0, <, rdi=N, 16)\nmovaps xmm0, [STR0 + rax * 4]\nLOOPEND(loop)\nPREFETCHEND(pf)\nUNROLLEND(u)\n");
+    out = bstrListCreate();
+    regs = bstrListCreate();
+    failed += (prepare_ptt(tcfg, out, regs) != 0);
+#if defined(__x86_64) || defined(__x86_64__)
+    failed += (_count_lines(out, "prefetcht0 [STR0 + rax * 4 + 128]") != 1);
+    failed += (_count_lines(out, "prefetcht0 [STR0 + rax * 4 + 192]") != 1);
+    failed += (_count_lines(out, "movaps xmm1, [STR0 + rax * 4 + 64]") != 1);
+#endif
+    bstrListDestroy(out);
+    bstrListDestroy(regs);
+
+    // Invalid factors and blocks without a loop fail
+    const char* invalid[] = {
+        "UNROLL(u, 0)\nLOOP(loop, rax=0, <, rdi=N, 8)\nLOOPEND(loop)\nUNROLLEND(u)\n",
+        "UNROLL(u, FACTOR)\nLOOP(loop, rax=0, <, rdi=N, 8)\nLOOPEND(loop)\nUNROLLEND(u)\n",
+        "UNROLL(u, 2)\nmovaps xmm0, [STR0]\nUNROLLEND(u)\n",
+        NULL
+    };
+    for (int i = 0; invalid[i] != NULL; i++)
+    {
+        bdestroy(tcfg->code);
+        tcfg->code = bfromcstr(invalid[i]);
+        out = bstrListCreate();
+        regs = bstrListCreate();
+        failed += (prepare_ptt(tcfg, out, regs) == 0);
+        bstrListDestroy(out);
+        bstrListDestroy(regs);
+    }
+
+    bdestroy(tcfg->code);
+    tcfg->code = code;
+    printf("UNROLL keyword: %s\n", failed ? "FAIL" : "PASS");
+    return (failed > 0);
+}
+
+static int run_chain_tests(TestConfig_t tcfg)
+{
+    int failed = 0;
+    bstring code = tcfg->code;
+
+    // The destination feeds the second operand of the next copy
+    tcfg->code = bfromcstr("BUILD_DEP_CHAIN(c, 2, 3)\nvaddpd ymm, ymm, ymm, none\nBUILD_DEP_CHAINEND(c)\n");
+    struct bstrList* out = bstrListCreate();
+    struct bstrList* regs = bstrListCreate();
+    failed += (prepare_ptt(tcfg, out, regs) != 0);
+#if defined(__x86_64) || defined(__x86_64__)
+    failed += (_count_lines(out, "vaddpd ymm0, ymm0, ymm1") != 3);
+    failed += (_count_lines(out, "vbroadcastsd ymm0, QWORD PTR [rip + SCALAR]") != 1);
+    failed += (_count_lines(out, "vbroadcastsd ymm1, QWORD PTR [rip + SCALAR]") != 1);
+#endif
+    bstrListDestroy(out);
+    bstrListDestroy(regs);
+
+    // A read-modify-write destination with a memory source, the 64 bit name reserves the register
+    bdestroy(tcfg->code);
+    tcfg->code = bfromcstr("BUILD_DEP_CHAIN(c, 1, 2)\nimul r32, m32\nBUILD_DEP_CHAINEND(c)\n");
+    out = bstrListCreate();
+    regs = bstrListCreate();
+    failed += (prepare_ptt(tcfg, out, regs) != 0);
+#if defined(__x86_64) || defined(__x86_64__)
+    failed += (_count_lines(out, "imul ebx, DWORD PTR [STR0]") != 2);
+    failed += (_count_lines(out, "# c registers: rbx") != 1);
+    failed += (_count_lines(out, "mov ebx, 1") != 1);
+    failed += (_count_lines(regs, "rbx") != 1);
+#endif
+    bstrListDestroy(out);
+    bstrListDestroy(regs);
+
+    // Independent chains rotate the destinations over the registers left by the sources
+    bdestroy(tcfg->code);
+    tcfg->code = bfromcstr("BUILD_INDEP_CHAIN(c, 20)\nvfmadd231pd ymm, ymm, ymm\nBUILD_INDEP_CHAINEND(c)\n");
+    out = bstrListCreate();
+    regs = bstrListCreate();
+    failed += (prepare_ptt(tcfg, out, regs) != 0);
+#if defined(__x86_64) || defined(__x86_64__)
+    failed += (_count_lines(out, "vfmadd231pd ymm2, ymm0, ymm1") != 2);
+    failed += (_count_lines(out, "vfmadd231pd ymm15, ymm0, ymm1") != 1);
+    failed += (_count_lines(out, "vfmadd231pd ymm0, ymm0, ymm1") != 0);
+    failed += (_count_lines(out, "vbroadcastsd ymm15, QWORD PTR [rip + SCALAR]") != 1);
+#endif
+    bstrListDestroy(out);
+    bstrListDestroy(regs);
+
+    // The registers of a chain in a loop are initialized once before the loop
+    bdestroy(tcfg->code);
+    tcfg->code = bfromcstr("LOOP(loop, rax=0, <, rdi=N, 1)\nBUILD_DEP_CHAIN(c, 1, 2)\nmulps xmm, xmm\nBUILD_DEP_CHAINEND(c)\nLOOPEND(loop)\n");
+    out = bstrListCreate();
+    regs = bstrListCreate();
+    failed += (prepare_ptt(tcfg, out, regs) != 0);
+#if defined(__x86_64) || defined(__x86_64__)
+    failed += (out->qty < 2 || !biseqcstr(out->entry[0], "movaps xmm0, [rip + SSCALAR]"));
+    failed += (out->qty < 2 || !biseqcstr(out->entry[1], "movaps xmm1, [rip + SSCALAR]"));
+    failed += (_count_lines(out, "movaps xmm0, [rip + SSCALAR]") != 1);
+#endif
+    bstrListDestroy(out);
+    bstrListDestroy(regs);
+
+    // Mixed families for the dependency, immediate destinations, unknown classes and invalid blocks fail
+    const char* invalid[] = {
+        "BUILD_DEP_CHAIN(c, 2, 4)\ncvtsi2sd xmm, r64\nBUILD_DEP_CHAINEND(c)\n",
+        "BUILD_DEP_CHAIN(c, 1, 4)\nadd imm, r64\nBUILD_DEP_CHAINEND(c)\n",
+        "BUILD_INDEP_CHAIN(c, 4)\nadd r16, r16\nBUILD_INDEP_CHAINEND(c)\n",
+        "BUILD_INDEP_CHAIN(c, 0)\nadd r64, r64\nBUILD_INDEP_CHAINEND(c)\n",
+        "BUILD_INDEP_CHAIN(c, 4)\nadd r64, r64\nsub r64, r64\nBUILD_INDEP_CHAINEND(c)\n",
+        "BUILD_DEP_CHAIN(c, 4)\nadd r64, r64\nBUILD_DEP_CHAINEND(c)\n",
+        NULL
+    };
+    for (int i = 0; invalid[i] != NULL; i++)
+    {
+        bdestroy(tcfg->code);
+        tcfg->code = bfromcstr(invalid[i]);
+        out = bstrListCreate();
+        regs = bstrListCreate();
+        failed += (prepare_ptt(tcfg, out, regs) == 0);
+        bstrListDestroy(out);
+        bstrListDestroy(regs);
+    }
+
+    bdestroy(tcfg->code);
+    tcfg->code = code;
+    printf("Chain keywords: %s\n", failed ? "FAIL" : "PASS");
+    return (failed > 0);
+}
+
 int main(int argc, char* argv[])
 {
+    int fail_count = 0;
     struct bstrList* out = bstrListCreate();
     struct bstrList* regs = bstrListCreate();
-    RuntimeConfig runcfg;
-    memset(&runcfg, 0, sizeof(RuntimeConfig));
     TestConfig tcfg;
     memset(&tcfg, 0, sizeof(TestConfig));
     static struct tagbstring default_stream_name = bsStatic("STR0");
@@ -34,7 +273,6 @@ int main(int argc, char* argv[])
     tcfg.name = bfromcstr("doubleload");
     tcfg.code = bfromcstr("xor xmm0, xmm0\nLOOP(loop, rax=0, <, rdi=N, UNROLL_FACTOR)\nxor xmm0, xmm0\nDUMMY(myunroll)\nmovsd    xmm0, [STR0 + rax * 8]\nmovsd    xmm1, [STR0 + rax * 8 + 8]\nmovsd    xmm2, [STR0 + rax * 8 + 16]\nmovsd    xmm3, [STR0 + rax * 8 + 24]\nmovsd    xmm4, [STR0 + rax * 8 + 32]\nmovsd    xmm5, [STR0 + rax * 8 + 40]\nmovsd    xmm6, [STR0 + rax * 8 + 48]\nmovsd    xmm7, [STR0 + rax * 8 + 56]\nDUMMYEND(myunroll)\nxor xmm0, xmm0\nLOOPEND(loop)\nxor xmm0, xmm0\nxor xmm0, xmm0\nLOOP(loop2, rax=0, <, rdi=N, UNROLL_FACTOR)\nxor xmm0, xmm0\nDUMMY(myunroll2)\nmovsd    xmm0, [STR0 + rax * 8]\nmovsd    xmm1, [STR0 + rax * 8 + 8]\nmovsd    xmm2, [STR0 + rax * 8 + 16]\nmovsd    xmm3, [STR0 + rax * 8 + 24]\nmovsd    xmm4, [STR0 + rax * 8 + 32]\nmovsd    xmm5, [STR0 + rax * 8 + 40]\nmovsd    xmm6, [STR0 + rax * 8 + 48]\nmovsd    xmm7, [STR0 + rax * 8 + 56]\nDUMMYEND(myunroll2)\nxor xmm0, xmm0\nLOOPEND(loop2)\nxor xmm0, xmm0\n");
     //tcfg.code = bfromcstr("xor xmm0, xmm0\nLOOP(loop, rax=0, <, rdi=N, UNROLL_FACTOR)\nxor xmm0, xmm0\nDUMMY(myunroll)\nmovsd    xmm0, [STR0 + rax * 8]\nmovsd    xmm1, [STR0 + rax * 8 + 8]\nmovsd    xmm2, [STR0 + rax * 8 + 16]\nmovsd    xmm3, [STR0 + rax * 8 + 24]\nmovsd    xmm4, [STR0 + rax * 8 + 32]\nmovsd    xmm5, [STR0 + rax * 8 + 40]\nmovsd    xmm6, [STR0 + rax * 8 + 48]\nmovsd    xmm7, [STR0 + rax * 8 + 56]\nDUMMYEND(myunroll)\nxor xmm0, xmm0\nLOOPEND(loop)\n");
-    runcfg.tcfg = &tcfg;
     prepare_ptt(&tcfg, out, regs);
     printf("Body:\n");
     for (int i = 0; i < out->qty; i++)
@@ -53,6 +291,7 @@ int main(int argc, char* argv[])
     {
         thread.sdata[i].name = tcfg.streams[i].name;
         thread.sdata[i].type = tcfg.streams[i].type;
+        thread.sdata[i].dims = 0;
     }
     thread.tstreams = (RuntimeThreadStreamConfig*)malloc(sizeof(RuntimeThreadStreamConfig) * tcfg.num_streams);
     for (int i = 0; i < thread.num_streams; i++)
@@ -63,12 +302,16 @@ int main(int argc, char* argv[])
     }
     
 
-    generate_code(&runcfg, &thread, out);
+    generate_code(&tcfg, &thread, out);
     printf("Final:\n");
     for (int i = 0; i < out->qty; i++)
     {
         printf("%s\n", bdata(out->entry[i]));
     }
+
+    fail_count += run_prefetch_tests(&tcfg);
+    fail_count += run_unroll_tests(&tcfg);
+    fail_count += run_chain_tests(&tcfg);
     bdestroy(tcfg.code);
     bdestroy(tcfg.name);
     bstrListDestroy(regs);
@@ -76,5 +319,6 @@ int main(int argc, char* argv[])
     free(tcfg.streams);
     free(thread.sdata);
     free(thread.tstreams);
-    return 0;
+    free(thread.args);
+    return (fail_count > 0 ? 1 : 0);
 }
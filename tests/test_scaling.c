@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "error.h"
+#include "bstrlib.h"
+#include "scaling.h"
+#include "table.h"
+
+int global_verbosity = DEBUGLEV_ONLY_ERROR;
+
+#define SEPARATOR "---------------------------------------\n"
+
+typedef struct {
+    char* str;
+    int expected_error;
+    ScalingOrder order;
+} TestParseScaling;
+
+static TestParseScaling parse_tests[] = {
+    {"compact", 0, SCALING_COMPACT},
+    {"Scatter", 0, SCALING_SCATTER},
+    {"none", -EINVAL, SCALING_NONE},
+    {"spread", -EINVAL, SCALING_NONE},
+    {"", -EINVAL, SCALING_NONE},
+};
+
+static int run_parse_tests(TestParseScaling* tests, int num_tests)
+{
+    int fail_count = 0;
+    printf(SEPARATOR);
+    printf("Running scaling parser tests\n");
+    for (int i = 0; i < num_tests; i++)
+    {
+        ScalingOrder order = SCALING_NONE;
+        int err = scaling_parse_order(tests[i].str, &order);
+        int failed = (err != tests[i].expected_error || (err == 0 && order != tests[i].order));
+        if (failed)
+        {
+            printf("\t'%s': expected %d (%s), actual %d (%s)\n", tests[i].str, tests[i].expected_error,
+                   scaling_order_name(tests[i].order), err, scaling_order_name(order));
+        }
+        printf("Test %2d: %s\n", i + 1, failed ? "FAIL" : "PASS");
+        fail_count += failed;
+    }
+    return fail_count;
+}
+
+/*
+ * Two NUMA domains with two cores of two SMT threads each. The hwthreads are numbered like
+ * on most Intel systems, the SMT siblings of the cores 0-3 are the hwthreads 4-7.
+ */
+static int run_scatter_tests()
+{
+    int fail_count = 0;
+    int domains[8] = {0, 0, 1, 1, 0, 0, 1, 1};
+    int cores[8] = {0, 1, 2, 3, 0, 1, 2, 3};
+    int list[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+    int expected[8] = {0, 2, 1, 3, 4, 6, 5, 7};
+    printf(SEPARATOR);
+    printf("Running scatter tests\n");
+
+    int failed = (scaling_scatter(list, domains, cores, 8) != 0);
+    failed += (memcmp(list, expected, sizeof(expected)) != 0);
+    printf("Scatter over domains and cores: %s\n", failed ? "FAIL" : "PASS");
+    fail_count += (failed > 0);
+
+    /* Sibling hwthreads next to each other, the second one of a core comes after all first ones */
+    int smt_domains[8] = {0, 0, 0, 0, 1, 1, 1, 1};
+    int smt_cores[8] = {0, 0, 1, 1, 2, 2, 3, 3};
+    int smt_list[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+    int smt_expected[8] = {0, 4, 2, 6, 1, 5, 3, 7};
+    failed = (scaling_scatter(smt_list, smt_domains, smt_cores, 8) != 0);
+    failed += (memcmp(smt_list, smt_expected, sizeof(smt_expected)) != 0);
+    printf("Scatter with adjacent siblings: %s\n", failed ? "FAIL" : "PASS");
+    fail_count += (failed > 0);
+
+    int compact[4] = {3, 1, 2, 0};
+    int compact_expected[4] = {3, 1, 2, 0};
+    failed = (scaling_order_hwthreads(compact, 4, SCALING_COMPACT) != 0);
+    failed += (memcmp(compact, compact_expected, sizeof(compact_expected)) != 0);
+    failed += (scaling_scatter(NULL, domains, cores, 1) != -EINVAL);
+    printf("Compact and invalid orders: %s\n", failed ? "FAIL" : "PASS");
+    fail_count += (failed > 0);
+    return fail_count;
+}
+
+static int run_saturation_tests()
+{
+    int fail_count = 0;
+    double rising[6] = {10.0, 19.0, 27.0, 33.0, 35.0, 36.0};
+    double flat[3] = {5.0, 5.0, 5.0};
+    double dropping[4] = {10.0, 20.0, 18.0, 17.0};
+    printf(SEPARATOR);
+    printf("Running saturation tests\n");
+
+    int failed = (scaling_saturation(rising, 6, 0.9) != 3);
+    failed += (scaling_saturation(rising, 6, 1.0) != 5);
+    failed += (scaling_saturation(flat, 3, 0.9) != 0);
+    failed += (scaling_saturation(dropping, 4, 0.95) != 1);
+    printf("Saturation points: %s\n", failed ? "FAIL" : "PASS");
+    fail_count += (failed > 0);
+
+    failed = (scaling_saturation(rising, 0, 0.9) != -EINVAL);
+    failed += (scaling_saturation(rising, 6, 0.0) != -EINVAL);
+    failed += (scaling_saturation(rising, 6, 1.5) != -EINVAL);
+    failed += (scaling_saturation(NULL, 6, 0.9) != -EINVAL);
+    printf("Invalid saturation: %s\n", failed ? "FAIL" : "PASS");
+    fail_count += (failed > 0);
+    return fail_count;
+}
+
+static int run_table_tests()
+{
+    int fail_count = 0;
+    Table* table = NULL;
+    struct bstrList* metrics = bstrListCreate();
+    bstring bmetric = bfromcstr("Bandwidth [MByte/s]");
+    bstrListAdd(metrics, bmetric);
+    bdestroy(bmetric);
+    bmetric = bfromcstr("Flops [MFLOP/s]");
+    bstrListAdd(metrics, bmetric);
+    bdestroy(bmetric);
+    int hwthreads[3] = {0, 4, 2};
+    double rates[6] = {100.0, 10.0, 150.0, 20.0, 180.0, 30.0};
+    printf(SEPARATOR);
+    printf("Running scaling table tests\n");
+
+    int failed = (scaling_table(metrics, 3, hwthreads, rates, &table) != 0);
+    if (!failed)
+    {
+        failed += (table->num_cols != 8 || table->rows->qty != 3);
+        failed += (strcmp(bdata(table->headers->entry[2]), "Bandwidth [MByte/s]") != 0);
+        failed += (strcmp(bdata(table->headers->entry[4]), "Bandwidth [MByte/s] efficiency") != 0);
+        failed += (strcmp(bdata(table->headers->entry[6]), "Flops [MFLOP/s] per thread") != 0);
+        struct bstrList* cells = bsplit(table->rows->entry[1], '|');
+        failed += (cells->qty != 8);
+        failed += (cells->qty == 8 && (atoi(bdata(cells->entry[0])) != 2 || atoi(bdata(cells->entry[1])) != 4));
+        failed += (cells->qty == 8 && (atof(bdata(cells->entry[3])) != 75.0 || atof(bdata(cells->entry[4])) != 0.75));
+        failed += (cells->qty == 8 && atof(bdata(cells->entry[7])) != 1.0);
+        bstrListDestroy(cells);
+        table_destroy(table);
+    }
+    printf("Scaling table: %s\n", failed ? "FAIL" : "PASS");
+    fail_count += (failed > 0);
+
+    failed = (scaling_table(metrics, 0, hwthreads, rates, &table) != -EINVAL);
+    failed += (scaling_table(NULL, 3, hwthreads, rates, &table) != -EINVAL);
+    printf("Invalid scaling tables: %s\n", failed ? "FAIL" : "PASS");
+    fail_count += (failed > 0);
+    bstrListDestroy(metrics);
+    return fail_count;
+}
+
+int main()
+{
+    int fail_count = 0;
+    fail_count += run_parse_tests(parse_tests, sizeof(parse_tests)/sizeof(TestParseScaling));
+    fail_count += run_scatter_tests();
+    fail_count += run_saturation_tests();
+    fail_count += run_table_tests();
+    return (fail_count > 0 ? 1 : 0);
+}
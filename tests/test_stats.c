@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+#include "error.h"
+#include "stats.h"
+
+int global_verbosity = DEBUGLEV_ONLY_ERROR;
+
+#define SEPARATOR "---------------------------------------\n"
+#define EPSILON 1E-3
+
+typedef struct {
+    int count;
+    uint64_t samples[10];
+    int expected_error;
+    SampleStats expected;
+} TestStats;
+
+/* Expected values computed with numpy (percentile with linear interpolation) and scipy.stats.t */
+static TestStats stats_tests[] = {
+    {1, {42}, 0, {1, 42.0, 42.0, 42.0, 42.0, 0.0, 42.0, 42.0, 0.0}},
+    {4, {40, 10, 30, 20}, 0, {4, 10.0, 40.0, 25.0, 25.0, 12.910, 11.5, 38.5, 20.543}},
+    {10, {9, 1, 8, 2, 7, 3, 6, 4, 5, 10}, 0, {10, 1.0, 10.0, 5.5, 5.5, 3.028, 1.45, 9.55, 2.166}},
+    {0, {0}, -EINVAL, {0}},
+};
+
+typedef struct {
+    int count;
+    uint64_t starts[4];
+    uint64_t stops[4];
+    int expected_error;
+    OverlapStats expected;
+} TestOverlap;
+
+static TestOverlap overlap_tests[] = {
+    {1, {100}, {250}, 0, {0.0, 0.0, 150.0, 150.0}},
+    {3, {100, 110, 105}, {300, 290, 310}, 0, {10.0, 20.0, 180.0, 210.0}},
+    /* The second thread starts after the first one stopped, so there is no common window */
+    {2, {100, 400}, {300, 600}, 0, {300.0, 300.0, 0.0, 500.0}},
+    {2, {100, 200}, {300, 150}, -EINVAL, {0}},
+    {0, {0}, {0}, -EINVAL, {0}},
+};
+
+typedef struct {
+    const char* name;
+    int count;
+    double values[10];
+    int expected_error;
+    double expected;
+} TestAggregate;
+
+/* Expected values computed with numpy, the median is the lower middle value like in the calculator */
+static TestAggregate aggregate_tests[] = {
+    {"min", 5, {3, 1, 4, 1, 5}, 0, 1.0},
+    {"max", 5, {3, 1, 4, 1, 5}, 0, 5.0},
+    {"sum", 5, {3, 1, 4, 1, 5}, 0, 14.0},
+    {"mean", 4, {40, 10, 30, 20}, 0, 25.0},
+    {"median", 5, {3, 1, 4, 1, 5}, 0, 3.0},
+    {"median", 4, {40, 10, 30, 20}, 0, 20.0},
+    {"median", 10, {7, 7, 7, 1, 7, 7, 2, 7, 7, 7}, 0, 7.0},
+    {"stddev", 4, {40, 10, 30, 20}, 0, 12.910},
+    {"stddev", 1, {42}, 0, 0.0},
+    {"hmean", 3, {1, 2, 4}, 0, 1.714},
+    {"hmean", 2, {0, 4}, 0, 0.0},
+    {"p50", 4, {40, 10, 30, 20}, 0, 25.0},
+    {"p95", 10, {9, 1, 8, 2, 7, 3, 6, 4, 5, 10}, 0, 9.55},
+    {"p5", 10, {9, 1, 8, 2, 7, 3, 6, 4, 5, 10}, 0, 1.45},
+    {"P100", 3, {2, 9, 4}, 0, 9.0},
+    /* Values that are nan are skipped */
+    {"sum", 4, {1, NAN, 2, NAN}, 0, 3.0},
+    {"max", 2, {NAN, NAN}, -EINVAL, 0.0},
+    {"min", 0, {0}, -EINVAL, 0.0},
+    {"p101", 1, {1}, -EINVAL, 0.0},
+    {"p", 1, {1}, -EINVAL, 0.0},
+    {"avg", 1, {1}, -EINVAL, 0.0},
+};
+
+static int _compare(const char* name, double actual, double expected)
+{
+    if (fabs(actual - expected) > EPSILON * (fabs(expected) > 1.0 ? fabs(expected) : 1.0))
+    {
+        printf("\t%s: expected %f, actual %f\n", name, expected, actual);
+        return 1;
+    }
+    return 0;
+}
+
+static int run_stats_tests(TestStats* tests, int num_tests)
+{
+    int fail_count = 0;
+    printf(SEPARATOR);
+    printf("Running sample statistics tests\n");
+    for (int i = 0; i < num_tests; i++)
+    {
+        SampleStats stats;
+        int failed = 0;
+        int err = sample_stats(tests[i].count > 0 ? tests[i].samples : NULL, tests[i].count, &stats);
+        if (err != tests[i].expected_error)
+        {
+            printf("\texpected error %d, actual %d\n", tests[i].expected_error, err);
+            failed = 1;
+        }
+        else if (err == 0)
+        {
+            failed += (stats.count != tests[i].expected.count);
+            failed += _compare("min", stats.min, tests[i].expected.min);
+            failed += _compare("max", stats.max, tests[i].expected.max);
+            failed += _compare("median", stats.median, tests[i].expected.median);
+            failed += _compare("mean", stats.mean, tests[i].expected.mean);
+            failed += _compare("stddev", stats.stddev, tests[i].expected.stddev);
+            failed += _compare("p5", stats.p5, tests[i].expected.p5);
+            failed += _compare("p95", stats.p95, tests[i].expected.p95);
+            failed += _compare("ci", stats.ci, tests[i].expected.ci);
+        }
+        printf("Test %2d: %s\n", i + 1, failed ? "FAIL" : "PASS");
+        fail_count += (failed > 0);
+    }
+    return fail_count;
+}
+
+static int run_relerror_tests()
+{
+    int fail_count = 0;
+    uint64_t samples[10] = {9, 1, 8, 2, 7, 3, 6, 4, 5, 10};
+    double mean = 0.0;
+    double m2 = 0.0;
+    printf(SEPARATOR);
+    printf("Running relative error tests\n");
+    for (int i = 0; i < 10; i++)
+    {
+        double delta = (double)samples[i] - mean;
+        mean += delta / (double)(i + 1);
+        m2 += delta * ((double)samples[i] - mean);
+        double relerror = sample_relerror(i + 1, mean, m2);
+        if (i + 1 < STATS_MIN_SAMPLES && relerror >= 0.0)
+        {
+            printf("Test %2d: FAIL (relative error %f with %d samples)\n", i + 1, relerror, i + 1);
+            fail_count++;
+        }
+    }
+    /* The running sums must agree with the summary of all samples */
+    if (_compare("relerror", sample_relerror(10, mean, m2), 2.166 / 5.5))
+    {
+        fail_count++;
+    }
+    /* Beyond the table, the quantile approaches the normal quantile */
+    fail_count += _compare("t(31)", sample_tquantile(32), 2.040);
+    fail_count += _compare("t(1000)", sample_tquantile(1001), 1.962);
+    printf("Relative error tests: %s\n", fail_count ? "FAIL" : "PASS");
+    return fail_count;
+}
+
+static int run_aggregate_tests(TestAggregate* tests, int num_tests)
+{
+    int fail_count = 0;
+    printf(SEPARATOR);
+    printf("Running aggregation tests\n");
+    for (int i = 0; i < num_tests; i++)
+    {
+        SampleAggregation agg;
+        double result = 0.0;
+        int err = sample_parse_aggregation(tests[i].name, &agg);
+        if (err == 0)
+        {
+            err = sample_aggregate(&agg, tests[i].values, tests[i].count, &result);
+        }
+        int failed = (err != tests[i].expected_error);
+        if (err == 0 && !failed)
+        {
+            failed += _compare(tests[i].name, result, tests[i].expected);
+        }
+        printf("Test %2d: %s\n", i + 1, failed ? "FAIL" : "PASS");
+        fail_count += (failed > 0);
+    }
+    return fail_count;
+}
+
+/* Selection of every rank against the sorted values */
+static int run_select_tests()
+{
+    int fail_count = 0;
+    int count = 1001;
+    double* values = malloc(count * sizeof(double));
+    printf(SEPARATOR);
+    printf("Running selection tests\n");
+    for (int k = 0; k < count; k += 50)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            values[i] = (double)((i * 7919) % count / 4);
+        }
+        double value = sample_select(values, count, k);
+        if (value != (double)(k / 4))
+        {
+            printf("\trank %d: expected %f, actual %f\n", k, (double)(k / 4), value);
+            fail_count++;
+        }
+        for (int i = 0; i < count; i++)
+        {
+            if ((i < k && values[i] > value) || (i > k && values[i] < value))
+            {
+                printf("\trank %d: value %f at %d on the wrong side\n", k, values[i], i);
+                fail_count++;
+                break;
+            }
+        }
+    }
+    free(values);
+    printf("Selection tests: %s\n", fail_count ? "FAIL" : "PASS");
+    return fail_count;
+}
+
+static int run_overlap_tests(TestOverlap* tests, int num_tests)
+{
+    int fail_count = 0;
+    printf(SEPARATOR);
+    printf("Running overlap tests\n");
+    for (int i = 0; i < num_tests; i++)
+    {
+        OverlapStats stats;
+        memset(&stats, 0, sizeof(OverlapStats));
+        int err = sample_overlap(tests[i].starts, tests[i].stops, tests[i].count, &stats);
+        int failed = (err != tests[i].expected_error);
+        if (err == 0 && !failed)
+        {
+            failed += _compare("start_skew", stats.start_skew, tests[i].expected.start_skew);
+            failed += _compare("stop_skew", stats.stop_skew, tests[i].expected.stop_skew);
+            failed += _compare("overlap", stats.overlap, tests[i].expected.overlap);
+            failed += _compare("span", stats.span, tests[i].expected.span);
+        }
+        printf("Test %2d: %s\n", i + 1, failed ? "FAIL" : "PASS");
+        fail_count += (failed > 0);
+    }
+    return fail_count;
+}
+
+int main()
+{
+    int fail_count = 0;
+    fail_count += run_stats_tests(stats_tests, sizeof(stats_tests)/sizeof(TestStats));
+    fail_count += run_relerror_tests();
+    fail_count += run_overlap_tests(overlap_tests, sizeof(overlap_tests)/sizeof(TestOverlap));
+    fail_count += run_aggregate_tests(aggregate_tests, sizeof(aggregate_tests)/sizeof(TestAggregate));
+    fail_count += run_select_tests();
+    return (fail_count > 0 ? 1 : 0);
+}
@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "error.h"
+#include "bstrlib.h"
+#include "sweep.h"
+
+int global_verbosity = DEBUGLEV_ONLY_ERROR;
+
+#define SEPARATOR "---------------------------------------\n"
+
+typedef struct {
+    char* str;
+    int expected_error;
+    char* points;
+} TestSweep;
+
+static TestSweep sweep_tests[] = {
+    {"1000", 1, "1000"},
+    {" 16kB ", 1, "16kB"},
+    {"1,2, 4,8", 4, "1 2 4 8"},
+    {"1kB,2MB", 2, "1kB 2MB"},
+    {"1:16", 5, "1 2 4 8 16"},
+    {"1:20:x2", 5, "1 2 4 8 16"},
+    {"1:10:x1.5", 5, "1 2 3 5 8"},
+    {"1:10:+3", 4, "1 4 7 10"},
+    {"2:9:2", 4, "2 4 6 8"},
+    {"5:5", 1, "5"},
+    {"1kB:4kB", 3, "1000B 2000B 4000B"},
+    {"1KiB:3KiB:1KiB", 3, "1024B 2048B 3072B"},
+    {"0:1", 2, "0 1"},
+    {"", -EINVAL, ""},
+    {"16:1", -EINVAL, ""},
+    {"1:16:x1", -EINVAL, ""},
+    {"1:16:0", -EINVAL, ""},
+    {"1:16:y", -EINVAL, ""},
+    {"1:2:3:4", -EINVAL, ""},
+    {"1,abc", -EINVAL, ""},
+    {"0:100000:+1", -E2BIG, ""},
+};
+
+static int run_sweep_tests(TestSweep* tests, int num_tests)
+{
+    int fail_count = 0;
+    printf(SEPARATOR);
+    printf("Running sweep tests\n");
+    for (int i = 0; i < num_tests; i++)
+    {
+        struct bstrList* points = NULL;
+        bstring bstr = bfromcstr(tests[i].str);
+        int err = sweep_parse(bstr, &points);
+        int failed = (err != tests[i].expected_error);
+        if (!failed && err > 0)
+        {
+            bstring joined = bjoin(points, &(struct tagbstring)bsStatic(" "));
+            failed = (strcmp(bdata(joined), tests[i].points) != 0);
+            if (failed)
+            {
+                printf("\t'%s': expected '%s', actual '%s'\n", tests[i].str, tests[i].points, bdata(joined));
+            }
+            bdestroy(joined);
+        }
+        else if (failed)
+        {
+            printf("\t'%s': expected %d, actual %d\n", tests[i].str, tests[i].expected_error, err);
+        }
+        printf("Test %2d: %s\n", i + 1, failed ? "FAIL" : "PASS");
+        fail_count += failed;
+        if (err > 0)
+        {
+            bstrListDestroy(points);
+        }
+        bdestroy(bstr);
+    }
+    return fail_count;
+}
+
+static int run_largest_tests()
+{
+    int fail_count = 0;
+    struct bstrList* points = NULL;
+    struct tagbstring bsweep = bsStatic("1MB,4kB,2MiB,100");
+    printf(SEPARATOR);
+    printf("Running largest point tests\n");
+    int failed = (sweep_parse(&bsweep, &points) != 4);
+    failed += (!failed && sweep_largest(points) != 2);
+    failed += (sweep_largest(NULL) != -EINVAL);
+    printf("Largest point: %s\n", failed ? "FAIL" : "PASS");
+    fail_count += (failed > 0);
+    if (points)
+    {
+        bstrListDestroy(points);
+    }
+    return fail_count;
+}
+
+int main()
+{
+    int fail_count = 0;
+    fail_count += run_sweep_tests(sweep_tests, sizeof(sweep_tests)/sizeof(TestSweep));
+    fail_count += run_largest_tests();
+    return (fail_count > 0 ? 1 : 0);
+}
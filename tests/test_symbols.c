@@ -0,0 +1,81 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include "error.h"
+#include "bstrlib.h"
+#include "bstrlib_helper.h"
+#include "symbols.h"
+
+int global_verbosity = DEBUGLEV_ONLY_ERROR;
+
+/* More names than the initial table holds, so it grows several times */
+#define NUM_NAMES 300
+
+static int all = 0;
+static int success = 0;
+
+static void _check(int ok, const char* what)
+{
+    all++;
+    if (ok)
+    {
+        success++;
+    }
+    else
+    {
+        printf("Failed: %s\n", what);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    struct tagbstring bnum_threads = bsStatic("NUM_THREADS");
+    struct tagbstring bnum_threads2 = bsStatic("NUM_THREADS");
+    struct tagbstring bn = bsStatic("N");
+    struct tagbstring bmissing = bsStatic("missing");
+
+    _check(symbol_count() == 0, "empty table");
+    _check(symbol_hash(&bnum_threads) == symbol_hash(&bnum_threads2), "same hash for equal names");
+    _check(symbol_hash(&bnum_threads) != symbol_hash(&bn), "other hash for other names");
+
+    int id = symbol_intern(&bnum_threads, symbol_hash(&bnum_threads));
+    _check(id == 0, "first ID is 0");
+    _check(symbol_intern(&bnum_threads2, symbol_hash(&bnum_threads2)) == id, "interning twice gives the same ID");
+    _check(symbol_find(&bnum_threads, symbol_hash(&bnum_threads)) == id, "find interned name");
+    _check(symbol_find(&bmissing, symbol_hash(&bmissing)) == -ENOENT, "find unknown name");
+    _check(symbol_count() == 1, "find does not add names");
+    _check(symbol_intern(&bn, symbol_hash(&bn)) == 1, "IDs count up");
+    _check(symbol_intern(NULL, 0) == -EINVAL, "intern without name");
+
+    int ok = 1;
+    for (int i = 0; i < NUM_NAMES; i++)
+    {
+        bstring name = bformat("STR%d", i);
+        ok = ok && (symbol_intern(name, symbol_hash(name)) == i + 2);
+        bdestroy(name);
+    }
+    _check(ok, "IDs of many names");
+    _check(symbol_count() == NUM_NAMES + 2, "count of many names");
+    ok = 1;
+    for (int i = 0; i < NUM_NAMES; i++)
+    {
+        bstring name = bformat("STR%d", i);
+        ok = ok && (symbol_find(name, symbol_hash(name)) == i + 2) && biseq(symbol_name(i + 2), name);
+        bdestroy(name);
+    }
+    _check(ok, "find and names after growing");
+    _check(biseq(symbol_name(id), &bnum_threads), "name of first ID");
+    _check(symbol_name(NUM_NAMES + 2) == NULL, "name of unknown ID");
+
+    symbol_reset();
+    _check(symbol_count() == 0, "empty after reset");
+    _check(symbol_find(&bnum_threads, symbol_hash(&bnum_threads)) == -ENOENT, "find after reset");
+    _check(symbol_intern(&bn, symbol_hash(&bn)) == 0, "IDs start at 0 after reset");
+    symbol_reset();
+
+    printf("All\tSuccess\tFail\n");
+    printf("%d\t%d\t%d\n", all, success, all - success);
+    return (all != success);
+}
@@ -19,6 +19,7 @@ static struct tagbstring name = bsStatic("Name");
 static struct tagbstring one = bsStatic("1");
 static struct tagbstring two = bsStatic("2");
 static struct tagbstring three = bsStatic("3");
+static struct tagbstring half = bsStatic("0.50");
 
 static const char* fname = "test-sample.csv";
 
@@ -93,11 +94,28 @@ int main(int argc, char* argv)
     }
     table_destroy(table);
 
+    // A column with kept format prints 0.50, not 0.500000
+    Table* kept = NULL;
+    table_create(headers, &kept);
+    table_keep_format(kept, 1);
+    struct bstrList* row5 = bstrListCreate();
+    bstrListAdd(row5, &half);
+    bstrListAdd(row5, &half);
+    table_addrow(kept, row5);
+    table_print(stdout, kept, 0);
+    int failed = (strcmp(bdata(kept->rows->entry[0]), "0.500000|0.50") != 0);
+    if (failed)
+    {
+        printf("Row '%s' does not keep the format of the second column\n", bdata(kept->rows->entry[0]));
+    }
+    table_destroy(kept);
+
     bstrListDestroy(headers);
     bstrListDestroy(row1);
     bstrListDestroy(row2);
     bstrListDestroy(row3);
     bstrListDestroy(row4);
+    bstrListDestroy(row5);
 
-    return 0;
+    return failed;
 }
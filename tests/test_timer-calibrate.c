@@ -0,0 +1,97 @@
+// main
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "error.h"
+#include "timer.h"
+#include "cachedir.h"
+
+int global_verbosity = DEBUGLEV_ONLY_ERROR;
+
+#define ABS(x) (((x) < 0) ? -(x) : (x))
+/* Sources have to agree within their confidence intervals plus this relative tolerance */
+#define TOLERANCE 1e-3
+
+int main()
+{
+    int fail_count = 0;
+    TimerFreqInfo reference;
+    TimerFreqInfo info;
+    char base[] = "/tmp/test_timer_XXXXXX";
+    char file[256];
+    struct stat st;
+    // The state file goes to a fresh cache folder
+    if (!mkdtemp(base))
+    {
+        fprintf(stderr, "Cannot create temporary folder\n");
+        return 1;
+    }
+    setenv("XDG_CACHE_HOME", base, 1);
+    snprintf(file, sizeof(file), "%s/%s/%s", base, CACHEDIR_NAME, TIMER_FREQ_CACHE_NAME);
+    int err = lb_timer_freq_from_source(TIMER_FREQ_SOURCE_REGRESSION, &reference);
+    if (err != 0)
+    {
+        fprintf(stderr, "Regression calibration failed with err %d: %s\n", -err, strerror(-err));
+        rmdir(base);
+        return 0;
+    }
+    printf("Reference (regression): %" PRIu64 " Hz +- %" PRIu64 " Hz\n", reference.freq, reference.ci);
+    if (reference.ci > reference.freq * TOLERANCE)
+    {
+        printf("FAIL: confidence interval of the regression too wide\n");
+        fail_count++;
+    }
+    for (int s = TIMER_FREQ_SOURCE_CACHE; s < MAX_TIMER_FREQ_SOURCE; s++)
+    {
+        err = lb_timer_freq_from_source(s, &info);
+        if (err != 0)
+        {
+            printf("Source %-10s: not available (%s)\n", lb_timer_freq_source_name(s), strerror(-err));
+            continue;
+        }
+        double diff = (double)info.freq - (double)reference.freq;
+        double limit = (double)info.ci + (double)reference.ci + reference.freq * TOLERANCE;
+        printf("Source %-10s: %" PRIu64 " Hz +- %" PRIu64 " Hz, difference %.0f Hz: %s\n", lb_timer_freq_source_name(s), info.freq, info.ci, diff, (ABS(diff) <= limit ? "PASS" : "FAIL"));
+        if (ABS(diff) > limit)
+        {
+            fail_count++;
+        }
+    }
+    err = lb_timer_calibrate(&info);
+    if (err != 0 || info.freq == 0ULL || info.source == TIMER_FREQ_SOURCE_NONE)
+    {
+        printf("FAIL: lb_timer_calibrate returned %d\n", err);
+        fail_count++;
+    }
+    else
+    {
+        printf("Selected %s: %" PRIu64 " Hz +- %" PRIu64 " Hz\n", lb_timer_freq_source_name(info.source), info.freq, info.ci);
+    }
+    // The state file is private to the user and ignored once others can modify it
+    if (access("/proc/sys/kernel/random/boot_id", R_OK) == 0)
+    {
+        if (stat(file, &st) != 0 || (st.st_mode & 0077) != 0 || lb_timer_freq_from_source(TIMER_FREQ_SOURCE_CACHE, &info) != 0)
+        {
+            printf("FAIL: no private state file %s\n", file);
+            fail_count++;
+        }
+        chmod(file, 0666);
+        if (lb_timer_freq_from_source(TIMER_FREQ_SOURCE_CACHE, &info) != -EPERM)
+        {
+            printf("FAIL: state file writable by others is used\n");
+            fail_count++;
+        }
+    }
+    char cmd[512];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", base);
+    if (system(cmd) != 0)
+    {
+        printf("Cannot remove %s\n", base);
+    }
+    return (fail_count > 0 ? 1 : 0);
+}
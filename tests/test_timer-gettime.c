@@ -6,8 +6,11 @@
 #include <unistd.h>
 #include <sys/utsname.h>
 
+#include "error.h"
 #include "timer.h"
 
+int global_verbosity = DEBUGLEV_ONLY_ERROR;
+
 void print_arch_info()
 {
     struct utsname sysinfo;
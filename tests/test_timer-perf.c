@@ -0,0 +1,65 @@
+// main
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "error.h"
+#include "timer.h"
+
+int global_verbosity = DEBUGLEV_ONLY_ERROR;
+
+#define MIN_FREQ 100000000ULL
+#define MAX_FREQ 10000000000ULL
+
+int main()
+{
+    int fail_count = 0;
+    TimerEvents type = TIMER_RDTSC;
+    if (lb_timer_parse_type("perf", &type) != 0 || type != TIMER_PERF_EVENT)
+    {
+        printf("FAIL: cannot parse timer name 'perf'\n");
+        return 1;
+    }
+    if (lb_timer_parse_type("unknown", &type) != -EINVAL)
+    {
+        printf("FAIL: unknown timer name accepted\n");
+        return 1;
+    }
+    if (!lb_timer_has_type(TIMER_PERF_EVENT))
+    {
+        printf("perf_event timer not available, skipping\n");
+        return 0;
+    }
+    for (int r = 0; r < 5; r++)
+    {
+        TimerDataLB timer;
+        uint64_t ns = 0, cycles = 0, freq = 0;
+        int err = lb_timer_init(TIMER_PERF_EVENT, &timer);
+        if (err != 0)
+        {
+            printf("FAIL: timer initialization failed with err %d: %s\n", -err, strerror(-err));
+            return 1;
+        }
+        lb_timer_start(&timer);
+        for (volatile uint64_t i = 0; i < 100000000ULL; i++);
+        lb_timer_stop(&timer);
+        lb_timer_as_ns(&timer, &ns);
+        err = lb_timer_as_cycles(&timer, &cycles);
+        if (err == 0)
+        {
+            err = lb_timer_as_freq(&timer, &freq);
+        }
+        printf("Repetition %d: time %" PRIu64 " ns, core cycles %" PRIu64 ", frequency %" PRIu64 " Hz, mmap page %s\n",
+               r + 1, ns, cycles, freq, (timer.perf[TIMER_PERF_CYCLES].page ? "yes" : "no"));
+        if (err != 0 || cycles == 0 || freq < MIN_FREQ || freq > MAX_FREQ)
+        {
+            printf("FAIL\n");
+            fail_count++;
+        }
+        lb_timer_close(&timer);
+    }
+    return (fail_count > 0 ? 1 : 0);
+}
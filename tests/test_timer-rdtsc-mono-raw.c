@@ -6,8 +6,11 @@
 #include <unistd.h>
 #include <sys/utsname.h>
 
+#include "error.h"
 #include "timer.h"
 
+int global_verbosity = DEBUGLEV_ONLY_ERROR;
+
 #define ABS(x) (((x) < 0) ? -(x) : (x))
 
 void print_arch_info()